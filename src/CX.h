@@ -5,12 +5,21 @@
 
 #include "CX_Clock.h" //Includes CX::Instances::Clock
 #include "CX_TimeUtilities.h"
+#include "CX_TimerScheduler.h"
 
 #include "CX_Display.h" //Includes CX::Instances::Disp
 #include "CX_Draw.h"
+#include "CX_DrawBatch.h"
+#include "CX_FramebufferPool.h"
 #include "CX_SlidePresenter.h"
+#include "CX_SlideQueue.h"
+#include "CX_FrameTelemetry.h"
+#include "CX_FrameCapture.h"
+#include "CX_SimulatedDisplay.h"
 
 #include "CX_InputManager.h" //Includes CX::Instances::Input
+#include "CX_EvdevInput.h"
+#include "CX_InputRecording.h"
 #include "CX_Logger.h" //Includes CX::Instances::Log
 #include "CX_RandomNumberGenerator.h" //Includes CX::Instances::RNG
 
@@ -1,5 +1,10 @@
 #include "CX_Algorithm.h"
 
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <unordered_map>
+
 namespace CX {
 namespace Algo {
 
@@ -9,6 +14,7 @@ namespace Algo {
 
 /*! \brief Construct a LatinSquare with no contents. */
 LatinSquare::LatinSquare(void) :
+	_rows(0),
 	_columns(0)
 {}
 
@@ -25,22 +31,23 @@ LatinSquare::LatinSquare(unsigned int dimensions) {
 /*! \copydoc CX::Algo::LatinSquare::LatinSquare
 \note This deletes any previous contents of the latin square. */
 void LatinSquare::generate(unsigned int dimensions) {
-	square.resize(dimensions);
+	_rows = dimensions;
 	_columns = dimensions;
+	_values.resize(_rows * _columns);
 	for (unsigned int i = 0; i < dimensions; i++) {
-		square[i].resize(dimensions);
 		for (unsigned int j = 0; j < dimensions; j++) {
-			square[i][j] = (i + j) % dimensions;
+			_values[i * _columns + j] = (i + j) % dimensions;
 		}
 	}
 }
 
 /*! Creates a latin square that is balanced in the sense that each condition
-precedes each other condition an equal number of times.
+precedes each other condition an equal number of times (a Williams design).
+This can be checked with validateBalance().
 
 If `dimensions` is even, the number of rows of the latin square will be
 equal to `dimensions`. If `dimensions` is odd, the number of rows will
-be `2 * dimensions`.
+be `2 * dimensions`: the second half of the rows are the first half reversed.
 
 \param dimensions The number of conditions in the experiment.
 
@@ -53,7 +60,9 @@ void LatinSquare::generateBalanced(unsigned int dimensions) {
 		firstHelper.push_back(i);
 	}
 
-	currentRow[0] = 0;
+	if (dimensions > 0) {
+		currentRow[0] = 0;
+	}
 	for (unsigned int i = 1; i < dimensions; i++) {
 		if (i % 2 == 0) {
 			currentRow[i] = firstHelper.back();
@@ -64,75 +73,75 @@ void LatinSquare::generateBalanced(unsigned int dimensions) {
 		}
 	}
 
-	square.resize(dimensions);
+	bool isOdd = (dimensions % 2) == 1;
+
 	_columns = dimensions;
+	_rows = isOdd ? 2 * dimensions : dimensions;
+	_values.resize(_rows * _columns);
 	for (unsigned int i = 0; i < dimensions; i++) {
-		square[i].resize(dimensions);
 		for (unsigned int j = 0; j < dimensions; j++) {
-			square[i][j] = currentRow[j];
+			_values[i * _columns + j] = currentRow[j];
+			if (isOdd) {
+				_values[(i + dimensions) * _columns + (dimensions - 1 - j)] = currentRow[j];
+			}
 
 			currentRow[j] = (currentRow[j] + 1) % dimensions;
 		}
-
-	}
-
-	bool isOdd = (dimensions % 2) == 1;
-	if (isOdd) {
-		LatinSquare ls2 = *this;
-		ls2.reverseColumns();
-		this->appendBelow(ls2);
 	}
 }
 
 /*! This function shifts the columns to the right and the last column is moved
 to be the first column. */
 void LatinSquare::reorderRight(void) {
-	for (size_t i = 0; i < square.size(); i++) {
-		for (size_t j = square[i].size() - 1; j > 0; j--) {
-			std::swap(square[i][j], square[i][j - 1]);
-		}
+	if (_columns == 0) {
+		return;
+	}
+	for (unsigned int i = 0; i < _rows; i++) {
+		std::vector<unsigned int>::iterator rowBegin = _values.begin() + i * _columns;
+		std::rotate(rowBegin, rowBegin + _columns - 1, rowBegin + _columns);
 	}
 }
 
 /*! This function shifts the columns to the left and the first column is moved
 to be the last column. */
 void LatinSquare::reorderLeft(void) {
-	for (size_t i = 0; i < square.size(); i++) {
-		for (size_t j = 0; j < square[i].size() - 1; j++) {
-			std::swap(square[i][j], square[i][j + 1]);
-		}
+	if (_columns == 0) {
+		return;
+	}
+	for (unsigned int i = 0; i < _rows; i++) {
+		std::vector<unsigned int>::iterator rowBegin = _values.begin() + i * _columns;
+		std::rotate(rowBegin, rowBegin + 1, rowBegin + _columns);
 	}
 }
 
 /*! This function moves all of the rows up one place, then moves the topmost row to the bottom. */
 void LatinSquare::reorderUp(void) {
-	for (size_t i = 0; i < square.size() - 1; i++) {
-		std::swap(square[i], square[i + 1]);
+	if (_rows == 0) {
+		return;
 	}
+	std::rotate(_values.begin(), _values.begin() + _columns, _values.end());
 }
 
 /*! This function moves all of the rows down one place, then moves the bottommost row to the top. */
 void LatinSquare::reorderDown(void) {
-	for (size_t i = square.size() - 1; i > 0; i--) {
-		std::swap(square[i], square[i - 1]);
+	if (_rows == 0) {
+		return;
 	}
+	std::rotate(_values.begin(), _values.end() - _columns, _values.end());
 }
 
 /*! Reverses the order of the columns in the latin square. */
 void LatinSquare::reverseColumns(void) {
-	std::vector< std::vector<unsigned int> > copy = square;
-	for (size_t i = 0; i < square.size(); i++) {
-		for (size_t j = 0, k = square[i].size() - 1; j < square[i].size(); j++, k--) {
-			square[i][j] = copy[i][k];
-		}
+	for (unsigned int i = 0; i < _rows; i++) {
+		std::vector<unsigned int>::iterator rowBegin = _values.begin() + i * _columns;
+		std::reverse(rowBegin, rowBegin + _columns);
 	}
 }
 
 /*! Reverses the order of the rows in the latin square. */
 void LatinSquare::reverseRows(void) {
-	std::vector< std::vector<unsigned int> > copy = square;
-	for (unsigned int i = 0, j = rows() - 1; i < rows(); i++, j--) {
-		square[i] = copy[j];
+	for (unsigned int i = 0; i < _rows / 2; i++) {
+		swapRows(i, _rows - 1 - i);
 	}
 }
 
@@ -143,17 +152,17 @@ void LatinSquare::swapColumns(unsigned int c1, unsigned int c2) {
 	}
 
 	for (unsigned int i = 0; i < rows(); i++) {
-		std::swap(square[i][c1], square[i][c2]);
+		std::swap(_values[i * _columns + c1], _values[i * _columns + c2]);
 	}
 }
 
 /*! Swap the given rows. If either row is out of range, this function has no effect. */
 void LatinSquare::swapRows(unsigned int r1, unsigned int r2) {
-	if (r1 >= rows() || r2 >= rows()) {
+	if (r1 >= rows() || r2 >= rows() || r1 == r2) {
 		return;
 	}
 
-	std::swap(square[r1], square[r2]);
+	std::swap_ranges(_values.begin() + r1 * _columns, _values.begin() + (r1 + 1) * _columns, _values.begin() + r2 * _columns);
 }
 
 /*! Appends another LatinSquare (ls) to the right of this one. If the number of 
@@ -163,14 +172,16 @@ bool LatinSquare::appendRight(const LatinSquare& ls) {
 		return false;
 	}
 
-	_columns += ls.square.front().size();
-
-	for (unsigned int i = 0; i < rows(); i++) {
-		for (unsigned int j = 0; j < ls.columns(); j++) {
-			square[i].push_back(ls.square[i][j]);
-		}
+	unsigned int newColumns = _columns + ls._columns;
+	std::vector<unsigned int> values(_rows * newColumns);
+	for (unsigned int i = 0; i < _rows; i++) {
+		std::copy(_values.begin() + i * _columns, _values.begin() + (i + 1) * _columns, values.begin() + i * newColumns);
+		std::copy(ls._values.begin() + i * ls._columns, ls._values.begin() + (i + 1) * ls._columns, values.begin() + i * newColumns + _columns);
 	}
 
+	_values.swap(values);
+	_columns = newColumns;
+
 	return true;
 }
 
@@ -181,31 +192,28 @@ bool LatinSquare::appendBelow(const LatinSquare& ls) {
 		return false;
 	}
 
-	for (unsigned int i = 0; i < ls.rows(); i++) {
-		square.push_back(ls.square[i]);
-	}
+	_values.insert(_values.end(), ls._values.begin(), ls._values.end());
+	_rows += ls._rows;
 
 	return true;
 }
 
 /*! Adds the given value to all of the values in the latin square. */
 LatinSquare& LatinSquare::operator+=(unsigned int value) {
-	for (unsigned int i = 0; i < rows(); i++) {
-		for (unsigned int j = 0; j < columns(); j++) {
-			square[i][j] += value;
-		}
+	for (unsigned int& v : _values) {
+		v += value;
 	}
 	return *this;
 }
 
 /*! Prints the contents of the latin square to a string with the given delimiter between
 elements of the latin square. */
-std::string LatinSquare::print(std::string delim) {
+std::string LatinSquare::print(std::string delim) const {
 	stringstream s;
 	for (unsigned int i = 0; i < rows(); i++) {
 		for (unsigned int j = 0; j < columns(); j++) {
-			s << square[i][j];
-			if (j != square[i].size() - 1) {
+			s << _values[i * _columns + j];
+			if (j != _columns - 1) {
 				s << delim;
 			}
 		}
@@ -214,51 +222,129 @@ std::string LatinSquare::print(std::string delim) {
 	return s.str();
 }
 
-/*! Checks to make sure that the latin square held by this instance is a valid latin square. */
+/*! Checks to make sure that the latin square held by this instance is a valid latin square: It is square and
+every row and every column contains each of the values in the first row exactly once. This takes time proportional to the
+number of values in the square. */
 bool LatinSquare::validate(void) const {
-	if (columns() != rows()) {
+	if (columns() != rows() || rows() == 0) {
+		return false;
+	}
+
+	std::vector<unsigned int> indices;
+	if (!_symbolIndices(&indices)) {
 		return false;
 	}
 
-	vector<unsigned int> firstRow = square.front();
-	std::sort(firstRow.begin(), firstRow.end());
+	const unsigned int n = _columns;
+	std::vector<bool> inRow(n);
+	std::vector<bool> inColumn(n * n, false); // [column][symbol]
 
-	vector<unsigned int>::iterator logicalEnd = std::unique(firstRow.begin(), firstRow.end());
-	if (logicalEnd != firstRow.end()) { //No duplicates allowed!
+	for (unsigned int i = 0; i < n; i++) {
+		std::fill(inRow.begin(), inRow.end(), false);
+		for (unsigned int j = 0; j < n; j++) {
+			unsigned int symbol = indices[i * n + j];
+			if (inRow[symbol] || inColumn[j * n + symbol]) {
+				return false;
+			}
+			inRow[symbol] = true;
+			inColumn[j * n + symbol] = true;
+		}
+	}
+
+	return true;
+}
+
+/*! Checks that each row contains each of the values in the first row exactly once and that, counting over
+all of the rows, each value immediately precedes each other value an equal number of times (i.e. that the rows are
+balanced for first-order carryover effects). Squares made with generateBalanced() have this property. */
+bool LatinSquare::validateBalance(void) const {
+	if (rows() == 0 || columns() < 2) {
 		return false;
 	}
 
-	for (unsigned int i = 1; i < rows(); i++) {
-		vector<unsigned int> thisRow = square[i];
-		std::sort(thisRow.begin(), thisRow.end());
-		for (unsigned int j = 0; j < columns(); j++) {
-			if (thisRow[j] != firstRow[j]) {
+	std::vector<unsigned int> indices;
+	if (!_symbolIndices(&indices)) {
+		return false;
+	}
+
+	const unsigned int n = _columns;
+	std::vector<bool> inRow(n);
+	std::vector<unsigned int> precedes(n * n, 0); // [first][second]
+
+	for (unsigned int i = 0; i < _rows; i++) {
+		std::fill(inRow.begin(), inRow.end(), false);
+		for (unsigned int j = 0; j < n; j++) {
+			unsigned int symbol = indices[i * n + j];
+			if (inRow[symbol]) {
 				return false;
 			}
+			inRow[symbol] = true;
+
+			if (j > 0) {
+				precedes[indices[i * n + j - 1] * n + symbol]++;
+			}
 		}
 	}
 
-	for (unsigned int j = 0; j < columns(); j++) {
-		vector<unsigned int> thisColumn = getColumn(j);
-		std::sort(thisColumn.begin(), thisColumn.end());
-		for (unsigned int i = 0; i < rows(); i++) {
-			if (thisColumn[i] != firstRow[i]) {
+	unsigned int expected = precedes[1]; // 0 followed by 1
+	for (unsigned int a = 0; a < n; a++) {
+		for (unsigned int b = 0; b < n; b++) {
+			if (a != b && precedes[a * n + b] != expected) {
 				return false;
 			}
 		}
 	}
+	return true;
+}
 
+/*! Checks whether this latin square is orthogonal to another: Both are valid latin squares of the same size and,
+when they are superimposed, each ordered pair of values occurs exactly once. See generateOrthogonalLatinSquares(). */
+bool LatinSquare::isOrthogonalTo(const LatinSquare& ls) const {
+	if (ls.rows() != rows() || ls.columns() != columns() || !validate() || !ls.validate()) {
+		return false;
+	}
+
+	std::vector<unsigned int> indices;
+	std::vector<unsigned int> otherIndices;
+	_symbolIndices(&indices);
+	ls._symbolIndices(&otherIndices);
+
+	const unsigned int n = _columns;
+	std::vector<bool> pairSeen(n * n, false);
+	for (size_t i = 0; i < indices.size(); i++) {
+		size_t pair = indices[i] * n + otherIndices[i];
+		if (pairSeen[pair]) {
+			return false;
+		}
+		pairSeen[pair] = true;
+	}
 	return true;
 }
 
 /*! Returns the number of columns. */
 unsigned int LatinSquare::columns(void) const {
-	return (unsigned int)_columns;
+	return _columns;
 }
 
 /*! Returns the number of rows. */
 unsigned int LatinSquare::rows(void) const {
-	return (unsigned int)square.size();
+	return _rows;
+}
+
+/*! Returns a reference to the value at the given row and column. Throws std::out_of_range if either is out of range. */
+unsigned int& LatinSquare::at(unsigned int row, unsigned int col) {
+	if (row >= rows() || col >= columns()) {
+		throw std::out_of_range("Latin square index out of range.");
+	}
+	return _values[row * _columns + col];
+}
+
+/*! Returns the value at the given row and column. Throws std::out_of_range if either is out of range. */
+unsigned int LatinSquare::at(unsigned int row, unsigned int col) const {
+	if (row >= rows() || col >= columns()) {
+		throw std::out_of_range("Latin square index out of range.");
+	}
+	return _values[row * _columns + col];
 }
 
 /*! Returns a copy of the given column. Throws std::out_of_range if the column is out of range. */
@@ -270,7 +356,7 @@ std::vector<unsigned int> LatinSquare::getColumn(unsigned int col) const {
 
 	std::vector<unsigned int> column(rows());
 	for (unsigned int i = 0; i < rows(); i++) {
-		column[i] = square[i][col];
+		column[i] = _values[i * _columns + col];
 	}
 	return column;
 };
@@ -281,7 +367,913 @@ std::vector<unsigned int> LatinSquare::getRow(unsigned int row) const {
 		throw std::out_of_range("Latin square row index out of range.");
 	}
 
-	return square[row];
+	return std::vector<unsigned int>(_values.begin() + row * _columns, _values.begin() + (row + 1) * _columns);
+}
+
+/*! Returns a copy of the contents of the latin square as a vector of rows. */
+std::vector< std::vector<unsigned int> > LatinSquare::getSquare(void) const {
+	std::vector< std::vector<unsigned int> > rval(rows());
+	for (unsigned int i = 0; i < rows(); i++) {
+		rval[i] = getRow(i);
+	}
+	return rval;
+}
+
+/*! Sets the contents of the latin square from a vector of rows. The square does not need to be a valid latin square,
+but all rows must have the same length.
+\return `false` if the rows have different lengths, in which case the latin square is not changed. */
+bool LatinSquare::setSquare(const std::vector< std::vector<unsigned int> >& square) {
+	unsigned int newColumns = square.empty() ? 0 : (unsigned int)square.front().size();
+	for (const std::vector<unsigned int>& row : square) {
+		if (row.size() != newColumns) {
+			CX::Instances::Log.error("Algo::LatinSquare") << "setSquare(): All rows must have the same number of values.";
+			return false;
+		}
+	}
+
+	_rows = (unsigned int)square.size();
+	_columns = newColumns;
+	_values.clear();
+	_values.reserve(_rows * _columns);
+	for (const std::vector<unsigned int>& row : square) {
+		_values.insert(_values.end(), row.begin(), row.end());
+	}
+	return true;
+}
+
+/*! Copies the latin square into a CX_DataFrame with one row per value in the square and the columns "sequence"
+(the row of the square), "position" (the column of the square), and "condition" (the value). */
+CX_DataFrame LatinSquare::toDataFrame(void) const {
+	CX_DataFrame df;
+	CX_DataFrame::RowIndex index = 0;
+	for (unsigned int i = 0; i < rows(); i++) {
+		for (unsigned int j = 0; j < columns(); j++) {
+			df(index, "sequence") = i;
+			df(index, "position") = j;
+			df(index, "condition") = _values[i * _columns + j];
+			index++;
+		}
+	}
+	return df;
+}
+
+/*! Get the rows of `conditions` in the order given by a row of the latin square. The values in the square are used
+as row indices into `conditions`.
+\param conditions A CX_DataFrame with one row per condition, e.g. from fullyCross().
+\param row The row of the square to use, e.g. `participantNumber % rows()`.
+\return A copy of the rows of `conditions` in the order given by the square. If `row` is out of range, an empty
+CX_DataFrame is returned. */
+CX_DataFrame LatinSquare::orderConditions(const CX_DataFrame& conditions, unsigned int row) const {
+	if (row >= rows()) {
+		CX::Instances::Log.error("Algo::LatinSquare") << "orderConditions(): Row " << row << " is out of range.";
+		return CX_DataFrame();
+	}
+
+	std::vector<CX_DataFrame::RowIndex> order(_values.begin() + row * _columns, _values.begin() + (row + 1) * _columns);
+	return conditions.copyRows(order);
+}
+
+// Converts the values in the square to the positions of those values in the first row. Fails if
+// the first row contains duplicates or a value is not in the first row.
+bool LatinSquare::_symbolIndices(std::vector<unsigned int>* indices) const {
+	if (_columns == 0) {
+		indices->clear();
+		return true;
+	}
+
+	indices->resize(_values.size());
+
+	unsigned int minValue = *std::min_element(_values.begin(), _values.begin() + _columns);
+	unsigned int maxValue = *std::max_element(_values.begin(), _values.begin() + _columns);
+
+	if (maxValue - minValue == _columns - 1) {
+		// The common case: the values are a contiguous range, so they are their own indices after subtracting the minimum
+		std::vector<bool> inFirstRow(_columns, false);
+		for (unsigned int j = 0; j < _columns; j++) {
+			if (inFirstRow[_values[j] - minValue]) {
+				return false;
+			}
+			inFirstRow[_values[j] - minValue] = true;
+		}
+
+		for (size_t i = 0; i < _values.size(); i++) {
+			if (_values[i] < minValue || _values[i] > maxValue) {
+				return false;
+			}
+			(*indices)[i] = _values[i] - minValue;
+		}
+		return true;
+	}
+
+	std::unordered_map<unsigned int, unsigned int> symbols;
+	for (unsigned int j = 0; j < _columns; j++) {
+		if (!symbols.insert(std::make_pair(_values[j], j)).second) {
+			return false;
+		}
+	}
+
+	for (size_t i = 0; i < _values.size(); i++) {
+		std::unordered_map<unsigned int, unsigned int>::const_iterator it = symbols.find(_values[i]);
+		if (it == symbols.end()) {
+			return false;
+		}
+		(*indices)[i] = it->second;
+	}
+	return true;
+}
+
+namespace {
+	// Finite field GF(p^m). Elements are numbered by their polynomial coefficients as base-p digits.
+	struct GaloisField {
+		unsigned int p;
+		unsigned int m;
+		unsigned int q;
+		std::vector<unsigned int> exp; // Powers of a primitive element
+		std::vector<unsigned int> log;
+
+		unsigned int add(unsigned int a, unsigned int b) const {
+			unsigned int rval = 0;
+			for (unsigned int place = 1; place < q; place *= p) {
+				rval += (((a / place) % p + (b / place) % p) % p) * place;
+			}
+			return rval;
+		}
+
+		unsigned int multiply(unsigned int a, unsigned int b) const {
+			if (a == 0 || b == 0) {
+				return 0;
+			}
+			return exp[(log[a] + log[b]) % (q - 1)];
+		}
+
+		// Searches for a primitive polynomial x^m + c(x): if the powers of x modulo it reach every nonzero element,
+		// they give the multiplication table of the field.
+		void setup(unsigned int p_, unsigned int m_) {
+			p = p_;
+			m = m_;
+			q = 1;
+			for (unsigned int i = 0; i < m; i++) {
+				q *= p;
+			}
+
+			std::vector<unsigned int> c(m);
+			std::vector<unsigned int> digits(m);
+			for (unsigned int poly = 0; poly < q; poly++) {
+				for (unsigned int i = 0, rest = poly; i < m; i++, rest /= p) {
+					c[i] = rest % p;
+				}
+				if (c[0] == 0) {
+					continue; // Divisible by x
+				}
+
+				exp.assign(q - 1, 0);
+				log.assign(q, 0);
+				std::vector<bool> seen(q, false);
+
+				std::fill(digits.begin(), digits.end(), 0);
+				digits[0] = 1;
+				bool primitive = true;
+				for (unsigned int k = 0; k < q - 1; k++) {
+					unsigned int element = 0;
+					for (unsigned int i = m; i > 0; i--) {
+						element = element * p + digits[i - 1];
+					}
+					if (seen[element]) {
+						primitive = false;
+						break;
+					}
+					seen[element] = true;
+					exp[k] = element;
+					log[element] = k;
+
+					// Multiply by x and reduce with x^m = -c(x)
+					unsigned int top = digits[m - 1];
+					for (unsigned int i = m - 1; i > 0; i--) {
+						digits[i] = digits[i - 1];
+					}
+					digits[0] = 0;
+					for (unsigned int i = 0; i < m; i++) {
+						digits[i] = (digits[i] + (p - (top * c[i]) % p)) % p;
+					}
+				}
+
+				if (primitive) {
+					return;
+				}
+			}
+		}
+	};
+}
+
+/*! Generates mutually orthogonal latin squares: Each pair of the returned squares is orthogonal (see LatinSquare::isOrthogonalTo()).
+
+If `dimensions` is a prime power (e.g. 7, 8, or 9), up to `dimensions - 1` orthogonal squares can be generated. Otherwise, 
+`dimensions` is factored into prime powers and squares for each factor are combined, which gives up to one less than the
+smallest prime power factor (e.g. 3 for 20 = 4 * 5, but only 1 for 6 or 10). Larger sets exist for some sizes but are not
+constructed by this function. No two orthogonal latin squares of size 2 or 6 exist.
+
+The same permutation of rows, of columns, or of values can be applied to all of the squares without breaking their orthogonality,
+which is a way to randomize the set.
+
+\param dimensions The number of rows and columns of the squares.
+\param count The number of squares to generate.
+\return A vector of orthogonal squares. If fewer than `count` can be generated, a warning is logged and as many as possible
+are returned. */
+std::vector<LatinSquare> generateOrthogonalLatinSquares(unsigned int dimensions, unsigned int count) {
+	std::vector<LatinSquare> rval;
+	if (dimensions == 0 || count == 0) {
+		return rval;
+	}
+
+	std::vector<GaloisField> fields;
+	unsigned int available = std::numeric_limits<unsigned int>::max();
+	unsigned int rest = dimensions;
+	for (unsigned int p = 2; rest > 1; p++) {
+		if (rest % p != 0) {
+			continue;
+		}
+		unsigned int m = 0;
+		while (rest % p == 0) {
+			rest /= p;
+			m++;
+		}
+		fields.push_back(GaloisField());
+		fields.back().setup(p, m);
+		available = std::min(available, fields.back().q - 1);
+	}
+
+	if (count > available) {
+		CX::Instances::Log.warning("Algo") << "generateOrthogonalLatinSquares(): Only " << available << " orthogonal latin squares of size " <<
+			dimensions << " can be generated. " << count << " were requested.";
+		count = available;
+	}
+
+	std::vector<unsigned int> rowDigits(fields.size());
+	std::vector<unsigned int> columnDigits(fields.size());
+	for (unsigned int k = 1; k <= count; k++) {
+		// For each field, the square L(i, j) = a * i + j, with a different nonzero a for each k, is orthogonal to the others.
+		// Those squares are combined as the digits of a mixed-radix number.
+		LatinSquare ls(dimensions);
+		for (unsigned int i = 0; i < dimensions; i++) {
+			for (unsigned int j = 0; j < dimensions; j++) {
+				unsigned int value = 0;
+				unsigned int r = i;
+				unsigned int c = j;
+				unsigned int place = 1;
+				for (const GaloisField& field : fields) {
+					unsigned int a = field.exp[(k - 1) % (field.q - 1)];
+					value += field.add(field.multiply(a, r % field.q), c % field.q) * place;
+					r /= field.q;
+					c /= field.q;
+					place *= field.q;
+				}
+				ls.at(i, j) = value;
+			}
+		}
+		rval.push_back(ls);
+	}
+
+	return rval;
+}
+
+//////////////////////
+// IndexPermutation //
+//////////////////////
+
+namespace {
+	// The splitmix64 finalizer
+	uint64_t mix64(uint64_t z) {
+		z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+		z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+		return z ^ (z >> 31);
+	}
+}
+
+/*! \brief Construct an empty permutation. */
+IndexPermutation::IndexPermutation(void) {
+	setup(0, 0);
+}
+
+/*! \brief Construct a permutation. See setup(). */
+IndexPermutation::IndexPermutation(uint64_t n, uint64_t seed) {
+	setup(n, seed);
+}
+
+/*! Set up the permutation.
+\param n The number of indices to permute.
+\param seed The seed. Different seeds give different permutations. */
+void IndexPermutation::setup(uint64_t n, uint64_t seed) {
+	_n = n;
+
+	// The Feistel network permutes [0, 2^(2 * _halfBits)), which is at most 4 times larger than n,
+	// so on average fewer than 4 encryptions are needed to get a value less than n (cycle walking).
+	unsigned int bits = 0;
+	while (bits < 64 && (uint64_t(1) << bits) < n) {
+		bits++;
+	}
+	_halfBits = std::max<unsigned int>((bits + 1) / 2, 1);
+	_halfMask = (uint64_t(1) << _halfBits) - 1;
+
+	for (int i = 0; i < 6; i++) {
+		_keys[i] = mix64(seed + 0x9E3779B97F4A7C15ULL * (i + 1));
+	}
+}
+
+/*! \brief Get the `i`th element of the permutation, for `0 <= i < size()`. */
+uint64_t IndexPermutation::operator()(uint64_t i) const {
+	if (i >= _n) {
+		CX::Instances::Log.error("Algo::IndexPermutation") << "Index " << i << " is out of range.";
+		return i;
+	}
+
+	uint64_t x = _encrypt(i);
+	while (x >= _n) {
+		x = _encrypt(x);
+	}
+	return x;
+}
+
+/*! \brief The number of indices that are permuted. */
+uint64_t IndexPermutation::size(void) const {
+	return _n;
+}
+
+uint64_t IndexPermutation::_encrypt(uint64_t x) const {
+	uint64_t left = (x >> _halfBits) & _halfMask;
+	uint64_t right = x & _halfMask;
+	for (int i = 0; i < 6; i++) {
+		uint64_t next = left ^ (mix64(right ^ _keys[i]) & _halfMask);
+		left = right;
+		right = next;
+	}
+	return (left << _halfBits) | right;
+}
+
+/////////////////////////
+// ConstrainedShuffler //
+/////////////////////////
+
+ConstrainedShuffler::ConstrainedShuffler(void) :
+	_rng(&CX::Instances::RNG),
+	_violations(0)
+{}
+
+/*! \brief Set up the shuffler with the given configuration. */
+void ConstrainedShuffler::setup(const Configuration& config) {
+	_config = config;
+	_rng = (config.rng != nullptr) ? config.rng : &CX::Instances::RNG;
+}
+
+/*! \brief Returns the configuration given to setup(). */
+ConstrainedShuffler::Configuration ConstrainedShuffler::getConfiguration(void) const {
+	return _config;
+}
+
+/*! Get a constrained random order of trials.
+\param levels The level (condition) of each trial.
+\return The indices of the trials (indices into `levels`) in the new order. */
+std::vector<size_t> ConstrainedShuffler::shuffle(const std::vector<std::string>& levels) {
+	std::map<std::string, size_t> levelNumbers;
+	for (const std::string& level : levels) {
+		levelNumbers.insert(std::make_pair(level, levelNumbers.size()));
+	}
+
+	std::vector<std::vector<size_t>> trialsByLevel(levelNumbers.size());
+	for (size_t i = 0; i < levels.size(); i++) {
+		trialsByLevel[levelNumbers[levels[i]]].push_back(i);
+	}
+
+	std::vector<size_t> counts(trialsByLevel.size());
+	for (size_t l = 0; l < trialsByLevel.size(); l++) {
+		counts[l] = trialsByLevel[l].size();
+		_rng->shuffleVector(&trialsByLevel[l]);
+	}
+
+	std::vector<size_t> levelOrder = _shuffleLevels(counts);
+
+	std::vector<size_t> rval;
+	rval.reserve(levels.size());
+	std::vector<size_t> used(trialsByLevel.size(), 0);
+	for (size_t level : levelOrder) {
+		rval.push_back(trialsByLevel[level][used[level]++]);
+	}
+	return rval;
+}
+
+/*! Get a constrained random order of the rows of a data frame.
+\param df The data frame.
+\param column The name of the column containing the level of each row. Levels are compared as strings.
+\return The row indices in the new order, or an empty vector if `column` does not exist. This can be given to
+CX_DataFrame::reorderRows() or CX_DataFrame::copyRows(). */
+std::vector<CX_DataFrame::RowIndex> ConstrainedShuffler::shuffle(const CX_DataFrame& df, std::string column) {
+	if (!df.columnExists(column)) {
+		CX::Instances::Log.error("Algo::ConstrainedShuffler") << "shuffle(): Column \"" << column << "\" does not exist.";
+		_violations = 0;
+		return std::vector<CX_DataFrame::RowIndex>();
+	}
+
+	std::vector<size_t> order = shuffle(df.copyColumn<std::string>(column));
+	return std::vector<CX_DataFrame::RowIndex>(order.begin(), order.end());
+}
+
+/*! Reorder the rows of a data frame in a constrained random order. See shuffle(const CX_DataFrame&, std::string).
+\return `true` if the rows were reordered and the constraints were satisfied. If the rows were reordered but the constraints
+were not fully satisfied, `false` is returned and getViolationCount() is greater than 0. */
+bool ConstrainedShuffler::shuffleRows(CX_DataFrame& df, std::string column) {
+	std::vector<CX_DataFrame::RowIndex> order = shuffle(df, column);
+	if (order.size() != df.getRowCount() || !df.reorderRows(order)) {
+		return false;
+	}
+	return _violations == 0;
+}
+
+/*! \brief The number of positions in the last order at which a constraint was violated. 0 means that the
+constraints were satisfied. */
+size_t ConstrainedShuffler::getViolationCount(void) const {
+	return _violations;
+}
+
+bool ConstrainedShuffler::_allowed(const SearchState& state, size_t level, size_t position) const {
+	if (_config.maxRunLength > 0 && state.runLevel == level && state.runLength >= _config.maxRunLength) {
+		return false;
+	}
+	if (_config.minDistance > 1 && state.lastPosition[level] != SIZE_MAX && position - state.lastPosition[level] < _config.minDistance) {
+		return false;
+	}
+	return true;
+}
+
+// Necessary conditions for the remaining trials to be placeable from `position` on. This catches most dead ends early.
+bool ConstrainedShuffler::_feasible(const SearchState& state, size_t position) const {
+	size_t remainingTotal = 0;
+	for (size_t c : state.remaining) {
+		remainingTotal += c;
+	}
+
+	for (size_t level = 0; level < state.remaining.size(); level++) {
+		size_t count = state.remaining[level];
+		if (count == 0) {
+			continue;
+		}
+
+		if (_config.maxRunLength > 0) {
+			// Each other trial can separate runs of at most maxRunLength, and the current run uses up part of the first one
+			size_t others = remainingTotal - count;
+			size_t capacity = (size_t)_config.maxRunLength * (others + 1);
+			if (state.runLevel == level) {
+				capacity -= std::min(capacity, state.runLength);
+			}
+			if (count > capacity) {
+				return false;
+			}
+		}
+
+		if (_config.minDistance > 1) {
+			size_t firstOffset = 0;
+			if (state.lastPosition[level] != SIZE_MAX && state.lastPosition[level] + _config.minDistance > position) {
+				firstOffset = state.lastPosition[level] + _config.minDistance - position;
+			}
+			size_t capacity = (firstOffset >= remainingTotal) ? 0 : 1 + (remainingTotal - 1 - firstOffset) / _config.minDistance;
+			if (count > capacity) {
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+// Orders the levels that have trials left randomly, weighted by their remaining counts (so that levels with many
+// trials left tend to come first), and, if transitions are balanced, by how often they have followed `previous`.
+std::vector<size_t> ConstrainedShuffler::_orderCandidates(const SearchState& state, size_t previous) {
+	std::vector<std::pair<std::pair<unsigned int, double>, size_t>> keyed;
+	for (size_t level = 0; level < state.remaining.size(); level++) {
+		if (state.remaining[level] == 0) {
+			continue;
+		}
+
+		// Exponential race: sorting by -log(U) / weight is weighted sampling without replacement
+		double u = 1 - _rng->randomDouble(0, 1);
+		double key = -std::log(u) / state.remaining[level];
+
+		unsigned int transitions = 0;
+		if (_config.balanceTransitions && previous != SIZE_MAX) {
+			transitions = state.transitions[previous][level];
+		}
+
+		keyed.push_back(std::make_pair(std::make_pair(transitions, key), level));
+	}
+
+	std::sort(keyed.begin(), keyed.end());
+
+	std::vector<size_t> rval;
+	for (const auto& k : keyed) {
+		rval.push_back(k.second);
+	}
+	return rval;
+}
+
+std::vector<size_t> ConstrainedShuffler::_shuffleLevels(const std::vector<size_t>& counts) {
+	size_t total = 0;
+	for (size_t c : counts) {
+		total += c;
+	}
+
+	SearchState state;
+	state.remaining = counts;
+	state.lastPosition.assign(counts.size(), SIZE_MAX);
+	state.transitions.assign(counts.size(), std::vector<unsigned int>(counts.size(), 0));
+	state.runLevel = SIZE_MAX;
+	state.runLength = 0;
+
+	// What placing a level changed, so that it can be undone
+	struct Placement {
+		std::vector<size_t> candidates;
+		size_t nextCandidate;
+		size_t previousLastPosition;
+		size_t previousRunLevel;
+		size_t previousRunLength;
+	};
+
+	std::vector<size_t> sequence;
+	sequence.reserve(total);
+	std::vector<Placement> stack;
+
+	auto place = [&](Placement& p, size_t level) {
+		p.previousLastPosition = state.lastPosition[level];
+		p.previousRunLevel = state.runLevel;
+		p.previousRunLength = state.runLength;
+
+		if (!sequence.empty()) {
+			state.transitions[sequence.back()][level]++;
+		}
+		state.remaining[level]--;
+		state.lastPosition[level] = sequence.size();
+		state.runLength = (state.runLevel == level) ? state.runLength + 1 : 1;
+		state.runLevel = level;
+		sequence.push_back(level);
+	};
+
+	auto unplace = [&](const Placement& p) {
+		size_t level = sequence.back();
+		sequence.pop_back();
+		if (!sequence.empty()) {
+			state.transitions[sequence.back()][level]--;
+		}
+		state.remaining[level]++;
+		state.lastPosition[level] = p.previousLastPosition;
+		state.runLevel = p.previousRunLevel;
+		state.runLength = p.previousRunLength;
+	};
+
+	bool searching = _feasible(state, 0);
+	if (!searching) {
+		CX::Instances::Log.warning("Algo::ConstrainedShuffler") << "The constraints cannot be satisfied with the given levels. "
+			"The order will have as few violations as possible.";
+	}
+
+	unsigned int steps = 0;
+	while (searching && sequence.size() < total) {
+		if (stack.size() == sequence.size()) {
+			Placement p;
+			p.nextCandidate = 0;
+			for (size_t level : _orderCandidates(state, sequence.empty() ? SIZE_MAX : sequence.back())) {
+				if (_allowed(state, level, sequence.size())) {
+					p.candidates.push_back(level);
+				}
+			}
+			stack.push_back(p);
+		}
+
+		Placement& p = stack.back();
+		bool placed = false;
+		while (p.nextCandidate < p.candidates.size()) {
+			if (++steps > _config.maxSteps) {
+				searching = false;
+				break;
+			}
+
+			place(p, p.candidates[p.nextCandidate++]);
+			if (_feasible(state, sequence.size())) {
+				placed = true;
+				break;
+			}
+			unplace(p);
+		}
+
+		if (!searching) {
+			CX::Instances::Log.warning("Algo::ConstrainedShuffler") << "No order satisfying the constraints was found in " <<
+				_config.maxSteps << " steps. The rest of the order will have as few violations as possible.";
+			break;
+		}
+
+		if (!placed) {
+			// Dead end: back up and try the next candidate at the previous position
+			stack.pop_back();
+			if (stack.empty()) {
+				CX::Instances::Log.warning("Algo::ConstrainedShuffler") << "The constraints cannot be satisfied with the given levels. "
+					"The order will have as few violations as possible.";
+				searching = false;
+				break;
+			}
+			unplace(stack.back());
+		}
+	}
+
+	// If the search failed, complete the order greedily, starting from the valid partial order
+	_violations = 0;
+	while (sequence.size() < total) {
+		std::vector<size_t> candidates = _orderCandidates(state, sequence.empty() ? SIZE_MAX : sequence.back());
+
+		// Prefer an allowed level after which the rest of the order can still be completed
+		size_t choice = SIZE_MAX;
+		for (size_t level : candidates) {
+			if (_allowed(state, level, sequence.size())) {
+				if (choice == SIZE_MAX) {
+					choice = level;
+				}
+
+				Placement trial;
+				place(trial, level);
+				bool feasible = _feasible(state, sequence.size());
+				unplace(trial);
+
+				if (feasible) {
+					choice = level;
+					break;
+				}
+			}
+		}
+
+		if (choice == SIZE_MAX) {
+			// Nothing is allowed: use the level with the most trials left
+			for (size_t level : candidates) {
+				if (choice == SIZE_MAX || state.remaining[level] > state.remaining[choice]) {
+					choice = level;
+				}
+			}
+			_violations++;
+		}
+
+		Placement p;
+		place(p, choice);
+	}
+
+	return sequence;
+}
+
+////////////////////////
+// PoissonDiskSampler //
+////////////////////////
+
+PoissonDiskSampler::PoissonDiskSampler(void) :
+	_rng(nullptr),
+	_is3D(false),
+	_cellSize(1)
+{
+	_gridSize[0] = _gridSize[1] = _gridSize[2] = 0;
+}
+
+/*! Set up the sampler.
+\param config The configuration to use.
+\return `false` if the configuration is invalid, `true` otherwise. */
+bool PoissonDiskSampler::setup(const Configuration& config) {
+	_config = config;
+	_rng = (config.rng != nullptr) ? config.rng : &CX::Instances::RNG;
+	_grid.clear();
+
+	if (config.minDistance <= 0) {
+		CX::Instances::Log.error("Algo::PoissonDiskSampler") << "setup(): minDistance must be greater than 0.";
+		return false;
+	}
+
+	ofPoint size = config.maximum - config.minimum;
+	if (size.x <= 0 || size.y <= 0 || size.z < 0) {
+		CX::Instances::Log.error("Algo::PoissonDiskSampler") << "setup(): maximum must be greater than minimum in x and y, and not less than minimum in z.";
+		return false;
+	}
+
+	_is3D = size.z > 0;
+
+	// The diagonal of a cell is minDistance, so there can be at most one point in each cell
+	_cellSize = config.minDistance / std::sqrt(_is3D ? 3.0f : 2.0f);
+
+	double cellCount = 1;
+	for (int d = 0; d < 3; d++) {
+		_gridSize[d] = (d == 2 && !_is3D) ? 1 : (int)std::ceil(size[d] / _cellSize);
+		_gridSize[d] = std::max(_gridSize[d], 1);
+		cellCount *= _gridSize[d];
+	}
+
+	if (cellCount > 1e8) {
+		CX::Instances::Log.error("Algo::PoissonDiskSampler") << "setup(): minDistance is too small for the size of the region (the grid would have " <<
+			cellCount << " cells).";
+		return false;
+	}
+
+	_grid.assign((size_t)cellCount, -1);
+
+	return true;
+}
+
+/*! \brief Returns the configuration given to setup(). */
+PoissonDiskSampler::Configuration PoissonDiskSampler::getConfiguration(void) const {
+	return _config;
+}
+
+/*! Fill the region with as many points as will fit. Every point is at least `Configuration::minDistance` from every
+other point and no more space is left for another point (up to the randomness of the algorithm: see
+`Configuration::candidatesPerPoint`).
+\return The points, in the order in which they were generated. */
+std::vector<ofPoint> PoissonDiskSampler::sampleAll(void) {
+	std::vector<ofPoint> points;
+	if (_grid.empty()) {
+		CX::Instances::Log.error("Algo::PoissonDiskSampler") << "sampleAll(): The sampler has not been successfully set up.";
+		return points;
+	}
+
+	std::fill(_grid.begin(), _grid.end(), -1);
+
+	std::vector<size_t> active; // Indices of points that may still have room around them
+
+	while (true) {
+		// Exclusion zones and regionFunction can split the region into parts that cannot be reached from each other,
+		// so each time the active points run out, try to start again from a new point anywhere in the region.
+		bool seeded = false;
+		for (unsigned int i = 0; i < _config.candidatesPerPoint && !seeded; i++) {
+			ofPoint p = _randomPointInRegion();
+			if (_acceptable(p, points)) {
+				_insert(p, points, active);
+				seeded = true;
+			}
+		}
+		if (!seeded) {
+			break;
+		}
+
+		while (!active.empty()) {
+			size_t activeIndex = (size_t)_rng->randomInt(0, active.size() - 1);
+			ofPoint center = points[active[activeIndex]];
+
+			bool placed = false;
+			for (unsigned int i = 0; i < _config.candidatesPerPoint; i++) {
+				ofPoint p = _randomPointAround(center);
+				if (_acceptable(p, points)) {
+					_insert(p, points, active);
+					placed = true;
+					break;
+				}
+			}
+
+			if (!placed) {
+				active[activeIndex] = active.back();
+				active.pop_back();
+			}
+		}
+	}
+
+	return points;
+}
+
+/*! Generate `count` points that are spread throughout the region. This fills the region with sampleAll() and takes a random
+subset of the points, so the points are at least `Configuration::minDistance` apart, but usually further.
+\param count The number of points to generate.
+\return A vector of `count` points, or, if `count` points do not fit in the region after `Configuration::maxAttempts` tries,
+an empty vector. */
+std::vector<ofPoint> PoissonDiskSampler::sample(unsigned int count) {
+	if (count == 0) {
+		return std::vector<ofPoint>();
+	}
+
+	size_t mostPoints = 0;
+	for (unsigned int attempt = 0; attempt < std::max<unsigned int>(_config.maxAttempts, 1); attempt++) {
+		std::vector<ofPoint> points = sampleAll();
+		if (points.size() >= count) {
+			return _rng->sample(count, points, false);
+		}
+		mostPoints = std::max(mostPoints, points.size());
+	}
+
+	CX::Instances::Log.error("Algo::PoissonDiskSampler") << "sample(): Could not fit " << count << " points in the region. At most " <<
+		mostPoints << " points fit. Returning an empty vector.";
+	return std::vector<ofPoint>();
+}
+
+// Gets the grid cell of p. Returns false if p is outside of the region.
+bool PoissonDiskSampler::_cellCoordinates(const ofPoint& p, int* cell) const {
+	for (int d = 0; d < (_is3D ? 3 : 2); d++) {
+		if (p[d] < _config.minimum[d] || p[d] > _config.maximum[d]) {
+			return false;
+		}
+		cell[d] = std::min((int)((p[d] - _config.minimum[d]) / _cellSize), _gridSize[d] - 1);
+	}
+	if (!_is3D) {
+		cell[2] = 0;
+	}
+	return true;
+}
+
+size_t PoissonDiskSampler::_cellIndex(const int* cell) const {
+	return ((size_t)cell[2] * _gridSize[1] + cell[1]) * _gridSize[0] + cell[0];
+}
+
+bool PoissonDiskSampler::_acceptable(const ofPoint& p, const std::vector<ofPoint>& points) const {
+	int cell[3];
+	if (!_cellCoordinates(p, cell)) {
+		return false;
+	}
+
+	for (const ExclusionZone& zone : _config.exclusionZones) {
+		if (p.squareDistance(zone.center) < zone.radius * zone.radius) {
+			return false;
+		}
+	}
+
+	if (_config.regionFunction && !_config.regionFunction(p)) {
+		return false;
+	}
+
+	// Points closer than minDistance can only be within 2 cells in each direction
+	const float minDistSq = _config.minDistance * _config.minDistance;
+	const int zRange = _is3D ? 2 : 0;
+
+	for (int z = std::max(cell[2] - zRange, 0); z <= std::min(cell[2] + zRange, _gridSize[2] - 1); z++) {
+		for (int y = std::max(cell[1] - 2, 0); y <= std::min(cell[1] + 2, _gridSize[1] - 1); y++) {
+			for (int x = std::max(cell[0] - 2, 0); x <= std::min(cell[0] + 2, _gridSize[0] - 1); x++) {
+				int neighbor[3] = { x, y, z };
+				int index = _grid[_cellIndex(neighbor)];
+				if (index >= 0 && p.squareDistance(points[index]) < minDistSq) {
+					return false;
+				}
+			}
+		}
+	}
+
+	return true;
+}
+
+void PoissonDiskSampler::_insert(const ofPoint& p, std::vector<ofPoint>& points, std::vector<size_t>& active) {
+	int cell[3];
+	_cellCoordinates(p, cell);
+	_grid[_cellIndex(cell)] = (int)points.size();
+	active.push_back(points.size());
+	points.push_back(p);
+}
+
+ofPoint PoissonDiskSampler::_randomPointInRegion(void) {
+	ofPoint p;
+	p.x = _rng->randomDouble(_config.minimum.x, _config.maximum.x);
+	p.y = _rng->randomDouble(_config.minimum.y, _config.maximum.y);
+	p.z = _is3D ? _rng->randomDouble(_config.minimum.z, _config.maximum.z) : _config.minimum.z;
+	return p;
+}
+
+// A uniformly distributed point between minDistance and 2 * minDistance from center
+ofPoint PoissonDiskSampler::_randomPointAround(const ofPoint& center) {
+	const double r = _config.minDistance;
+	const double twoPi = 2 * 3.14159265358979323846;
+
+	ofPoint offset;
+	if (_is3D) {
+		double radius = std::cbrt(_rng->randomDouble(r * r * r, 8 * r * r * r));
+		double z = _rng->randomDouble(-1, 1);
+		double angle = _rng->randomDouble(0, twoPi);
+		double xy = std::sqrt(1 - z * z);
+		offset = ofPoint(radius * xy * std::cos(angle), radius * xy * std::sin(angle), radius * z);
+	} else {
+		double radius = std::sqrt(_rng->randomDouble(r * r, 4 * r * r));
+		double angle = _rng->randomDouble(0, twoPi);
+		offset = ofPoint(radius * std::cos(angle), radius * std::sin(angle), 0);
+	}
+	return center + offset;
+}
+
+/*! Generate points that are at least `minDistance` from each other within a rectangle (or box). This is a shortcut for
+PoissonDiskSampler::sample(). Use PoissonDiskSampler directly for exclusion zones or irregular regions.
+
+\param count The number of points to generate.
+\param minDistance The minimum distance between any two points.
+\param minimum The corner of the region with the smallest coordinates. If `minimum.z == maximum.z`, 2D points are generated.
+\param maximum The corner of the region with the largest coordinates.
+\param rng The random number generator to use.
+\return A vector of `count` points, or an empty vector if the points do not fit in the region.
+
+\code{.cpp}
+vector<ofPoint> locations = Algo::generateSeparatedPoints(200, 40, ofPoint(0, 0), ofPoint(1000, 800));
+\endcode
+*/
+std::vector<ofPoint> generateSeparatedPoints(unsigned int count, float minDistance, ofPoint minimum, ofPoint maximum, CX_RandomNumberGenerator* rng) {
+	PoissonDiskSampler::Configuration config;
+	config.minimum = minimum;
+	config.maximum = maximum;
+	config.minDistance = minDistance;
+	config.rng = rng;
+
+	PoissonDiskSampler sampler;
+	if (!sampler.setup(config)) {
+		return std::vector<ofPoint>();
+	}
+	return sampler.sample(count);
 }
 
 ///////////////////////////
@@ -292,10 +1284,19 @@ RollingLinearModel::RollingLinearModel(void) :
 	_autoUpdate(false),
 	_modelNeedsUpdate(true),
 	_maxSamples(100),
-	_minSamples(3)
+	_minSamples(3),
+	_runningValid(true),
+	_refitInterval(1000),
+	_updatesSinceRefit(0)
 {}
 
-void RollingLinearModel::setup(bool autoUpdate, unsigned int maxSamples, unsigned int minSamples) {
+/*! Set up the model.
+\param autoUpdate If `true`, the model is updated every time data are stored.
+\param maxSamples The maximum number of samples to keep. Older samples are dropped.
+\param minSamples The minimum number of samples needed to fit the model. At least 2.
+\param refitInterval The number of incremental updates between full refits of the model.
+*/
+void RollingLinearModel::setup(bool autoUpdate, unsigned int maxSamples, unsigned int minSamples, unsigned int refitInterval) {
 
 	std::lock_guard<std::recursive_mutex> lock(_mutex);
 
@@ -304,19 +1305,28 @@ void RollingLinearModel::setup(bool autoUpdate, unsigned int maxSamples, unsigne
 	_autoUpdate = autoUpdate;
 	_minSamples = std::max<unsigned int>(minSamples, 2);
 	_maxSamples = std::max(maxSamples, _minSamples);
+	_refitInterval = std::max<unsigned int>(refitInterval, 1);
 
 }
 
-void RollingLinearModel::store(double x, double y) {
-
-	std::lock_guard<std::recursive_mutex> lock(_mutex);
-
+void RollingLinearModel::_pushDatum(double x, double y) {
 	_data.push_back(Datum(x, y));
+	_running.add(x, y);
 
 	while (_data.size() > _maxSamples) {
+		_running.remove(_data.front().x, _data.front().y);
 		_data.pop_front();
 	}
 
+	_updatesSinceRefit++;
+}
+
+void RollingLinearModel::store(double x, double y) {
+
+	std::lock_guard<std::recursive_mutex> lock(_mutex);
+
+	_pushDatum(x, y);
+
 	_modelNeedsUpdate = true;
 
 	if (_autoUpdate) {
@@ -329,11 +1339,7 @@ void RollingLinearModel::storeMultiple(const std::vector<double>& x, const std::
 	std::lock_guard<std::recursive_mutex> lock(_mutex);
 
 	for (unsigned int i = 0; i < x.size(); i++) {
-		_data.push_back(Datum(x[i], y[i]));
-	}
-
-	while (_data.size() > _maxSamples) {
-		_data.pop_front();
+		_pushDatum(x[i], y[i]);
 	}
 
 	_modelNeedsUpdate = true;
@@ -355,6 +1361,10 @@ void RollingLinearModel::clear(void) {
 	_modelNeedsUpdate = true;
 
 	_data.clear();
+
+	_running.clear();
+	_runningValid = true;
+	_updatesSinceRefit = 0;
 }
 
 // Returns true if model is ready, false otherwise.
@@ -366,7 +1376,20 @@ bool RollingLinearModel::updateModel(void) {
 		return true;
 	}
 
-	return updateModelOnSubset(0, _data.size());
+	if (!_runningValid || _updatesSinceRefit >= _refitInterval) {
+		return updateModelOnSubset(0, _data.size());
+	}
+
+	if (_data.size() < _minSamples) {
+		return false;
+	}
+
+	_slope = _running.slope();
+	_intercept = _running.intercept();
+
+	_modelNeedsUpdate = false;
+
+	return true;
 }
 
 // Always updates model, regardless of state
@@ -396,19 +1419,36 @@ bool RollingLinearModel::updateModelOnSubset(unsigned int start_inclusive, unsig
 
 	double numSum = 0;
 	double denSum = 0;
+	double yySum = 0;
 
 	for (unsigned int i = start_inclusive; i < end_exclusive; i++) {
 
 		double xDif = (_data[i].x - xBar);
+		double yDif = (_data[i].y - yBar);
 
-		numSum += xDif * (_data[i].y - yBar);
+		numSum += xDif * yDif;
 
 		denSum += xDif * xDif;
+
+		yySum += yDif * yDif;
 	}
 
 	_slope = numSum / denSum;
 	_intercept = yBar - _slope * xBar;
 
+	// A fit on all of the data resets the running sums, discarding accumulated rounding error.
+	if (start_inclusive == 0 && end_exclusive == _data.size()) {
+		_running.n = sampleSize;
+		_running.xBar = xBar;
+		_running.yBar = yBar;
+		_running.Sxx = denSum;
+		_running.Sxy = numSum;
+		_running.Syy = yySum;
+
+		_runningValid = true;
+		_updatesSinceRefit = 0;
+	}
+
 	_modelNeedsUpdate = false;
 
 	return true;
@@ -454,6 +1494,9 @@ bool RollingLinearModel::modelReady(void) {
 
 std::deque<RollingLinearModel::Datum>& RollingLinearModel::getData(void) {
 	std::lock_guard<std::recursive_mutex> lock(_mutex);
+	// The caller may modify the data, so the next update must be a full refit.
+	_runningValid = false;
+	_modelNeedsUpdate = true;
 	return _data;
 }
 
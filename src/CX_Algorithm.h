@@ -5,9 +5,12 @@
 #include <map>
 #include <utility> //pair
 #include <string>
+#include <deque>
+#include <iterator>
 #include <functional>
 
 #include "CX_Logger.h"
+#include "CX_Utilities.h"
 #include "CX_RandomNumberGenerator.h"
 #include "CX_DataFrame.h"
 
@@ -21,12 +24,120 @@ namespace CX {
 		std::vector<dataT> generateSeparatedValues(int count, distT minDistance, std::function<distT(dataT, dataT)> distanceFunction,
 												std::function<dataT(void)> randomDeviate, unsigned int maxSequentialFailures, int maxRestarts);
 
+		/*! This class generates points that are at least a minimum distance from each other within a rectangular (2D)
+		or box-shaped (3D) region, optionally avoiding exclusion zones, using Bridson's Poisson-disk sampling algorithm.
+
+		The points are stored in a uniform grid with cells small enough that each cell holds at most one point, so checking
+		a candidate point only requires looking at a few nearby cells. Points are generated by proposing candidates around
+		existing points, which densely fills the region in time proportional to the number of points. This is much faster
+		and more reliable than generateSeparatedValues(), which compares each candidate with every accepted point and
+		restarts if it has trouble finding a place for a point.
+
+		sampleAll() fills the region with as many points as fit. sample() picks a random subset of such a filling, so
+		the requested number of points are spread throughout the whole region.
+
+		\code{.cpp}
+		Algo::PoissonDiskSampler sampler;
+		Algo::PoissonDiskSampler::Configuration config;
+		config.minimum = ofPoint(50, 50);
+		config.maximum = ofPoint(Disp.getResolution().x - 50, Disp.getResolution().y - 50);
+		config.minDistance = 60;
+		config.exclusionZones.push_back(Algo::PoissonDiskSampler::ExclusionZone(Disp.getCenter(), 80)); // Keep clear of the fixation point
+		sampler.setup(config);
+
+		std::vector<ofPoint> itemLocations = sampler.sample(24);
+		\endcode
+		*/
+		class PoissonDiskSampler {
+		public:
+
+			/*! \brief A circle (or sphere, in 3D) in which no points are placed. */
+			struct ExclusionZone {
+				ExclusionZone(void) :
+					center(0, 0, 0),
+					radius(0)
+				{}
+
+				ExclusionZone(ofPoint center_, float radius_) :
+					center(center_),
+					radius(radius_)
+				{}
+
+				ofPoint center;
+				float radius;
+			};
+
+			struct Configuration {
+				Configuration(void) :
+					minimum(0, 0, 0),
+					maximum(0, 0, 0),
+					minDistance(1),
+					candidatesPerPoint(30),
+					maxAttempts(10),
+					rng(nullptr)
+				{}
+
+				/*! \brief The corner of the region with the smallest coordinates. If `minimum.z == maximum.z`, 2D points are generated. */
+				ofPoint minimum;
+				ofPoint maximum; //!< The corner of the region with the largest coordinates.
+
+				float minDistance; //!< The minimum distance between any two points.
+
+				std::vector<ExclusionZone> exclusionZones; //!< Zones in which points are not placed.
+
+				/*! \brief If set, points are only placed where this function returns `true`. This can be used for regions that
+				are not rectangular, e.g. a circular display area. */
+				std::function<bool(const ofPoint&)> regionFunction;
+
+				/*! \brief The number of candidates proposed around each point before giving up on placing more points near it.
+				Larger values fill the region more densely, but take longer. 30 is the value suggested by Bridson. */
+				unsigned int candidatesPerPoint;
+
+				/*! \brief The number of times that sample() fills the region again if a filling has too few points. */
+				unsigned int maxAttempts;
+
+				/*! \brief The random number generator to use. If `nullptr`, CX::Instances::RNG is used. */
+				CX_RandomNumberGenerator* rng;
+			};
+
+			PoissonDiskSampler(void);
+
+			bool setup(const Configuration& config);
+			Configuration getConfiguration(void) const;
+
+			std::vector<ofPoint> sampleAll(void);
+			std::vector<ofPoint> sample(unsigned int count);
+
+		private:
+			Configuration _config;
+			CX_RandomNumberGenerator* _rng;
+
+			bool _is3D;
+			float _cellSize;
+			int _gridSize[3];
+			std::vector<int> _grid; // Index of the point in each cell, or -1
+
+			bool _cellCoordinates(const ofPoint& p, int* cell) const;
+			size_t _cellIndex(const int* cell) const;
+			bool _acceptable(const ofPoint& p, const std::vector<ofPoint>& points) const;
+			void _insert(const ofPoint& p, std::vector<ofPoint>& points, std::vector<size_t>& active);
+
+			ofPoint _randomPointInRegion(void);
+			ofPoint _randomPointAround(const ofPoint& center);
+		};
+
+		std::vector<ofPoint> generateSeparatedPoints(unsigned int count, float minDistance, ofPoint minimum, ofPoint maximum,
+													 CX_RandomNumberGenerator* rng = &CX::Instances::RNG);
+
 		template <typename T> 
 		std::vector< std::vector<T> > fullyCross (std::vector< std::vector<T> > factors);
 
 		template <typename T>
 		CX_DataFrame fullyCross(std::map<std::string, std::vector<T>>& factors);
 
+		template <typename T>
+		class CrossedDesign;
+
 		/*! This class provides a way to work with Latin squares in a relatively easy way. 
 
 		The constructed Latin squares use 0-indexed integers for the values, 
@@ -34,6 +145,13 @@ namespace CX {
 
 		Each row of the square is one condition of the design, so take use rows to determine condition order.
 
+		The values are stored in a single row-major array, so squares with hundreds of conditions can be generated,
+		rearranged, and validated quickly. Individual values are accessed with at().
+
+		\note Older versions of this class had a public `square` member, a vector of rows, which was removed when the storage
+		was changed. Replace `ls.square[row][col]` with `ls.at(row, col)`, reading `ls.square` with `ls.getSquare()`, and
+		assigning to `ls.square` with `ls.setSquare()`.
+
 		\code{.cpp}
 		Algo::LatinSquare ls(4); //Construct a standard 4x4 LatinSquare.
 		cout << "This latin square has " << ls.rows() << " rows and " << ls.columns() << " columns." << endl;
@@ -59,6 +177,14 @@ namespace CX {
 			cout << "The latin square is no longer valid, but it is still useful (8 counterbalancing conditions, both forward and backward ordering)." << endl;
 		}
 		\endcode
+
+		Rows of a square can be used to order the conditions of a design for each participant:
+		\code{.cpp}
+		Algo::LatinSquare ls;
+		ls.generateBalanced(conditions.getRowCount()); //conditions is a CX_DataFrame with one row per condition
+
+		CX_DataFrame trials = ls.orderConditions(conditions, participantNumber % ls.rows());
+		\endcode
 		*/
 		class LatinSquare {
 		public:
@@ -84,22 +210,38 @@ namespace CX {
 
 			LatinSquare& operator+=(unsigned int value);
 
-			std::string print(std::string delim = ",");
+			std::string print(std::string delim = ",") const;
 
 			bool validate(void) const;
+			bool validateBalance(void) const;
+			bool isOrthogonalTo(const LatinSquare& ls) const;
 
 			unsigned int columns(void) const;
 			unsigned int rows(void) const;
 
+			unsigned int& at(unsigned int row, unsigned int col);
+			unsigned int at(unsigned int row, unsigned int col) const;
+
 			std::vector<unsigned int> getColumn(unsigned int col) const;
 			std::vector<unsigned int> getRow(unsigned int row) const;
 
-			std::vector< std::vector<unsigned int> > square; //!< The Latin square.
-			
+			std::vector< std::vector<unsigned int> > getSquare(void) const;
+			bool setSquare(const std::vector< std::vector<unsigned int> >& square);
+
+			CX_DataFrame toDataFrame(void) const;
+			CX_DataFrame orderConditions(const CX_DataFrame& conditions, unsigned int row) const;
+			template <typename T> CX_DataFrame orderConditions(const CrossedDesign<T>& design, unsigned int row) const;
+
 		private:
-			size_t _columns;
+			std::vector<unsigned int> _values; // Row-major
+			unsigned int _rows;
+			unsigned int _columns;
+
+			bool _symbolIndices(std::vector<unsigned int>* indices) const;
 		};
 
+		std::vector<LatinSquare> generateOrthogonalLatinSquares(unsigned int dimensions, unsigned int count);
+
 
 		/*! This class implements a simple linear regression model that 
 		1. Collects samples of data over time using the store() function.
@@ -108,6 +250,10 @@ namespace CX {
 		4. With valid parameter values, calculates predicted x and y values with getX() and getY().
 		5. Does all of this in a thread-safe way.
 
+		The regression sums are updated as samples are stored and dropped, so updating the model
+		takes constant time regardless of `maxSamples`. Every `refitInterval` updates, the model is
+		refit from all of the stored data to keep rounding error from accumulating.
+
 		This class is semi-internal to CX and is not well-documented, but is publicly available.
 
 		\code{.cpp}
@@ -133,7 +279,7 @@ namespace CX {
 
 			RollingLinearModel(void);
 
-			void setup(bool autoUpdate, unsigned int maxSamples, unsigned int minSamples = 3);
+			void setup(bool autoUpdate, unsigned int maxSamples, unsigned int minSamples = 3, unsigned int refitInterval = 1000);
 
 			void store(double x, double y);
 			void storeMultiple(const std::vector<double>& x, const std::vector<double>& y);
@@ -179,6 +325,13 @@ namespace CX {
 
 			std::deque<Datum> _data;
 
+			void _pushDatum(double x, double y);
+
+			Util::RunningRegression _running; // sums for all of _data
+			bool _runningValid; // false if _data may have been modified without updating _running
+			unsigned int _refitInterval;
+			unsigned int _updatesSinceRefit;
+
 		};
 
 
@@ -296,6 +449,552 @@ namespace CX {
 		};
 
 
+		/*! This class is a random permutation of the integers `[0, n)` that is computed one element at a time, without
+		storing the permutation. Each element is found in (amortized) constant time by encrypting the index with a small 
+		Feistel network keyed by the seed, so very large sets of indices (e.g. all of the trials of a large design) can be
+		put in a random order without allocating memory for them. The same seed always gives the same permutation.
+
+		\code{.cpp}
+		Algo::IndexPermutation perm(10, RNG.randomInt());
+		for (uint64_t i = 0; i < perm.size(); i++) {
+			cout << perm(i) << " "; // Each of 0 to 9, once, in a random order
+		}
+		\endcode
+		*/
+		class IndexPermutation {
+		public:
+			IndexPermutation(void);
+			IndexPermutation(uint64_t n, uint64_t seed);
+
+			void setup(uint64_t n, uint64_t seed);
+
+			uint64_t operator()(uint64_t i) const;
+			uint64_t size(void) const;
+
+		private:
+			uint64_t _n;
+			unsigned int _halfBits;
+			uint64_t _halfMask;
+			uint64_t _keys[6];
+
+			uint64_t _encrypt(uint64_t x) const;
+		};
+
+		/*! This class represents a fully crossed factorial design (see fullyCross()) without materializing it. Each condition
+		(combination of factor levels) has an index, like the digits of a mixed-radix number in which the first factor is the 
+		most significant digit, so conditions can be looked up by index in constant time, iterated over, or streamed in a
+		random order, using very little memory regardless of the size of the design.
+
+		A design can also have:
+		+ Repetitions, so that each condition occurs more than once (indices `[0, getConditionCount())` are the first repetition,
+		and so on).
+		+ Exclusions, i.e. combinations of levels that should not occur. Excluded conditions are skipped when iterating
+		or shuffling.
+		+ Maximum run lengths for the levels of factors, which limit how many trials in a row may have the same level of a
+		factor in a shuffled order (see Shuffle).
+
+		\code{.cpp}
+		std::map<std::string, std::vector<std::string>> factors;
+		factors["color"] = { "red", "green", "blue" };
+		factors["size"] = { "small", "large" };
+		factors["side"] = { "left", "right" };
+
+		Algo::CrossedDesign<std::string> design(factors, 20); // 12 conditions, 20 repetitions each
+		design.addExclusion([](const std::vector<size_t>& levels) {
+			return levels[0] == 2 && levels[1] == 1; // No large blue stimuli (factors are in alphabetical order: color, side, size)
+		});
+		design.setMaxRunLength(1, 3); // No more than 3 trials in a row on the same side
+
+		Algo::CrossedDesign<std::string>::Shuffle trials = design.shuffle(RNG.randomInt());
+		uint64_t index;
+		while (trials.next(index)) {
+			std::vector<std::string> condition = design.getCondition(index);
+			// run a trial...
+		}
+		\endcode
+
+		\tparam T The type of the factor levels.
+		*/
+		template <typename T>
+		class CrossedDesign {
+		public:
+
+			CrossedDesign(void) :
+				_repetitions(1),
+				_cellCount(0)
+			{}
+
+			/*! \brief Construct a design. See setup(). */
+			CrossedDesign(const std::vector<std::vector<T>>& factors, uint64_t repetitions = 1) {
+				setup(factors, repetitions);
+			}
+
+			/*! \brief Construct a design with named factors. See setup(). */
+			CrossedDesign(const std::map<std::string, std::vector<T>>& factors, uint64_t repetitions = 1) {
+				setup(factors, repetitions);
+			}
+
+			/*! Set up the design. Exclusions and maximum run lengths are cleared.
+			\param factors A vector of factors, each factor being a vector of its levels.
+			\param repetitions The number of times that each condition occurs. */
+			void setup(const std::vector<std::vector<T>>& factors, uint64_t repetitions = 1) {
+				_factors = factors;
+				_repetitions = repetitions;
+
+				_factorNames.clear();
+				for (size_t f = 0; f < factors.size(); f++) {
+					_factorNames.push_back("factor" + ofToString(f));
+				}
+
+				_strides.assign(factors.size(), 1);
+				_cellCount = factors.empty() ? 0 : 1;
+				for (size_t f = factors.size(); f-- > 0; ) {
+					_strides[f] = _cellCount;
+					_cellCount *= factors[f].size();
+				}
+
+				_exclusions.clear();
+				_maxRunLengths.clear();
+			}
+
+			/*! Set up the design with named factors. The factors are ordered by name (the order of the `std::map`), which
+			is the order used by getCondition() and levelIndices().
+			\param factors A map from factor name to the levels of the factor.
+			\param repetitions The number of times that each condition occurs. */
+			void setup(const std::map<std::string, std::vector<T>>& factors, uint64_t repetitions = 1) {
+				std::vector<std::vector<T>> levels;
+				std::vector<std::string> names;
+				for (const std::pair<const std::string, std::vector<T>>& f : factors) {
+					names.push_back(f.first);
+					levels.push_back(f.second);
+				}
+				setup(levels, repetitions);
+				_factorNames = names;
+			}
+
+			/*! \brief The number of distinct conditions, i.e. the product of the numbers of levels of the factors. */
+			uint64_t getConditionCount(void) const {
+				return _cellCount;
+			}
+
+			/*! \brief The number of indices in the design, including excluded conditions: `getConditionCount() * repetitions`. */
+			uint64_t size(void) const {
+				return _cellCount * _repetitions;
+			}
+
+			size_t getFactorCount(void) const {
+				return _factors.size();
+			}
+
+			const std::vector<std::string>& getFactorNames(void) const {
+				return _factorNames;
+			}
+
+			/*! \brief Get the index of the level of `factor` in the condition with the given index. */
+			size_t levelIndex(uint64_t index, size_t factor) const {
+				return (size_t)(((index % _cellCount) / _strides[factor]) % _factors[factor].size());
+			}
+
+			/*! \brief Get the indices of the levels of all of the factors in the condition with the given index. */
+			std::vector<size_t> levelIndices(uint64_t index) const {
+				std::vector<size_t> rval(_factors.size());
+				for (size_t f = 0; f < _factors.size(); f++) {
+					rval[f] = levelIndex(index, f);
+				}
+				return rval;
+			}
+
+			/*! \brief Get the level of `factor` in the condition with the given index. */
+			const T& getLevel(uint64_t index, size_t factor) const {
+				return _factors[factor][levelIndex(index, factor)];
+			}
+
+			/*! \brief Get the levels of all of the factors in the condition with the given index. */
+			std::vector<T> getCondition(uint64_t index) const {
+				std::vector<T> rval;
+				rval.reserve(_factors.size());
+				for (size_t f = 0; f < _factors.size(); f++) {
+					rval.push_back(getLevel(index, f));
+				}
+				return rval;
+			}
+
+			/*! Exclude conditions from the design.
+			\param excluded A function that is given the level indices of a condition (see levelIndices()) and returns `true`
+			if the condition should be excluded. */
+			void addExclusion(std::function<bool(const std::vector<size_t>&)> excluded) {
+				_exclusions.push_back(excluded);
+			}
+
+			void clearExclusions(void) {
+				_exclusions.clear();
+			}
+
+			/*! \brief Returns `true` if the condition with the given index is excluded by any exclusion. */
+			bool isExcluded(uint64_t index) const {
+				if (_exclusions.empty()) {
+					return false;
+				}
+				std::vector<size_t> levels = levelIndices(index);
+				for (const std::function<bool(const std::vector<size_t>&)>& ex : _exclusions) {
+					if (ex(levels)) {
+						return true;
+					}
+				}
+				return false;
+			}
+
+			/*! Limit the number of consecutive trials that have the same level of a factor in shuffled orders (see shuffle()).
+			\param factor The index of the factor.
+			\param maxRunLength The maximum number of trials in a row with the same level. 0 removes the limit. */
+			void setMaxRunLength(size_t factor, unsigned int maxRunLength) {
+				if (factor >= _factors.size()) {
+					CX::Instances::Log.error("Algo::CrossedDesign") << "setMaxRunLength(): Factor index " << factor << " is out of range.";
+					return;
+				}
+				_maxRunLengths[factor] = maxRunLength;
+				if (maxRunLength == 0) {
+					_maxRunLengths.erase(factor);
+				}
+			}
+
+			/*! \brief Get the maximum run lengths of the factors (factor index -> maximum run length). */
+			const std::map<size_t, unsigned int>& getMaxRunLengths(void) const {
+				return _maxRunLengths;
+			}
+
+			/*! A forward iterator over the indices of the conditions that are not excluded, in order. */
+			class Iterator {
+			public:
+				typedef std::forward_iterator_tag iterator_category;
+				typedef uint64_t value_type;
+				typedef std::ptrdiff_t difference_type;
+				typedef const uint64_t* pointer;
+				typedef uint64_t reference;
+
+				Iterator(const CrossedDesign* design, uint64_t index) :
+					_design(design),
+					_index(index)
+				{
+					_skipExcluded();
+				}
+
+				uint64_t operator*(void) const {
+					return _index;
+				}
+
+				Iterator& operator++(void) {
+					_index++;
+					_skipExcluded();
+					return *this;
+				}
+
+				Iterator operator++(int) {
+					Iterator copy = *this;
+					++(*this);
+					return copy;
+				}
+
+				bool operator==(const Iterator& rhs) const {
+					return _index == rhs._index;
+				}
+
+				bool operator!=(const Iterator& rhs) const {
+					return _index != rhs._index;
+				}
+
+			private:
+				const CrossedDesign* _design;
+				uint64_t _index;
+
+				void _skipExcluded(void) {
+					while (_index < _design->size() && _design->isExcluded(_index)) {
+						_index++;
+					}
+				}
+			};
+
+			Iterator begin(void) const {
+				return Iterator(this, 0);
+			}
+
+			Iterator end(void) const {
+				return Iterator(this, size());
+			}
+
+			/*! A random order of the indices of the design that is generated one index at a time. Excluded conditions are 
+			skipped. If maximum run lengths are set (see CrossedDesign::setMaxRunLength()), an index that would make a run too
+			long is set aside and used as soon as it fits, so the order stays random and nothing is lost. If, at the end,
+			only indices that would make a run too long are left, they are used anyway and counted by getConstraintViolations().
+
+			The design must outlive the Shuffle and must not be modified while it is in use. */
+			class Shuffle {
+			public:
+				Shuffle(const CrossedDesign* design, uint64_t seed) :
+					_design(design),
+					_permutation(design->size(), seed)
+				{
+					restart();
+				}
+
+				/*! \brief Get the next index. Returns `false` if there are no more indices. */
+				bool next(uint64_t& index) {
+					// Near the end, all of the remaining indices are set aside so that the ones that are hardest to place
+					// can be placed first, which avoids being left with only indices that make a run too long.
+					if (!_design->getMaxRunLengths().empty() && _permutation.size() - _position <= EndgameSize) {
+						while (_position < _permutation.size()) {
+							uint64_t candidate = _permutation(_position++);
+							if (!_design->isExcluded(candidate)) {
+								_deferred.push_back(candidate);
+							}
+						}
+					}
+
+					// Set-aside indices are used first, as soon as they fit
+					auto best = _deferred.end();
+					size_t bestScore = 0;
+					for (auto it = _deferred.begin(); it != _deferred.end(); it++) {
+						if (!_fits(*it)) {
+							continue;
+						}
+						if (_position < _permutation.size()) {
+							best = it;
+							break;
+						}
+						size_t score = _levelFrequency(*it);
+						if (best == _deferred.end() || score > bestScore) {
+							best = it;
+							bestScore = score;
+						}
+					}
+					if (best != _deferred.end()) {
+						index = *best;
+						_deferred.erase(best);
+						_accept(index);
+						return true;
+					}
+
+					while (_position < _permutation.size()) {
+						uint64_t candidate = _permutation(_position++);
+						if (_design->isExcluded(candidate)) {
+							continue;
+						}
+						if (_fits(candidate)) {
+							index = candidate;
+							_accept(index);
+							return true;
+						}
+						_deferred.push_back(candidate);
+					}
+
+					if (_deferred.empty()) {
+						return false;
+					}
+
+					// Only indices that would make a run too long are left
+					index = _deferred.front();
+					_deferred.pop_front();
+					_violations++;
+					_accept(index);
+					return true;
+				}
+
+				/*! \brief Get up to `count` indices. */
+				std::vector<uint64_t> take(size_t count) {
+					std::vector<uint64_t> rval;
+					uint64_t index;
+					while (rval.size() < count && next(index)) {
+						rval.push_back(index);
+					}
+					return rval;
+				}
+
+				/*! \brief Start the same order over from the beginning. */
+				void restart(void) {
+					_position = 0;
+					_deferred.clear();
+					_violations = 0;
+					_lastLevels.clear();
+					_runLengths.clear();
+				}
+
+				/*! \brief The number of indices that had to be used even though they made a run too long. */
+				uint64_t getConstraintViolations(void) const {
+					return _violations;
+				}
+
+			private:
+				const CrossedDesign* _design;
+				IndexPermutation _permutation;
+				uint64_t _position;
+				std::deque<uint64_t> _deferred;
+				uint64_t _violations;
+
+				std::map<size_t, size_t> _lastLevels; // factor -> level of the last index
+				std::map<size_t, unsigned int> _runLengths; // factor -> length of the current run
+
+				static const uint64_t EndgameSize = 64;
+
+				// The number of set-aside indices that share the levels of constrained factors with `index`
+				size_t _levelFrequency(uint64_t index) const {
+					size_t count = 0;
+					for (uint64_t other : _deferred) {
+						for (const std::pair<const size_t, unsigned int>& limit : _design->getMaxRunLengths()) {
+							if (_design->levelIndex(other, limit.first) == _design->levelIndex(index, limit.first)) {
+								count++;
+							}
+						}
+					}
+					return count;
+				}
+
+				bool _fits(uint64_t index) const {
+					for (const std::pair<const size_t, unsigned int>& limit : _design->getMaxRunLengths()) {
+						auto last = _lastLevels.find(limit.first);
+						if (last != _lastLevels.end() && last->second == _design->levelIndex(index, limit.first) &&
+							_runLengths.at(limit.first) >= limit.second)
+						{
+							return false;
+						}
+					}
+					return true;
+				}
+
+				void _accept(uint64_t index) {
+					for (const std::pair<const size_t, unsigned int>& limit : _design->getMaxRunLengths()) {
+						size_t level = _design->levelIndex(index, limit.first);
+						auto last = _lastLevels.find(limit.first);
+						if (last != _lastLevels.end() && last->second == level) {
+							_runLengths[limit.first]++;
+						} else {
+							_lastLevels[limit.first] = level;
+							_runLengths[limit.first] = 1;
+						}
+					}
+				}
+			};
+
+			/*! \brief Get a random order of the design. The same seed always gives the same order. */
+			Shuffle shuffle(uint64_t seed) const {
+				return Shuffle(this, seed);
+			}
+
+			/*! \brief Get a random order of the design, seeded from `rng`. */
+			Shuffle shuffle(CX_RandomNumberGenerator& rng) const {
+				return Shuffle(this, (uint64_t)rng.randomInt());
+			}
+
+			/*! Copy the conditions with the given indices into a CX_DataFrame, with one row per index and one column
+			per factor (see getFactorNames()). */
+			CX_DataFrame copyConditions(const std::vector<uint64_t>& indices) const {
+				CX_DataFrame rval;
+				for (size_t i = 0; i < indices.size(); i++) {
+					for (size_t f = 0; f < _factors.size(); f++) {
+						rval(i, _factorNames[f]) = getLevel(indices[i], f);
+					}
+				}
+				return rval;
+			}
+
+		private:
+			std::vector<std::vector<T>> _factors;
+			std::vector<std::string> _factorNames;
+			uint64_t _repetitions;
+
+			std::vector<uint64_t> _strides; // The number of conditions between consecutive levels of each factor
+			uint64_t _cellCount;
+
+			std::vector<std::function<bool(const std::vector<size_t>&)>> _exclusions;
+			std::map<size_t, unsigned int> _maxRunLengths;
+		};
+
+		/*! This class puts trials in a random order that satisfies constraints on how trials of the same condition (level) 
+		are arranged:
+		+ A maximum run length: no more than `maxRunLength` trials in a row may have the same level.
+		+ A minimum distance: trials with the same level must be at least `minDistance` positions apart.
+		+ Balanced transitions: how often each level follows each other level is kept as even as possible.
+
+		Rather than shuffling over and over until a shuffle happens to satisfy the constraints, the order is built one
+		position at a time, choosing randomly among the levels that can go in that position without making the constraints 
+		impossible to satisfy for the rest of the order. If a choice leads to a dead end, the search backs up and tries another
+		choice. The amount of work is limited by `Configuration::maxSteps`, so the time taken is bounded. If the constraints
+		cannot be satisfied within that limit (or at all), the order is completed with as few violations as possible and a 
+		warning is logged. Trials with the same level are randomly ordered among themselves.
+
+		\code{.cpp}
+		CX_DataFrame trials = Algo::fullyCross(factors);
+		// ...add repetitions...
+
+		Algo::ConstrainedShuffler::Configuration config;
+		config.maxRunLength = 3; // No more than 3 trials in a row with the same target
+		config.balanceTransitions = true;
+
+		Algo::ConstrainedShuffler shuffler;
+		shuffler.setup(config);
+		shuffler.shuffleRows(trials, "target");
+		\endcode
+		*/
+		class ConstrainedShuffler {
+		public:
+
+			struct Configuration {
+				Configuration(void) :
+					maxRunLength(0),
+					minDistance(0),
+					balanceTransitions(false),
+					maxSteps(100000),
+					rng(nullptr)
+				{}
+
+				unsigned int maxRunLength; //!< The maximum number of consecutive trials with the same level. 0 means no limit.
+
+				/*! \brief The minimum distance between trials with the same level, where adjacent trials have distance 1.
+				For example, 3 means that there must be at least two other trials between trials with the same level.
+				0 or 1 means no limit. */
+				unsigned int minDistance;
+
+				/*! \brief If `true`, each level is followed by each level as equally often as possible. */
+				bool balanceTransitions;
+
+				/*! \brief The maximum number of placements (including those undone by backing up) to try before giving up on
+				satisfying the constraints exactly. */
+				unsigned int maxSteps;
+
+				/*! \brief The random number generator to use. If `nullptr`, CX::Instances::RNG is used. */
+				CX_RandomNumberGenerator* rng;
+			};
+
+			ConstrainedShuffler(void);
+
+			void setup(const Configuration& config);
+			Configuration getConfiguration(void) const;
+
+			std::vector<size_t> shuffle(const std::vector<std::string>& levels);
+			std::vector<CX_DataFrame::RowIndex> shuffle(const CX_DataFrame& df, std::string column);
+			bool shuffleRows(CX_DataFrame& df, std::string column);
+
+			size_t getViolationCount(void) const;
+
+		private:
+			Configuration _config;
+			CX_RandomNumberGenerator* _rng;
+			size_t _violations;
+
+			// State of the search over level sequences. Levels are numbered from 0.
+			struct SearchState {
+				std::vector<size_t> remaining; // Remaining count of each level
+				std::vector<size_t> lastPosition; // Last position of each level, or SIZE_MAX
+				std::vector<std::vector<unsigned int>> transitions; // [from][to]
+				size_t runLevel;
+				size_t runLength;
+			};
+
+			bool _allowed(const SearchState& state, size_t level, size_t position) const;
+			bool _feasible(const SearchState& state, size_t position) const;
+			std::vector<size_t> _orderCandidates(const SearchState& state, size_t previous);
+			std::vector<size_t> _shuffleLevels(const std::vector<size_t>& counts);
+		};
+
 		/*! This algorithm is designed to deal with the situation in which a number
 		of random values must be generated that are each at least some distance from every other
 		random value. This is a very generic implementation of this algorithm. It works by taking
@@ -325,6 +1024,9 @@ namespace CX {
 		\return A vector of values. If the function terminated prematurely due to maxSequentialFailures being reached, the
 		returned vector will have 0 elements.
 
+		\note Each candidate is compared with every accepted value, so this gets slow for many values. For 2D or 3D points with
+		Euclidean distance, use PoissonDiskSampler or generateSeparatedPoints() instead.
+
 		\code{.cpp}
 		//This example function generates locCount points with both x and y values bounded by minimumValues and maximumValues that
 		//are at least minDistance from each other.
@@ -398,6 +1100,8 @@ namespace CX {
 		\return A vector of crossed factor levels. It's length is equal to the product of the levels of the factors.
 		The length of each "row" is equal to the number of factors.
 
+		\note This stores every condition. For large designs, use CrossedDesign, which looks up conditions by index.
+
 		Example use:
 		\code{.cpp}
 		std::vector< std::vector<int> > levels(2); //Two factors
@@ -421,39 +1125,13 @@ namespace CX {
 		*/
 		template <typename T>
 		std::vector< std::vector<T> > fullyCross (std::vector< std::vector<T> > factors) {
+			CrossedDesign<T> design(factors);
 
-			unsigned int crossedLevels = 1;
-			for (unsigned int factor = 0; factor < factors.size(); factor++) {
-				crossedLevels *= factors[factor].size();
+			std::vector< std::vector<T> > rval;
+			rval.reserve((size_t)design.getConditionCount());
+			for (uint64_t index : design) {
+				rval.push_back(design.getCondition(index));
 			}
-
-			std::vector< std::vector<T> > formatOne(factors.size());
-			unsigned int lback = 1;
-			for (unsigned int factor = 0; factor < factors.size(); factor++) {
-
-				unsigned int lcurrent = factors[factor].size();
-				unsigned int lforward = crossedLevels / (lback * lcurrent);
-
-				for (unsigned int b = 0; b < lback; b++) {
-					for (unsigned int c = 0; c < lcurrent; c++) {
-						for (unsigned int f = 0; f < lforward; f++) {
-							formatOne[factor].push_back(factors[factor][c]);
-						}
-					}
-				}
-
-				lback *= lcurrent;
-			}
-
-			//Now we have the data, but in wrong format, so transpose it.
-			std::vector< std::vector<T> > rval(crossedLevels);
-			for (unsigned int level = 0; level < crossedLevels; level++) {
-				rval[level].resize( factors.size() );
-				for (unsigned int factor = 0; factor < factors.size(); factor++) {
-					rval[level][factor] = formatOne[factor][level];
-				}
-			}
-
 			return rval;
 		}
 
@@ -484,26 +1162,36 @@ namespace CX {
 		*/
 		template <typename T>
 		CX_DataFrame fullyCross(std::map<std::string, std::vector<T>>& factors) {
-	
-			std::vector< std::string > factorNames;
-			std::vector< std::vector<T> > vFactors;
+			CrossedDesign<T> design(factors);
 
-			for (std::pair<std::string, std::vector<T>> f : factors) {
-				factorNames.push_back(f.first);
-				vFactors.push_back(f.second);
-			}
-
-			std::vector< std::vector<T> > crossed = fullyCross(vFactors);
+			std::vector<uint64_t> indices(design.begin(), design.end());
+			return design.copyConditions(indices);
+		}
 
-			CX::CX_DataFrame rval;
+		/*! Get the conditions of a crossed design in the order given by a row of the Latin square. The values in the
+		square are used as condition indices into `design` (see CrossedDesign::getCondition()), so the square should have
+		`design.getConditionCount()` columns.
+		\param design The design.
+		\param row The row of the square to use, e.g. `participantNumber % rows()`.
+		\return A CX_DataFrame with one row per column of the square and one column per factor of the design. If `row` is
+		out of range or the square contains values that are not indices into `design`, an empty CX_DataFrame is returned. */
+		template <typename T>
+		CX_DataFrame LatinSquare::orderConditions(const CrossedDesign<T>& design, unsigned int row) const {
+			if (row >= rows()) {
+				CX::Instances::Log.error("Algo::LatinSquare") << "orderConditions(): Row " << row << " is out of range.";
+				return CX_DataFrame();
+			}
 
-			for (unsigned int i = 0; i < crossed.size(); i++) {
-				for (unsigned int f = 0; f < crossed.at(i).size(); f++) {
-					rval(i, factorNames.at(f)) = crossed.at(i).at(f);
+			std::vector<uint64_t> indices(columns());
+			for (unsigned int j = 0; j < columns(); j++) {
+				indices[j] = at(row, j);
+				if (indices[j] >= design.size()) {
+					CX::Instances::Log.error("Algo::LatinSquare") << "orderConditions(): The square contains value " << indices[j] <<
+						", which is not a condition index of the design.";
+					return CX_DataFrame();
 				}
 			}
-
-			return rval;
+			return design.copyConditions(indices);
 		}
 
 
@@ -12,6 +12,7 @@ CX_Clock CX::Instances::Clock;
 CX_Clock::CX_Clock(void) {
 	_regularEvent.enabled = false;
 	_regularEvent.period = CX_Millis(10);
+	_regularEvent.timerId = CX_TimerScheduler::InvalidTimerId;
 }
 
 /*! Set up the CX_Clock with the given clock implementation or choose the best available implementation.
@@ -240,17 +241,26 @@ std::string CX_Clock::getDateTimeString(const std::string& format) const {
 	return Poco::DateTimeFormatter::format(localTime, format);
 }
 
+/*! Enable or disable `regularEvent`. The event is notified from a secondary thread, so listeners
+must be thread safe. Notifications are scheduled on an absolute timeline (see CX_TimerScheduler),
+so the event does not drift even if listeners take some time to run.
+\param enable If `true`, the event is enabled.
+*/
 void CX_Clock::enableRegularEvent(bool enable) {
 	std::lock_guard<std::recursive_mutex> lock(_regularEvent.mutex);
 
+	if (enable == _regularEvent.enabled) {
+		return;
+	}
+
 	if (enable) {
-		if (_regularEvent.enabled) {
-			return;
-		} else {
-			_regularEvent.enabled = true; // enable first
-			_regularEvent.thread = std::thread(std::bind(&CX_Clock::_regularEventThreadFunction, this));
-		}
+		_regularEvent.timerId = _regularEvent.scheduler.addTimer(_regularEvent.period, [this](const CX_TimerScheduler::TickInfo&) {
+			ofNotifyEvent(this->regularEvent);
+		});
+		_regularEvent.enabled = (_regularEvent.timerId != CX_TimerScheduler::InvalidTimerId);
 	} else {
+		_regularEvent.scheduler.removeTimer(_regularEvent.timerId);
+		_regularEvent.timerId = CX_TimerScheduler::InvalidTimerId;
 		_regularEvent.enabled = false;
 	}
 }
@@ -260,9 +270,21 @@ bool CX_Clock::isRegularEventEnabled(void) {
 	return _regularEvent.enabled;
 }
 
+/*! Set the period of `regularEvent`. If the event is enabled, the next notification happens
+on the old schedule and subsequent notifications use the new period.
+\param period The period. Must be greater than 0.
+*/
 void CX_Clock::setRegularEventPeriod(CX_Millis period) {
+	if (period <= CX_Millis(0)) {
+		Instances::Log.error("CX_Clock") << "setRegularEventPeriod(): period must be greater than 0.";
+		return;
+	}
+
 	std::lock_guard<std::recursive_mutex> lock(_regularEvent.mutex);
 	_regularEvent.period = period;
+	if (_regularEvent.enabled) {
+		_regularEvent.scheduler.setTimerPeriod(_regularEvent.timerId, period);
+	}
 }
 
 CX_Millis CX_Clock::getRegularEventPeriod(void) {
@@ -270,24 +292,18 @@ CX_Millis CX_Clock::getRegularEventPeriod(void) {
 	return _regularEvent.period;
 }
 
-void CX_Clock::_regularEventThreadFunction(void) {
-
-	bool threadRunning = true;
-	while (threadRunning) {
-		_regularEvent.mutex.lock();
-		threadRunning = _regularEvent.enabled;
-		CX_Millis period = _regularEvent.period;
-		_regularEvent.mutex.unlock();
-
-		if (!threadRunning) {
-			break;
-		}
-
-		this->sleep(period);
-
-		ofNotifyEvent(this->regularEvent);
-	}
+/*! Get statistics about how late notifications of `regularEvent` have been relative to their
+scheduled times. If the event is not enabled, all values are 0. */
+CX_TimerScheduler::LatenessStatistics CX_Clock::getRegularEventLatenessStatistics(void) {
+	std::lock_guard<std::recursive_mutex> lock(_regularEvent.mutex);
+	return _regularEvent.scheduler.getLatenessStatistics(_regularEvent.timerId);
+}
 
+/*! Get the scheduler that runs `regularEvent`. It can be configured with CX_TimerScheduler::setup()
+(e.g. to request real-time priority) and other timers can be added to it, which share the thread
+with `regularEvent`. */
+CX_TimerScheduler* CX_Clock::getRegularEventScheduler(void) {
+	return &_regularEvent.scheduler;
 }
 
 /*! Tests the precision, with `testImplPrecision()`, of all of the clock implementations that are built-in to CX and chooses the 
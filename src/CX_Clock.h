@@ -16,6 +16,7 @@
 #include "CX_Utilities.h"
 #include "CX_Logger.h"
 #include "CX_Time_t.h"
+#include "CX_TimerScheduler.h"
 
 /*! \defgroup timing Timing
 This module provides methods for timestamping events in experiments.
@@ -97,19 +98,21 @@ namespace CX {
 		bool isRegularEventEnabled(void);
 		void setRegularEventPeriod(CX_Millis period);
 		CX_Millis getRegularEventPeriod(void);
+		CX_TimerScheduler::LatenessStatistics getRegularEventLatenessStatistics(void);
 		ofEvent<void> regularEvent;
 
+		CX_TimerScheduler* getRegularEventScheduler(void);
+
 	private:
 		std::unique_ptr<Poco::LocalDateTime> _pocoExperimentStart;
 
 		std::shared_ptr<CX_BaseClockInterface> _impl;
 
-		
-		void _regularEventThreadFunction(void);
 
 		struct {
 			std::recursive_mutex mutex;
-			std::thread thread;
+			CX_TimerScheduler scheduler;
+			CX_TimerScheduler::TimerId timerId;
 			CX_Millis period;
 			bool enabled;
 		} _regularEvent;
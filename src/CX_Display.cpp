@@ -13,6 +13,7 @@ CX_Display::CX_Display(void) :
 	_framePeriod(0),
 	_framePeriodStandardDeviation(0),
 	_softVSyncWithGLFinish(false),
+	_swapBackend(nullptr),
 	_dispThread(this, &CX_Display::_swapBuffers)
 {}
 
@@ -299,10 +300,29 @@ void CX_Display::swapBuffers(void) {
 }
 
 void CX_Display::_swapBuffers(void) {
-	Private::swapVideoBuffers(_softVSyncWithGLFinish);
+	CX_DisplaySwapBackend* backend = _swapBackend.load(std::memory_order_acquire);
+	if (backend) {
+		backend->swapBuffers();
+	} else {
+		Private::swapVideoBuffers(_softVSyncWithGLFinish);
+	}
 	swapData.storeSwap(Instances::Clock.now());
 }
 
+/*! Replace the buffer swaps of the display with `backend`, e.g. a CX_SimulatedDisplay. All swaps, whether made with swapBuffers()
+or by the display thread, go through the backend and are stored in `swapData` as usual.
+
+Only the swaps are replaced: drawing still uses the rendering context of the display.
+\param backend The backend to use, or `nullptr` to swap the video buffers again. The backend must stay alive while it is set. */
+void CX_Display::setSwapBackend(CX_DisplaySwapBackend* backend) {
+	_swapBackend.store(backend, std::memory_order_release);
+}
+
+/*! \brief Get the backend set with setSwapBackend(), or `nullptr` if the video buffers are swapped directly. */
+CX_DisplaySwapBackend* CX_Display::getSwapBackend(void) {
+	return _swapBackend.load(std::memory_order_acquire);
+}
+
 
 /*! This function cues `count` swaps of the front and back buffers. It avoids blocking
 (like `swapBuffers()` does) by spawning a thread in which the swap is waited for. 
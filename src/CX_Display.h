@@ -10,6 +10,7 @@ draw stimuli with openFrameworks: See the graphics and 3d sections of this page:
 */
 
 #include <deque>
+#include <atomic>
 
 #include "ofThread.h"
 #include "ofRectangle.h"
@@ -28,6 +29,24 @@ draw stimuli with openFrameworks: See the graphics and 3d sections of this page:
 
 namespace CX {
 
+	/*! An interface for replacing the way that CX_Display swaps the front and back buffers. When a backend is set with
+	CX_Display::setSwapBackend(), every buffer swap made by the display, including swaps made by the display thread, by
+	CX_DisplaySwapper, and during slide presentation, calls the backend instead of swapping the video buffers. The swap is then
+	stored in CX_Display::swapData as usual.
+
+	See CX_SimulatedDisplay for an implementation.
+
+	\ingroup video
+	*/
+	class CX_DisplaySwapBackend {
+	public:
+		virtual ~CX_DisplaySwapBackend(void) {}
+
+		/*! Swap the buffers. Like a swap with vertical synchronization, this must return once the swap has happened.
+		This may be called from the main thread or from the display thread. */
+		virtual void swapBuffers(void) = 0;
+	};
+
 
 	/*! This class represents an abstract visual display surface, which is my way of saying that it doesn't
 	necessarily represent a monitor. The display surface can either be a window or, if full screen, the whole
@@ -65,6 +84,8 @@ namespace CX {
 		void endDrawingToBackBuffer(void);
 
 		void swapBuffers(void);
+		void setSwapBackend(CX_DisplaySwapBackend* backend);
+		CX_DisplaySwapBackend* getSwapBackend(void);
 		//void swapAt(CX_Millis time); // blocking function for really basic synchronization?
 
 		// main class
@@ -134,6 +155,8 @@ namespace CX {
 
 		bool _softVSyncWithGLFinish;
 
+		std::atomic<CX_DisplaySwapBackend*> _swapBackend;
+
 		// display thread stuff
 		CX_DisplayThread _dispThread;
 
@@ -9,19 +9,42 @@ bool CX_DisplaySwapper::setup(const Configuration& config) {
 		return false;
 	}
 
-	_config = config;
+	// Work on a copy so that this swapper is left as it was if setup fails.
+	Configuration newConfig = config;
 
-	if (!_config.client) {
-		_config.client = &_config.display->swapClient;
+	if (!newConfig.client) {
+		newConfig.client = &newConfig.display->swapClient;
 	}
 
 	if (config.preSwapSafetyBuffer < CX_Millis(1)) {
 		Instances::Log.warning("CX_DisplaySwapper") << "setup(): config.preSwapSafetyBuffer was less than 1 millisecond. It is recommended that preSwapSafetyBuffer be at least one millisecond.";
-		if (_config.preSwapSafetyBuffer < CX_Millis(0)) {
-			_config.preSwapSafetyBuffer = CX_Millis(0);
+		if (newConfig.preSwapSafetyBuffer < CX_Millis(0)) {
+			newConfig.preSwapSafetyBuffer = CX_Millis(0);
 		}
 	}
 
+	std::unique_ptr<Sync::RobustModel> newModel;
+
+	if (newConfig.mode == Mode::RobustPrediction) {
+
+		if (!newConfig.robustModel.dataContainer) {
+			newConfig.robustModel.dataContainer = &newConfig.display->swapData;
+		}
+
+		if (newConfig.robustModel.sampleSize == 0) {
+			newConfig.robustModel.sampleSize = newConfig.client->lm.getConfiguration().sampleSize;
+		}
+
+		newModel.reset(new Sync::RobustModel);
+		if (!newModel->setup(newConfig.robustModel)) {
+			Instances::Log.error("CX_DisplaySwapper") << "setup(): The robust model could not be set up. The previous configuration is kept.";
+			return false;
+		}
+	}
+
+	_config = newConfig;
+	_robustModel = std::move(newModel);
+
 	return true;
 }
 
@@ -31,15 +54,24 @@ const CX_DisplaySwapper::Configuration& CX_DisplaySwapper::getConfiguration(void
 
 
 bool CX_DisplaySwapper::shouldSwap(void) const {
+	return getTimeUntilSwapWindow() < CX_Millis(0);
+}
+
+/*! Get the amount of time until shouldSwap() will become `true`, i.e. until `preSwapSafetyBuffer` before the
+earliest likely time of the next swap. Once the swap window is open, this is negative. This can be used to
+sleep until shortly before the swap window instead of polling shouldSwap(). */
+CX_Millis CX_DisplaySwapper::getTimeUntilSwapWindow(void) const {
 
 	switch (_config.mode) {
 	case Mode::NominalPeriod:
-		return _NominalPeriod_shouldSwap();
+		return _NominalPeriod_timeUntilSwapWindow();
 	case Mode::Prediction:
-		return _Prediction_shouldSwap();
+		return _Prediction_timeUntilSwapWindow();
+	case Mode::RobustPrediction:
+		return _RobustPrediction_timeUntilSwapWindow();
 	}
 
-	return false;
+	return CX_Millis::max();
 }
 
 // true if swap happened
@@ -57,18 +89,18 @@ bool CX_DisplaySwapper::trySwap(void) {
 	return true;
 }
 
-bool CX_DisplaySwapper::_NominalPeriod_shouldSwap(void) const {
+CX_Millis CX_DisplaySwapper::_NominalPeriod_timeUntilSwapWindow(void) const {
 
 	// TODO: cache the value of getFramePeriod somehow?
 	CX_Millis nextSwapEst = _config.display->getLastSwapTime() + _config.display->getFramePeriod();
 
 	CX_Millis timeToSwap = nextSwapEst - Instances::Clock.now();
 
-	return timeToSwap < _config.preSwapSafetyBuffer;
+	return timeToSwap - _config.preSwapSafetyBuffer;
 
 }
 
-bool CX_DisplaySwapper::_Prediction_shouldSwap(void) const {
+CX_Millis CX_DisplaySwapper::_Prediction_timeUntilSwapWindow(void) const {
 	Sync::TimePrediction tp = _config.client->predictNextSwapTime();
 
 	if (tp.usable) {
@@ -77,11 +109,44 @@ bool CX_DisplaySwapper::_Prediction_shouldSwap(void) const {
 
 		CX_Millis minTimeToSwap = tp.lowerBound();
 
-		return minTimeToSwap < _config.preSwapSafetyBuffer;
+		return minTimeToSwap - _config.preSwapSafetyBuffer;
+
+	}
+
+	return _NominalPeriod_timeUntilSwapWindow();
+}
+
+CX_Millis CX_DisplaySwapper::_RobustPrediction_timeUntilSwapWindow(void) const {
+
+	if (!_robustModel) {
+		// setup() only selects this mode with a model, but fall back rather than dereferencing null.
+		return _NominalPeriod_timeUntilSwapWindow();
+	}
+
+	Sync::RobustModel::FittedModel fm = _robustModel->copyFittedModel();
+
+	if (fm.fittedSuccessfully) {
+
+		Sync::TimePrediction tp = fm.predictTime(_config.robustModel.dataContainer->getNextSwapUnit());
+
+		tp.pred -= Instances::Clock.now();
+
+		CX_Millis minTimeToSwap = tp.lowerBound();
+
+		return minTimeToSwap - _config.preSwapSafetyBuffer;
 
 	}
 
-	return _NominalPeriod_shouldSwap();
+	return _NominalPeriod_timeUntilSwapWindow();
+}
+
+/*! Get statistics about the residuals of the robust swap time model. Only available if the mode is
+`Mode::RobustPrediction`. Otherwise, a default-constructed value is returned. */
+Sync::RobustModel::ResidualStatistics CX_DisplaySwapper::getResidualStatistics(void) const {
+	if (!_robustModel) {
+		return Sync::RobustModel::ResidualStatistics();
+	}
+	return _robustModel->getResidualStatistics();
 }
 
 
@@ -11,7 +11,8 @@ class CX_DisplaySwapper {
 public:
 	enum class Mode {
 		NominalPeriod,
-		Prediction // with NominalPeriod as backup
+		Prediction, // with NominalPeriod as backup
+		RobustPrediction // Sync::RobustModel, with NominalPeriod as backup
 	};
 
 	struct Configuration {
@@ -29,19 +30,30 @@ public:
 		CX_Millis preSwapSafetyBuffer;
 
 		Mode mode;
+
+		// Only used if mode is RobustPrediction. If robustModel.dataContainer is nullptr, the display's swap data are used.
+		// If robustModel.sampleSize is 0, the sample size of the client's LinearModel is used.
+		Sync::RobustModel::Configuration robustModel;
 	};
 
 	bool setup(const Configuration& config);
 	const Configuration& getConfiguration(void) const;
 
 	bool shouldSwap(void) const;
+	CX_Millis getTimeUntilSwapWindow(void) const;
 	bool trySwap(void); // true if swap happened
 
+	Sync::RobustModel::ResidualStatistics getResidualStatistics(void) const;
+
 private:
 	Configuration _config;
 
-	bool _NominalPeriod_shouldSwap(void) const;
-	bool _Prediction_shouldSwap(void) const;
+	std::unique_ptr<Sync::RobustModel> _robustModel;
+
+	// Time remaining until the swap window opens (negative once it is open)
+	CX_Millis _NominalPeriod_timeUntilSwapWindow(void) const;
+	CX_Millis _Prediction_timeUntilSwapWindow(void) const;
+	CX_Millis _RobustPrediction_timeUntilSwapWindow(void) const;
 
 };
 
@@ -2,6 +2,8 @@
 
 #include "CX_Display.h"
 #include "CX_Private.h"
+#include "CX_SlideQueue.h"
+#include "CX_FrameTelemetry.h"
 
 namespace CX {
 namespace Private {
@@ -22,7 +24,10 @@ CX_DisplayThread::~CX_DisplayThread(void) {
 CX_DisplayThread::CX_DisplayThread(CX_Display* disp, std::function<void(CX_Display*)> swapFun) :
 	_threadRunning(false),
 	_hasSwappedSinceLastCheck(false),
-	_display(disp)
+	_wakeRequested(false),
+	_display(disp),
+	_slideQueue(new CX_SlideQueue(disp)),
+	_telemetry(new CX_FrameTelemetry(disp))
 {
 	_bufferSwapFunction = std::bind(swapFun, disp);
 }
@@ -42,7 +47,8 @@ bool CX_DisplayThread::setup(Configuration config, bool startThread) {
 		dsc.display = _display;
 		dsc.client = &_display->swapClient;
 		dsc.preSwapSafetyBuffer = config.preSwapSafetyBuffer;
-		dsc.mode = CX_DisplaySwapper::Mode::Prediction;
+		dsc.mode = config.swapMode;
+		dsc.robustModel = config.robustModel;
 
 		if (!_displaySwapper.setup(dsc)) {
 			return false;
@@ -105,6 +111,8 @@ void CX_DisplayThread::stopThread(bool wait) {
 	_threadRunning = false;
 	_mutex.unlock(); // Essential unlock before waiting on thread, which must check state of _threadRunning in order to exit.
 
+	wakeThread();
+
 	if (wait) {
 		_thread.join();
 	}
@@ -116,6 +124,24 @@ bool CX_DisplayThread::isThreadRunning(void) {
 	return _threadRunning;
 }
 
+/*! If the thread is sleeping (see `SchedulingMode::Sleep`), wake it up so that it processes queued commands and slides
+immediately. This is done automatically when commands or slides are queued. */
+void CX_DisplayThread::wakeThread(void) {
+	{
+		std::lock_guard<std::mutex> lock(_wakeMutex);
+		_wakeRequested = true;
+	}
+	_wakeCondition.notify_one();
+}
+
+void CX_DisplayThread::_sleepUntilWoken(CX_Millis maxSleep) {
+	std::unique_lock<std::mutex> lock(_wakeMutex);
+
+	_wakeCondition.wait_for(lock, std::chrono::nanoseconds(maxSleep.nanos()), [this]() { return _wakeRequested; });
+
+	_wakeRequested = false;
+}
+
 
 bool CX_DisplayThread::isSwappingStably(void) {
 	// don't need to lock mutex because _display cannot change
@@ -126,6 +152,13 @@ bool CX_DisplayThread::waitForStableSwapping(CX_Millis timeout) {
 	return this->_display->swapClient.verifier.waitForStableSwapping(timeout);
 }
 
+/*! Get residual statistics for the robust swap time model. Only meaningful if the thread was set up with
+`Configuration::swapMode` set to `CX_DisplaySwapper::Mode::RobustPrediction`. */
+Sync::RobustModel::ResidualStatistics CX_DisplayThread::getSwapResidualStatistics(void) {
+	std::lock_guard<std::recursive_mutex> lock(_mutex);
+	return _displaySwapper.getResidualStatistics();
+}
+
 
 void CX_DisplayThread::_threadFunction(void) {
 
@@ -141,13 +174,21 @@ void CX_DisplayThread::_threadFunction(void) {
 		_processQueuedCommands();
 
 		//CX_Millis preSwapSafetyBuffer = _config.preSwapSafetyBuffer;
+		SchedulingMode schedulingMode = _config.schedulingMode;
+		CX_Millis spinWindow = _config.spinWindow;
 
 		_mutex.unlock(); // --- UNLOCK
 		
 		ofNotifyEvent(updateEvent);
 
-		if (_displaySwapper.shouldSwap()) {
+		CX_Millis timeUntilSwapWindow = _displaySwapper.getTimeUntilSwapWindow();
+
+		if (timeUntilSwapWindow < CX_Millis(0)) {
 			_swap();
+		} else if (schedulingMode == SchedulingMode::Sleep && timeUntilSwapWindow > spinWindow) {
+			// Never sleep for more than a frame, in case the prediction is far off
+			CX_Millis sleepFor = std::min(timeUntilSwapWindow - spinWindow, _display->getFramePeriod());
+			_sleepUntilWoken(sleepFor);
 		} else {
 			std::this_thread::yield();
 		}
@@ -177,16 +218,38 @@ void CX_DisplayThread::_threadFunction(void) {
 
 void CX_DisplayThread::_swap(void) {
 
+	bool recordTelemetry = _telemetry->isRecording();
+
+	CX_FrameTelemetry::Record record;
+	if (recordTelemetry) {
+		// Not predictNextSwapTime(), which replaces an unusable model prediction with the last swap plus the nominal
+		// period and reports it as usable.
+		Sync::TimePrediction tp = _display->swapClient.predictSwapTime(_display->swapData.getNextSwapUnit());
+		record.predictionUsable = tp.usable;
+		if (tp.usable) {
+			record.predictedSwapTime = tp.prediction();
+			record.predictionHalfWidth = tp.predictionIntervalHalfWidth;
+		}
+		record.requestTime = Instances::Clock.now();
+	}
+
 	_bufferSwapFunction();
 
 	_mutex.lock();
 
 	_hasSwappedSinceLastCheck = true;
 
-	_queuedFramePostSwapTask();
+	_queuedFramePostSwapTask(&record.preRenderCompleteTime, &record.renderCompleteTime);
 
 	_mutex.unlock();
 
+	if (recordTelemetry) {
+		Sync::SwapData lastSwap = _display->swapData.getLastSwapData();
+		record.unit = lastSwap.unit;
+		record.swapTime = lastSwap.time;
+		_telemetry->_recordSwap(record);
+	}
+
 }
 
 
@@ -199,9 +262,12 @@ bool CX_DisplayThread::_queueCommand(std::shared_ptr<Command> cmd, bool wait) {
 
 	if (!wait) {
 		// If not waiting, push the command into the queue for the thread to process
-		std::lock_guard<std::recursive_mutex> lock(_commandQueueMutex);
+		{
+			std::lock_guard<std::recursive_mutex> lock(_commandQueueMutex);
+			_commandQueue.push_back(cmd);
+		}
 
-		_commandQueue.push_back(cmd);
+		wakeThread();
 
 		return false;
 	}
@@ -226,6 +292,8 @@ bool CX_DisplayThread::_queueCommand(std::shared_ptr<Command> cmd, bool wait) {
 	_commandQueue.push_back(cmd);
 	_commandQueueMutex.unlock();
 
+	wakeThread();
+
 	while (!signal) {
 		std::this_thread::yield();
 	}
@@ -466,69 +534,55 @@ bool CX_DisplayThread::_acquireRenderingContext(bool acquire) {
 	return true;
 }
 
-bool CX_DisplayThread::queueFrame(std::shared_ptr<QueuedFrame> qf) {
+/*! Get the slide queue, which renders slides ahead on the display thread and presents them on their start frames.
+The frame queue must be enabled (see enableFrameQueue()) for the slide queue to be used. */
+CX_SlideQueue* CX_DisplayThread::getSlideQueue(void) {
+	return _slideQueue.get();
+}
 
-	if (!isThreadRunning()) {
-		Instances::Log.warning("CX_DisplayThread") << "Queued frame for frame number " << qf->startFrame <<
-			" ignored because the display thread was not running.";
-		return false;
-	}
+/*! Get the frame telemetry recorder, which records timing information about every swap made by the display thread.
+Recording starts when CX_FrameTelemetry::setup() is called. */
+CX_FrameTelemetry* CX_DisplayThread::getTelemetry(void) {
+	return _telemetry.get();
+}
 
-	if (!frameQueueEnabled()) {
-		Instances::Log.warning("CX_DisplayThread") << "Queued frame for frame number " << qf->startFrame <<
-			" ignored because frame queue was disabled.";
-		return false;
-	}
+// The queued frame functions are wrappers around the slide queue.
+bool CX_DisplayThread::queueFrame(std::shared_ptr<QueuedFrame> qf) {
 
 	if (qf->fbo == nullptr && qf->fun == nullptr) {
 		// fail: not set up. This should be impossible with a good interface
 		return false;
 	}
 
-	{
-		std::lock_guard<std::recursive_mutex> lock(_mutex);
-		
-		FrameNumber lastFrameNumber = _display->swapData.getLastSwapUnit();
-		if (qf->startFrame <= lastFrameNumber) {
-			Instances::Log.warning("CX_DisplayThread") << "Queued frame for frame number " << qf->startFrame <<
-				" arrived late (on frame number " << lastFrameNumber << ") and was ignored.";
-			return false;
-		}
-	}
-
-	std::lock_guard<std::recursive_mutex> qfLock(_queuedFramesMutex);
-
-	int existingFrameIndex = -1;
-	int nextGreaterIndex = 0;
-	for (int i = 0; i < _queuedFrames.size(); i++) {
-		if (_queuedFrames[i]->startFrame == qf->startFrame) {
-			existingFrameIndex = i;
-			break;
-		}
-		if (_queuedFrames[i]->startFrame < qf->startFrame) {
-			nextGreaterIndex = i + 1;
-		}
+	CX_SlideBuffer::Slide slide;
+	slide.intended.startFrame = qf->startFrame;
+	slide.intended.frameDuration = 1;
+	if (qf->fbo != nullptr) {
+		slide.framebuffer = qf->fbo;
+	} else {
+		slide.drawingFunction = qf->fun;
 	}
 
-	if (existingFrameIndex >= 0) {
-
-		Instances::Log.notice("CX_DisplayThread") << "Queued frame for frame number " << qf->startFrame << " replaced.";
-		_queuedFrames[existingFrameIndex] = qf;
-
-	} else if (nextGreaterIndex < _queuedFrames.size()) {
-
-		auto it = _queuedFrames.begin() + nextGreaterIndex;
-		_queuedFrames.insert(it, qf);
-
-		Instances::Log.notice("CX_DisplayThread") << "Queued frame for frame number " << qf->startFrame << " inserted.";
+	CX_SlideQueue::SlideCallback callback = nullptr;
+	if (qf->frameCompleteCallback != nullptr) {
+		std::function<void(QueuedFrameResult&&)> frameCompleteCallback = qf->frameCompleteCallback;
+		callback = [frameCompleteCallback](const CX_SlideQueue::SlideResult& sr) {
+			if (sr.dropped) {
+				return;
+			}
 
-	} else {
-		_queuedFrames.push_back(qf);
+			QueuedFrameResult result;
+			result.desiredStartFrame = sr.desiredStartFrame;
+			result.actualStartFrame = sr.actualStartFrame;
+			result.startTime = sr.startTime;
+			result.renderTimeValid = sr.renderTimeValid;
+			result.renderCompleteTime = sr.renderCompleteTime;
 
-		Instances::Log.notice("CX_DisplayThread") << "Queued frame for frame number " << qf->startFrame << " appended.";
+			frameCompleteCallback(std::move(result));
+		};
 	}
 
-	return true;
+	return _slideQueue->queueSlide(slide, callback);
 }
 
 bool CX_DisplayThread::queueFrame(FrameNumber startFrame, std::function<void(void)> fun, std::function<void(QueuedFrameResult&&)> frameCompleteCallback) {
@@ -552,33 +606,7 @@ bool CX_DisplayThread::queueFrame(FrameNumber startFrame, std::shared_ptr<ofFbo>
 }
 
 bool CX_DisplayThread::requeueFrame(FrameNumber oldFrame, FrameNumber newFrame) {
-	std::lock_guard<std::recursive_mutex> qfLock(_queuedFramesMutex);
-
-	unsigned int oldFrameIndex = _queuedFrames.size();
-	unsigned int newFrameIndex = _queuedFrames.size();
-	for (unsigned int i = 0; i < _queuedFrames.size(); i++) {
-		if (_queuedFrames[i]->startFrame == oldFrame) {
-			oldFrameIndex = i;
-		}
-		if (_queuedFrames[i]->startFrame == newFrame) {
-			newFrameIndex = i;
-		}
-	}
-
-	if (oldFrameIndex == _queuedFrames.size()) {
-		Instances::Log.warning("CX_DisplayThread") << "requeueFrame(): Nothing queued for frame " << oldFrame << ".";
-		return false;
-	}
-
-	if (newFrameIndex != _queuedFrames.size()) {
-		Instances::Log.warning("CX_DisplayThread") << "requeueFrame(): Frame queued for frame " <<
-			newFrame << " was replaced with the frame queued for frame " << oldFrame << ".";
-	}
-
-	_queuedFrames[newFrameIndex] = _queuedFrames[oldFrameIndex];
-	_queuedFrames.erase(_queuedFrames.begin() + oldFrameIndex);
-
-	return true;
+	return _slideQueue->requeueSlide(oldFrame, newFrame);
 }
 
 bool CX_DisplayThread::requeueAllFrames(int offset) {
@@ -587,137 +615,59 @@ bool CX_DisplayThread::requeueAllFrames(int offset) {
 }
 
 unsigned int CX_DisplayThread::getQueuedFrameCount(void) {
-	std::lock_guard<std::recursive_mutex> qfLock(_queuedFramesMutex);
-	return _queuedFrames.size();
+	return _slideQueue->getQueuedSlideCount();
 }
 
 void CX_DisplayThread::clearQueuedFrames(void) {
-	std::lock_guard<std::recursive_mutex> qfLock(_queuedFramesMutex);
-	_queuedFrames.clear();
+	_slideQueue->clear();
 }
 
+// Returns a copy of the queued frame. Modifying it does not affect the queue.
 std::shared_ptr<CX_DisplayThread::QueuedFrame> CX_DisplayThread::getQueuedFrame(unsigned int index) {
-	std::lock_guard<std::recursive_mutex> qfLock(_queuedFramesMutex);
+	std::lock_guard<std::mutex> lock(_slideQueue->_mutex);
 
-	if (index >= _queuedFrames.size()) {
+	if (index >= _slideQueue->_queue.size()) {
 		return nullptr;
 	}
 
-	return _queuedFrames[index];
-}
-
-/*
-std::vector<uint64_t> CX_DisplayThread::getQueuedFrameNumbers(void) {
-	std::lock_guard<std::recursive_mutex> qfLock(_queuedFramesMutex);
-
+	const CX_SlideQueue::Entry& entry = *_slideQueue->_queue[index];
 
-	std::vector<uint64_t> rval;
-	for (const auto& fr : _queuedFrames) {
-		rval.push_back(fr->startFrame);
+	auto qf = std::make_shared<QueuedFrame>();
+	qf->startFrame = entry.slide.intended.startFrame;
+	qf->fun = entry.drawingFunction;
+	if (qf->fun == nullptr) {
+		qf->fbo = entry.slide.framebuffer;
 	}
-
-	return rval;
+	return qf;
 }
-*/
 
 void CX_DisplayThread::_queuedFrameTask(void) {
 	if (!frameQueueEnabled()) {
 		return;
 	}
 
-	_drawQueuedFrameIfNeeded();
-
-	std::lock_guard<std::recursive_mutex> qfLock(_queuedFramesMutex);
-	if (_currentQF.frame != nullptr && _currentQF.fenceSync.isSyncing()) {
-		_currentQF.fenceSync.updateSync();
-	}
+	_slideQueue->_update();
 }
 
-void CX_DisplayThread::_queuedFramePostSwapTask(void) {
-
-	Sync::SwapData lastSwap = _display->swapData.getLastSwapData();
-
-	std::lock_guard<std::recursive_mutex> qfLock(_queuedFramesMutex);
-
-	if (_currentQF.frame == nullptr) {
-		_drawQueuedFrameIfNeeded();
-		return;
-	}
-
-	if (_currentQF.frame->frameCompleteCallback != nullptr) {
-
-		QueuedFrameResult result;
-
-		result.desiredStartFrame = _currentQF.frame->startFrame;
-
-		result.actualStartFrame = lastSwap.unit;
-		result.startTime = lastSwap.time;
-
-		result.renderTimeValid = _currentQF.fenceSync.syncSuccess();
-
-		if (result.renderTimeValid) {
-			result.renderCompleteTime = _currentQF.fenceSync.getSyncTime();
-		}
-
-		_currentQF.frame->frameCompleteCallback(std::move(result));
-
-	}
-
-	_currentQF.frame = nullptr;
-
-	_drawQueuedFrameIfNeeded();
-}
-
-
-
-void CX_DisplayThread::_drawQueuedFrameIfNeeded(void) {
-
-	std::unique_lock<std::recursive_mutex> lock(_mutex, std::defer_lock);
-	std::unique_lock<std::recursive_mutex> qfLock(_queuedFramesMutex, std::defer_lock);
-	std::lock(lock, qfLock);
-
-	FrameNumber nextFrameNumber = _display->swapData.getNextSwapUnit();
-
-	while (_queuedFrames.size() > 0 && _queuedFrames.front()->startFrame < nextFrameNumber) {
-		// this should never happen
-		Instances::Log.error("CX_DisplayThread") << "Queued frame " << _queuedFrames.front()->startFrame << " was lost because its start frame was missed.";
-		_queuedFrames.pop_front(); 
-	}
-
-	if (_queuedFrames.size() == 0) {
-		return;
-	}
-
-	if (_queuedFrames.front()->startFrame == nextFrameNumber) {
-		_currentQF.frame = _queuedFrames.front();
-		_queuedFrames.pop_front();
-	} else {
-		return; // nothing to present
-	}
-
-
-	if (!Private::glfwContextManager.isLockedByThisThread()) {
-		// Error: Context is unavailable
-		Instances::Log.error("CX_DisplayThread") << "Rendering context unavailable.";
-		return;
+// Returns true if a slide was swapped in, in which case the fence times of the slide are stored (-1 if not available)
+bool CX_DisplayThread::_queuedFramePostSwapTask(CX_Millis* preRenderCompleteTime, CX_Millis* renderCompleteTime) {
+	if (!frameQueueEnabled()) {
+		return false;
 	}
 
-	
-	_display->beginDrawingToBackBuffer();
+	Sync::SwapData lastSwap = _display->swapData.getLastSwapData();
 
-	if (_currentQF.frame->fbo != nullptr) {
-		ofPushStyle();
-		ofDisableAlphaBlending();
-		ofSetColor(255);
-		_currentQF.frame->fbo->draw(0, 0);
-		ofPopStyle();
-	} else if (_currentQF.frame->fun != nullptr) {
-		_currentQF.frame->fun();
+	CX_SlideQueue::SlideResult result;
+	bool slideSwapped = _slideQueue->_bufferSwapped(lastSwap, &result);
+	if (slideSwapped) {
+		*preRenderCompleteTime = result.preRenderCompleteTime;
+		*renderCompleteTime = result.renderTimeValid ? result.renderCompleteTime : CX_Millis(-1);
 	}
 
-	_display->endDrawingToBackBuffer();
+	// Get the next slide into the back buffer as soon as possible
+	_slideQueue->_update();
 
-	_currentQF.fenceSync.startSync();
+	return slideSwapped;
 }
 
 // Display thread locking.
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <condition_variable>
+
 #include "CX_Definitions.h"
 #include "CX_DataFrameCell.h"
 #include "CX_Private.h" // CX_GLFenceSync ???
@@ -10,6 +12,9 @@ namespace CX {
 
 	//class CX_CLASS(Display);
 	class CX_Display;
+	class CX_SlideQueue;
+	class CX_FrameTelemetry;
+	class CX_FrameCapture;
 
 	namespace Private {
 		void swapVideoBuffers(bool glFinish);
@@ -18,8 +23,28 @@ namespace CX {
 	class CX_DisplayThread {
 	public:
 
+		/*! How the display thread waits between swaps. */
+		enum class SchedulingMode {
+			/*! The thread checks whether it should swap as often as possible, yielding between checks.
+			This gives the most frequent `updateEvent`s, but uses a full CPU core. */
+			Spin,
+
+			/*! The thread sleeps until `spinWindow` before the swap window opens (i.e. before `preSwapSafetyBuffer`
+			before the predicted swap time) and only spins for the final part of the interval. The thread is woken
+			early when commands or slides are queued. `updateEvent` is notified about once per wake. */
+			Sleep
+		};
+
 		struct Configuration {
 
+			Configuration(void) :
+				preSwapSafetyBuffer(0),
+				enableFrameQueue(false),
+				swapMode(CX_DisplaySwapper::Mode::Prediction),
+				schedulingMode(SchedulingMode::Spin),
+				spinWindow(2)
+			{}
+
 			CX_Millis preSwapSafetyBuffer;
 
 			//CX_Millis requiredSwapDuration; // duration of swaps required for data and swap lock
@@ -29,6 +54,16 @@ namespace CX {
 
 			bool enableFrameQueue;
 
+			CX_DisplaySwapper::Mode swapMode; //!< How the thread decides when to swap. See CX_DisplaySwapper::Mode.
+			Sync::RobustModel::Configuration robustModel; //!< Used if `swapMode` is `CX_DisplaySwapper::Mode::RobustPrediction`.
+
+			SchedulingMode schedulingMode; //!< How the thread waits between swaps. See SchedulingMode.
+
+			/*! \brief Only used if `schedulingMode` is `SchedulingMode::Sleep`. How long before the swap window opens the thread
+			stops sleeping and starts spinning. This must cover the wakeup latency of the operating system: about 1 ms is
+			usually enough on Linux and OS X, but Windows may need more. */
+			CX_Millis spinWindow;
+
 		};
 
 		~CX_DisplayThread(void);
@@ -47,6 +82,7 @@ namespace CX {
 		void startThread(void);
 		void stopThread(bool wait = true);
 		bool isThreadRunning(void);
+		void wakeThread(void);
 
 		ofEvent<void> updateEvent;
 		// for the swap event, use Disp.swapData.newDataEvent
@@ -67,6 +103,8 @@ namespace CX {
 		bool isSwappingStably(void); // dataUser
 		bool waitForStableSwapping(CX_Millis timeout); // dataUser
 
+		Sync::RobustModel::ResidualStatistics getSwapResidualStatistics(void);
+
 		///////////////////
 		// Queued frames //
 		///////////////////
@@ -92,6 +130,9 @@ namespace CX {
 
 		bool enableFrameQueue(bool enable);
 
+		CX_SlideQueue* getSlideQueue(void);
+		CX_FrameTelemetry* getTelemetry(void);
+
 		// These functions do the same thing
 		bool frameQueueEnabled(void);
 		bool threadOwnsRenderingContext(void);
@@ -115,6 +156,7 @@ namespace CX {
 	private:
 
 		friend class CX::CX_Display;
+		friend class CX::CX_FrameCapture; // Completes readbacks on the display thread with commandExecuteFunction()
 
 		CX_DisplayThread(CX_Display* disp, std::function<void(CX_Display*)> swapFun);
 		
@@ -138,21 +180,21 @@ namespace CX {
 		void _threadFunction(void);
 		void _swap(void);
 
+		std::mutex _wakeMutex;
+		std::condition_variable _wakeCondition;
+		bool _wakeRequested;
+		void _sleepUntilWoken(CX_Millis maxSleep);
+
 
 		
 
 		// Queued frames
-		std::recursive_mutex _queuedFramesMutex;
-		std::deque<std::shared_ptr<QueuedFrame>> _queuedFrames;
-		struct {
-			std::shared_ptr<QueuedFrame> frame;
-			Private::CX_GLFenceSync fenceSync;
-		} _currentQF;
+		std::unique_ptr<CX_SlideQueue> _slideQueue;
 
 		void _queuedFrameTask(void);
-		void _drawQueuedFrameIfNeeded(void);
+		bool _queuedFramePostSwapTask(CX_Millis* preRenderCompleteTime, CX_Millis* renderCompleteTime);
 
-		void _queuedFramePostSwapTask(void);
+		std::unique_ptr<CX_FrameTelemetry> _telemetry;
 		
 		
 
@@ -194,11 +236,4 @@ namespace CX {
 		bool _acquireRenderingContext(bool acquire);
 	};
 
-	class CX_SlideQueue {
-		// Move the queued frames logic into this class.
-		// The exception is that enableFrameQueue() might stay with CX_DisplayThread, but be renamed renderOnDisplayThread().
-		// Use CX_SlideBuffer::Slide.
-	};
-
-
 } // namespace CX
\ No newline at end of file
@@ -553,6 +553,9 @@ as part of the file name.
 If no file extention is given, nothing gets saved.
 Many standard file types are supported: png, bmp, jpg, gif, etc. However, if the fbo has an alpha channel,
 only png works properly (at least of those I have tested).
+
+\note This function blocks until the pixels have been read back and the image has been written. To save
+many framebuffers without stalling rendering, use CX::CX_FrameCapture instead.
 */
 void saveFboToFile(ofFbo& fbo, std::string filename) {
 	ofPixels pix;
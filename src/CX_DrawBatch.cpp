@@ -0,0 +1,425 @@
+#include "CX_DrawBatch.h"
+
+#include "CX_Draw.h"
+#include "CX_Algorithm.h"
+#include "CX_Logger.h"
+
+namespace CX {
+namespace Draw {
+
+// Past this many cached shapes, the cache is cleared so that it does not grow without bound
+// when shape parameters are randomized on every trial.
+static const size_t tessellationCacheLimit = 4096;
+
+std::mutex Batch::_cacheMutex;
+std::map<Batch::ShapeKey, Batch::Tessellation> Batch::_cache;
+
+Batch::ShapeKey::ShapeKey(ShapeType type_, float p0, float p1, float p2, float p3, float p4, float p5) :
+	type(type_)
+{
+	params = { { p0, p1, p2, p3, p4, p5 } };
+}
+
+bool Batch::ShapeKey::operator<(const ShapeKey& rhs) const {
+	if (type != rhs.type) {
+		return type < rhs.type;
+	}
+	return params < rhs.params;
+}
+
+Batch::Batch(void) :
+	_color(1, 1, 1, 1),
+	_vboDirty(true)
+{}
+
+/*! \brief Remove all shapes from the batch. The memory used by the batch is kept for reuse. */
+void Batch::clear(void) {
+	_vertices.clear();
+	_colors.clear();
+	_vboDirty = true;
+}
+
+/*! \brief Reserve memory for `triangles` triangles, so that adding shapes does not reallocate. */
+void Batch::reserve(size_t triangles) {
+	_vertices.reserve(3 * triangles);
+	_colors.reserve(3 * triangles);
+}
+
+/*! \brief Set the color of shapes that are added to the batch after this is called. The default is white. */
+void Batch::setColor(ofFloatColor color) {
+	_color = color;
+}
+
+ofFloatColor Batch::getColor(void) const {
+	return _color;
+}
+
+/*! Add a ring. See Draw::ring() for the meaning of the parameters. */
+void Batch::ring(ofPoint center, float radius, float width, unsigned int resolution) {
+	resolution = std::max<unsigned int>(resolution, 3);
+
+	Tessellation tess = _getTessellation(ShapeKey(ShapeType::Ring, radius, width, resolution), [=](void) {
+		float outerRadius = radius + width / 2;
+		float innerRadius = radius - width / 2;
+
+		std::vector<ofPoint> tri;
+		tri.reserve(6 * resolution);
+		for (unsigned int i = 0; i < resolution; i++) {
+			float a1 = TWO_PI * i / resolution;
+			float a2 = TWO_PI * (i + 1) / resolution;
+
+			ofPoint outer1(outerRadius * cos(a1), outerRadius * sin(a1));
+			ofPoint outer2(outerRadius * cos(a2), outerRadius * sin(a2));
+			ofPoint inner1(innerRadius * cos(a1), innerRadius * sin(a1));
+			ofPoint inner2(innerRadius * cos(a2), innerRadius * sin(a2));
+
+			tri.push_back(outer1);
+			tri.push_back(inner1);
+			tri.push_back(outer2);
+
+			tri.push_back(inner1);
+			tri.push_back(inner2);
+			tri.push_back(outer2);
+		}
+		return tri;
+	});
+
+	_addShape(*tess, center);
+}
+
+/*! Add an arc. See Draw::arc() for the meaning of the parameters. */
+void Batch::arc(ofPoint center, float radiusX, float radiusY, float width, float angleBegin, float angleEnd, unsigned int resolution) {
+	resolution = std::max<unsigned int>(resolution, 1);
+
+	ShapeKey key(ShapeType::Arc, radiusX, radiusY, width, angleBegin, angleEnd, resolution);
+
+	Tessellation tess = _getTessellation(key, [=](void) {
+		float d = width / 2;
+
+		// The same vertices as Draw::arc(), converted from a triangle strip to triangles
+		std::vector<ofPoint> strip(2 * (resolution + 1));
+		for (unsigned int i = 0; i <= resolution; i++) {
+			float angle = (angleEnd - angleBegin) * i / resolution + angleBegin;
+			angle = angle * PI / 180;
+
+			strip[(2 * i)] = ofPoint((radiusX - d) * cos(angle), (radiusY - d) * sin(angle));
+			strip[(2 * i) + 1] = ofPoint((radiusX + d) * cos(angle), (radiusY + d) * sin(angle));
+		}
+
+		std::vector<ofPoint> tri;
+		tri.reserve(3 * (strip.size() - 2));
+		for (unsigned int i = 0; i < strip.size() - 2; i++) {
+			tri.push_back(strip[i]);
+			tri.push_back(strip[i + 1]);
+			tri.push_back(strip[i + 2]);
+		}
+		return tri;
+	});
+
+	_addShape(*tess, center);
+}
+
+/*! Add a filled circle.
+\param center The center of the circle.
+\param radius The radius of the circle.
+\param resolution The number of line segments used to approximate the circle. */
+void Batch::circle(ofPoint center, float radius, unsigned int resolution) {
+	resolution = std::max<unsigned int>(resolution, 3);
+
+	Tessellation tess = _getTessellation(ShapeKey(ShapeType::Circle, radius, resolution), [=](void) {
+		std::vector<ofPoint> tri;
+		tri.reserve(3 * resolution);
+		for (unsigned int i = 0; i < resolution; i++) {
+			float a1 = TWO_PI * i / resolution;
+			float a2 = TWO_PI * (i + 1) / resolution;
+
+			tri.push_back(ofPoint(0, 0));
+			tri.push_back(ofPoint(radius * cos(a1), radius * sin(a1)));
+			tri.push_back(ofPoint(radius * cos(a2), radius * sin(a2)));
+		}
+		return tri;
+	});
+
+	_addShape(*tess, center);
+}
+
+/*! \brief Add a filled rectangle. */
+void Batch::rectangle(ofRectangle rect) {
+	_addQuad(rect.getTopLeft(), rect.getTopRight(), rect.getBottomRight(), rect.getBottomLeft());
+}
+
+/*! Add a line. See Draw::line() for the meaning of the parameters. */
+void Batch::line(ofPoint p1, ofPoint p2, float width) {
+	ofPoint dir = p2 - p1;
+	float length = sqrt(dir.x * dir.x + dir.y * dir.y);
+	if (length == 0) {
+		return;
+	}
+
+	ofPoint normal(-dir.y / length * width / 2, dir.x / length * width / 2);
+
+	_addQuad(p1 + normal, p2 + normal, p2 - normal, p1 - normal);
+}
+
+/*! Add a series of connected lines. See Draw::lines(std::vector<ofPoint>, float, bool) for the meaning of the parameters.
+\param joinResolution The resolution of the circles that join the lines, if `circleJoins` is `true`. */
+void Batch::lines(const std::vector<ofPoint>& points, float lineWidth, bool circleJoins, unsigned int joinResolution) {
+	if (points.size() < 2) {
+		return;
+	}
+
+	float d = lineWidth / 2;
+	line(points[0], points[1], lineWidth);
+	for (unsigned int i = 1; i < points.size() - 1; i++) {
+		if (circleJoins) {
+			circle(points[i], d, joinResolution);
+		}
+		line(points[i], points[i + 1], lineWidth);
+	}
+
+	if (circleJoins && (points.back() == points.front())) {
+		circle(points.front(), d, joinResolution);
+	}
+}
+
+/*! Add a squircle. See Draw::squircle() for the meaning of the parameters. */
+void Batch::squircle(ofPoint center, double radius, double amount, double rotationDeg) {
+	Tessellation tess = _getTessellation(ShapeKey(ShapeType::Squircle, radius, amount), [=](void) {
+		ofPath sq = squircleToPath(radius, amount);
+		sq.setFilled(true);
+		return meshToTriangles(sq.getTessellation());
+	});
+
+	_addShape(*tess, center, rotationDeg);
+}
+
+/*! Add a star. See Draw::star() for the meaning of the parameters. */
+void Batch::star(ofPoint center, unsigned int numberOfPoints, float innerRadius, float outerRadius, float rotationDeg) {
+	if (numberOfPoints == 0) {
+		return;
+	}
+
+	Tessellation tess = _getTessellation(ShapeKey(ShapeType::Star, numberOfPoints, innerRadius, outerRadius), [=](void) {
+		std::vector<ofPoint> vertices = getStarVertices(numberOfPoints, innerRadius, outerRadius, 0);
+
+		std::vector<ofPoint> tri;
+		tri.reserve(3 * (vertices.size() - 1));
+		for (unsigned int i = 0; i < vertices.size() - 1; i++) {
+			tri.push_back(ofPoint(0, 0));
+			tri.push_back(vertices[i]);
+			tri.push_back(vertices[i + 1]);
+		}
+		return tri;
+	});
+
+	_addShape(*tess, center, rotationDeg);
+}
+
+/*! Add a fixation cross. See Draw::fixationCross() for the meaning of the parameters. The cross is made of three
+non-overlapping rectangles, so it can be drawn with transparency. */
+void Batch::fixationCross(ofPoint location, float armLength, float armWidth) {
+	float w = armWidth / 2;
+	float l = armLength / 2;
+
+	// Vertical bar, then the left and right arms
+	rectangle(ofRectangle(location.x - w, location.y - l, armWidth, armLength));
+	rectangle(ofRectangle(location.x - l, location.y - w, l - w, armWidth));
+	rectangle(ofRectangle(location.x + w, location.y - w, l - w, armWidth));
+}
+
+/*! Add a pattern mask using CX::Instances::RNG. See Draw::patternMask() for the meaning of the parameters.
+The batch color is not used. */
+void Batch::patternMask(ofPoint center, float width, float height, float squareSize, const std::vector<ofFloatColor>& colors) {
+	patternMask(center, width, height, squareSize, &CX::Instances::RNG, colors);
+}
+
+/*! Add a pattern mask. See Draw::patternMask() for the meaning of the parameters. The batch color is not used.
+\param rng The random number generator used to choose the colors. */
+void Batch::patternMask(ofPoint center, float width, float height, float squareSize, CX_RandomNumberGenerator* rng, const std::vector<ofFloatColor>& colors) {
+	squareSize = abs(squareSize);
+	if (squareSize == 0) {
+		return;
+	}
+
+	ofPoint corner(center.x - width / 2, center.y - height / 2);
+
+	CX::Algo::BlockSampler<ofFloatColor> bs(rng, colors);
+
+	ofFloatColor originalColor = _color;
+
+	for (float x = 0; x < width; x += squareSize) {
+		for (float y = 0; y < height; y += squareSize) {
+			if (colors.size() == 0) {
+				_color = ofFloatColor::fromHsb(rng->randomDouble(0, ofFloatColor::limit()), ofFloatColor::limit(), ofFloatColor::limit());
+			} else {
+				_color = bs.getNextValue();
+			}
+
+			rectangle(ofRectangle(corner.x + x, corner.y + y, squareSize, squareSize));
+		}
+	}
+
+	_color = originalColor;
+}
+
+/*! Add the filled area of an ofPath. The path is tessellated every time this is called, so prefer the specific shape
+functions for shapes that are added many times.
+\param path The path to add. Paths that are not filled add nothing.
+\param position The location at which the origin of the path is placed. */
+void Batch::path(ofPath path, ofPoint position) {
+	_addShape(meshToTriangles(path.getTessellation()), position);
+}
+
+/*! Add triangles.
+\param vertices The vertices of the triangles, three per triangle. If the number of vertices is not a multiple of
+three, the extra vertices are ignored.
+\param offset Added to each vertex. */
+void Batch::triangles(const std::vector<ofPoint>& vertices, ofPoint offset) {
+	if (vertices.size() % 3 != 0) {
+		std::vector<ofPoint> whole(vertices.begin(), vertices.end() - (vertices.size() % 3));
+		_addShape(whole, offset);
+	} else {
+		_addShape(vertices, offset);
+	}
+}
+
+/*! \brief Get the number of triangles in the batch. */
+size_t Batch::getTriangleCount(void) const {
+	return _vertices.size() / 3;
+}
+
+/*! \brief Returns `true` if there are no shapes in the batch. */
+bool Batch::empty(void) const {
+	return _vertices.empty();
+}
+
+/*! Draw all of the shapes in the batch with a single draw call. If the batch changed since it was last drawn,
+the vertices are uploaded to video memory first. The current transformation matrix (e.g. from ofTranslate())
+applies to the batch, but the current color does not: each shape has the color it was added with. */
+void Batch::draw(void) {
+	if (_vertices.empty()) {
+		return;
+	}
+
+	if (_vboDirty) {
+		_vbo.setVertexData(_vertices.data(), _vertices.size(), GL_DYNAMIC_DRAW);
+		_vbo.setColorData(_colors.data(), _colors.size(), GL_DYNAMIC_DRAW);
+		_vboDirty = false;
+	}
+
+	_vbo.draw(GL_TRIANGLES, 0, _vertices.size());
+}
+
+/*! \brief Clear the tessellation cache that is shared by all batches. */
+void Batch::clearTessellationCache(void) {
+	std::lock_guard<std::mutex> lock(_cacheMutex);
+	_cache.clear();
+}
+
+/*! \brief Get the number of shapes in the tessellation cache that is shared by all batches. */
+size_t Batch::getTessellationCacheSize(void) {
+	std::lock_guard<std::mutex> lock(_cacheMutex);
+	return _cache.size();
+}
+
+Batch::Tessellation Batch::_getTessellation(const ShapeKey& key, std::function<std::vector<ofPoint>(void)> tessellate) {
+	{
+		std::lock_guard<std::mutex> lock(_cacheMutex);
+		auto it = _cache.find(key);
+		if (it != _cache.end()) {
+			return it->second;
+		}
+	}
+
+	// Tessellate without holding the lock
+	Tessellation tess = std::make_shared<const std::vector<ofPoint>>(tessellate());
+
+	std::lock_guard<std::mutex> lock(_cacheMutex);
+	if (_cache.size() >= tessellationCacheLimit) {
+		Instances::Log.verbose("Draw::Batch") << "The tessellation cache is full. It has been cleared.";
+		_cache.clear();
+	}
+	_cache[key] = tess;
+	return tess;
+}
+
+void Batch::_addShape(const std::vector<ofPoint>& shape, ofPoint offset, float rotationDeg) {
+	size_t start = _vertices.size();
+
+	_vertices.insert(_vertices.end(), shape.begin(), shape.end());
+	_colors.insert(_colors.end(), shape.size(), _color);
+
+	if (rotationDeg != 0) {
+		float rad = rotationDeg * PI / 180;
+		float c = cos(rad);
+		float s = sin(rad);
+		for (size_t i = start; i < _vertices.size(); i++) {
+			ofPoint& p = _vertices[i];
+			p = ofPoint(p.x * c - p.y * s + offset.x, p.x * s + p.y * c + offset.y, p.z + offset.z);
+		}
+	} else {
+		for (size_t i = start; i < _vertices.size(); i++) {
+			_vertices[i] += offset;
+		}
+	}
+
+	_vboDirty = true;
+}
+
+void Batch::_addQuad(ofPoint a, ofPoint b, ofPoint c, ofPoint d) {
+	ofPoint quad[6] = { a, b, c, a, c, d };
+	_vertices.insert(_vertices.end(), quad, quad + 6);
+	_colors.insert(_colors.end(), 6, _color);
+	_vboDirty = true;
+}
+
+/*! Convert the faces of a mesh to a list of triangles, three vertices per triangle. Meshes with indices are expanded.
+\param mesh A mesh with mode `OF_PRIMITIVE_TRIANGLES`, `OF_PRIMITIVE_TRIANGLE_STRIP`, or `OF_PRIMITIVE_TRIANGLE_FAN`,
+like the tessellation of an ofPath.
+\return The triangles. If the mesh has a different mode, an empty vector is returned and an error is logged.
+\ingroup video */
+std::vector<ofPoint> meshToTriangles(const ofMesh& mesh) {
+	const std::vector<ofPoint>& verts = mesh.getVertices();
+
+	std::vector<ofPoint> ordered;
+	if (mesh.getNumIndices() > 0) {
+		const auto& indices = mesh.getIndices();
+		ordered.reserve(indices.size());
+		for (const auto& i : indices) {
+			ordered.push_back(verts[i]);
+		}
+	} else {
+		ordered = verts;
+	}
+
+	std::vector<ofPoint> tri;
+
+	switch (mesh.getMode()) {
+	case OF_PRIMITIVE_TRIANGLES:
+		tri = ordered;
+		tri.resize(ordered.size() - (ordered.size() % 3));
+		break;
+	case OF_PRIMITIVE_TRIANGLE_STRIP:
+		for (size_t i = 2; i < ordered.size(); i++) {
+			tri.push_back(ordered[i - 2]);
+			tri.push_back(ordered[i - 1]);
+			tri.push_back(ordered[i]);
+		}
+		break;
+	case OF_PRIMITIVE_TRIANGLE_FAN:
+		for (size_t i = 2; i < ordered.size(); i++) {
+			tri.push_back(ordered[0]);
+			tri.push_back(ordered[i - 1]);
+			tri.push_back(ordered[i]);
+		}
+		break;
+	default:
+		Instances::Log.error("Draw") << "meshToTriangles(): The mesh must be made of triangles.";
+		break;
+	}
+
+	return tri;
+}
+
+} // namespace Draw
+} // namespace CX
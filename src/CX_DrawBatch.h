@@ -0,0 +1,132 @@
+#pragma once
+
+#include <map>
+#include <mutex>
+#include <array>
+#include <memory>
+#include <functional>
+
+#include "ofPoint.h"
+#include "ofPath.h"
+#include "ofVbo.h"
+#include "ofRectangle.h"
+
+#include "CX_RandomNumberGenerator.h"
+
+namespace CX {
+namespace Draw {
+
+	/*! This class collects many primitives (rings, arcs, stars, fixation crosses, lines, etc.) into a single vertex buffer
+	that is drawn with one draw call. The functions in CX::Draw tessellate their shape and issue a separate draw call
+	every time they are called, which is slow when hundreds of shapes are drawn, like in visual search arrays.
+
+	The tessellation of each shape is cached, keyed on the shape parameters (e.g. radius, width, and resolution for rings),
+	so adding many copies of the same shape at different locations only tessellates the shape once. The cache is shared
+	by all batches.
+
+	Shapes are given the current batch color, set with setColor(), when they are added. Once the batch has been drawn,
+	it is kept in video memory and redrawing it is very fast until the batch is changed.
+
+	\code{.cpp}
+	Draw::Batch batch;
+
+	for (unsigned int i = 0; i < 300; i++) {
+		ofPoint location(RNG.randomInt(0, Disp.getResolution().x), RNG.randomInt(0, Disp.getResolution().y));
+		if (i == 0) {
+			batch.setColor(ofColor::red);
+			batch.star(location, 5, 8, 20);
+		} else {
+			batch.setColor(ofColor::green);
+			batch.ring(location, 15, 4, 40);
+		}
+	}
+	batch.setColor(ofColor::white);
+	batch.fixationCross(Disp.getCenter(), 30, 5);
+
+	Disp.beginDrawingToBackBuffer();
+	ofBackground(0);
+	batch.draw();
+	Disp.endDrawingToBackBuffer();
+	\endcode
+
+	\ingroup video
+	*/
+	class Batch {
+	public:
+
+		Batch(void);
+
+		void clear(void);
+		void reserve(size_t triangles);
+
+		void setColor(ofFloatColor color);
+		ofFloatColor getColor(void) const;
+
+		void ring(ofPoint center, float radius, float width, unsigned int resolution);
+		void arc(ofPoint center, float radiusX, float radiusY, float width, float angleBegin, float angleEnd, unsigned int resolution);
+		void circle(ofPoint center, float radius, unsigned int resolution);
+		void rectangle(ofRectangle rect);
+
+		void line(ofPoint p1, ofPoint p2, float width);
+		void lines(const std::vector<ofPoint>& points, float lineWidth, bool circleJoins = true, unsigned int joinResolution = 20);
+
+		void squircle(ofPoint center, double radius, double amount = 0.9, double rotationDeg = 0);
+		void star(ofPoint center, unsigned int numberOfPoints, float innerRadius, float outerRadius, float rotationDeg = 0);
+		void fixationCross(ofPoint location, float armLength, float armWidth);
+
+		void patternMask(ofPoint center, float width, float height, float squareSize, const std::vector<ofFloatColor>& colors = std::vector<ofFloatColor>());
+		void patternMask(ofPoint center, float width, float height, float squareSize, CX_RandomNumberGenerator* rng, const std::vector<ofFloatColor>& colors = std::vector<ofFloatColor>());
+
+		void path(ofPath path, ofPoint position);
+		void triangles(const std::vector<ofPoint>& vertices, ofPoint offset = ofPoint(0, 0));
+
+		size_t getTriangleCount(void) const;
+		bool empty(void) const;
+
+		void draw(void);
+
+		static void clearTessellationCache(void);
+		static size_t getTessellationCacheSize(void);
+
+	private:
+
+		std::vector<ofPoint> _vertices; // Triangle list
+		std::vector<ofFloatColor> _colors;
+
+		ofFloatColor _color;
+
+		ofVbo _vbo;
+		bool _vboDirty;
+
+		void _addShape(const std::vector<ofPoint>& shape, ofPoint offset, float rotationDeg = 0);
+		void _addQuad(ofPoint a, ofPoint b, ofPoint c, ofPoint d);
+
+		enum class ShapeType : int {
+			Ring,
+			Arc,
+			Circle,
+			Squircle,
+			Star
+		};
+
+		struct ShapeKey {
+			ShapeKey(ShapeType type_, float p0 = 0, float p1 = 0, float p2 = 0, float p3 = 0, float p4 = 0, float p5 = 0);
+
+			ShapeType type;
+			std::array<float, 6> params;
+
+			bool operator<(const ShapeKey& rhs) const;
+		};
+
+		typedef std::shared_ptr<const std::vector<ofPoint>> Tessellation;
+
+		static Tessellation _getTessellation(const ShapeKey& key, std::function<std::vector<ofPoint>(void)> tessellate);
+
+		static std::mutex _cacheMutex;
+		static std::map<ShapeKey, Tessellation> _cache;
+	};
+
+	std::vector<ofPoint> meshToTriangles(const ofMesh& mesh);
+
+} // namespace Draw
+} // namespace CX
@@ -0,0 +1,774 @@
+#include "CX_EvdevInput.h"
+
+#ifdef TARGET_LINUX
+
+#include <cerrno>
+#include <cstring>
+#include <algorithm>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <time.h>
+#include <sys/ioctl.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <linux/input.h>
+
+#include "CX_InputManager.h"
+#include "CX_Display.h"
+#include "CX_Logger.h"
+
+namespace CX {
+
+namespace {
+
+	// Recording layout: "CXEV", uint32 version, uint32 device count, then for each device uint8 kind (0 = keyboard, 1 = mouse),
+	// uint32 path length, and the path, then events of int32 device, int64 time (nanoseconds), uint16 type, uint16 code, int32 value.
+	const char recordingMagic[4] = { 'C', 'X', 'E', 'V' };
+	const uint32_t recordingVersion = 2;
+
+	template <size_t N>
+	bool testBit(const unsigned long (&bits)[N], unsigned int bit) {
+		const unsigned int bitsPerLong = sizeof(unsigned long) * 8;
+		return (bit / bitsPerLong < N) && ((bits[bit / bitsPerLong] >> (bit % bitsPerLong)) & 1);
+	}
+
+	// Checks what kind of device the fd is from its capabilities.
+	void probeDevice(int fd, bool* isKeyboard, bool* isMouse) {
+		const unsigned int bitsPerLong = sizeof(unsigned long) * 8;
+
+		unsigned long evBits[EV_MAX / bitsPerLong + 1] = { 0 };
+		unsigned long keyBits[KEY_MAX / bitsPerLong + 1] = { 0 };
+		unsigned long relBits[REL_MAX / bitsPerLong + 1] = { 0 };
+
+		ioctl(fd, EVIOCGBIT(0, sizeof(evBits)), evBits);
+		ioctl(fd, EVIOCGBIT(EV_KEY, sizeof(keyBits)), keyBits);
+		ioctl(fd, EVIOCGBIT(EV_REL, sizeof(relBits)), relBits);
+
+		*isKeyboard = testBit(evBits, EV_KEY) && testBit(keyBits, KEY_A) && testBit(keyBits, KEY_SPACE);
+		*isMouse = testBit(evBits, EV_REL) && testBit(relBits, REL_X) && testBit(relBits, REL_Y) && testBit(keyBits, BTN_LEFT);
+	}
+
+	bool isMouseButton(uint16_t code) {
+		return code >= BTN_MOUSE && code < BTN_JOYSTICK;
+	}
+
+	int toMouseButton(uint16_t code) {
+		switch (code) {
+		case BTN_LEFT: return OF_MOUSE_BUTTON_LEFT;
+		case BTN_MIDDLE: return OF_MOUSE_BUTTON_MIDDLE;
+		case BTN_RIGHT: return OF_MOUSE_BUTTON_RIGHT;
+		default: return OF_MOUSE_BUTTON_RIGHT + 1 + (code - BTN_SIDE); // BTN_SIDE, BTN_EXTRA, etc.
+		}
+	}
+
+	// Linux keycodes (US layout positions) to GLFW keycodes
+	int toGlfwKey(uint16_t code) {
+		if (code >= KEY_1 && code <= KEY_9) {
+			return GLFW_KEY_1 + (code - KEY_1);
+		}
+		if (code >= KEY_F1 && code <= KEY_F10) {
+			return GLFW_KEY_F1 + (code - KEY_F1);
+		}
+		if (code >= KEY_F13 && code <= KEY_F24) {
+			return GLFW_KEY_F13 + (code - KEY_F13);
+		}
+
+		switch (code) {
+		case KEY_0: return GLFW_KEY_0;
+		case KEY_A: return GLFW_KEY_A;
+		case KEY_B: return GLFW_KEY_B;
+		case KEY_C: return GLFW_KEY_C;
+		case KEY_D: return GLFW_KEY_D;
+		case KEY_E: return GLFW_KEY_E;
+		case KEY_F: return GLFW_KEY_F;
+		case KEY_G: return GLFW_KEY_G;
+		case KEY_H: return GLFW_KEY_H;
+		case KEY_I: return GLFW_KEY_I;
+		case KEY_J: return GLFW_KEY_J;
+		case KEY_K: return GLFW_KEY_K;
+		case KEY_L: return GLFW_KEY_L;
+		case KEY_M: return GLFW_KEY_M;
+		case KEY_N: return GLFW_KEY_N;
+		case KEY_O: return GLFW_KEY_O;
+		case KEY_P: return GLFW_KEY_P;
+		case KEY_Q: return GLFW_KEY_Q;
+		case KEY_R: return GLFW_KEY_R;
+		case KEY_S: return GLFW_KEY_S;
+		case KEY_T: return GLFW_KEY_T;
+		case KEY_U: return GLFW_KEY_U;
+		case KEY_V: return GLFW_KEY_V;
+		case KEY_W: return GLFW_KEY_W;
+		case KEY_X: return GLFW_KEY_X;
+		case KEY_Y: return GLFW_KEY_Y;
+		case KEY_Z: return GLFW_KEY_Z;
+
+		case KEY_SPACE: return GLFW_KEY_SPACE;
+		case KEY_APOSTROPHE: return GLFW_KEY_APOSTROPHE;
+		case KEY_COMMA: return GLFW_KEY_COMMA;
+		case KEY_MINUS: return GLFW_KEY_MINUS;
+		case KEY_DOT: return GLFW_KEY_PERIOD;
+		case KEY_SLASH: return GLFW_KEY_SLASH;
+		case KEY_SEMICOLON: return GLFW_KEY_SEMICOLON;
+		case KEY_EQUAL: return GLFW_KEY_EQUAL;
+		case KEY_LEFTBRACE: return GLFW_KEY_LEFT_BRACKET;
+		case KEY_RIGHTBRACE: return GLFW_KEY_RIGHT_BRACKET;
+		case KEY_BACKSLASH: return GLFW_KEY_BACKSLASH;
+		case KEY_GRAVE: return GLFW_KEY_GRAVE_ACCENT;
+		case KEY_102ND: return GLFW_KEY_WORLD_1;
+
+		case KEY_ESC: return GLFW_KEY_ESCAPE;
+		case KEY_ENTER: return GLFW_KEY_ENTER;
+		case KEY_TAB: return GLFW_KEY_TAB;
+		case KEY_BACKSPACE: return GLFW_KEY_BACKSPACE;
+		case KEY_INSERT: return GLFW_KEY_INSERT;
+		case KEY_DELETE: return GLFW_KEY_DELETE;
+		case KEY_RIGHT: return GLFW_KEY_RIGHT;
+		case KEY_LEFT: return GLFW_KEY_LEFT;
+		case KEY_DOWN: return GLFW_KEY_DOWN;
+		case KEY_UP: return GLFW_KEY_UP;
+		case KEY_PAGEUP: return GLFW_KEY_PAGE_UP;
+		case KEY_PAGEDOWN: return GLFW_KEY_PAGE_DOWN;
+		case KEY_HOME: return GLFW_KEY_HOME;
+		case KEY_END: return GLFW_KEY_END;
+		case KEY_CAPSLOCK: return GLFW_KEY_CAPS_LOCK;
+		case KEY_SCROLLLOCK: return GLFW_KEY_SCROLL_LOCK;
+		case KEY_NUMLOCK: return GLFW_KEY_NUM_LOCK;
+		case KEY_SYSRQ: return GLFW_KEY_PRINT_SCREEN;
+		case KEY_PAUSE: return GLFW_KEY_PAUSE;
+		case KEY_F11: return GLFW_KEY_F11;
+		case KEY_F12: return GLFW_KEY_F12;
+
+		case KEY_KP0: return GLFW_KEY_KP_0;
+		case KEY_KP1: return GLFW_KEY_KP_1;
+		case KEY_KP2: return GLFW_KEY_KP_2;
+		case KEY_KP3: return GLFW_KEY_KP_3;
+		case KEY_KP4: return GLFW_KEY_KP_4;
+		case KEY_KP5: return GLFW_KEY_KP_5;
+		case KEY_KP6: return GLFW_KEY_KP_6;
+		case KEY_KP7: return GLFW_KEY_KP_7;
+		case KEY_KP8: return GLFW_KEY_KP_8;
+		case KEY_KP9: return GLFW_KEY_KP_9;
+		case KEY_KPDOT: return GLFW_KEY_KP_DECIMAL;
+		case KEY_KPSLASH: return GLFW_KEY_KP_DIVIDE;
+		case KEY_KPASTERISK: return GLFW_KEY_KP_MULTIPLY;
+		case KEY_KPMINUS: return GLFW_KEY_KP_SUBTRACT;
+		case KEY_KPPLUS: return GLFW_KEY_KP_ADD;
+		case KEY_KPENTER: return GLFW_KEY_KP_ENTER;
+		case KEY_KPEQUAL: return GLFW_KEY_KP_EQUAL;
+
+		case KEY_LEFTSHIFT: return GLFW_KEY_LEFT_SHIFT;
+		case KEY_LEFTCTRL: return GLFW_KEY_LEFT_CONTROL;
+		case KEY_LEFTALT: return GLFW_KEY_LEFT_ALT;
+		case KEY_LEFTMETA: return GLFW_KEY_LEFT_SUPER;
+		case KEY_RIGHTSHIFT: return GLFW_KEY_RIGHT_SHIFT;
+		case KEY_RIGHTCTRL: return GLFW_KEY_RIGHT_CONTROL;
+		case KEY_RIGHTALT: return GLFW_KEY_RIGHT_ALT;
+		case KEY_RIGHTMETA: return GLFW_KEY_RIGHT_SUPER;
+		case KEY_COMPOSE: return GLFW_KEY_MENU;
+		}
+
+		return GLFW_KEY_UNKNOWN;
+	}
+
+	int64_t kernelClockNanos(clockid_t clock) {
+		timespec ts;
+		clock_gettime(clock, &ts);
+		return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+	}
+
+}
+
+CX_EvdevInput::CX_EvdevInput(void) :
+	_manager(nullptr),
+	_running(false),
+	_replaying(false),
+	_epollFd(-1),
+	_wakeFd(-1),
+	_droppedEvents(0),
+	_heldButtonCount(0),
+	_clockOffset(0),
+	_clockUncertainty(0),
+	_lastClockSync(0)
+{}
+
+CX_EvdevInput::~CX_EvdevInput(void) {
+	stop();
+}
+
+/*! Start reading events from evdev devices or from a recording.
+\param config The configuration to use. If events were already being read, that is stopped first.
+\return `false` if no devices could be opened or the recording could not be read, `true` otherwise. */
+bool CX_EvdevInput::setup(const Configuration& config) {
+	std::lock_guard<std::recursive_mutex> lock(_mutex);
+
+	stop();
+
+	_config = config;
+	_manager = (config.inputManager != nullptr) ? config.inputManager : &Instances::Input;
+
+	_keyboardEvents.reset(new Util::SpscQueue<CX_Keyboard::Event>(config.queueCapacity));
+	_mouseEvents.reset(new Util::SpscQueue<CX_Mouse::Event>(config.queueCapacity));
+	_droppedEvents = 0;
+
+	_cursorPos = _manager->Mouse.getCursorPosition();
+	ofRectangle resolution = Instances::Disp.getResolution();
+	if (resolution.width > 0 && resolution.height > 0) {
+		_cursorLimit = ofPoint(resolution.width, resolution.height);
+	} else {
+		_cursorLimit = ofPoint(std::numeric_limits<float>::max(), std::numeric_limits<float>::max());
+	}
+	_heldButtonCount = 0;
+
+	std::vector<RawEvent> replayEvents;
+	if (config.replayFilename != "") {
+		if (!_readRecording(config.replayFilename, replayEvents, _devices)) {
+			return false;
+		}
+	} else if (!_openDevices()) {
+		return false;
+	}
+
+	if (config.recordFilename != "" && config.replayFilename == "") {
+		_recordFile.open(ofToDataPath(config.recordFilename).c_str(), std::ios::out | std::ios::trunc | std::ios::binary);
+		if (!_recordFile.is_open()) {
+			Instances::Log.error("CX_EvdevInput") << "setup(): Could not open recording file \"" << config.recordFilename << "\".";
+			_closeDevices();
+			return false;
+		}
+
+		_recordFile.write(recordingMagic, sizeof(recordingMagic));
+		Util::writeBinaryValue<uint32_t>(_recordFile, recordingVersion);
+		Util::writeBinaryValue<uint32_t>(_recordFile, (uint32_t)_devices.size());
+		for (const Device& dev : _devices) {
+			Util::writeBinaryValue<uint8_t>(_recordFile, dev.kind == DeviceKind::Mouse ? 1 : 0);
+			Util::writeBinaryValue<uint32_t>(_recordFile, (uint32_t)dev.path.size());
+			_recordFile.write(dev.path.data(), dev.path.size());
+		}
+	}
+
+	// GLFW events would duplicate the evdev events
+	if (config.useKeyboard) {
+		_manager->Keyboard.enable(true);
+		_manager->Keyboard._useGlfwEvents(false);
+	}
+	if (config.useMouse) {
+		_manager->Mouse.enable(true);
+		_manager->Mouse._useGlfwEvents(false);
+	}
+	_manager->_eventSources[this] = std::bind(&CX_EvdevInput::_takeEvents, this);
+
+	_running = true;
+
+	if (config.replayFilename != "") {
+		_replaying = true;
+		_thread = std::thread(&CX_EvdevInput::_replayThreadFunction, this, std::move(replayEvents));
+	} else {
+		_thread = std::thread(&CX_EvdevInput::_deviceThreadFunction, this);
+	}
+
+	return true;
+}
+
+CX_EvdevInput::Configuration CX_EvdevInput::getConfiguration(void) {
+	std::lock_guard<std::recursive_mutex> lock(_mutex);
+	return _config;
+}
+
+/*! Stop reading events, close the devices, and go back to getting keyboard and mouse events from GLFW.
+Events that have already been read are moved into the input devices. */
+void CX_EvdevInput::stop(void) {
+	std::lock_guard<std::recursive_mutex> lock(_mutex);
+
+	if (!_thread.joinable()) {
+		return;
+	}
+
+	_running = false;
+	if (_wakeFd >= 0) {
+		uint64_t one = 1;
+		if (write(_wakeFd, &one, sizeof(one)) < 0) {
+			// The thread also wakes up periodically to resync the clocks, so it will notice eventually
+		}
+	}
+	_thread.join();
+	_replaying = false;
+
+	_takeEvents();
+	_manager->_eventSources.erase(this);
+
+	if (_config.useKeyboard) {
+		_manager->Keyboard._useGlfwEvents(true);
+	}
+	if (_config.useMouse) {
+		_manager->Mouse._useGlfwEvents(true);
+	}
+
+	_closeDevices();
+
+	if (_recordFile.is_open()) {
+		_recordFile.close();
+	}
+}
+
+/*! \brief Returns `true` if events are being read from devices or a recording. */
+bool CX_EvdevInput::isRunning(void) {
+	return _running;
+}
+
+/*! \brief Returns `true` if events from a recording are still being replayed. */
+bool CX_EvdevInput::isReplaying(void) {
+	return _replaying;
+}
+
+/*! \brief Get the paths of the devices that are being read. When replaying, these are the devices in the recording. */
+std::vector<std::string> CX_EvdevInput::getOpenDevicePaths(void) {
+	std::lock_guard<std::recursive_mutex> lock(_mutex);
+	std::vector<std::string> paths;
+	for (const Device& dev : _devices) {
+		paths.push_back(dev.path);
+	}
+	return paths;
+}
+
+/*! \brief Get the number of events that were dropped because the queue was full. */
+uint64_t CX_EvdevInput::getDroppedEventCount(void) {
+	return _droppedEvents;
+}
+
+/*! Find the evdev devices that look like keyboards or mice.
+\param keyboards Include keyboards.
+\param mice Include mice.
+\return The paths of the devices. Devices that cannot be opened (e.g. because of permissions) are not included. */
+std::vector<std::string> CX_EvdevInput::findDevices(bool keyboards, bool mice) {
+	std::vector<std::string> paths;
+
+	DIR* dir = opendir("/dev/input");
+	if (dir == nullptr) {
+		return paths;
+	}
+
+	while (dirent* entry = readdir(dir)) {
+		std::string name = entry->d_name;
+		if (name.compare(0, 5, "event") != 0) {
+			continue;
+		}
+
+		std::string path = "/dev/input/" + name;
+		int fd = open(path.c_str(), O_RDONLY | O_NONBLOCK);
+		if (fd < 0) {
+			continue;
+		}
+
+		bool isKeyboard = false;
+		bool isMouse = false;
+		probeDevice(fd, &isKeyboard, &isMouse);
+		close(fd);
+
+		if ((keyboards && isKeyboard) || (mice && isMouse)) {
+			paths.push_back(path);
+		}
+	}
+
+	closedir(dir);
+
+	std::sort(paths.begin(), paths.end());
+	return paths;
+}
+
+bool CX_EvdevInput::_openDevices(void) {
+
+	std::vector<std::string> paths = _config.devicePaths;
+	if (paths.empty()) {
+		paths = findDevices(_config.useKeyboard, _config.useMouse);
+	}
+
+	for (const std::string& path : paths) {
+		int fd = open(path.c_str(), O_RDONLY | O_NONBLOCK);
+		if (fd < 0) {
+			Instances::Log.warning("CX_EvdevInput") << "Could not open device \"" << path << "\". Check that the user has read permission.";
+			continue;
+		}
+
+		bool isKeyboard = false;
+		bool isMouse = false;
+		probeDevice(fd, &isKeyboard, &isMouse);
+
+		if (!(isKeyboard && _config.useKeyboard) && !(isMouse && _config.useMouse)) {
+			Instances::Log.verbose("CX_EvdevInput") << "Device \"" << path << "\" is not a keyboard or mouse that is being used.";
+			close(fd);
+			continue;
+		}
+
+		// Ask for timestamps from the monotonic clock, which is not changed by NTP adjustments.
+		int clockId = CLOCK_MONOTONIC;
+		if (ioctl(fd, EVIOCSCLOCKID, &clockId) != 0) {
+			Instances::Log.warning("CX_EvdevInput") << "Could not set the clock of \"" << path << "\" to CLOCK_MONOTONIC.";
+		}
+
+		if (_config.grabDevices && ioctl(fd, EVIOCGRAB, 1) != 0) {
+			Instances::Log.warning("CX_EvdevInput") << "Could not grab device \"" << path << "\".";
+		}
+
+		Device dev;
+		dev.path = path;
+		dev.kind = (isMouse && _config.useMouse) ? DeviceKind::Mouse : DeviceKind::Keyboard;
+		dev.fd = fd;
+		dev.relX = 0;
+		dev.relY = 0;
+		_devices.push_back(dev);
+
+		Instances::Log.verbose("CX_EvdevInput") << "Opened device \"" << path << "\".";
+	}
+
+	if (_devices.empty()) {
+		Instances::Log.error("CX_EvdevInput") << "setup(): No keyboard or mouse devices could be opened.";
+		return false;
+	}
+
+	_epollFd = epoll_create1(0);
+	_wakeFd = eventfd(0, EFD_NONBLOCK);
+
+	for (size_t i = 0; i < _devices.size(); i++) {
+		epoll_event ev;
+		ev.events = EPOLLIN;
+		ev.data.u64 = i;
+		epoll_ctl(_epollFd, EPOLL_CTL_ADD, _devices[i].fd, &ev);
+	}
+
+	epoll_event wake;
+	wake.events = EPOLLIN;
+	wake.data.u64 = std::numeric_limits<uint64_t>::max();
+	epoll_ctl(_epollFd, EPOLL_CTL_ADD, _wakeFd, &wake);
+
+	return true;
+}
+
+void CX_EvdevInput::_closeDevices(void) {
+	for (Device& dev : _devices) {
+		if (dev.fd >= 0) {
+			if (_config.grabDevices) {
+				ioctl(dev.fd, EVIOCGRAB, 0);
+			}
+			close(dev.fd);
+		}
+	}
+	_devices.clear();
+
+	if (_epollFd >= 0) {
+		close(_epollFd);
+		_epollFd = -1;
+	}
+	if (_wakeFd >= 0) {
+		close(_wakeFd);
+		_wakeFd = -1;
+	}
+}
+
+// Measures the offset between CLOCK_MONOTONIC and CX_Clock. The sample with the shortest
+// gap between the two CX_Clock readings is used, because it was least disturbed by preemption.
+void CX_EvdevInput::_syncClocks(void) {
+	CX_Millis bestGap = CX_Millis::max();
+
+	for (int i = 0; i < 10; i++) {
+		CX_Millis before = Instances::Clock.now();
+		int64_t kernel = kernelClockNanos(CLOCK_MONOTONIC);
+		CX_Millis after = Instances::Clock.now();
+
+		CX_Millis gap = after - before;
+		if (gap < bestGap) {
+			bestGap = gap;
+			_clockOffset = before + gap / 2 - CX_Nanos(kernel);
+		}
+	}
+
+	_clockUncertainty = bestGap / 2;
+
+	_lastClockSync = Instances::Clock.now();
+}
+
+CX_Millis CX_EvdevInput::_kernelToClockTime(int64_t seconds, int64_t microseconds) {
+	return CX_Nanos(seconds * 1000000000 + microseconds * 1000) + _clockOffset;
+}
+
+void CX_EvdevInput::_deviceThreadFunction(void) {
+
+	_syncClocks();
+
+	const int maxEpollEvents = 16;
+	epoll_event epollEvents[maxEpollEvents];
+	input_event inputEvents[64];
+
+	int timeoutMs = std::max<int>(1, (int)_config.clockResyncInterval.millis());
+
+	while (_running) {
+		int ready = epoll_wait(_epollFd, epollEvents, maxEpollEvents, timeoutMs);
+
+		if (Instances::Clock.now() - _lastClockSync > _config.clockResyncInterval) {
+			_syncClocks();
+		}
+
+		for (int i = 0; i < ready; i++) {
+			uint64_t index = epollEvents[i].data.u64;
+			if (index >= _devices.size()) {
+				continue; // Woken by stop()
+			}
+
+			Device& dev = _devices[index];
+
+			while (true) {
+				ssize_t bytes = read(dev.fd, inputEvents, sizeof(inputEvents));
+				if (bytes <= 0) {
+					if (bytes < 0 && errno == ENODEV) {
+						Instances::Log.warning("CX_EvdevInput") << "Device \"" << dev.path << "\" was disconnected.";
+						epoll_ctl(_epollFd, EPOLL_CTL_DEL, dev.fd, nullptr);
+					}
+					break;
+				}
+
+				size_t count = bytes / sizeof(input_event);
+				for (size_t j = 0; j < count; j++) {
+					const input_event& ie = inputEvents[j];
+
+					RawEvent ev;
+					ev.device = (int)index;
+					ev.time = _kernelToClockTime(ie.time.tv_sec, ie.time.tv_usec);
+					ev.type = ie.type;
+					ev.code = ie.code;
+					ev.value = ie.value;
+
+					if (_recordFile.is_open()) {
+						Util::writeBinaryValue<int32_t>(_recordFile, ev.device);
+						Util::writeBinaryValue<int64_t>(_recordFile, ev.time.nanos());
+						Util::writeBinaryValue<uint16_t>(_recordFile, ev.type);
+						Util::writeBinaryValue<uint16_t>(_recordFile, ev.code);
+						Util::writeBinaryValue<int32_t>(_recordFile, ev.value);
+					}
+
+					_processEvent(ev);
+				}
+			}
+		}
+	}
+
+	if (_recordFile.is_open()) {
+		_recordFile.flush();
+	}
+}
+
+void CX_EvdevInput::_replayThreadFunction(std::vector<RawEvent> events) {
+
+	_clockUncertainty = CX_Millis(0); // Replayed times are exact by definition
+
+	CX_Millis replayStart = Instances::Clock.now();
+	CX_Millis recordingStart = events.empty() ? CX_Millis(0) : events.front().time;
+
+	for (RawEvent& ev : events) {
+		if (!_running) {
+			break;
+		}
+
+		ev.time = replayStart + (ev.time - recordingStart);
+
+		if (_config.replayInRealTime) {
+			// Sleep in short steps so that stop() does not have to wait for long gaps in the recording
+			CX_Millis wait = ev.time - Instances::Clock.now();
+			while (_running && wait > CX_Millis(0)) {
+				Instances::Clock.sleep(std::min(wait, CX_Millis(10)));
+				wait = ev.time - Instances::Clock.now();
+			}
+		}
+
+		_processEvent(ev);
+	}
+
+	_replaying = false;
+}
+
+bool CX_EvdevInput::_readRecording(std::string filename, std::vector<RawEvent>& events, std::vector<Device>& devices) {
+	std::ifstream file(ofToDataPath(filename).c_str(), std::ios::in | std::ios::binary);
+	if (!file.is_open()) {
+		Instances::Log.error("CX_EvdevInput") << "Could not open recording \"" << filename << "\".";
+		return false;
+	}
+
+	char magic[4];
+	uint32_t version = 0;
+	file.read(magic, sizeof(magic));
+	if (!file.good() || std::memcmp(magic, recordingMagic, sizeof(magic)) != 0 || !Util::readBinaryValue(file, version)) {
+		Instances::Log.error("CX_EvdevInput") << "\"" << filename << "\" is not an evdev recording.";
+		return false;
+	}
+	if (version != recordingVersion) {
+		Instances::Log.error("CX_EvdevInput") << "\"" << filename << "\" has version " << version << ", but only version " <<
+			recordingVersion << " can be read.";
+		return false;
+	}
+
+	devices.clear();
+	events.clear();
+
+	uint32_t deviceCount = 0;
+	if (!Util::readBinaryValue(file, deviceCount)) {
+		Instances::Log.error("CX_EvdevInput") << "The device list of \"" << filename << "\" is incomplete.";
+		return false;
+	}
+
+	for (uint32_t i = 0; i < deviceCount; i++) {
+		uint8_t kind = 0;
+		uint32_t pathLength = 0;
+		if (!Util::readBinaryValue(file, kind) || !Util::readBinaryValue(file, pathLength) || pathLength > 4096) {
+			Instances::Log.error("CX_EvdevInput") << "The device list of \"" << filename << "\" is incomplete.";
+			return false;
+		}
+
+		Device dev;
+		dev.path.resize(pathLength);
+		if (pathLength > 0 && !file.read(&dev.path[0], pathLength)) {
+			Instances::Log.error("CX_EvdevInput") << "The device list of \"" << filename << "\" is incomplete.";
+			return false;
+		}
+		dev.kind = (kind == 1) ? DeviceKind::Mouse : DeviceKind::Keyboard;
+		dev.fd = -1;
+		dev.relX = 0;
+		dev.relY = 0;
+		devices.push_back(dev);
+	}
+
+	while (true) {
+		RawEvent ev;
+		int32_t device = 0;
+		int64_t nanos = 0;
+		if (!Util::readBinaryValue(file, device)) {
+			break;
+		}
+		if (!Util::readBinaryValue(file, nanos) || !Util::readBinaryValue(file, ev.type) ||
+			!Util::readBinaryValue(file, ev.code) || !Util::readBinaryValue(file, ev.value))
+		{
+			Instances::Log.warning("CX_EvdevInput") << "The last event in \"" << filename << "\" is incomplete and was skipped.";
+			break;
+		}
+		if (device < 0 || (size_t)device >= devices.size()) {
+			Instances::Log.warning("CX_EvdevInput") << "Skipped an event for an unknown device in \"" << filename << "\".";
+			continue;
+		}
+		ev.device = device;
+		ev.time = CX_Nanos(nanos);
+		events.push_back(ev);
+	}
+
+	return true;
+}
+
+// Converts evdev events to CX events. Runs on the reading (or replay) thread.
+void CX_EvdevInput::_processEvent(const RawEvent& ev) {
+	Device& dev = _devices[ev.device];
+
+	if (ev.type == EV_KEY) {
+		if (isMouseButton(ev.code)) {
+			if (!_config.useMouse || ev.value == 2) {
+				return; // Mouse buttons don't repeat
+			}
+
+			CX_Mouse::Event mev;
+			mev.type = (ev.value != 0) ? CX_Mouse::Pressed : CX_Mouse::Released;
+			mev.button = toMouseButton(ev.code);
+			mev.x = _cursorPos.x;
+			mev.y = _cursorPos.y;
+			mev.time = ev.time;
+			mev.uncertainty = _clockUncertainty;
+
+			_heldButtonCount = std::max(0, _heldButtonCount + (ev.value != 0 ? 1 : -1));
+			_pushMouseEvent(mev);
+
+		} else if (_config.useKeyboard && ev.code < BTN_MISC) {
+			CX_Keyboard::Event kev;
+			switch (ev.value) {
+			case 0: kev.type = CX_Keyboard::Released; break;
+			case 1: kev.type = CX_Keyboard::Pressed; break;
+			default: kev.type = CX_Keyboard::Repeat; break;
+			}
+
+			kev.codes = CX_Keyboard::Keycodes(-1, toGlfwKey(ev.code), ev.code, 0);
+			kev.key = kev.codes.glfw;
+			kev.time = ev.time;
+			kev.uncertainty = _clockUncertainty;
+
+			_pushKeyboardEvent(kev);
+		}
+
+	} else if (ev.type == EV_REL && _config.useMouse) {
+		switch (ev.code) {
+		case REL_X:
+			dev.relX += ev.value;
+			break;
+		case REL_Y:
+			dev.relY += ev.value;
+			break;
+		case REL_WHEEL:
+		case REL_HWHEEL:
+		{
+			CX_Mouse::Event mev;
+			mev.type = CX_Mouse::Scrolled;
+			mev.button = -1;
+			mev.x = (ev.code == REL_HWHEEL) ? (float)ev.value : 0;
+			mev.y = (ev.code == REL_WHEEL) ? (float)ev.value : 0;
+			mev.time = ev.time;
+			mev.uncertainty = _clockUncertainty;
+			_pushMouseEvent(mev);
+			break;
+		}
+		}
+
+	} else if (ev.type == EV_SYN && ev.code == SYN_REPORT) {
+		// Motion is reported at the end of each packet so that x and y changes are combined
+		if (dev.relX != 0 || dev.relY != 0) {
+			_cursorPos.x = ofClamp(_cursorPos.x + dev.relX, 0, _cursorLimit.x);
+			_cursorPos.y = ofClamp(_cursorPos.y + dev.relY, 0, _cursorLimit.y);
+			dev.relX = 0;
+			dev.relY = 0;
+
+			CX_Mouse::Event mev;
+			mev.type = (_heldButtonCount > 0) ? CX_Mouse::Dragged : CX_Mouse::Moved;
+			mev.button = -1;
+			mev.x = _cursorPos.x;
+			mev.y = _cursorPos.y;
+			mev.time = ev.time;
+			mev.uncertainty = _clockUncertainty;
+			_pushMouseEvent(mev);
+		}
+	}
+}
+
+void CX_EvdevInput::_pushKeyboardEvent(const CX_Keyboard::Event& ev) {
+	if (!_keyboardEvents->push(ev)) {
+		_droppedEvents++;
+	}
+}
+
+void CX_EvdevInput::_pushMouseEvent(const CX_Mouse::Event& ev) {
+	if (!_mouseEvents->push(ev)) {
+		_droppedEvents++;
+	}
+}
+
+void CX_EvdevInput::_takeEvents(void) {
+	CX_Keyboard::Event kev;
+	while (_keyboardEvents->pop(kev)) {
+		if (_manager->Keyboard.enabled()) {
+			_manager->Keyboard._storeEvent(kev);
+		}
+	}
+
+	CX_Mouse::Event mev;
+	while (_mouseEvents->pop(mev)) {
+		if (_manager->Mouse.enabled()) {
+			_manager->Mouse._storeEvent(mev);
+		}
+	}
+}
+
+} // namespace CX
+
+#endif // TARGET_LINUX
@@ -0,0 +1,193 @@
+#pragma once
+
+#include "ofConstants.h"
+
+#ifdef TARGET_LINUX
+
+#include <mutex>
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <fstream>
+
+#include "CX_Clock.h"
+#include "CX_Keyboard.h"
+#include "CX_Mouse.h"
+#include "CX_Utilities.h"
+
+namespace CX {
+
+	class CX_InputManager;
+
+	/*! This class reads keyboard and mouse events directly from Linux evdev devices (`/dev/input/event*`), rather than
+	getting them from GLFW. The kernel timestamps each event when the device interrupt is handled, and these timestamps
+	are converted to CX_Clock time, so event times are not affected by when the program polls for events or by
+	scheduling delays.
+
+	The devices are read on a separate thread (using epoll) and the events are handed to the CX_Keyboard and CX_Mouse of
+	a CX_InputManager, which stop receiving events from GLFW while this is running. Events are moved into the devices whenever
+	CX_InputManager::pollEvents() is called, so existing code (e.g. CX_Keyboard::waitForKeypress()) works without changes.
+
+	Differences from GLFW events:
+	+ Keyboard events have `codes.glfw`, `key` (converted from the Linux keycode), and `codes.scancode` (the Linux keycode),
+	but `codes.oF` is -1 and `codes.codepoint` is 0, because they depend on the keyboard layout, which evdev does not know about.
+	+ The mouse reports relative motion. Cursor positions are estimated by adding the motion to the last known cursor position
+	(see CX_Mouse::getCursorPosition()), without pointer acceleration, and limited to the display resolution. Use GLFW events if
+	you need exact cursor positions.
+	+ Events are read regardless of which window has focus.
+
+	Reading evdev devices requires read permission, which usually means that the user must be in the `input` group.
+
+	The raw evdev events can be recorded to a binary file and replayed later (see `Configuration::recordFilename` and
+	`Configuration::replayFilename`), so that the conversion of evdev events, including the cursor position estimation,
+	can be tested without devices. Replayed events are converted exactly like events read from devices. To record and replay
+	the converted events of all input sources, use CX_InputRecorder and CX_InputReplayer instead.
+
+	\code{.cpp}
+	CX_EvdevInput evdev;
+	CX_EvdevInput::Configuration config;
+	config.inputManager = &Input;
+	config.recordFilename = "logfiles/input.cxev"; // Optional: keep a copy of the raw events
+	evdev.setup(config);
+
+	CX_Keyboard::Event ev = Input.Keyboard.waitForKeypress(' ');
+	// ev.time is when the kernel received the keypress
+	\endcode
+
+	\ingroup inputDevices
+	*/
+	class CX_EvdevInput {
+	public:
+
+		struct Configuration {
+			Configuration(void) :
+				inputManager(nullptr),
+				useKeyboard(true),
+				useMouse(true),
+				grabDevices(false),
+				queueCapacity(4096),
+				replayFilename(""),
+				replayInRealTime(true),
+				recordFilename(""),
+				clockResyncInterval(1000)
+			{}
+
+			/*! \brief The input manager to deliver events to. If `nullptr`, CX::Instances::Input is used. */
+			CX_InputManager* inputManager;
+
+			bool useKeyboard; //!< If `true`, keyboard events are read. The keyboard of `inputManager` is enabled.
+			bool useMouse; //!< If `true`, mouse events are read. The mouse of `inputManager` is enabled.
+
+			/*! \brief The devices to read, e.g. "/dev/input/event3". If empty, all devices in /dev/input that look like
+			keyboards or mice are used. */
+			std::vector<std::string> devicePaths;
+
+			/*! \brief If `true`, the devices are grabbed so that no other program (including the X server) receives their events. */
+			bool grabDevices;
+
+			size_t queueCapacity; //!< The number of events that can wait for CX_InputManager::pollEvents() before events are dropped.
+
+			/*! \brief If not empty, events are read from this recording instead of from devices. Relative paths are
+			relative to the data directory. */
+			std::string replayFilename;
+
+			/*! \brief If `true`, replayed events are delivered with the same timing as when they were recorded. If `false`,
+			they are delivered as fast as possible, but their timestamps keep the recorded spacing. */
+			bool replayInRealTime;
+
+			/*! \brief If not empty, the raw events read from devices are written to this binary file, which can be replayed
+			with `replayFilename`. Relative paths are relative to the data directory. */
+			std::string recordFilename;
+
+			/*! \brief How often the offset between the kernel clock and CX_Clock is remeasured, which corrects for drift. */
+			CX_Millis clockResyncInterval;
+		};
+
+		CX_EvdevInput(void);
+		~CX_EvdevInput(void);
+
+		bool setup(const Configuration& config);
+		Configuration getConfiguration(void);
+
+		void stop(void);
+		bool isRunning(void);
+		bool isReplaying(void);
+
+		std::vector<std::string> getOpenDevicePaths(void);
+		uint64_t getDroppedEventCount(void);
+
+		static std::vector<std::string> findDevices(bool keyboards, bool mice);
+
+	private:
+
+		// The fields of a Linux input_event, with the time already converted to CX_Clock time
+		struct RawEvent {
+			int device; // Index into _devices
+			CX_Millis time;
+			uint16_t type;
+			uint16_t code;
+			int32_t value;
+		};
+
+		enum class DeviceKind : int {
+			Keyboard,
+			Mouse
+		};
+
+		struct Device {
+			std::string path;
+			DeviceKind kind;
+			int fd;
+
+			// Motion accumulated until the next SYN_REPORT
+			int relX;
+			int relY;
+		};
+
+		std::recursive_mutex _mutex;
+		Configuration _config;
+		CX_InputManager* _manager;
+
+		std::vector<Device> _devices;
+
+		std::thread _thread;
+		std::atomic<bool> _running;
+		std::atomic<bool> _replaying;
+		int _epollFd;
+		int _wakeFd; // eventfd used to wake the thread when stopping
+
+		std::ofstream _recordFile;
+
+		std::unique_ptr<Util::SpscQueue<CX_Keyboard::Event>> _keyboardEvents;
+		std::unique_ptr<Util::SpscQueue<CX_Mouse::Event>> _mouseEvents;
+		std::atomic<uint64_t> _droppedEvents;
+
+		// Only used on the reading thread
+		ofPoint _cursorPos;
+		int _heldButtonCount;
+		ofPoint _cursorLimit;
+
+		// Mapping from the kernel clock to CX_Clock time, only used on the reading thread
+		CX_Millis _clockOffset;
+		CX_Millis _clockUncertainty; // Used as the uncertainty of event times
+		CX_Millis _lastClockSync;
+		void _syncClocks(void);
+		CX_Millis _kernelToClockTime(int64_t seconds, int64_t microseconds);
+
+		bool _openDevices(void);
+		void _closeDevices(void);
+
+		void _deviceThreadFunction(void);
+		void _replayThreadFunction(std::vector<RawEvent> events);
+		static bool _readRecording(std::string filename, std::vector<RawEvent>& events, std::vector<Device>& devices);
+
+		void _processEvent(const RawEvent& ev);
+		void _pushKeyboardEvent(const CX_Keyboard::Event& ev);
+		void _pushMouseEvent(const CX_Mouse::Event& ev);
+
+		void _takeEvents(void); // Called by CX_InputManager::pollEvents()
+	};
+
+} // namespace CX
+
+#endif // TARGET_LINUX
@@ -0,0 +1,486 @@
+#include "CX_FrameCapture.h"
+
+#include <fstream>
+#include <cstring>
+
+#include "ofImage.h"
+#include "ofFileUtils.h"
+
+#include "CX_Logger.h"
+#include "CX_DisplayThread.h"
+
+namespace CX {
+
+CX_FrameCapture::CX_FrameCapture(void) :
+	_encoding(false),
+	_encoderRunning(false),
+	_captures(0),
+	_filesWritten(0),
+	_errors(0),
+	_ringStalls(0),
+	_droppedImages(0),
+	_filenameCounter(0)
+{}
+
+CX_FrameCapture::~CX_FrameCapture(void) {
+	_shutdown();
+}
+
+/*! Set up the capture pipeline. If captures are in progress, they are finished first (see flush()).
+\param config The configuration to use.
+\return `false` if the configuration is invalid, `true` otherwise. */
+bool CX_FrameCapture::setup(const Configuration& config) {
+
+	if (config.ringSize == 0) {
+		Instances::Log.error("CX_FrameCapture") << "setup(): ringSize must be at least 1.";
+		return false;
+	}
+
+	// Not locked, because the display thread may need the lock to finish the old readbacks
+	_shutdown();
+
+	std::lock_guard<std::recursive_mutex> lock(_mutex);
+
+	_config = config;
+	_ring.resize(_config.ringSize);
+	_filenameCounter = 0;
+
+	_captures = 0;
+	_filesWritten = 0;
+	_errors = 0;
+	_ringStalls = 0;
+	_droppedImages = 0;
+
+	_encoderRunning = true;
+	_encoderThread = std::thread(&CX_FrameCapture::_encoderFunction, this, _config.format);
+
+	if (_config.displayThread) {
+		ofAddListener(_config.displayThread->updateEvent, this, &CX_FrameCapture::_displayThreadUpdate);
+	}
+
+	return true;
+}
+
+CX_FrameCapture::Configuration CX_FrameCapture::getConfiguration(void) {
+	std::lock_guard<std::recursive_mutex> lock(_mutex);
+	return _config;
+}
+
+/*! Start capturing the contents of a framebuffer. The pixels are copied asynchronously into a PBO and
+written to `filename` by the encoder thread.
+\param fbo The framebuffer to capture. If it is multisampled, it is resolved before the copy.
+\param filename The name of the file. Relative paths are relative to the data directory. If the
+directory does not exist, it is created.
+\return `false` if setup() has not been called or this is not the thread that has the rendering context, `true` otherwise. */
+bool CX_FrameCapture::capture(ofFbo& fbo, std::string filename) {
+	std::lock_guard<std::recursive_mutex> lock(_mutex);
+
+	if (!_encoderRunning) {
+		Instances::Log.error("CX_FrameCapture") << "capture(): setup() has not been called.";
+		return false;
+	}
+
+	if (!_checkRenderingThread("capture()")) {
+		return false;
+	}
+
+	ofTexture& tex = fbo.getTextureReference(); // Resolves multisampled fbos
+	Readback* rb = _acquireReadback(tex.getWidth(), tex.getHeight());
+
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, rb->pbo);
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+
+	glBindTexture(tex.getTextureData().textureTarget, tex.getTextureData().textureID);
+	glGetTexImage(tex.getTextureData().textureTarget, 0, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+	glBindTexture(tex.getTextureData().textureTarget, 0);
+
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	// Framebuffers are drawn with the y axis flipped, so the first row of the texture is the top of the image.
+	_startReadback(*rb, filename, false);
+	return true;
+}
+
+/*! Start capturing the contents of the back buffer. Call this after drawing to the back buffer is complete but
+before the buffers are swapped, e.g. just after CX_Display::endDrawingToBackBuffer().
+\param filename The name of the file. Relative paths are relative to the data directory.
+\return `false` if setup() has not been called or this is not the thread that has the rendering context, `true` otherwise. */
+bool CX_FrameCapture::captureBackBuffer(std::string filename) {
+	std::lock_guard<std::recursive_mutex> lock(_mutex);
+
+	if (!_encoderRunning) {
+		Instances::Log.error("CX_FrameCapture") << "captureBackBuffer(): setup() has not been called.";
+		return false;
+	}
+
+	if (!_checkRenderingThread("captureBackBuffer()")) {
+		return false;
+	}
+
+	GLint viewport[4];
+	glGetIntegerv(GL_VIEWPORT, viewport);
+	int width = viewport[2];
+	int height = viewport[3];
+
+	Readback* rb = _acquireReadback(width, height);
+
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, rb->pbo);
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+	glReadBuffer(GL_BACK);
+	glReadPixels(viewport[0], viewport[1], width, height, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	_startReadback(*rb, filename, true);
+	return true;
+}
+
+/*! Make a unique filename in `Configuration::directory` with the extension for `Configuration::format`.
+\param name A name to include in the filename, e.g. the name of a slide. May be empty.
+\return A filename like "captures/000012_name.png". */
+std::string CX_FrameCapture::makeFilename(std::string name) {
+	std::lock_guard<std::recursive_mutex> lock(_mutex);
+
+	std::string number = ofToString(_filenameCounter++, 6, '0');
+	std::string extension = (_config.format == Format::PNG) ? ".png" : ".rgba";
+
+	std::string filename = number;
+	if (name != "") {
+		filename += "_" + name;
+	}
+	filename += extension;
+
+	if (_config.directory == "") {
+		return filename;
+	}
+	return ofFilePath::join(_config.directory, filename);
+}
+
+/*! Check whether any in-flight readbacks are complete and, if so, hand their pixels to the encoder thread.
+This does not block. It is called by capture() and captureBackBuffer(), when slides in a CX_SlideBuffer are rendered,
+and on every loop of `Configuration::displayThread`. If none of those happen regularly, call it regularly (e.g. once
+per frame) so that completed readbacks are not left waiting.
+
+This must be called from the thread that has the rendering context. */
+void CX_FrameCapture::update(void) {
+	if (!_checkRenderingThread("update()")) {
+		return;
+	}
+
+	std::lock_guard<std::recursive_mutex> lock(_mutex);
+
+	// Readbacks complete in order, so stop at the first one that is not done.
+	while (!_inFlight.empty()) {
+		Readback& rb = _ring[_inFlight.front()];
+
+		rb.fence.updateSync();
+		if (!rb.fence.syncComplete()) {
+			break;
+		}
+
+		_completeReadback(rb, false);
+		_inFlight.pop_front();
+	}
+}
+
+/*! Block until all in-flight readbacks are complete and all images have been written to files.
+
+The readbacks are completed on the thread that has the rendering context. If that is not the calling thread, they are
+completed by `Configuration::displayThread`, if it has the rendering context.
+\return `false` if the in-flight readbacks could not be completed because neither this thread nor the display thread
+has the rendering context, `true` otherwise. Images that were already read back are written in either case. */
+bool CX_FrameCapture::flush(void) {
+	bool completed = true;
+	if (getInFlightCount() > 0) {
+		completed = _runOnRenderingThread(std::bind(&CX_FrameCapture::_completeAllReadbacks, this), "flush()");
+	}
+
+	std::unique_lock<std::mutex> encodeLock(_encodeMutex);
+	while (_encoderRunning && (!_encodeQueue.empty() || _encoding)) {
+		_encodeCondition.wait(encodeLock);
+	}
+
+	return completed;
+}
+
+bool CX_FrameCapture::_completeAllReadbacks(void) {
+	std::lock_guard<std::recursive_mutex> lock(_mutex);
+
+	while (!_inFlight.empty()) {
+		_completeReadback(_ring[_inFlight.front()], true);
+		_inFlight.pop_front();
+	}
+	return true;
+}
+
+/*! \brief Get the number of readbacks that have been started but not yet handed to the encoder thread. */
+size_t CX_FrameCapture::getInFlightCount(void) {
+	std::lock_guard<std::recursive_mutex> lock(_mutex);
+	return _inFlight.size();
+}
+
+/*! \brief Get the number of images waiting to be encoded, including the image currently being encoded. */
+size_t CX_FrameCapture::getQueuedImageCount(void) {
+	std::lock_guard<std::mutex> lock(_encodeMutex);
+	return _encodeQueue.size() + (_encoding ? 1 : 0);
+}
+
+CX_FrameCapture::Statistics CX_FrameCapture::getStatistics(void) {
+	Statistics stats;
+	stats.captures = _captures;
+	stats.filesWritten = _filesWritten;
+	stats.errors = _errors;
+	stats.ringStalls = _ringStalls;
+	stats.droppedImages = _droppedImages;
+	return stats;
+}
+
+// Must not be called with _mutex locked: the display thread may need it to finish the readbacks.
+void CX_FrameCapture::_shutdown(void) {
+
+	if (_config.displayThread) {
+		ofRemoveListener(_config.displayThread->updateEvent, this, &CX_FrameCapture::_displayThreadUpdate);
+	}
+
+	if (_encoderRunning) {
+		flush();
+
+		{
+			std::lock_guard<std::mutex> encodeLock(_encodeMutex);
+			_encoderRunning = false;
+		}
+		_encodeCondition.notify_all();
+	}
+
+	if (_encoderThread.joinable()) {
+		_encoderThread.join();
+	}
+
+	bool anyBuffers = false;
+	{
+		std::lock_guard<std::recursive_mutex> lock(_mutex);
+		for (const Readback& rb : _ring) {
+			anyBuffers = anyBuffers || (rb.pbo != 0);
+		}
+	}
+
+	// Nothing to delete if nothing was ever captured, e.g. on the first setup(), so no rendering context is needed.
+	bool deleted = !anyBuffers || _runOnRenderingThread([this]() {
+		std::lock_guard<std::recursive_mutex> lock(_mutex);
+		for (Readback& rb : _ring) {
+			if (rb.pbo != 0) {
+				glDeleteBuffers(1, &rb.pbo);
+				rb.pbo = 0;
+			}
+		}
+		return true;
+	}, "_shutdown()");
+
+	if (!deleted) {
+		Instances::Log.warning("CX_FrameCapture") << "The pixel buffers could not be deleted because the rendering context "
+			"was not available.";
+	}
+
+	std::lock_guard<std::recursive_mutex> lock(_mutex);
+	_ring.clear();
+	_inFlight.clear();
+}
+
+bool CX_FrameCapture::_checkRenderingThread(std::string functionName) {
+	if (!Private::glfwContextManager.isLockedByThisThread()) {
+		Instances::Log.error("CX_FrameCapture") << functionName << ": Called from a thread that does not have the rendering context. "
+			"It must be called from the thread that renders, e.g. the display thread if it has the rendering context.";
+		return false;
+	}
+	return true;
+}
+
+// Runs fun on this thread if it has the rendering context, otherwise on the display thread if it has it.
+// Must not be called with _mutex locked, because fun may need it on the display thread.
+bool CX_FrameCapture::_runOnRenderingThread(std::function<bool(void)> fun, std::string functionName) {
+	if (Private::glfwContextManager.isLockedByThisThread()) {
+		return fun();
+	}
+
+	CX_DisplayThread* displayThread = _config.displayThread;
+	if (displayThread && displayThread->isThreadRunning() && displayThread->threadOwnsRenderingContext()) {
+		return displayThread->commandExecuteFunction(fun, true);
+	}
+
+	Instances::Log.error("CX_FrameCapture") << functionName << ": Neither this thread nor the display thread has the rendering context.";
+	return false;
+}
+
+void CX_FrameCapture::_displayThreadUpdate(void) {
+	// The display thread may not have the rendering context, e.g. if it only swaps
+	if (Private::glfwContextManager.isLockedByThisThread()) {
+		update();
+	}
+}
+
+CX_FrameCapture::Readback* CX_FrameCapture::_acquireReadback(int width, int height) {
+
+	update();
+
+	// If every PBO is in flight, the oldest readback must be finished before its PBO can be reused.
+	if (_inFlight.size() >= _ring.size()) {
+		_ringStalls++;
+		_completeReadback(_ring[_inFlight.front()], true);
+		_inFlight.pop_front();
+	}
+
+	size_t index = 0;
+	while (_ring[index].active) {
+		index++;
+	}
+	Readback& rb = _ring[index];
+
+	size_t bytes = (size_t)width * height * 4;
+
+	if (rb.pbo == 0) {
+		glGenBuffers(1, &rb.pbo);
+		rb.pboBytes = 0;
+	}
+
+	if (rb.pboBytes != bytes) {
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, rb.pbo);
+		glBufferData(GL_PIXEL_PACK_BUFFER, bytes, nullptr, GL_STREAM_READ);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+		rb.pboBytes = bytes;
+	}
+
+	rb.width = width;
+	rb.height = height;
+
+	_inFlight.push_back(index);
+
+	return &rb;
+}
+
+void CX_FrameCapture::_startReadback(Readback& rb, std::string filename, bool flip) {
+	rb.filename = filename;
+	rb.flip = flip;
+	rb.active = true;
+	rb.fence.startSync();
+
+	_captures++;
+}
+
+// If wait is true, the readback is finished even if the fence has not signaled: mapping the buffer blocks until the copy is done.
+void CX_FrameCapture::_completeReadback(Readback& rb, bool wait) {
+
+	bool copyFailed = !wait && !rb.fence.syncSuccess();
+
+	Image image;
+	image.filename = rb.filename;
+
+	if (!copyFailed) {
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, rb.pbo);
+		const unsigned char* data = (const unsigned char*)glMapBuffer(GL_PIXEL_PACK_BUFFER, GL_READ_ONLY);
+
+		if (data != nullptr) {
+			image.pixels.allocate(rb.width, rb.height, OF_IMAGE_COLOR_ALPHA);
+			unsigned char* dst = image.pixels.getPixels();
+			size_t rowBytes = (size_t)rb.width * 4;
+
+			if (rb.flip) {
+				for (int y = 0; y < rb.height; y++) {
+					std::memcpy(dst + y * rowBytes, data + (rb.height - 1 - y) * rowBytes, rowBytes);
+				}
+			} else {
+				std::memcpy(dst, data, rowBytes * rb.height);
+			}
+
+			glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+		} else {
+			copyFailed = true;
+		}
+
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	}
+
+	rb.fence.clear();
+	rb.active = false;
+
+	if (copyFailed) {
+		_errors++;
+		Instances::Log.error("CX_FrameCapture") << "Reading back the pixels for \"" << rb.filename << "\" failed.";
+		return;
+	}
+
+	std::unique_lock<std::mutex> encodeLock(_encodeMutex);
+
+	// This runs on the rendering thread, so waiting for the encoder could delay swaps. Drop the image instead.
+	if (_encodeQueue.size() >= _config.maxQueuedImages) {
+		encodeLock.unlock();
+		_droppedImages++;
+		Instances::Log.warning("CX_FrameCapture") << "\"" << rb.filename << "\" was dropped because the encoder queue is full.";
+		return;
+	}
+
+	_encodeQueue.push_back(std::move(image));
+	encodeLock.unlock();
+
+	_encodeCondition.notify_all();
+}
+
+void CX_FrameCapture::_encoderFunction(Format format) {
+	std::unique_lock<std::mutex> lock(_encodeMutex);
+
+	while (true) {
+		_encodeCondition.wait(lock, [this]() { return !_encodeQueue.empty() || !_encoderRunning; });
+
+		if (_encodeQueue.empty()) {
+			break; // Only happens once _encoderRunning is false
+		}
+
+		Image image = std::move(_encodeQueue.front());
+		_encodeQueue.pop_front();
+		_encoding = true;
+
+		lock.unlock();
+		_encodeCondition.notify_all(); // There is space in the queue
+
+		if (_encode(image, format)) {
+			_filesWritten++;
+		} else {
+			_errors++;
+		}
+
+		lock.lock();
+		_encoding = false;
+		_encodeCondition.notify_all(); // For flush()
+	}
+}
+
+bool CX_FrameCapture::_encode(Image& image, Format format) {
+
+	std::string path = ofToDataPath(image.filename);
+
+	std::string directory = ofFilePath::getEnclosingDirectory(path, false);
+	if (directory != "" && !ofDirectory::doesDirectoryExist(directory, false)) {
+		ofDirectory::createDirectory(directory, false, true);
+	}
+
+	if (format == Format::PNG) {
+		ofSaveImage(image.pixels, path, OF_IMAGE_QUALITY_BEST);
+		if (!ofFile::doesFileExist(path, false)) {
+			Instances::Log.error("CX_FrameCapture") << "Could not write image file \"" << image.filename << "\".";
+			return false;
+		}
+		return true;
+	}
+
+	std::ofstream file(path.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+	file.write((const char*)image.pixels.getPixels(), (size_t)image.pixels.getWidth() * image.pixels.getHeight() * 4);
+
+	if (!file.good()) {
+		Instances::Log.error("CX_FrameCapture") << "Could not write raw file \"" << image.filename << "\".";
+		return false;
+	}
+	return true;
+}
+
+} // namespace CX
@@ -0,0 +1,208 @@
+#pragma once
+
+#include <deque>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <condition_variable>
+#include <functional>
+
+#include "ofFbo.h"
+#include "ofPixels.h"
+
+#include "CX_Private.h"
+
+namespace CX {
+
+	class CX_DisplayThread;
+
+	/*! This class saves the contents of framebuffers (or the back buffer) to image files without stalling the GPU or
+	the calling thread. It is an asynchronous alternative to Draw::saveFboToFile(), which reads back the pixels and
+	encodes the image on the calling thread.
+
+	A capture works in three stages:
+	1. capture() starts copying the pixels into a pixel buffer object (PBO). The GPU does the copy in the background and
+	capture() returns immediately. Up to `Configuration::ringSize` copies can be in flight at once.
+	2. update() (which is also called by capture()) checks whether in-flight copies are complete and, if so,
+	maps the PBOs and moves the pixels to the encoder queue. Slides in a CX_SlideBuffer call update() every time they are
+	rendered, and if `Configuration::displayThread` is set, update() is called on every loop of the display thread.
+	3. A background thread encodes the pixels to files, as PNG or raw RGBA data.
+
+	Slides in a CX_SlideBuffer can be captured when they are rendered by setting `CX_SlideBuffer::Slide::capture`
+	(see also CX_SlideBuffer::setLastSlideCapture() and `CX_SlideBuffer::Configuration::frameCapture`).
+
+	\code{.cpp}
+	std::shared_ptr<CX_FrameCapture> capture = std::make_shared<CX_FrameCapture>();
+	CX_FrameCapture::Configuration config;
+	config.directory = "stimuli/" + Clock.getDateTimeString();
+	config.displayThread = Disp.getDisplayThread(); // If slides are presented by the display thread
+	capture->setup(config);
+
+	CX_SlideBuffer::Configuration sbConfig;
+	sbConfig.display = &Disp;
+	sbConfig.frameCapture = capture;
+	slideBuffer.setup(sbConfig);
+
+	slideBuffer.beginDrawingNextSlide(500, "target");
+	// draw...
+	slideBuffer.endDrawingCurrentSlide();
+	slideBuffer.setLastSlideCapture(true);
+
+	// present the slides...
+
+	capture->flush(); // Between trials, make sure everything has been written
+	\endcode
+
+	\note capture(), captureBackBuffer(), and update() make OpenGL calls, so they must be called from the thread that has the
+	rendering context. They log an error and do nothing on other threads. flush() and setup() may be called from any thread
+	if `Configuration::displayThread` has the rendering context: the OpenGL work is done on the display thread.
+
+	\ingroup video
+	*/
+	class CX_FrameCapture {
+	public:
+
+		/*! The file format used to save captures. */
+		enum class Format {
+			PNG, //!< Lossless PNG images. Encoding is slow, but is done on the encoder thread.
+
+			/*! Uncompressed RGBA data, 4 bytes per pixel, with rows from the top of the image to the bottom.
+			The file has no header, so the width and height must be known to read it. This is the fastest format. */
+			Raw
+		};
+
+		struct Configuration {
+			Configuration(void) :
+				ringSize(4),
+				format(Format::PNG),
+				directory("captures"),
+				maxQueuedImages(64),
+				displayThread(nullptr)
+			{}
+
+			unsigned int ringSize; //!< The number of PBOs, i.e. the number of captures that can be in flight on the GPU at once.
+			Format format; //!< The file format.
+
+			/*! \brief The directory in which captures made with makeFilename() (e.g. slide captures) are saved.
+			Relative paths are relative to the data directory. */
+			std::string directory;
+
+			/*! \brief The maximum number of images waiting to be encoded. If the encoder falls further behind, further images
+			are dropped (see `Statistics::droppedImages`), because otherwise memory use would grow without bound. Images are
+			not waited for, because that would stall the rendering thread. */
+			unsigned int maxQueuedImages;
+
+			/*! \brief If the display thread has the rendering context (e.g. when slides are presented with CX_SlideQueue),
+			set this to that thread. Readbacks are then completed on every loop of the display thread, and flush() can be called
+			from other threads. */
+			CX_DisplayThread* displayThread;
+		};
+
+		/*! Counts of what the capture pipeline has done since setup(). */
+		struct Statistics {
+			Statistics(void) :
+				captures(0),
+				filesWritten(0),
+				errors(0),
+				ringStalls(0),
+				droppedImages(0)
+			{}
+
+			uint64_t captures; //!< The number of captures that were started.
+			uint64_t filesWritten; //!< The number of files that were successfully written.
+			uint64_t errors; //!< The number of captures that failed (e.g. the file could not be written).
+
+			/*! \brief The number of times that capture() had to wait for the oldest readback to complete because all PBOs
+			were in flight. If this is not 0, increase `Configuration::ringSize`. */
+			uint64_t ringStalls;
+
+			/*! \brief The number of images that were dropped because `Configuration::maxQueuedImages` images were already
+			waiting to be encoded. If this is not 0, increase `Configuration::maxQueuedImages` or use a faster format. */
+			uint64_t droppedImages;
+		};
+
+		CX_FrameCapture(void);
+		~CX_FrameCapture(void);
+
+		bool setup(const Configuration& config);
+		Configuration getConfiguration(void);
+
+		bool capture(ofFbo& fbo, std::string filename);
+		bool captureBackBuffer(std::string filename);
+
+		std::string makeFilename(std::string name);
+
+		void update(void);
+		bool flush(void);
+
+		size_t getInFlightCount(void);
+		size_t getQueuedImageCount(void);
+
+		Statistics getStatistics(void);
+
+	private:
+
+		struct Readback {
+			Readback(void) :
+				pbo(0),
+				pboBytes(0),
+				width(0),
+				height(0),
+				flip(false),
+				active(false)
+			{}
+
+			GLuint pbo;
+			size_t pboBytes;
+
+			int width;
+			int height;
+			bool flip; // Rows are bottom to top
+			std::string filename;
+
+			Private::CX_GLFenceSync fence;
+			bool active;
+		};
+
+		struct Image {
+			ofPixels pixels;
+			std::string filename;
+		};
+
+		std::recursive_mutex _mutex;
+		Configuration _config;
+
+		std::vector<Readback> _ring;
+		std::deque<size_t> _inFlight; // Indices into _ring, oldest first
+
+		std::mutex _encodeMutex;
+		std::condition_variable _encodeCondition;
+		std::deque<Image> _encodeQueue;
+		bool _encoding; // true while the encoder is working on an image
+		bool _encoderRunning;
+		std::thread _encoderThread;
+
+		std::atomic<uint64_t> _captures;
+		std::atomic<uint64_t> _filesWritten;
+		std::atomic<uint64_t> _errors;
+		std::atomic<uint64_t> _ringStalls;
+		std::atomic<uint64_t> _droppedImages;
+
+		uint64_t _filenameCounter;
+
+		void _shutdown(void);
+
+		bool _checkRenderingThread(std::string functionName);
+		bool _runOnRenderingThread(std::function<bool(void)> fun, std::string functionName);
+		void _displayThreadUpdate(void);
+		bool _completeAllReadbacks(void);
+
+		Readback* _acquireReadback(int width, int height);
+		void _startReadback(Readback& rb, std::string filename, bool flip);
+		void _completeReadback(Readback& rb, bool wait);
+
+		void _encoderFunction(Format format);
+		bool _encode(Image& image, Format format);
+	};
+
+} // namespace CX
@@ -0,0 +1,337 @@
+#include "CX_FrameTelemetry.h"
+
+#include "CX_Display.h"
+#include "CX_Logger.h"
+
+namespace CX {
+
+namespace Private {
+
+	// Binary file layout: a header of "CXFT", uint32 version, uint32 record size in bytes, then records.
+	// Fields are written one at a time in native byte order so that struct padding does not matter.
+	const char telemetryFileMagic[4] = { 'C', 'X', 'F', 'T' };
+	const uint32_t telemetryFileVersion = 1;
+	const uint32_t telemetryRecordBytes = sizeof(uint64_t) + 6 * sizeof(cxTick_t) + sizeof(uint32_t) + sizeof(uint8_t);
+
+	bool readTelemetryTime(std::istream& is, CX_Millis& time) {
+		cxTick_t nanos;
+		if (!Util::readBinaryValue(is, nanos)) {
+			return false;
+		}
+		time = CX_Nanos(nanos);
+		return true;
+	}
+
+}
+
+CX_FrameTelemetry::CX_FrameTelemetry(CX_Display* display) :
+	_display(display),
+	_recording(false),
+	_lastSwapTime(-1),
+	_records(0),
+	_lostRecords(0),
+	_missedFrames(0),
+	_exportedRecords(0),
+	_exportThreadRunning(false)
+{}
+
+CX_FrameTelemetry::~CX_FrameTelemetry(void) {
+	stop();
+}
+
+/*! Start recording swaps with the given configuration. If recording was already in progress, it is stopped
+(see stop()) and any records that have not been taken out of the ring are discarded.
+\param config The configuration to use.
+\return `false` if the binary file could not be opened, `true` otherwise. */
+bool CX_FrameTelemetry::setup(const Configuration& config) {
+
+	stop();
+
+	std::lock_guard<std::recursive_mutex> consumerLock(_consumerMutex);
+
+	if (config.filename != "") {
+		_file.open(ofToDataPath(config.filename).c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+		if (!_file.is_open()) {
+			Instances::Log.error("CX_FrameTelemetry") << "setup(): Could not open file \"" << config.filename << "\" for writing.";
+			return false;
+		}
+
+		_file.write(Private::telemetryFileMagic, sizeof(Private::telemetryFileMagic));
+		Util::writeBinaryValue(_file, Private::telemetryFileVersion);
+		Util::writeBinaryValue(_file, Private::telemetryRecordBytes);
+		_file.flush();
+	}
+
+	{
+		std::lock_guard<std::mutex> producerLock(_producerMutex);
+
+		_config = config;
+		_ring.reset(new Util::SpscQueue<Record>(std::max<size_t>(config.capacity, 1)));
+		_exportBuffer.reserve(_ring->capacity());
+		_lastSwapTime = CX_Millis(-1);
+	}
+
+	resetStatistics();
+
+	if (_file.is_open()) {
+		_exportThreadRunning = true;
+		_exportThread = std::thread(&CX_FrameTelemetry::_exportThreadFunction, this);
+	}
+
+	_recording = true;
+
+	return true;
+}
+
+CX_FrameTelemetry::Configuration CX_FrameTelemetry::getConfiguration(void) {
+	std::lock_guard<std::recursive_mutex> lock(_consumerMutex);
+	return _config;
+}
+
+/*! Stop recording. If records are being written to a file, the remaining records are written and the file is closed.
+Records that have not been taken out of the ring can still be taken with popRecords() or exportToDataFrame(). */
+void CX_FrameTelemetry::stop(void) {
+	_recording = false;
+
+	_stopExportThread();
+
+	std::lock_guard<std::recursive_mutex> lock(_consumerMutex);
+	if (_file.is_open()) {
+		flush();
+		_file.close();
+	}
+}
+
+/*! \brief Returns `true` if swaps are being recorded. */
+bool CX_FrameTelemetry::isRecording(void) {
+	return _recording;
+}
+
+/*! Write all records in the ring to the binary file now, rather than waiting for the background thread.
+\return `false` if there is no open file or writing failed, `true` otherwise. */
+bool CX_FrameTelemetry::flush(void) {
+	std::lock_guard<std::recursive_mutex> lock(_consumerMutex);
+
+	if (!_file.is_open()) {
+		return false;
+	}
+
+	_exportBuffer.clear();
+	popRecords(_exportBuffer);
+	return _writeRecords(_exportBuffer);
+}
+
+/*! Take records out of the ring, oldest first, and append them to `records`.
+\param records The records are appended to this vector.
+\param maxRecords The maximum number of records to take.
+\return The number of records taken.
+\note If `Configuration::filename` is set, the background thread also takes records out of the ring, so records taken
+with this function will not be in the file. */
+size_t CX_FrameTelemetry::popRecords(std::vector<Record>& records, size_t maxRecords) {
+	std::lock_guard<std::recursive_mutex> lock(_consumerMutex);
+
+	if (_ring == nullptr) {
+		return 0;
+	}
+
+	size_t count = 0;
+	Record rec;
+	while (count < maxRecords && _ring->pop(rec)) {
+		records.push_back(rec);
+		count++;
+	}
+	return count;
+}
+
+/*! \brief Take all records out of the ring and return them in a CX_DataFrame with the format described in toDataFrame(). */
+CX_DataFrame CX_FrameTelemetry::exportToDataFrame(void) {
+	std::vector<Record> records;
+	popRecords(records);
+	return toDataFrame(records);
+}
+
+/*! \brief Get the number of records in the ring that have not yet been taken out. */
+size_t CX_FrameTelemetry::getPendingRecordCount(void) {
+	std::lock_guard<std::recursive_mutex> lock(_consumerMutex);
+	if (_ring == nullptr) {
+		return 0;
+	}
+	return _ring->size();
+}
+
+CX_FrameTelemetry::Statistics CX_FrameTelemetry::getStatistics(void) {
+	Statistics stats;
+	stats.records = _records;
+	stats.lostRecords = _lostRecords;
+	stats.missedFrames = _missedFrames;
+	stats.exportedRecords = _exportedRecords;
+	return stats;
+}
+
+void CX_FrameTelemetry::resetStatistics(void) {
+	_records = 0;
+	_lostRecords = 0;
+	_missedFrames = 0;
+	_exportedRecords = 0;
+}
+
+/*! Convert records to a CX_DataFrame with one row per record. The columns are named after the fields of Record,
+plus a "predictionError" column, which is `swapTime - predictedSwapTime` if the prediction was usable and -1 otherwise.
+Times are in milliseconds. */
+CX_DataFrame CX_FrameTelemetry::toDataFrame(const std::vector<Record>& records) {
+	CX_DataFrame df;
+
+	for (const Record& rec : records) {
+		CX_DataFrame::RowIndex row = df.getRowCount();
+
+		df(row, "unit") = rec.unit;
+		df(row, "swapTime") = rec.swapTime;
+		df(row, "requestTime") = rec.requestTime;
+		df(row, "predictionUsable") = rec.predictionUsable;
+		df(row, "predictedSwapTime") = rec.predictedSwapTime;
+		df(row, "predictionHalfWidth") = rec.predictionHalfWidth;
+		df(row, "predictionError") = rec.predictionUsable ? rec.swapTime - rec.predictedSwapTime : CX_Millis(-1);
+		df(row, "preRenderCompleteTime") = rec.preRenderCompleteTime;
+		df(row, "renderCompleteTime") = rec.renderCompleteTime;
+		df(row, "missedFrames") = rec.missedFrames;
+	}
+
+	return df;
+}
+
+/*! Read records from a binary file written by a CX_FrameTelemetry.
+\param filename The name of the file. Relative paths are relative to the data directory.
+\param records The records in the file are appended to this vector.
+\return `false` if the file could not be read or is not a telemetry file, `true` otherwise. If the file ends partway
+through a record (e.g. because the program crashed while writing), the complete records are read and `true` is returned. */
+bool CX_FrameTelemetry::readBinaryFile(std::string filename, std::vector<Record>& records) {
+	std::ifstream file(ofToDataPath(filename).c_str(), std::ios::in | std::ios::binary);
+	if (!file.is_open()) {
+		Instances::Log.error("CX_FrameTelemetry") << "readBinaryFile(): Could not open file \"" << filename << "\".";
+		return false;
+	}
+
+	char magic[4];
+	uint32_t version = 0;
+	uint32_t recordBytes = 0;
+	if (!file.read(magic, sizeof(magic)) || !std::equal(magic, magic + 4, Private::telemetryFileMagic) ||
+		!Util::readBinaryValue(file, version) || !Util::readBinaryValue(file, recordBytes))
+	{
+		Instances::Log.error("CX_FrameTelemetry") << "readBinaryFile(): \"" << filename << "\" is not a frame telemetry file.";
+		return false;
+	}
+
+	if (version != Private::telemetryFileVersion) {
+		Instances::Log.error("CX_FrameTelemetry") << "readBinaryFile(): \"" << filename << "\" has an unsupported version (" << version <<
+			"). The supported version is " << Private::telemetryFileVersion << ".";
+		return false;
+	}
+
+	if (recordBytes != Private::telemetryRecordBytes) {
+		Instances::Log.error("CX_FrameTelemetry") << "readBinaryFile(): \"" << filename << "\" has records of " << recordBytes <<
+			" bytes, but records of version " << version << " files are " << Private::telemetryRecordBytes << " bytes. The file may be corrupt.";
+		return false;
+	}
+
+	while (true) {
+		Record rec;
+		uint8_t usable = 0;
+
+		bool ok = Util::readBinaryValue(file, rec.unit) &&
+			Private::readTelemetryTime(file, rec.swapTime) &&
+			Private::readTelemetryTime(file, rec.requestTime) &&
+			Private::readTelemetryTime(file, rec.predictedSwapTime) &&
+			Private::readTelemetryTime(file, rec.predictionHalfWidth) &&
+			Private::readTelemetryTime(file, rec.preRenderCompleteTime) &&
+			Private::readTelemetryTime(file, rec.renderCompleteTime) &&
+			Util::readBinaryValue(file, rec.missedFrames) &&
+			Util::readBinaryValue(file, usable);
+
+		if (!ok) {
+			break;
+		}
+
+		rec.predictionUsable = (usable != 0);
+		records.push_back(rec);
+	}
+
+	return true;
+}
+
+void CX_FrameTelemetry::_recordSwap(Record record) {
+	if (!_recording) {
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(_producerMutex);
+
+	CX_Millis period = _display->getFramePeriod();
+	if (_lastSwapTime >= CX_Millis(0) && period > CX_Millis(0)) {
+		double refreshes = Util::round((record.swapTime - _lastSwapTime) / period, 0, Util::Rounding::ToNearest);
+		if (refreshes > 1) {
+			record.missedFrames = (unsigned int)refreshes - 1;
+		}
+	}
+	_lastSwapTime = record.swapTime;
+
+	_records++;
+	_missedFrames += record.missedFrames;
+
+	if (!_ring->push(record)) {
+		_lostRecords++;
+	}
+}
+
+bool CX_FrameTelemetry::_writeRecords(const std::vector<Record>& records) {
+	for (const Record& rec : records) {
+		Util::writeBinaryValue<uint64_t>(_file, rec.unit);
+		Util::writeBinaryValue<cxTick_t>(_file, rec.swapTime.nanos());
+		Util::writeBinaryValue<cxTick_t>(_file, rec.requestTime.nanos());
+		Util::writeBinaryValue<cxTick_t>(_file, rec.predictedSwapTime.nanos());
+		Util::writeBinaryValue<cxTick_t>(_file, rec.predictionHalfWidth.nanos());
+		Util::writeBinaryValue<cxTick_t>(_file, rec.preRenderCompleteTime.nanos());
+		Util::writeBinaryValue<cxTick_t>(_file, rec.renderCompleteTime.nanos());
+		Util::writeBinaryValue<uint32_t>(_file, rec.missedFrames);
+		Util::writeBinaryValue<uint8_t>(_file, rec.predictionUsable ? 1 : 0);
+	}
+	_file.flush();
+
+	if (!_file.good()) {
+		Instances::Log.error("CX_FrameTelemetry") << "Error writing to file \"" << _config.filename << "\".";
+		return false;
+	}
+
+	_exportedRecords += records.size();
+	return true;
+}
+
+void CX_FrameTelemetry::_exportThreadFunction(void) {
+	std::unique_lock<std::mutex> lock(_exportMutex);
+
+	while (_exportThreadRunning) {
+		CX_Millis interval = getConfiguration().exportInterval;
+		_exportCondition.wait_for(lock, std::chrono::nanoseconds(interval.nanos()));
+
+		if (!_exportThreadRunning) {
+			break;
+		}
+
+		lock.unlock();
+		flush();
+		lock.lock();
+	}
+}
+
+void CX_FrameTelemetry::_stopExportThread(void) {
+	{
+		std::lock_guard<std::mutex> lock(_exportMutex);
+		_exportThreadRunning = false;
+	}
+	_exportCondition.notify_all();
+
+	if (_exportThread.joinable()) {
+		_exportThread.join();
+	}
+}
+
+} // namespace CX
@@ -0,0 +1,185 @@
+#pragma once
+
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <condition_variable>
+#include <fstream>
+
+#include "CX_Time_t.h"
+#include "CX_Utilities.h"
+#include "CX_DataFrame.h"
+#include "CX_SynchronizationUtils.h"
+
+namespace CX {
+
+	class CX_Display;
+
+	/*! This class records timing information about every buffer swap made by the display thread, so that every frame
+	of every session can be audited, rather than just testing swapping before the experiment with CX_Display::testBufferSwapping().
+
+	Records are stored by the display thread into a preallocated lock-free ring, so recording does not allocate or block
+	the display thread. Records are taken out of the ring in one of two ways:
+	+ If `Configuration::filename` is set, a background thread appends the records to a binary file every `Configuration::exportInterval`.
+	The file can be read with readBinaryFile() and converted with toDataFrame().
+	+ Otherwise, call popRecords() or exportToDataFrame() often enough that the ring does not fill up.
+
+	If the ring is full when a swap happens, the record of that swap is lost and counted in `Statistics::lostRecords`.
+
+	The telemetry recorder belongs to the display thread. Get it with `Disp.getDisplayThread()->getTelemetry()`.
+
+	\code{.cpp}
+	CX_FrameTelemetry* telemetry = Disp.getDisplayThread()->getTelemetry();
+
+	CX_FrameTelemetry::Configuration config;
+	config.filename = "logfiles/frames_" + Clock.getDateTimeString() + ".cxft";
+	telemetry->setup(config);
+
+	// run the experiment...
+
+	telemetry->stop(); // writes remaining records
+
+	std::vector<CX_FrameTelemetry::Record> records;
+	CX_FrameTelemetry::readBinaryFile(config.filename, records);
+	CX_FrameTelemetry::toDataFrame(records).printToFile("frames.txt");
+	\endcode
+
+	\ingroup video
+	*/
+	class CX_FrameTelemetry {
+	public:
+
+		struct Configuration {
+
+			Configuration(void) :
+				capacity(4096),
+				filename(""),
+				exportInterval(1000)
+			{}
+
+			/*! \brief The number of records that the ring can hold before records are lost. Rounded up to a power of 2.
+			At 60 Hz, 4096 records are about 68 seconds of swaps. */
+			size_t capacity;
+
+			/*! \brief If not empty, records are appended to this binary file by a background thread. The file is created
+			(or truncated) by setup(). Relative paths are relative to the data directory. */
+			std::string filename;
+
+			CX_Millis exportInterval; //!< How often the background thread writes records to `filename`.
+		};
+
+		/*! Timing information about a single buffer swap. Times are on the CX::Instances::Clock time base and
+		times that are not available are -1. */
+		struct Record {
+
+			Record(void) :
+				unit(Sync::SwapUnitError),
+				swapTime(-1),
+				requestTime(-1),
+				predictionUsable(false),
+				predictedSwapTime(-1),
+				predictionHalfWidth(-1),
+				preRenderCompleteTime(-1),
+				renderCompleteTime(-1),
+				missedFrames(0)
+			{}
+
+			Sync::SwapUnit unit; //!< The swap unit (frame number) of the swap.
+			CX_Millis swapTime; //!< The time of the swap, as stored in `Disp.swapData`.
+
+			CX_Millis requestTime; //!< The time at which the display thread requested the swap.
+
+			bool predictionUsable; //!< Whether the swap time could be predicted by the model of `Disp.swapClient` before the swap. If `false`, the prediction fields are -1.
+			CX_Millis predictedSwapTime; //!< The time that the swap was predicted to happen at, from `Disp.swapClient`.
+			CX_Millis predictionHalfWidth; //!< The half width of the prediction interval of `predictedSwapTime`.
+
+			/*! \brief If a slide from the CX_SlideQueue was swapped in, the time at which rendering the slide ahead
+			into its framebuffer was confirmed complete by a fence sync. */
+			CX_Millis preRenderCompleteTime;
+
+			/*! \brief If a slide from the CX_SlideQueue was swapped in, the time at which copying the slide into the back buffer
+			was confirmed complete by a fence sync. -1 if the swap happened before rendering was confirmed complete. */
+			CX_Millis renderCompleteTime;
+
+			/*! \brief The number of refreshes that passed without a swap between the previous swap and this one, based on
+			the frame period from `Disp.getFramePeriod()`. */
+			unsigned int missedFrames;
+		};
+
+		/*! Running totals since the last call to setup() or resetStatistics(). */
+		struct Statistics {
+
+			Statistics(void) :
+				records(0),
+				lostRecords(0),
+				missedFrames(0),
+				exportedRecords(0)
+			{}
+
+			uint64_t records; //!< The number of swaps that were recorded, including lost records.
+			uint64_t lostRecords; //!< The number of records that were lost because the ring was full.
+			uint64_t missedFrames; //!< The sum of `Record::missedFrames`.
+			uint64_t exportedRecords; //!< The number of records that were written to the binary file.
+		};
+
+		~CX_FrameTelemetry(void);
+
+		bool setup(const Configuration& config);
+		Configuration getConfiguration(void);
+
+		void stop(void);
+		bool isRecording(void);
+
+		bool flush(void);
+
+		size_t popRecords(std::vector<Record>& records, size_t maxRecords = std::numeric_limits<size_t>::max());
+		CX_DataFrame exportToDataFrame(void);
+
+		size_t getPendingRecordCount(void);
+
+		Statistics getStatistics(void);
+		void resetStatistics(void);
+
+		static CX_DataFrame toDataFrame(const std::vector<Record>& records);
+		static bool readBinaryFile(std::string filename, std::vector<Record>& records);
+
+	private:
+
+		friend class CX_DisplayThread;
+
+		CX_FrameTelemetry(CX_Display* display);
+
+		CX_Display* _display;
+
+		std::mutex _producerMutex; // Held by the display thread while pushing, or by setup() while replacing the ring
+		std::recursive_mutex _consumerMutex;
+
+		Configuration _config;
+		std::unique_ptr<Util::SpscQueue<Record>> _ring;
+		std::atomic<bool> _recording;
+
+		// Only used by the producer
+		CX_Millis _lastSwapTime;
+
+		std::atomic<uint64_t> _records;
+		std::atomic<uint64_t> _lostRecords;
+		std::atomic<uint64_t> _missedFrames;
+		std::atomic<uint64_t> _exportedRecords;
+
+		std::ofstream _file;
+		std::vector<Record> _exportBuffer;
+
+		std::thread _exportThread;
+		std::mutex _exportMutex;
+		std::condition_variable _exportCondition;
+		bool _exportThreadRunning;
+
+		void _exportThreadFunction(void);
+		void _stopExportThread(void);
+		bool _writeRecords(const std::vector<Record>& records);
+
+		// Called by CX_DisplayThread on the display thread
+		void _recordSwap(Record record);
+	};
+
+} // namespace CX
@@ -0,0 +1,219 @@
+#include "CX_FramebufferPool.h"
+
+#include "ofGraphics.h"
+
+#include "CX_Logger.h"
+#include "CX_Private.h"
+
+namespace CX {
+
+bool CX_FramebufferPool::Format::operator<(const Format& rhs) const {
+	if (width != rhs.width) {
+		return width < rhs.width;
+	}
+	if (height != rhs.height) {
+		return height < rhs.height;
+	}
+	if (internalFormat != rhs.internalFormat) {
+		return internalFormat < rhs.internalFormat;
+	}
+	return numSamples < rhs.numSamples;
+}
+
+bool CX_FramebufferPool::Format::operator==(const Format& rhs) const {
+	return width == rhs.width && height == rhs.height && internalFormat == rhs.internalFormat && numSamples == rhs.numSamples;
+}
+
+namespace {
+	// Framebuffers that were returned after their pool was destroyed, on a thread without the rendering context.
+	// They are deleted by the next pool function that runs on the rendering thread. The list is never destroyed
+	// so that nothing is deleted after the rendering context is gone at exit.
+	struct OrphanedFramebuffers {
+		std::mutex mutex;
+		std::vector<std::unique_ptr<ofFbo>> fbos;
+	};
+
+	OrphanedFramebuffers& orphanedFramebuffers(void) {
+		static OrphanedFramebuffers* orphans = new OrphanedFramebuffers;
+		return *orphans;
+	}
+}
+
+CX_FramebufferPool::CX_FramebufferPool(void) :
+	_state(std::make_shared<State>())
+{}
+
+CX_FramebufferPool::~CX_FramebufferPool(void) {
+	// Framebuffers that are still in use are deleted by their deleters when they are returned.
+	releaseAvailable();
+}
+
+/*! Get a framebuffer with the given format. If there is an available framebuffer of that format in the pool,
+it is reused. Otherwise, a new framebuffer is allocated.
+
+A reused framebuffer is cleared to transparent white so that whatever it was last used for
+does not show through.
+
+\param format The format of the framebuffer.
+\return A shared pointer to the framebuffer. When the last copy of the pointer is destroyed, the framebuffer
+is returned to the pool. If `format` has a width or height of 0, a `nullptr` is returned.
+*/
+std::shared_ptr<ofFbo> CX_FramebufferPool::acquire(const Format& format) {
+
+	if (format.width <= 0 || format.height <= 0) {
+		Instances::Log.error("CX_FramebufferPool") << "acquire(): Framebuffers must have positive width and height.";
+		return nullptr;
+	}
+
+	_releaseOrphaned();
+
+	ofFbo* fbo = nullptr;
+	bool reused = false;
+
+	{
+		std::lock_guard<std::mutex> lock(_state->mutex);
+
+		auto it = _state->available.find(format);
+		if (it != _state->available.end() && !it->second.empty()) {
+			fbo = it->second.back().release();
+			it->second.pop_back();
+			reused = true;
+		}
+
+		_state->inUse++;
+	}
+
+	if (reused) {
+		fbo->begin();
+		ofClear(255, 255, 255, 0);
+		fbo->end();
+	} else {
+		Instances::Log.verbose("CX_FramebufferPool") << "acquire(): No available framebuffer of size " << format.width << "x" <<
+			format.height << ". Allocating a new one.";
+		fbo = _allocate(format);
+	}
+
+	std::weak_ptr<State> state = _state;
+	return std::shared_ptr<ofFbo>(fbo, [state, format](ofFbo* f) {
+		CX_FramebufferPool::_returnFramebuffer(state, format, f);
+	});
+}
+
+/*! Make sure that at least `count` framebuffers with the given format are available in the pool,
+allocating new framebuffers as needed. Call this during setup so that no framebuffers need to be
+allocated while running trials.
+
+Framebuffers that are currently in use do not count toward `count`. For example, if you will draw 30
+slides per trial and the slides from the previous trial are cleared before drawing the next trial, reserving 30
+framebuffers is sufficient.
+
+\param count The number of framebuffers that should be available.
+\param format The format of the framebuffers.
+*/
+void CX_FramebufferPool::reserve(size_t count, const Format& format) {
+
+	if (format.width <= 0 || format.height <= 0) {
+		Instances::Log.error("CX_FramebufferPool") << "reserve(): Framebuffers must have positive width and height.";
+		return;
+	}
+
+	_releaseOrphaned();
+
+	size_t available = getAvailableCount(format);
+	if (available >= count) {
+		return;
+	}
+
+	// Allocate without holding the lock, because allocation is slow.
+	std::vector<std::unique_ptr<ofFbo>> newFbos;
+	for (size_t i = available; i < count; i++) {
+		newFbos.emplace_back(_allocate(format));
+	}
+
+	std::lock_guard<std::mutex> lock(_state->mutex);
+	std::vector<std::unique_ptr<ofFbo>>& pool = _state->available[format];
+	for (std::unique_ptr<ofFbo>& fbo : newFbos) {
+		pool.push_back(std::move(fbo));
+	}
+}
+
+/*! \brief Get the number of framebuffers with the given format that are available to be acquired without allocation. */
+size_t CX_FramebufferPool::getAvailableCount(const Format& format) {
+	std::lock_guard<std::mutex> lock(_state->mutex);
+
+	auto it = _state->available.find(format);
+	if (it == _state->available.end()) {
+		return 0;
+	}
+	return it->second.size();
+}
+
+/*! \brief Get the total number of framebuffers, of any format, that are available to be acquired without allocation. */
+size_t CX_FramebufferPool::getAvailableCount(void) {
+	std::lock_guard<std::mutex> lock(_state->mutex);
+
+	size_t total = 0;
+	for (const auto& fmt : _state->available) {
+		total += fmt.second.size();
+	}
+	return total;
+}
+
+/*! \brief Get the number of framebuffers that have been acquired and not yet returned to the pool. */
+size_t CX_FramebufferPool::getInUseCount(void) {
+	std::lock_guard<std::mutex> lock(_state->mutex);
+	return _state->inUse;
+}
+
+/*! Deallocate all of the framebuffers that are available in the pool. Framebuffers that are in use are not affected
+and will be returned to the pool as usual. This must be called from the thread that has the rendering context.
+
+This also deallocates framebuffers from destroyed pools that were returned on threads without the rendering context. */
+void CX_FramebufferPool::releaseAvailable(void) {
+	_releaseOrphaned();
+
+	std::map<Format, std::vector<std::unique_ptr<ofFbo>>> toRelease;
+	{
+		std::lock_guard<std::mutex> lock(_state->mutex);
+		std::swap(toRelease, _state->available);
+	}
+	// The framebuffers are deleted as toRelease goes out of scope
+}
+
+void CX_FramebufferPool::_returnFramebuffer(std::weak_ptr<State> weakState, Format format, ofFbo* fbo) {
+	std::shared_ptr<State> state = weakState.lock();
+	if (!state) {
+		// The pool is gone. Deleting a framebuffer makes OpenGL calls, so only do it on the rendering thread.
+		if (Private::glfwContextManager.isLockedByThisThread()) {
+			delete fbo;
+		} else {
+			OrphanedFramebuffers& orphans = orphanedFramebuffers();
+			std::lock_guard<std::mutex> lock(orphans.mutex);
+			orphans.fbos.emplace_back(fbo);
+		}
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(state->mutex);
+	state->available[format].emplace_back(fbo);
+	state->inUse--;
+}
+
+// Must be called from the thread that has the rendering context.
+void CX_FramebufferPool::_releaseOrphaned(void) {
+	std::vector<std::unique_ptr<ofFbo>> toRelease;
+	{
+		OrphanedFramebuffers& orphans = orphanedFramebuffers();
+		std::lock_guard<std::mutex> lock(orphans.mutex);
+		std::swap(toRelease, orphans.fbos);
+	}
+	// The framebuffers are deleted as toRelease goes out of scope
+}
+
+ofFbo* CX_FramebufferPool::_allocate(const Format& format) {
+	ofFbo* fbo = new ofFbo();
+	fbo->allocate(format.width, format.height, format.internalFormat, format.numSamples);
+	return fbo;
+}
+
+} // namespace CX
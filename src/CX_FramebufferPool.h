@@ -0,0 +1,112 @@
+#pragma once
+
+#include <map>
+#include <vector>
+#include <memory>
+#include <mutex>
+
+#include "ofFbo.h"
+
+namespace CX {
+
+	/*! This class keeps a pool of framebuffers (`ofFbo`s) that can be reused instead of allocated
+	and deallocated every time they are needed. Allocating a framebuffer is slow (often several
+	milliseconds) and repeatedly allocating and deallocating them can fragment video memory during
+	long sessions, so it is better to allocate all of the framebuffers that will be needed during
+	setup and then reuse them across trials.
+
+	Framebuffers are acquired with acquire(). The returned `std::shared_ptr` automatically returns the
+	framebuffer to the pool once the last copy of the pointer is destroyed or reset, so there is no
+	explicit release function. Framebuffers are pooled separately for each Format (resolution,
+	internal format, and MSAA sample count).
+
+	\code{.cpp}
+	CX_FramebufferPool pool;
+	CX_FramebufferPool::Format fmt(Disp.getResolution().x, Disp.getResolution().y, GL_RGB, Util::getMsaaSampleCount());
+
+	pool.reserve(30, fmt); // During setup
+
+	// During a trial
+	std::shared_ptr<ofFbo> fbo = pool.acquire(fmt); // No allocation needed
+	fbo->begin();
+	ofBackground(0);
+	ofDrawCircle(100, 100, 50);
+	fbo->end();
+
+	fbo = nullptr; // fbo goes back into the pool
+	\endcode
+
+	Both CX_SlideBuffer and CX_SlidePresenter use a CX_FramebufferPool for their slides. You can share a
+	pool between several slide buffers by setting the `framebufferPool` member of their configurations.
+
+	\note acquire() and reserve() make OpenGL calls, so they must be called from the thread that has the rendering context.
+	Framebuffers can be returned to the pool from any thread, because returning a framebuffer does not make OpenGL calls.
+	If a framebuffer is returned after its pool was destroyed, it is deleted right away on the thread that has the rendering
+	context. On other threads it is kept until the next call to acquire(), reserve(), or releaseAvailable() of any pool.
+	This class is otherwise thread-safe.
+
+	\ingroup video
+	*/
+	class CX_FramebufferPool {
+	public:
+
+		/*! The format of a framebuffer. Framebuffers are only reused for requests with exactly the same format. */
+		struct Format {
+
+			Format(void) :
+				width(0),
+				height(0),
+				internalFormat(GL_RGBA),
+				numSamples(0)
+			{}
+
+			Format(int width_, int height_, int internalFormat_ = GL_RGBA, int numSamples_ = 0) :
+				width(width_),
+				height(height_),
+				internalFormat(internalFormat_),
+				numSamples(numSamples_)
+			{}
+
+			int width; //!< Width in pixels.
+			int height; //!< Height in pixels.
+			int internalFormat; //!< The internal format, e.g. `GL_RGB` or `GL_RGBA`.
+			int numSamples; //!< The number of MSAA samples. See CX::Util::getMsaaSampleCount().
+
+			bool operator<(const Format& rhs) const;
+			bool operator==(const Format& rhs) const;
+		};
+
+		CX_FramebufferPool(void);
+		~CX_FramebufferPool(void);
+
+		std::shared_ptr<ofFbo> acquire(const Format& format);
+		void reserve(size_t count, const Format& format);
+
+		size_t getAvailableCount(const Format& format);
+		size_t getAvailableCount(void);
+		size_t getInUseCount(void);
+
+		void releaseAvailable(void);
+
+	private:
+
+		// The state is shared weakly with the deleters of acquired framebuffers so that framebuffers
+		// that are returned after the pool is destroyed can be released separately.
+		struct State {
+			State(void) :
+				inUse(0)
+			{}
+
+			std::mutex mutex;
+			std::map<Format, std::vector<std::unique_ptr<ofFbo>>> available;
+			size_t inUse;
+		};
+
+		std::shared_ptr<State> _state;
+
+		static void _returnFramebuffer(std::weak_ptr<State> state, Format format, ofFbo* fbo);
+		static void _releaseOrphaned(void);
+		static ofFbo* _allocate(const Format& format);
+	};
+
+}
@@ -1,5 +1,10 @@
 #include "CX_Gabor.h"
 
+#include <tuple>
+
+#include "CX_ThreadUtils.h"
+#include "CX_Private.h"
+
 
 #define STRINGIFY(x) #x
 
@@ -70,6 +75,246 @@ void main() {
 namespace CX {
 namespace Draw {
 
+// \cond INTERNAL_DOCS
+namespace {
+
+	// Built-in wave and envelope functions are recognized so that they can be evaluated for a whole row of
+	// pixels in a tight loop that the compiler can vectorize, rather than through a std::function per pixel.
+	enum class WaveKind {
+		Custom,
+		Sine,
+		Square,
+		Triangle,
+		Saw
+	};
+
+	enum class EnvelopeKind {
+		Custom,
+		None,
+		Circle,
+		Linear,
+		Cosine,
+		Gaussian
+	};
+
+	WaveKind identifyWave(const std::function<float(float)>& fun) {
+		typedef float(*WaveFunction)(float);
+		const WaveFunction* fp = fun.target<WaveFunction>();
+		if (fp == nullptr) {
+			return WaveKind::Custom;
+		}
+
+		if (*fp == &WaveformProperties::sine) {
+			return WaveKind::Sine;
+		} else if (*fp == &WaveformProperties::square) {
+			return WaveKind::Square;
+		} else if (*fp == &WaveformProperties::triangle) {
+			return WaveKind::Triangle;
+		} else if (*fp == &WaveformProperties::saw) {
+			return WaveKind::Saw;
+		}
+		return WaveKind::Custom;
+	}
+
+	EnvelopeKind identifyEnvelope(const std::function<float(float, float)>& fun) {
+		typedef float(*EnvelopeFunction)(float, float);
+		const EnvelopeFunction* fp = fun.target<EnvelopeFunction>();
+		if (fp == nullptr) {
+			return EnvelopeKind::Custom;
+		}
+
+		if (*fp == &EnvelopeProperties::none) {
+			return EnvelopeKind::None;
+		} else if (*fp == &EnvelopeProperties::circle) {
+			return EnvelopeKind::Circle;
+		} else if (*fp == &EnvelopeProperties::linear) {
+			return EnvelopeKind::Linear;
+		} else if (*fp == &EnvelopeProperties::cosine) {
+			return EnvelopeKind::Cosine;
+		} else if (*fp == &EnvelopeProperties::gaussian) {
+			return EnvelopeKind::Gaussian;
+		}
+		return EnvelopeKind::Custom;
+	}
+
+	// Rows smaller than this many pixels in total are not worth splitting across threads.
+	const size_t minPixelsPerTask = 16384;
+
+	size_t minRowsPerTask(unsigned int width) {
+		return std::max<size_t>(1, minPixelsPerTask / std::max<unsigned int>(width, 1));
+	}
+
+	// The waveform position of pixel (x, y) is a linear function of x within a row,
+	// so it is evaluated as `rowStart + x * xStep` and only the fractional part is kept.
+	class WaveRowGenerator {
+	public:
+
+		WaveRowGenerator(const WaveformProperties& properties, unsigned int width, unsigned int height) :
+			_fun(properties.waveFunction),
+			_kind(identifyWave(properties.waveFunction))
+		{
+			float theta = properties.angle * PI / 180;
+			float slope = tan(theta);
+
+			float waveformPosition = properties.wavelength * fmod(properties.phase, 360.0) / 360.0;
+
+			//Get point on line tangent to "radius" of rectangle and the interecept of the line passing through that point
+			float tanRadius = sqrt(width * width + height * height);
+			//Make the tanRadius be the next greatest multiple of the period
+			tanRadius = (ceil(tanRadius / properties.wavelength) * properties.wavelength) + waveformPosition;
+			ofPoint tangentPoint(tanRadius * sin(PI - theta), tanRadius * cos(PI - theta));
+			float intercept = tangentPoint.y - (slope * tangentPoint.x);
+
+			_centerX = properties.width / 2;
+			_centerY = properties.height / 2;
+
+			float inverseWavelength = 1 / properties.wavelength;
+
+			_A = -slope;
+			_C = -intercept;
+			_scale = inverseWavelength / sqrt(_A * _A + 1 * 1); //B == 1
+		}
+
+		void fillRow(unsigned int y, float* row, unsigned int width) const {
+			float py = y - _centerY;
+			float rowStart = (_A * -_centerX + py + _C) * _scale;
+			float xStep = _A * _scale;
+
+			for (unsigned int x = 0; x < width; x++) {
+				float d = rowStart + x * xStep;
+				row[x] = d - std::trunc(d); // Same as fmod(d, 1)
+			}
+
+			switch (_kind) {
+			case WaveKind::Sine:
+				for (unsigned int x = 0; x < width; x++) {
+					row[x] = (std::sin(row[x] * (float)TWO_PI) + 1) / 2;
+				}
+				break;
+			case WaveKind::Square:
+				for (unsigned int x = 0; x < width; x++) {
+					row[x] = (row[x] < 0.5f) ? 1.0f : 0.0f;
+				}
+				break;
+			case WaveKind::Triangle:
+				for (unsigned int x = 0; x < width; x++) {
+					row[x] = (row[x] < 0.5f) ? (2 * row[x]) : (2 - 2 * row[x]);
+				}
+				break;
+			case WaveKind::Saw:
+				break;
+			case WaveKind::Custom:
+				for (unsigned int x = 0; x < width; x++) {
+					row[x] = _fun(row[x]);
+				}
+				break;
+			}
+
+			for (unsigned int x = 0; x < width; x++) {
+				row[x] = std::min(std::max(row[x], 0.0f), 1.0f);
+			}
+		}
+
+	private:
+		const std::function<float(float)>& _fun;
+		WaveKind _kind;
+
+		float _centerX;
+		float _centerY;
+		float _A;
+		float _C;
+		float _scale;
+	};
+
+	class EnvelopeRowGenerator {
+	public:
+
+		EnvelopeRowGenerator(const EnvelopeProperties& properties) :
+			_fun(properties.envelopeFunction),
+			_kind(identifyEnvelope(properties.envelopeFunction)),
+			_cp(properties.controlParameter),
+			_centerX(properties.width / 2),
+			_centerY(properties.height / 2)
+		{}
+
+		void fillRow(unsigned int y, float* row, unsigned int width) const {
+			float dy = y - _centerY;
+			float dy2 = dy * dy;
+
+			switch (_kind) {
+			case EnvelopeKind::None:
+				std::fill(row, row + width, 1.0f);
+				return; // No clamping needed
+			case EnvelopeKind::Gaussian:
+				{
+					// The squared distance is all that is needed
+					float k = -1 / (2 * _cp * _cp);
+					for (unsigned int x = 0; x < width; x++) {
+						float dx = x - _centerX;
+						row[x] = std::exp((dx * dx + dy2) * k);
+					}
+				}
+				break;
+			default:
+				for (unsigned int x = 0; x < width; x++) {
+					float dx = x - _centerX;
+					row[x] = std::sqrt(dx * dx + dy2);
+				}
+				break;
+			}
+
+			switch (_kind) {
+			case EnvelopeKind::Circle:
+				for (unsigned int x = 0; x < width; x++) {
+					row[x] = (row[x] <= _cp) ? 1.0f : 0.0f;
+				}
+				break;
+			case EnvelopeKind::Linear:
+				for (unsigned int x = 0; x < width; x++) {
+					row[x] = (row[x] <= _cp) ? (1 - row[x] / _cp) : 0.0f;
+				}
+				break;
+			case EnvelopeKind::Cosine:
+				for (unsigned int x = 0; x < width; x++) {
+					row[x] = (row[x] < _cp) ? (std::cos((float)PI * row[x] / _cp) + 1) / 2 : 0.0f;
+				}
+				break;
+			case EnvelopeKind::Custom:
+				for (unsigned int x = 0; x < width; x++) {
+					row[x] = _fun(row[x], _cp);
+				}
+				break;
+			default:
+				break;
+			}
+
+			for (unsigned int x = 0; x < width; x++) {
+				row[x] = std::min(std::max(row[x], 0.0f), 1.0f);
+			}
+		}
+
+	private:
+		const std::function<float(float, float)>& _fun;
+		EnvelopeKind _kind;
+		float _cp;
+		float _centerX;
+		float _centerY;
+	};
+
+	// Writes RGBA pixels: the color is lerped from color1 to color2 by the wave and the alpha is the envelope.
+	void combineGaborRow(float* rgba, const float* wave, const float* envelope, unsigned int width, const ofFloatColor& c1, const ofFloatColor& c2) {
+		for (unsigned int x = 0; x < width; x++) {
+			float w = wave[x];
+			rgba[4 * x + 0] = c1.r + (c2.r - c1.r) * w;
+			rgba[4 * x + 1] = c1.g + (c2.g - c1.g) * w;
+			rgba[4 * x + 2] = c1.b + (c2.b - c1.b) * w;
+			rgba[4 * x + 3] = envelope[x];
+		}
+	}
+
+}
+// \endcond
+
 //Function bodies for various wave and envelope functions.
 //wp is the waveform position, from 0 to 1.
 std::string Gabor::Wave::saw = "return wp;";
@@ -84,6 +329,9 @@ std::string Gabor::Envelope::linear = "if (d > cp) return 0; \n return 1 - (d /
 std::string Gabor::Envelope::cosine = "if (d >= cp) return 0;\n return (cos(d / cp * PI) + 1) / 2;";
 std::string Gabor::Envelope::gaussian = "return exp(-(d * d) / (2 * (cp * cp)));";
 
+std::mutex Gabor::_shaderCacheMutex;
+std::map<std::pair<std::string, std::string>, std::weak_ptr<ofShader>> Gabor::_shaderCache;
+
 Gabor::Gabor(void)
 {
 	_initVars();
@@ -98,7 +346,8 @@ Gabor::Gabor(std::string waveFunction, std::string envelopeFunction) {
 /*! Set up the gabor to use certain wave and envelope functions. This is a
 special setup step because changing the functions changes the source code
 of the fragment shader used to draw the gabor, so it has to be recompiled.
-This is a potentially blocking function.
+This is a potentially blocking function, unless another Gabor has already been set up with the same
+functions, in which case the compiled shader is shared.
 
 \param waveFunction A function to use to calculate the mixing between color1
 and color2. Most users should use a value from Gabor::Wave. Advanced users
@@ -110,6 +359,28 @@ use a value from Gabor::Envelope. Advanced users can write their own function
 using GLSL.
 */
 void Gabor::setup(std::string waveFunction, std::string envelopeFunction) {
+	std::lock_guard<std::mutex> lock(_shaderCacheMutex);
+
+	std::pair<std::string, std::string> key(waveFunction, envelopeFunction);
+
+	// Remove shaders that are no longer used by any Gabor, so that the cache does not grow without bound
+	for (auto expired = _shaderCache.begin(); expired != _shaderCache.end(); ) {
+		if (expired->second.expired()) {
+			expired = _shaderCache.erase(expired);
+		} else {
+			++expired;
+		}
+	}
+
+	auto it = _shaderCache.find(key);
+	if (it != _shaderCache.end()) {
+		std::shared_ptr<ofShader> cached = it->second.lock();
+		if (cached) {
+			_shader = cached;
+			return;
+		}
+	}
+
 	std::string fullWaveFunction = "float waveformFunction(in float wp) {\n" +
 		waveFunction +
 		"\n}\n";
@@ -120,13 +391,25 @@ void Gabor::setup(std::string waveFunction, std::string envelopeFunction) {
 
 	std::string source = gaborPrelude + fullWaveFunction + fullEnvelopeFunction + gaborMain;
 
-	_shader.setupShaderFromSource(GL_VERTEX_SHADER, plainVert);
-	_shader.setupShaderFromSource(GL_FRAGMENT_SHADER, source);
+	std::shared_ptr<ofShader> shader = std::make_shared<ofShader>();
+
+	shader->setupShaderFromSource(GL_VERTEX_SHADER, plainVert);
+	shader->setupShaderFromSource(GL_FRAGMENT_SHADER, source);
 
 	if (ofIsGLProgrammableRenderer()){
-		_shader.bindDefaults();
+		shader->bindDefaults();
 	}
-	_shader.linkProgram();
+	shader->linkProgram();
+
+	_shader = shader;
+	_shaderCache[key] = shader;
+}
+
+/*! Remove all shaders from the cache of compiled gabor shaders. Shaders that are in use by Gabor instances
+are not deleted until those instances are set up with different functions or destroyed. */
+void Gabor::clearShaderCache(void) {
+	std::lock_guard<std::mutex> lock(_shaderCacheMutex);
+	_shaderCache.clear();
 }
 
 /*! Draw the gabor given the current settings */
@@ -158,9 +441,10 @@ void Gabor::draw(ofPoint newCenter, float newFboHeight) {
 }
 
 /*! \brief Get a reference to the ofShader used by this class. Use this only if
-you want to do advanced things directly with the shader. */
+you want to do advanced things directly with the shader. The shader may be shared with other Gabor
+instances that use the same wave and envelope functions. */
 ofShader& Gabor::getShader(void) {
-	return _shader;
+	return *_shader;
 }
 
 void Gabor::_setUniforms(void) {
@@ -222,33 +506,35 @@ void Gabor::_setUniforms(void) {
 	waveValues.inverseWavelength = 1 / wave.wavelength;
 
 
-	_shader.setUniform1f("relativeYMultiple", relativeYMultiple);
+	_shader->setUniform1f("relativeYMultiple", relativeYMultiple);
 
-	_shader.setUniform2f("gaborCenter", modCenter.x, modCenter.y);
+	_shader->setUniform2f("gaborCenter", modCenter.x, modCenter.y);
 
-	_shader.setUniform1f("lineA", waveValues.A);
-	_shader.setUniform1f("lineC", waveValues.C);
-	_shader.setUniform1f("lineMult", waveValues.multiplier);
-	_shader.setUniform1f("inverseWavelength", waveValues.inverseWavelength);
+	_shader->setUniform1f("lineA", waveValues.A);
+	_shader->setUniform1f("lineC", waveValues.C);
+	_shader->setUniform1f("lineMult", waveValues.multiplier);
+	_shader->setUniform1f("inverseWavelength", waveValues.inverseWavelength);
 
-	_shader.setUniform1f("envelopeCP", envelope.controlParameter);
+	_shader->setUniform1f("envelopeCP", envelope.controlParameter);
 
-	_shader.setUniform4f("color1", color1.r, color1.g, color1.b, color1.a);
-	_shader.setUniform4f("color2", color2.r, color2.g, color2.b, color2.a);
+	_shader->setUniform4f("color1", color1.r, color1.g, color1.b, color1.a);
+	_shader->setUniform4f("color2", color2.r, color2.g, color2.b, color2.a);
 }
 
 void Gabor::_draw(ofPoint center, float renderSurfaceHeightPx) {
-	_shader.begin();
+	_shader->begin();
 
 	_setUniforms();
 	ofCircle(center, radius);
 
 	//ofRect(x, y, width, height); //Draw a rect containing the gabor
 
-	_shader.end();
+	_shader->end();
 }
 
 void Gabor::_initVars(void) {
+	_shader = std::make_shared<ofShader>();
+
 	color1 = ofColor(255);
 	color2 = ofColor(0);
 	radius = 400;
@@ -279,46 +565,14 @@ ofFloatPixels waveformToPixels(const WaveformProperties& properties) {
 	unsigned int height = ceil(properties.height);
 	pix.allocate(width, height, ofImageType::OF_IMAGE_GRAYSCALE);
 
+	WaveRowGenerator gen(properties, width, height);
+	float* data = pix.getPixels();
 
-	float theta = properties.angle * PI / 180;
-	float slope = tan(theta);
-
-	float waveformPosition = properties.wavelength * fmod(properties.phase, 360.0) / 360.0;
-
-	//Get point on line tangent to "radius" of rectangle and the interecept of the line passing through that point
-	float tanRadius = sqrt(width * width + height * height);
-	//Make the tanRadius be the next greatest multiple of the period
-	tanRadius = (ceil(tanRadius / properties.wavelength) * properties.wavelength) + waveformPosition;
-	ofPoint tangentPoint(tanRadius * sin(PI - theta), tanRadius * cos(PI - theta));
-	float intercept = tangentPoint.y - (slope * tangentPoint.x);
-
-	ofPoint center = ofPoint(properties.width / 2, properties.height / 2);
-
-	float inverseWavelength = 1 / properties.wavelength;
-
-	float A = -slope;
-	//float B = 1;
-	float C = -intercept;
-	float mult = 1 / sqrt(A * A + 1 * 1);
-
-	for (int yi = 0; yi < pix.getHeight(); yi++) {
-		for (int xi = 0; xi < pix.getWidth(); xi++) {
-
-			//Center so that x and y are relative to the origin.
-			float px = xi - center.x;
-			float py = yi - center.y;
-
-			float distFromLine = (A*px + py + C) * mult; //B == 1
-
-			float wavePos = fmod(distFromLine * inverseWavelength, 1);
-			float intensity = properties.waveFunction(wavePos);
-
-			intensity = CX::Util::clamp<float>(intensity, 0, 1);
-
-			int index = xi + yi * pix.getWidth();
-			pix[index] = intensity;
+	Util::sharedThreadPool().parallelFor(0, height, [&](size_t begin, size_t end) {
+		for (size_t y = begin; y < end; y++) {
+			gen.fillRow(y, data + y * width, width);
 		}
-	}
+	}, minRowsPerTask(width));
 
 	return pix;
 }
@@ -374,23 +628,18 @@ float level = result.getColor(1,2).getBrightness(); //where 1 and 2 are some x a
 ofFloatPixels envelopeToPixels(const EnvelopeProperties& properties) {
 	ofFloatPixels pix;
 
-	pix.allocate(ceil(properties.width), ceil(properties.height), ofImageType::OF_IMAGE_GRAYSCALE);
-
-	ofPoint center = ofPoint(properties.width / 2, properties.height / 2);
-
-	for (int y = 0; y < pix.getHeight(); y++) {
-		for (int x = 0; x < pix.getWidth(); x++) {
-
-			float d = center.distance(ofPoint(x, y));
-
-			float amount = properties.envelopeFunction(d, properties.controlParameter);
+	unsigned int width = ceil(properties.width);
+	unsigned int height = ceil(properties.height);
+	pix.allocate(width, height, ofImageType::OF_IMAGE_GRAYSCALE);
 
-			amount = CX::Util::clamp<float>(amount, 0, 1);
+	EnvelopeRowGenerator gen(properties);
+	float* data = pix.getPixels();
 
-			int index = x + y * pix.getWidth();
-			pix[index] = amount;
+	Util::sharedThreadPool().parallelFor(0, height, [&](size_t begin, size_t end) {
+		for (size_t y = begin; y < end; y++) {
+			gen.fillRow(y, data + y * width, width);
 		}
-	}
+	}, minRowsPerTask(width));
 
 	return pix;
 }
@@ -445,7 +694,8 @@ float EnvelopeProperties::gaussian(float d, float cp) {
 }
 
 /*! Just like Draw::gabor(ofPoint, const GaborProperties&), except that instead of drawing the
-pattern, it returns it in an ofFloatPixels object.
+pattern, it returns it in an ofFloatPixels object. The wave, envelope, and colors are computed in a single pass
+over the pixels, with the rows split across the threads of Util::sharedThreadPool().
 \param properties The settings to be used to generate the pattern.
 \return An ofFloatPixels containing the gabor pattern. It cannot be drawn directly, but can
 be put into an ofTexture and drawn from there, for example.
@@ -455,14 +705,36 @@ ofFloatPixels gaborToPixels(const GaborProperties& properties) {
 	WaveformProperties waveProp = properties.wave;
 	waveProp.width = properties.width;
 	waveProp.height = properties.height;
-	ofFloatPixels wave = Draw::waveformToPixels(waveProp);
 
 	EnvelopeProperties envProp = properties.envelope;
 	envProp.width = properties.width;
 	envProp.height = properties.height;
-	ofFloatPixels envelope = Draw::envelopeToPixels(envProp);
 
-	return gaborToPixels(properties.color1, properties.color2, wave, envelope);
+	unsigned int width = ceil(properties.width);
+	unsigned int height = ceil(properties.height);
+
+	ofFloatPixels pix;
+	pix.allocate(width, height, ofImageType::OF_IMAGE_COLOR_ALPHA);
+
+	WaveRowGenerator waveGen(waveProp, width, height);
+	EnvelopeRowGenerator envGen(envProp);
+
+	ofFloatColor c1 = properties.color1;
+	ofFloatColor c2 = properties.color2;
+	float* data = pix.getPixels();
+
+	// The wave, envelope, and colors are computed in one pass over each row, so no intermediate images are needed.
+	Util::sharedThreadPool().parallelFor(0, height, [&](size_t begin, size_t end) {
+		std::vector<float> waveRow(width);
+		std::vector<float> envRow(width);
+		for (size_t y = begin; y < end; y++) {
+			waveGen.fillRow(y, waveRow.data(), width);
+			envGen.fillRow(y, envRow.data(), width);
+			combineGaborRow(data + 4 * y * width, waveRow.data(), envRow.data(), width, c1, c2);
+		}
+	}, minRowsPerTask(width));
+
+	return pix;
 }
 
 /*! This version of gaborToPixels uses precalculated waves and envelopes. This can save time. However, if
@@ -490,26 +762,24 @@ ofFloatPixels gaborToPixels(ofColor color1, ofColor color2, const ofFloatPixels&
 			" The minimum of both will be used.";
 	}
 
-	int width = ceil(min(wave.getWidth(), envelope.getWidth()));
-	int height = ceil(min(wave.getHeight(), envelope.getHeight()));
+	unsigned int width = min(wave.getWidth(), envelope.getWidth());
+	unsigned int height = min(wave.getHeight(), envelope.getHeight());
 
-	
 	pix.allocate(width, height, ofImageType::OF_IMAGE_COLOR_ALPHA);
 
-	for (int x = 0; x < pix.getHeight(); x++) {
-		for (int y = 0; y < pix.getWidth(); y++) {
-
-			int index = x + y * pix.getWidth();
-
-			float waveProportion = wave[index];
-			ofFloatColor lerped = color1.getLerped(color2, waveProportion);
-
-			float envelopeProportion = envelope[index];
-			lerped.a = envelopeProportion;
-
-			pix.setColor(x, y, lerped);
+	ofFloatColor c1 = color1;
+	ofFloatColor c2 = color2;
+	float* data = pix.getPixels();
+	const float* waveData = wave.getPixels();
+	const float* envData = envelope.getPixels();
+	unsigned int waveWidth = wave.getWidth();
+	unsigned int envWidth = envelope.getWidth();
+
+	Util::sharedThreadPool().parallelFor(0, height, [&](size_t begin, size_t end) {
+		for (size_t y = begin; y < end; y++) {
+			combineGaborRow(data + 4 * y * width, waveData + y * waveWidth, envData + y * envWidth, width, c1, c2);
 		}
-	}
+	}, minRowsPerTask(width));
 
 	return pix;
 }
@@ -568,5 +838,313 @@ void gabor(ofPoint center, ofColor color1, ofColor color2, const ofFloatPixels&
 
 
 
+
+bool GaborCache::Key::operator<(const Key& rhs) const {
+	return std::tie(width, height, color1, color2, angle, wavelength, phase, waveFunction, controlParameter, envelopeFunction) <
+		std::tie(rhs.width, rhs.height, rhs.color1, rhs.color2, rhs.angle, rhs.wavelength, rhs.phase, rhs.waveFunction, rhs.controlParameter, rhs.envelopeFunction);
+}
+
+GaborCache::GaborCache(void) :
+	_bytes(0)
+{}
+
+GaborCache::~GaborCache(void) {
+	clear();
+	_releaseRetired();
+}
+
+/*! Configure the cache. If the new memory limit is lower than the current memory usage, textures are evicted.
+If this is not called from the thread that owns the rendering context, the evicted textures are deleted the next time
+a texture is requested on the rendering thread.
+\param config The configuration.
+\return Always `true`. */
+bool GaborCache::setup(const Configuration& config) {
+	std::lock_guard<std::recursive_mutex> lock(_mutex);
+	_config = config;
+	_evict();
+	return true;
+}
+
+GaborCache::Configuration GaborCache::getConfiguration(void) {
+	std::lock_guard<std::recursive_mutex> lock(_mutex);
+	return _config;
+}
+
+/*! Get the texture for the given properties. If it is cached, the cached texture is returned. If it is being precomputed,
+this waits for the pixels and uploads them. Otherwise, the texture is generated with gaborToPixels() and cached.
+This must be called from the thread that owns the rendering context.
+\param properties The properties of the gabor.
+\return The texture. It remains valid even if it is later evicted from the cache. */
+std::shared_ptr<ofTexture> GaborCache::getTexture(const GaborProperties& properties) {
+	Key key;
+	if (!_makeKey(properties, &key)) {
+		Instances::Log.verbose("GaborCache") << "getTexture(): The properties are not cacheable. The texture was generated without caching.";
+		{
+			std::lock_guard<std::recursive_mutex> lock(_mutex);
+			_stats.misses++;
+		}
+		// Not locked, so that other callers do not wait while the pixels are generated
+		ofPixels pix = gaborToPixels(properties);
+		std::shared_ptr<ofTexture> tex = std::make_shared<ofTexture>();
+		tex->allocate(pix);
+		tex->loadData(pix);
+		return tex;
+	}
+
+	std::shared_ptr<Pending> pending;
+	{
+		std::lock_guard<std::recursive_mutex> lock(_mutex);
+
+		_releaseRetired();
+
+		auto it = _entries.find(key);
+		if (it != _entries.end()) {
+			_stats.hits++;
+			_touch(it->second);
+			return it->second.texture;
+		}
+
+		auto pit = _pending.find(key);
+		if (pit != _pending.end()) {
+			pending = pit->second;
+			_pending.erase(pit);
+			_stats.hits++;
+		} else {
+			_stats.misses++;
+		}
+	}
+
+	if (pending) {
+		// Waiting for pixels that are already being generated is faster than starting over
+		pending->done.wait();
+		std::lock_guard<std::recursive_mutex> lock(_mutex);
+		return _insert(key, pending->pixels);
+	}
+
+	ofPixels pix = gaborToPixels(properties);
+
+	std::lock_guard<std::recursive_mutex> lock(_mutex);
+	return _insert(key, pix);
+}
+
+/*! Draw the gabor with the given properties, using a cached texture if available. See getTexture().
+\param center The location of the center of the gabor.
+\param properties The properties of the gabor. */
+void GaborCache::draw(ofPoint center, const GaborProperties& properties) {
+	std::shared_ptr<ofTexture> tex = getTexture(properties);
+
+	ofSetColor(255);
+	tex->draw(center.x - tex->getWidth() / 2, center.y - tex->getHeight() / 2); //Draws centered
+}
+
+/*! Start generating the pixels for the given properties on a worker thread. The texture is uploaded when it is
+first requested or when uploadPrecomputed() is called.
+\param properties The properties of the gabor.
+\return `false` if the properties are not cacheable, `true` otherwise (including if the texture is already cached or pending). */
+bool GaborCache::precompute(const GaborProperties& properties) {
+	Key key;
+	if (!_makeKey(properties, &key)) {
+		Instances::Log.warning("GaborCache") << "precompute(): The properties are not cacheable because the wave or envelope function is not a function pointer.";
+		return false;
+	}
+
+	std::lock_guard<std::recursive_mutex> lock(_mutex);
+
+	if (_entries.find(key) != _entries.end() || _pending.find(key) != _pending.end()) {
+		return true;
+	}
+
+	std::shared_ptr<Pending> pending = std::make_shared<Pending>();
+	Pending* p = pending.get();
+	GaborProperties props = properties;
+	pending->done = Util::sharedThreadPool().push([p, props](void) {
+		p->pixels = gaborToPixels(props);
+	});
+
+	_pending[key] = pending;
+	return true;
+}
+
+/*! \brief Precompute several gabors. See precompute(const GaborProperties&).
+\return The number of properties that were cacheable. */
+size_t GaborCache::precompute(const std::vector<GaborProperties>& properties) {
+	size_t count = 0;
+	for (const GaborProperties& p : properties) {
+		if (precompute(p)) {
+			count++;
+		}
+	}
+	return count;
+}
+
+/*! Upload the textures of precomputed gabors whose pixels are ready. Call this from the thread that owns the rendering
+context at a convenient time (e.g. between trials) so that uploading does not happen while drawing a trial.
+\return The number of textures that were uploaded. */
+size_t GaborCache::uploadPrecomputed(void) {
+	std::lock_guard<std::recursive_mutex> lock(_mutex);
+
+	_releaseRetired();
+
+	size_t count = 0;
+	for (auto it = _pending.begin(); it != _pending.end(); ) {
+		if (it->second->done.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+			_insert(it->first, it->second->pixels);
+			it = _pending.erase(it);
+			count++;
+		} else {
+			++it;
+		}
+	}
+	return count;
+}
+
+/*! \brief Returns `true` if a texture for the given properties is cached. Precomputed gabors that have not been uploaded are not counted. */
+bool GaborCache::contains(const GaborProperties& properties) {
+	Key key;
+	if (!_makeKey(properties, &key)) {
+		return false;
+	}
+	std::lock_guard<std::recursive_mutex> lock(_mutex);
+	return _entries.find(key) != _entries.end();
+}
+
+/*! \brief Get the number of cached textures. */
+size_t GaborCache::getCachedCount(void) {
+	std::lock_guard<std::recursive_mutex> lock(_mutex);
+	return _entries.size();
+}
+
+/*! \brief Get the number of precomputed gabors that have not yet been uploaded to textures. */
+size_t GaborCache::getPendingCount(void) {
+	std::lock_guard<std::recursive_mutex> lock(_mutex);
+	return _pending.size();
+}
+
+/*! \brief Get the approximate amount of video memory used by cached textures, in bytes. */
+size_t GaborCache::getMemoryUsage(void) {
+	std::lock_guard<std::recursive_mutex> lock(_mutex);
+	return _bytes;
+}
+
+GaborCache::Statistics GaborCache::getStatistics(void) {
+	std::lock_guard<std::recursive_mutex> lock(_mutex);
+	return _stats;
+}
+
+/*! Remove all textures from the cache. Precomputations that are in progress are waited for and discarded.
+If this is not called from the thread that owns the rendering context, the textures are deleted the next time
+a texture is requested on the rendering thread. */
+void GaborCache::clear(void) {
+	std::map<Key, std::shared_ptr<Pending>> pending;
+	{
+		std::lock_guard<std::recursive_mutex> lock(_mutex);
+		for (auto& entry : _entries) {
+			_retire(entry.second.texture);
+		}
+		_entries.clear();
+		_lru.clear();
+		_bytes = 0;
+		std::swap(pending, _pending);
+	}
+
+	// The worker threads write into the pending entries, so they must finish first
+	for (auto& p : pending) {
+		p.second->done.wait();
+	}
+}
+
+/*! Check whether the given properties can be cached. They can be cached if the wave and envelope functions are
+plain function pointers, like the static functions of WaveformProperties and EnvelopeProperties. */
+bool GaborCache::isCacheable(const GaborProperties& properties) {
+	return _makeKey(properties, nullptr);
+}
+
+bool GaborCache::_makeKey(const GaborProperties& properties, Key* key) {
+	typedef float(*WaveFunction)(float);
+	typedef float(*EnvelopeFunction)(float, float);
+
+	const WaveFunction* wf = properties.wave.waveFunction.target<WaveFunction>();
+	const EnvelopeFunction* ef = properties.envelope.envelopeFunction.target<EnvelopeFunction>();
+	if (wf == nullptr || ef == nullptr) {
+		return false;
+	}
+
+	if (key != nullptr) {
+		const ofColor& c1 = properties.color1;
+		const ofColor& c2 = properties.color2;
+
+		key->width = properties.width;
+		key->height = properties.height;
+		key->color1 = (c1.r << 24) | (c1.g << 16) | (c1.b << 8) | c1.a;
+		key->color2 = (c2.r << 24) | (c2.g << 16) | (c2.b << 8) | c2.a;
+
+		// The wave and envelope sizes are taken from the gabor size, so they are not part of the key
+		key->angle = properties.wave.angle;
+		key->wavelength = properties.wave.wavelength;
+		key->phase = properties.wave.phase;
+		key->waveFunction = reinterpret_cast<uintptr_t>(*wf);
+
+		key->controlParameter = properties.envelope.controlParameter;
+		key->envelopeFunction = reinterpret_cast<uintptr_t>(*ef);
+	}
+
+	return true;
+}
+
+std::shared_ptr<ofTexture> GaborCache::_insert(const Key& key, const ofPixels& pixels) {
+	auto it = _entries.find(key);
+	if (it != _entries.end()) {
+		_touch(it->second);
+		return it->second.texture;
+	}
+
+	std::shared_ptr<ofTexture> tex = std::make_shared<ofTexture>();
+	tex->allocate(pixels);
+	tex->loadData(pixels);
+
+	_lru.push_front(key);
+
+	Entry& entry = _entries[key];
+	entry.texture = tex;
+	entry.bytes = (size_t)pixels.getWidth() * pixels.getHeight() * 4;
+	entry.lruPosition = _lru.begin();
+
+	_bytes += entry.bytes;
+
+	_evict();
+
+	return tex;
+}
+
+void GaborCache::_touch(Entry& entry) {
+	_lru.splice(_lru.begin(), _lru, entry.lruPosition);
+}
+
+void GaborCache::_evict(void) {
+	while (_bytes > _config.maxBytes && _lru.size() > 1) {
+		auto it = _entries.find(_lru.back());
+		_bytes -= it->second.bytes;
+		_retire(it->second.texture);
+		_entries.erase(it);
+		_lru.pop_back();
+		_stats.evictions++;
+	}
+}
+
+// Must be called with _mutex locked.
+void GaborCache::_retire(std::shared_ptr<ofTexture> texture) {
+	if (!Private::glfwContextManager.isLockedByThisThread()) {
+		_retired.push_back(texture);
+	}
+	// On the rendering thread, the texture is deleted when the last copy of texture is destroyed.
+}
+
+// Must be called with _mutex locked. Does nothing on threads without the rendering context.
+void GaborCache::_releaseRetired(void) {
+	if (Private::glfwContextManager.isLockedByThisThread()) {
+		_retired.clear();
+	}
+}
+
 } //namespace Draw
 } //namespace CX
\ No newline at end of file
@@ -1,5 +1,11 @@
 #pragma once
 
+#include <map>
+#include <list>
+#include <mutex>
+#include <future>
+#include <atomic>
+
 #include "ofShader.h"
 #include "ofGraphics.h"
 
@@ -85,6 +91,9 @@ Due to how GLSL works, these function bodies can be written as strings
 in C++ source code and passed to the GLSL compiler as strings. In this
 case, you just need to pass the function bodies to Gabor::setup().
 
+Compiled shaders are shared between all Gabor instances that use the same wave and envelope
+functions, so creating many Gabors with the same functions only compiles the shader once.
+
 */
 class Gabor {
 public:
@@ -149,10 +158,15 @@ public:
 		float controlParameter; //!< Control parameter for the envelope generating function.
 	} envelope; //!< Settings for the envelope.
 
+	static void clearShaderCache(void);
+
 private:
 
 	void _initVars(void);
-	ofShader _shader;
+	std::shared_ptr<ofShader> _shader;
+
+	static std::mutex _shaderCacheMutex;
+	static std::map<std::pair<std::string, std::string>, std::weak_ptr<ofShader>> _shaderCache;
 
 	void _draw(ofPoint center, float renderSurfaceHeightPx);
 
@@ -188,6 +202,10 @@ struct WaveformProperties {
 	It should take the current waveform position as a value in the interval [0,1) and
 	return the relative height of the wave as a value in the interval [0,1].
 	See the static functions in this struct, like sine(), square(), etc. for some options.
+
+	The static functions are recognized and evaluated for whole rows of pixels at once, which is much faster than
+	calling a user-defined function for every pixel. User-defined functions are called from several threads at
+	once, so they must not modify shared data.
 	*/
 	std::function<float(float)> waveFunction;
 
@@ -216,7 +234,10 @@ struct EnvelopeProperties {
 	or some user defined function. The first argument it takes is the distance in pixels from the
 	center of the envelope (depend on the width and height). The second argument is the
 	\ref controlParameter, which is set by the user. The function should return a value in the
-	interval [0,1]. */
+	interval [0,1].
+
+	As with WaveformProperties::waveFunction, the static functions are evaluated much faster than user-defined
+	functions, which are called from several threads at once. */
 	std::function<float(float, float)> envelopeFunction;
 
 	/*! A parameter that controls the envelope in different ways, depending on the envelope function.
@@ -266,6 +287,146 @@ void gabor(ofPoint center, const GaborProperties& properties);
 void gabor(ofPoint center, ofColor color1, ofColor color2, const ofFloatPixels& wave, const ofFloatPixels& envelope);
 
 
+/*! This class caches gabor textures generated from GaborProperties, so that stimuli that repeat across trials
+(e.g. the same orientation, wavelength, and phase) cost a texture bind rather than a regeneration. The least recently
+used textures are evicted when the cache exceeds its memory limit.
+
+Textures can be precomputed: precompute() generates the pixels on the threads of Util::sharedThreadPool() and the
+textures are uploaded the next time they are requested (or when uploadPrecomputed() is called), because textures can
+only be created on the thread that owns the rendering context.
+
+Properties are identified by their numeric values and by the identity of the wave and envelope functions. Functions
+are identifiable if they are plain function pointers, like the static functions of WaveformProperties and
+EnvelopeProperties. Properties with other functions (e.g. lambdas) can still be drawn, but are not cached
+(see isCacheable()).
+
+\code{.cpp}
+Draw::GaborCache cache;
+
+Draw::GaborProperties props;
+props.width = 200;
+props.height = 200;
+props.envelope.envelopeFunction = Draw::EnvelopeProperties::gaussian;
+props.envelope.controlParameter = 30;
+
+std::vector<Draw::GaborProperties> allProps;
+for (float angle : { 0, 45, 90, 135 }) {
+	props.wave.angle = angle;
+	allProps.push_back(props);
+}
+cache.precompute(allProps); // Generated in the background
+
+// Later, during a trial:
+Disp.beginDrawingToBackBuffer();
+ofBackground(127);
+cache.draw(Disp.getCenter(), allProps[2]);
+Disp.endDrawingToBackBuffer();
+\endcode
+*/
+class GaborCache {
+public:
+
+	struct Configuration {
+		Configuration(void) :
+			maxBytes(256 * 1024 * 1024)
+		{}
+
+		/*! \brief The approximate maximum amount of video memory used by cached textures, in bytes. Each texture uses
+		4 bytes per pixel. The most recently used texture is always kept, even if it is larger than this. */
+		size_t maxBytes;
+	};
+
+	/*! Counts of cache lookups. */
+	struct Statistics {
+		Statistics(void) :
+			hits(0),
+			misses(0),
+			evictions(0)
+		{}
+
+		uint64_t hits; //!< Lookups that found a cached or precomputed texture.
+		uint64_t misses; //!< Lookups that required generating the texture.
+		uint64_t evictions; //!< Textures that were evicted to stay under `Configuration::maxBytes`.
+	};
+
+	GaborCache(void);
+	~GaborCache(void);
+
+	bool setup(const Configuration& config);
+	Configuration getConfiguration(void);
+
+	std::shared_ptr<ofTexture> getTexture(const GaborProperties& properties);
+	void draw(ofPoint center, const GaborProperties& properties);
+
+	bool precompute(const GaborProperties& properties);
+	size_t precompute(const std::vector<GaborProperties>& properties);
+	size_t uploadPrecomputed(void);
+
+	bool contains(const GaborProperties& properties);
+	size_t getCachedCount(void);
+	size_t getPendingCount(void);
+	size_t getMemoryUsage(void);
+
+	Statistics getStatistics(void);
+	void clear(void);
+
+	static bool isCacheable(const GaborProperties& properties);
+
+private:
+
+	struct Key {
+		float width;
+		float height;
+		uint32_t color1;
+		uint32_t color2;
+
+		float angle;
+		float wavelength;
+		float phase;
+		uintptr_t waveFunction;
+
+		float controlParameter;
+		uintptr_t envelopeFunction;
+
+		bool operator<(const Key& rhs) const;
+	};
+
+	struct Entry {
+		std::shared_ptr<ofTexture> texture;
+		size_t bytes;
+		std::list<Key>::iterator lruPosition;
+	};
+
+	struct Pending {
+		std::future<void> done;
+		ofPixels pixels;
+	};
+
+	std::recursive_mutex _mutex;
+	Configuration _config;
+	Statistics _stats;
+
+	std::map<Key, Entry> _entries;
+	std::list<Key> _lru; // Most recently used at the front
+	size_t _bytes;
+
+	std::map<Key, std::shared_ptr<Pending>> _pending;
+
+	// Textures that were removed on a thread without the rendering context. They are released by the next
+	// function that runs on the rendering thread, because deleting a texture makes OpenGL calls.
+	std::vector<std::shared_ptr<ofTexture>> _retired;
+
+	static bool _makeKey(const GaborProperties& properties, Key* key);
+
+	std::shared_ptr<ofTexture> _insert(const Key& key, const ofPixels& pixels);
+	void _touch(Entry& entry);
+	void _evict(void);
+	void _retire(std::shared_ptr<ofTexture> texture);
+	void _releaseRetired(void);
+};
+
+
+
 
 } //namespace Draw
 } //namespace CX
@@ -1,6 +1,7 @@
 #include "CX_InputManager.h"
 
 #include "CX_AppWindow.h" //glfwPollEvents()
+#include "CX_Logger.h"
 
 namespace CX {
 
@@ -19,6 +20,10 @@ namespace CX {
 	{
 	}
 
+	CX_InputManager::~CX_InputManager(void) {
+		stopPollingThread();
+	}
+
 	/*!
 	Set up the input manager to use the requested devices. You may call this function multiple times if you want to
 	change the configuration over the course of the experiment. Every time this function is called, all input device
@@ -31,6 +36,12 @@ namespace CX {
 	*/
 	bool CX_InputManager::setup(bool useKeyboard, bool useMouse, int joystickIndex) {
 
+		// The polling thread reads the joystick configuration, so it is stopped while devices are set up.
+		bool restartPollingThread = isPollingThreadRunning();
+		if (restartPollingThread) {
+			stopPollingThread();
+		}
+
 		pollEvents(); //Flush out all waiting events during setup.
 
 		Keyboard.clearEvents();
@@ -47,6 +58,11 @@ namespace CX {
 		} else {
 			_usingJoystick = false;
 		}
+
+		if (restartPollingThread) {
+			startPollingThread(_polling.config);
+		}
+
 		return success;
 	}
 
@@ -67,11 +83,16 @@ namespace CX {
 		// they wouldn't have if they each took a poll time one after the other.
 		// The joystick works differently: the GLFW helper functions simply reads
 		// off the current axis and button values rather than creating events.
+		// GLFW only allows this on the main thread, so the polling thread never does it.
 		glfwPollEvents();
 		CX_Millis pollCompleteTime = CX::Instances::Clock.now();
 
 		if (_usingJoystick) {
-			Joystick.pollEvents();
+			Joystick.pollEvents(); // Takes events from the polling thread if it is polling the joystick
+		}
+
+		for (auto& source : _eventSources) {
+			source.second();
 		}
 
 		if (Mouse.enabled()) {
@@ -104,4 +125,117 @@ namespace CX {
 		Joystick.clearEvents();
 	}
 
+	/*! Start a thread that polls the joystick at a fixed rate. Events are timestamped on the polling thread when they are
+	received, so their timestamps and uncertainties do not depend on how often pollEvents() is called. The events
+	wait in a lock-free queue until pollEvents() moves them into Joystick, so pollEvents() must still be
+	called, but only as often as user code needs to see the events.
+
+	GLFW functions, including input polling, may only be called on the main thread, so the polling thread does not use GLFW.
+	It reads the Linux joystick device (`/dev/input/js<index>`) directly, which is also what GLFW reads for the joystick at
+	that index. This means that:
+	+ The polling thread is only available on Linux.
+	+ Keyboard and mouse events are still polled by pollEvents() on the main thread. For keyboard and mouse timestamps that
+	do not depend on pollEvents(), use CX_EvdevInput, which reads the devices on its own thread.
+
+	\param config The configuration of the thread. If the thread is already running, it is restarted with this configuration.
+	\return `false` if the joystick is not set up (see setup()), its device could not be opened, or this is not Linux,
+	`true` otherwise.
+
+	\code{.cpp}
+	Input.setup(false, false, 0);
+
+	CX_InputManager::PollingThreadConfiguration config;
+	config.pollInterval = CX_Millis(0.5);
+	Input.startPollingThread(config);
+
+	// Even if this loop is slow, the joystick event timestamps are accurate to about 0.5 ms.
+	while (!Input.Joystick.availableEvents()) {
+		drawComplicatedThings();
+		Input.pollEvents();
+	}
+	\endcode
+	*/
+	bool CX_InputManager::startPollingThread(const PollingThreadConfiguration& config) {
+		stopPollingThread();
+
+#ifdef TARGET_LINUX
+		PollingThreadConfiguration cfg = config;
+
+		if (!_usingJoystick) {
+			Instances::Log.error("CX_InputManager") << "startPollingThread(): The joystick is not set up, so there is nothing "
+				"for the polling thread to poll. Keyboard and mouse events are polled by pollEvents() (or CX_EvdevInput).";
+			return false;
+		}
+
+		if (cfg.pollInterval < CX_Millis(0)) {
+			cfg.pollInterval = CX_Millis(0);
+		}
+
+		pollEvents(); // Events from before the thread starts are handled the normal way
+
+		if (!Joystick._startPollingThread(cfg.queueCapacity)) {
+			return false;
+		}
+
+		_polling.config = cfg;
+		_polling.running = true;
+		_polling.thread = std::thread(&CX_InputManager::_pollingThreadFunction, this);
+
+		return true;
+#else
+		Instances::Log.error("CX_InputManager") << "startPollingThread(): The polling thread is only available on Linux. "
+			"On other platforms, the joystick can only be read with GLFW, which must be used on the main thread.";
+		return false;
+#endif
+	}
+
+	/*! Stop the polling thread, if it is running. Events that the thread received are moved into the devices
+	before this function returns, and afterwards, pollEvents() polls for events itself. */
+	void CX_InputManager::stopPollingThread(void) {
+		if (!_polling.thread.joinable()) {
+			return;
+		}
+
+		_polling.running = false;
+		_polling.thread.join();
+
+		// Take the remaining events, then stop using the queues.
+		if (_usingJoystick) {
+			Joystick.pollEvents();
+		}
+		Joystick._stopPollingThread();
+	}
+
+	/*! \brief Returns `true` if the polling thread is running. See startPollingThread(). */
+	bool CX_InputManager::isPollingThreadRunning(void) const {
+		return _polling.running;
+	}
+
+	/*! \brief Returns the number of events that were dropped because the queue between the polling thread and a device
+	was full. If this is not 0, call pollEvents() more often or increase `PollingThreadConfiguration::queueCapacity`. */
+	uint64_t CX_InputManager::getDroppedEventCount(void) const {
+		return _polling.droppedEvents;
+	}
+
+	// Must not call GLFW functions: they may only be called on the main thread.
+	void CX_InputManager::_pollingThreadFunction(void) {
+
+		const PollingThreadConfiguration config = _polling.config;
+
+		CX_Millis nextPollTime = Instances::Clock.now();
+
+		while (_polling.running) {
+
+			_polling.droppedEvents += Joystick._pollOnPollingThread();
+
+			nextPollTime += config.pollInterval;
+			CX_Millis now = Instances::Clock.now();
+			if (nextPollTime < now) {
+				nextPollTime = now; // Fell behind, so don't try to catch up
+			} else {
+				Instances::Clock.sleep(nextPollTime - now);
+			}
+		}
+	}
+
 }
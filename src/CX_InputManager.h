@@ -1,7 +1,11 @@
 #pragma once
 
 #include <set>
+#include <map>
 #include <queue>
+#include <atomic>
+#include <thread>
+#include <memory>
 
 #include "ofEvents.h"
 
@@ -96,6 +100,13 @@ namespace CX {
 	}
 	\endcode
 
+	By default, the timing precision of input events depends on how often user code calls pollEvents(). GLFW only allows
+	input to be polled on the main thread, so keyboard and mouse events always depend on pollEvents(), unless the Linux
+	evdev backend (CX_EvdevInput) is used, which reads the devices on its own thread with kernel timestamps. On Linux,
+	startPollingThread() can poll the joystick at a fixed, high rate on a separate thread by reading the joystick device
+	directly. You still call pollEvents() to move the events into the device queues, but the timestamps and uncertainties
+	no longer depend on when you call it.
+
 	This class has a private constructor because you should never need more than one of them. If you really,
 	really need more than one, you can use CX::Private::inputManagerFactory() to make one.
 
@@ -105,21 +116,80 @@ namespace CX {
 	class CX_InputManager {
 	public:
 
+		~CX_InputManager(void);
+
 		bool setup(bool useKeyboard, bool useMouse, int joystickIndex = -1);
 
 		bool pollEvents(void);
 
 		void clearAllEvents(bool pollFirst = true);
 
+		/*! Settings for the input polling thread. See startPollingThread(). */
+		struct PollingThreadConfiguration {
+			PollingThreadConfiguration(void) :
+				pollInterval(1),
+				queueCapacity(4096)
+			{}
+
+			/*! \brief The time between polls. The uncertainty of event timestamps is at most about this long,
+			plus the scheduling jitter of the thread. */
+			CX_Millis pollInterval;
+
+			/*! \brief The number of events per device that can wait for pollEvents() before events are dropped.
+			Dropped events are counted by getDroppedEventCount(). */
+			size_t queueCapacity;
+		};
+
+		bool startPollingThread(const PollingThreadConfiguration& config = PollingThreadConfiguration());
+		void stopPollingThread(void);
+		bool isPollingThreadRunning(void) const;
+
+		uint64_t getDroppedEventCount(void) const;
+
 		CX_Keyboard Keyboard; //!< An instance of CX::CX_Keyboard. Enabled or disabled with CX::CX_InputManager::setup().
 		CX_Mouse Mouse; //!< An instance of CX::CX_Mouse. Enabled or disabled with CX::CX_InputManager::setup().
 		CX_Joystick Joystick; //!< An instance of CX::CX_Joystick. Enabled or disabled with CX::CX_InputManager::setup().
 
 	private:
 		friend CX_InputManager Private::inputManagerFactory(void);
+		friend class CX_Keyboard;
+		friend class CX_Mouse;
+		friend class CX_EvdevInput;
+		friend class CX_InputReplayer;
+
 		CX_InputManager(void);
 
 		bool _usingJoystick;
+
+		// CX_InputManager is copyable for inputManagerFactory(), but a copy must not share (and be able to stop) the
+		// polling thread of the original, so copies of this state are new, stopped states.
+		struct PollingThreadState {
+			PollingThreadState(void) :
+				running(false),
+				droppedEvents(0)
+			{}
+
+			PollingThreadState(const PollingThreadState&) :
+				running(false),
+				droppedEvents(0)
+			{}
+
+			PollingThreadState& operator=(const PollingThreadState&) {
+				return *this;
+			}
+
+			PollingThreadConfiguration config;
+			std::thread thread;
+			std::atomic<bool> running;
+			std::atomic<uint64_t> droppedEvents;
+		};
+
+		PollingThreadState _polling;
+
+		// Other sources of events (e.g. CX_EvdevInput), which move their events into the devices when pollEvents() is called
+		std::map<const void*, std::function<void(void)>> _eventSources;
+
+		void _pollingThreadFunction(void);
 	};
 
 	namespace Instances {
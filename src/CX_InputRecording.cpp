@@ -0,0 +1,385 @@
+#include "CX_InputRecording.h"
+
+#include <cstring>
+
+#include "ofUtils.h"
+
+#include "CX_InputManager.h"
+#include "CX_Logger.h"
+#include "CX_Utilities.h"
+
+/* File format (all values little-endian, as written by the machine that made the recording):
+
+Header: "CXIR" (4 bytes), uint32 version
+
+Each event:
+	uint8 device (0 = keyboard, 1 = mouse, 2 = joystick)
+	int64 time (nanoseconds since the start of the recording)
+	int64 uncertainty (nanoseconds)
+	uint8 type
+	keyboard: int32 key, int32 oF, int32 glfw, int32 scancode, uint32 codepoint
+	mouse: int32 button, float x, float y
+	joystick: int32 buttonIndex, uint8 buttonState, int32 axisIndex, float axisPosition
+*/
+
+namespace CX {
+
+namespace {
+
+	const char recordingMagic[4] = { 'C', 'X', 'I', 'R' };
+	const uint32_t recordingVersion = 1;
+
+	const uint8_t keyboardDevice = 0;
+	const uint8_t mouseDevice = 1;
+	const uint8_t joystickDevice = 2;
+
+	void writeEventHeader(std::ostream& os, uint8_t device, CX_Millis time, CX_Millis uncertainty, int type) {
+		Util::writeBinaryValue<uint8_t>(os, device);
+		Util::writeBinaryValue<int64_t>(os, time.nanos());
+		Util::writeBinaryValue<int64_t>(os, uncertainty.nanos());
+		Util::writeBinaryValue<uint8_t>(os, (uint8_t)type);
+	}
+
+}
+
+////////////////////
+// CX_InputRecorder
+////////////////////
+
+CX_InputRecorder::CX_InputRecorder(void) :
+	_manager(nullptr),
+	_recordedEvents(0)
+{}
+
+CX_InputRecorder::~CX_InputRecorder(void) {
+	stop();
+}
+
+/*! Start recording. If a recording is in progress, it is stopped first.
+\param config The configuration to use.
+\return `false` if the file could not be opened, `true` otherwise. */
+bool CX_InputRecorder::setup(const Configuration& config) {
+	std::lock_guard<std::recursive_mutex> lock(_mutex);
+
+	stop();
+
+	_config = config;
+	_manager = (config.inputManager != nullptr) ? config.inputManager : &Instances::Input;
+
+	_file.open(ofToDataPath(config.filename).c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+	if (!_file.is_open()) {
+		Instances::Log.error("CX_InputRecorder") << "setup(): Could not open \"" << config.filename << "\" for writing.";
+		return false;
+	}
+
+	_file.write(recordingMagic, sizeof(recordingMagic));
+	Util::writeBinaryValue<uint32_t>(_file, recordingVersion);
+
+	_recordedEvents = 0;
+	_startTime = Instances::Clock.now();
+
+	// The observers are called on the main thread while events are stored, so _mutex is not needed in _record().
+	if (config.recordKeyboard) {
+		_manager->Keyboard._eventObserver = [this](const CX_Keyboard::Event& ev) { _record(ev); };
+	}
+	if (config.recordMouse) {
+		_manager->Mouse._eventObserver = [this](const CX_Mouse::Event& ev) { _record(ev); };
+	}
+	if (config.recordJoystick) {
+		_manager->Joystick._eventObserver = [this](const CX_Joystick::Event& ev) { _record(ev); };
+	}
+
+	return true;
+}
+
+CX_InputRecorder::Configuration CX_InputRecorder::getConfiguration(void) {
+	std::lock_guard<std::recursive_mutex> lock(_mutex);
+	return _config;
+}
+
+/*! Stop recording and close the file. Events that have not been moved into the input devices with
+CX_InputManager::pollEvents() are not recorded. */
+void CX_InputRecorder::stop(void) {
+	std::lock_guard<std::recursive_mutex> lock(_mutex);
+
+	if (!_file.is_open()) {
+		return;
+	}
+
+	if (_config.recordKeyboard) {
+		_manager->Keyboard._eventObserver = nullptr;
+	}
+	if (_config.recordMouse) {
+		_manager->Mouse._eventObserver = nullptr;
+	}
+	if (_config.recordJoystick) {
+		_manager->Joystick._eventObserver = nullptr;
+	}
+
+	_file.close();
+	if (_file.fail()) {
+		Instances::Log.error("CX_InputRecorder") << "stop(): There was an error while writing \"" << _config.filename << "\".";
+	}
+}
+
+/*! \brief Returns `true` if events are being recorded. */
+bool CX_InputRecorder::isRecording(void) {
+	std::lock_guard<std::recursive_mutex> lock(_mutex);
+	return _file.is_open();
+}
+
+/*! \brief Returns the number of events that have been recorded since setup() was called. */
+uint64_t CX_InputRecorder::getRecordedEventCount(void) {
+	std::lock_guard<std::recursive_mutex> lock(_mutex);
+	return _recordedEvents;
+}
+
+void CX_InputRecorder::_record(const CX_Keyboard::Event& ev) {
+	writeEventHeader(_file, keyboardDevice, ev.time - _startTime, ev.uncertainty, ev.type);
+	Util::writeBinaryValue<int32_t>(_file, ev.key);
+	Util::writeBinaryValue<int32_t>(_file, ev.codes.oF);
+	Util::writeBinaryValue<int32_t>(_file, ev.codes.glfw);
+	Util::writeBinaryValue<int32_t>(_file, ev.codes.scancode);
+	Util::writeBinaryValue<uint32_t>(_file, ev.codes.codepoint);
+	_recordedEvents++;
+}
+
+void CX_InputRecorder::_record(const CX_Mouse::Event& ev) {
+	writeEventHeader(_file, mouseDevice, ev.time - _startTime, ev.uncertainty, ev.type);
+	Util::writeBinaryValue<int32_t>(_file, ev.button);
+	Util::writeBinaryValue<float>(_file, ev.x);
+	Util::writeBinaryValue<float>(_file, ev.y);
+	_recordedEvents++;
+}
+
+void CX_InputRecorder::_record(const CX_Joystick::Event& ev) {
+	writeEventHeader(_file, joystickDevice, ev.time - _startTime, ev.uncertainty, ev.type);
+	Util::writeBinaryValue<int32_t>(_file, ev.buttonIndex);
+	Util::writeBinaryValue<uint8_t>(_file, ev.buttonState);
+	Util::writeBinaryValue<int32_t>(_file, ev.axisIndex);
+	Util::writeBinaryValue<float>(_file, ev.axisPosition);
+	_recordedEvents++;
+}
+
+////////////////////
+// CX_InputReplayer
+////////////////////
+
+CX_InputReplayer::CX_InputReplayer(void) :
+	_manager(nullptr),
+	_nextRecord(0)
+{}
+
+CX_InputReplayer::~CX_InputReplayer(void) {
+	stop();
+}
+
+/*! Load a recording and start replaying it. If a replay is in progress, it is stopped first.
+\param config The configuration to use.
+\return `false` if the recording could not be read, `true` otherwise. */
+bool CX_InputReplayer::setup(const Configuration& config) {
+	std::lock_guard<std::recursive_mutex> lock(_mutex);
+
+	stop();
+
+	_config = config;
+	_manager = (config.inputManager != nullptr) ? config.inputManager : &Instances::Input;
+
+	if (!_load(config.filename)) {
+		return false;
+	}
+
+	_nextRecord = 0;
+	_startTime = Instances::Clock.now();
+	_manager->_eventSources[this] = std::bind(&CX_InputReplayer::_injectEvents, this);
+
+	return true;
+}
+
+CX_InputReplayer::Configuration CX_InputReplayer::getConfiguration(void) {
+	std::lock_guard<std::recursive_mutex> lock(_mutex);
+	return _config;
+}
+
+/*! Stop replaying. Events that have not been added to the input devices yet are discarded. */
+void CX_InputReplayer::stop(void) {
+	std::lock_guard<std::recursive_mutex> lock(_mutex);
+
+	if (_manager != nullptr) {
+		_manager->_eventSources.erase(this);
+	}
+	_records.clear();
+	_nextRecord = 0;
+}
+
+/*! \brief Returns `true` if there are events that have not been replayed yet. */
+bool CX_InputReplayer::isReplaying(void) {
+	std::lock_guard<std::recursive_mutex> lock(_mutex);
+	return _nextRecord < _records.size();
+}
+
+/*! \brief Returns the number of events in the recording (only counting devices that are replayed). */
+size_t CX_InputReplayer::getEventCount(void) {
+	std::lock_guard<std::recursive_mutex> lock(_mutex);
+	return _records.size();
+}
+
+/*! \brief Returns the number of events that have not been replayed yet. */
+size_t CX_InputReplayer::getRemainingEventCount(void) {
+	std::lock_guard<std::recursive_mutex> lock(_mutex);
+	return _records.size() - _nextRecord;
+}
+
+/*! \brief Returns the time from the start of the recording to the last replayed event. */
+CX_Millis CX_InputReplayer::getDuration(void) {
+	std::lock_guard<std::recursive_mutex> lock(_mutex);
+	if (_records.empty()) {
+		return 0;
+	}
+	return _records.back().time;
+}
+
+bool CX_InputReplayer::_load(std::string filename) {
+	_records.clear();
+
+	std::ifstream file(ofToDataPath(filename).c_str(), std::ios::in | std::ios::binary);
+	if (!file.is_open()) {
+		Instances::Log.error("CX_InputReplayer") << "setup(): Could not open \"" << filename << "\".";
+		return false;
+	}
+
+	char magic[4];
+	uint32_t version = 0;
+	file.read(magic, sizeof(magic));
+	if (!file.good() || std::memcmp(magic, recordingMagic, sizeof(magic)) != 0 || !Util::readBinaryValue(file, version) || version != recordingVersion) {
+		Instances::Log.error("CX_InputReplayer") << "setup(): \"" << filename << "\" is not an input recording made by CX_InputRecorder, or is from an unsupported version.";
+		return false;
+	}
+
+	while (true) {
+		Record rec;
+		int64_t time = 0;
+		int64_t uncertainty = 0;
+		uint8_t type = 0;
+
+		if (!Util::readBinaryValue(file, rec.device)) {
+			break; // End of the file
+		}
+
+		bool ok = Util::readBinaryValue(file, time) && Util::readBinaryValue(file, uncertainty) && Util::readBinaryValue(file, type);
+
+		if (rec.device == keyboardDevice) {
+			int32_t key = 0, oF = 0, glfw = 0, scancode = 0;
+			uint32_t codepoint = 0;
+			ok = ok && Util::readBinaryValue(file, key) && Util::readBinaryValue(file, oF) && Util::readBinaryValue(file, glfw) && Util::readBinaryValue(file, scancode) && Util::readBinaryValue(file, codepoint);
+
+			rec.keyboard.key = key;
+			rec.keyboard.type = (CX_Keyboard::EventType)type;
+			rec.keyboard.time = CX_Nanos(time);
+			rec.keyboard.uncertainty = CX_Nanos(uncertainty);
+			rec.keyboard.codes.oF = oF;
+			rec.keyboard.codes.glfw = glfw;
+			rec.keyboard.codes.scancode = scancode;
+			rec.keyboard.codes.codepoint = codepoint;
+
+		} else if (rec.device == mouseDevice) {
+			int32_t button = 0;
+			float x = 0, y = 0;
+			ok = ok && Util::readBinaryValue(file, button) && Util::readBinaryValue(file, x) && Util::readBinaryValue(file, y);
+
+			rec.mouse.button = button;
+			rec.mouse.x = x;
+			rec.mouse.y = y;
+			rec.mouse.type = (CX_Mouse::EventType)type;
+			rec.mouse.time = CX_Nanos(time);
+			rec.mouse.uncertainty = CX_Nanos(uncertainty);
+
+		} else if (rec.device == joystickDevice) {
+			int32_t buttonIndex = 0, axisIndex = 0;
+			uint8_t buttonState = 0;
+			float axisPosition = 0;
+			ok = ok && Util::readBinaryValue(file, buttonIndex) && Util::readBinaryValue(file, buttonState) && Util::readBinaryValue(file, axisIndex) && Util::readBinaryValue(file, axisPosition);
+
+			rec.joystick.buttonIndex = buttonIndex;
+			rec.joystick.buttonState = buttonState;
+			rec.joystick.axisIndex = axisIndex;
+			rec.joystick.axisPosition = axisPosition;
+			rec.joystick.type = (CX_Joystick::EventType)type;
+			rec.joystick.time = CX_Nanos(time);
+			rec.joystick.uncertainty = CX_Nanos(uncertainty);
+
+		} else {
+			Instances::Log.error("CX_InputReplayer") << "setup(): \"" << filename << "\" contains an invalid event. Only the " <<
+				_records.size() << " events before it will be replayed.";
+			break;
+		}
+
+		if (!ok) {
+			Instances::Log.warning("CX_InputReplayer") << "setup(): The last event in \"" << filename << "\" is incomplete and will not be replayed.";
+			break;
+		}
+
+		bool replayed = (rec.device == keyboardDevice && _config.replayKeyboard) ||
+			(rec.device == mouseDevice && _config.replayMouse) ||
+			(rec.device == joystickDevice && _config.replayJoystick);
+
+		if (replayed) {
+			rec.time = CX_Nanos(time);
+			_records.push_back(rec);
+		}
+	}
+
+	Instances::Log.verbose("CX_InputReplayer") << "Loaded " << _records.size() << " events from \"" << filename << "\".";
+
+	return true;
+}
+
+void CX_InputReplayer::_injectEvents(void) {
+	std::lock_guard<std::recursive_mutex> lock(_mutex);
+
+	CX_Millis elapsed = Instances::Clock.now() - _startTime;
+
+	// Replayed events must not be recorded again by an active CX_InputRecorder
+	std::function<void(const CX_Keyboard::Event&)> keyboardObserver = _manager->Keyboard._eventObserver;
+	std::function<void(const CX_Mouse::Event&)> mouseObserver = _manager->Mouse._eventObserver;
+	std::function<void(const CX_Joystick::Event&)> joystickObserver = _manager->Joystick._eventObserver;
+	_manager->Keyboard._eventObserver = nullptr;
+	_manager->Mouse._eventObserver = nullptr;
+	_manager->Joystick._eventObserver = nullptr;
+
+	size_t axisCount = _manager->Joystick.getAxisPositions().size();
+	size_t buttonCount = _manager->Joystick.getButtonStates().size();
+
+	while (_nextRecord < _records.size()) {
+		Record& rec = _records[_nextRecord];
+		if (_config.realTime && rec.time > elapsed) {
+			break;
+		}
+		_nextRecord++;
+
+		if (rec.device == keyboardDevice) {
+			rec.keyboard.time += _startTime;
+			_manager->Keyboard.appendEvent(rec.keyboard);
+
+		} else if (rec.device == mouseDevice) {
+			rec.mouse.time += _startTime;
+			_manager->Mouse.appendEvent(rec.mouse);
+
+		} else if (rec.device == joystickDevice) {
+			bool fits = (rec.joystick.type == CX_Joystick::AxisPositionChange) ?
+				(rec.joystick.axisIndex >= 0 && (size_t)rec.joystick.axisIndex < axisCount) :
+				(rec.joystick.buttonIndex >= 0 && (size_t)rec.joystick.buttonIndex < buttonCount);
+
+			if (fits) {
+				rec.joystick.time += _startTime;
+				_manager->Joystick.appendEvent(rec.joystick);
+			}
+		}
+	}
+
+	_manager->Keyboard._eventObserver = keyboardObserver;
+	_manager->Mouse._eventObserver = mouseObserver;
+	_manager->Joystick._eventObserver = joystickObserver;
+}
+
+}
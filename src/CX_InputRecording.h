@@ -0,0 +1,174 @@
+#pragma once
+
+#include <mutex>
+#include <fstream>
+
+#include "CX_Clock.h"
+#include "CX_Keyboard.h"
+#include "CX_Mouse.h"
+#include "CX_Joystick.h"
+
+namespace CX {
+
+	class CX_InputManager;
+
+	/*! This class records every keyboard, mouse, and joystick event that is stored by a CX_InputManager to a compact
+	binary file. The recording can be played back with CX_InputReplayer, which makes it possible to rerun an experiment
+	with realistic input without a participant, e.g. for regression or soak testing.
+
+	Events are recorded when they are stored in the input devices (i.e. during CX_InputManager::pollEvents() or
+	when appendEvent() is called), so events are recorded even if user code never looks at them. This includes events
+	read by CX_EvdevInput. Events that are being replayed by a CX_InputReplayer are not recorded.
+
+	\code{.cpp}
+	CX_InputRecorder recorder;
+	CX_InputRecorder::Configuration config;
+	config.filename = "logfiles/input_" + Clock.getDateTimeString() + ".cxir";
+	recorder.setup(config);
+
+	// run the experiment...
+
+	recorder.stop();
+	\endcode
+
+	\ingroup inputDevices
+	*/
+	class CX_InputRecorder {
+	public:
+
+		struct Configuration {
+			Configuration(void) :
+				inputManager(nullptr),
+				filename(""),
+				recordKeyboard(true),
+				recordMouse(true),
+				recordJoystick(true)
+			{}
+
+			/*! \brief The input manager to record from. If `nullptr`, CX::Instances::Input is used. */
+			CX_InputManager* inputManager;
+
+			/*! \brief The file to write to. The file is overwritten. Relative paths are relative to the data directory. */
+			std::string filename;
+
+			bool recordKeyboard; //!< If `true`, keyboard events are recorded.
+			bool recordMouse; //!< If `true`, mouse events are recorded.
+			bool recordJoystick; //!< If `true`, joystick events are recorded.
+		};
+
+		CX_InputRecorder(void);
+		~CX_InputRecorder(void);
+
+		bool setup(const Configuration& config);
+		Configuration getConfiguration(void);
+
+		void stop(void);
+		bool isRecording(void);
+
+		uint64_t getRecordedEventCount(void);
+
+	private:
+
+		std::recursive_mutex _mutex;
+		Configuration _config;
+		CX_InputManager* _manager;
+
+		std::ofstream _file;
+		uint64_t _recordedEvents;
+		CX_Millis _startTime;
+
+		void _record(const CX_Keyboard::Event& ev);
+		void _record(const CX_Mouse::Event& ev);
+		void _record(const CX_Joystick::Event& ev);
+	};
+
+	/*! This class plays back input recorded with CX_InputRecorder. The recorded events are added to the input devices
+	of a CX_InputManager with appendEvent() when CX_InputManager::pollEvents() is called, so code that uses the input devices
+	in the normal way receives them.
+
+	By default, each event is added when as much time has passed since setup() as had passed since the start of the
+	recording when the event was recorded. The timestamps of the events are shifted by the same amount, so they can
+	be compared to CX_Clock::now() as usual. Alternatively, all of the events can be added as fast as possible
+	(see `Configuration::realTime`).
+
+	The keyboard and mouse must be enabled (see CX_InputManager::setup()) for their events to be kept by
+	CX_InputManager::pollEvents(). Joystick events are only replayed if the joystick has been set up and has enough
+	axes and buttons for the events.
+
+	\code{.cpp}
+	Input.setup(true, true);
+
+	CX_InputReplayer replayer;
+	CX_InputReplayer::Configuration config;
+	config.filename = "logfiles/input_session3.cxir";
+	replayer.setup(config);
+
+	// Run the experiment as usual: the recorded responses arrive through Input.
+	\endcode
+
+	\ingroup inputDevices
+	*/
+	class CX_InputReplayer {
+	public:
+
+		struct Configuration {
+			Configuration(void) :
+				inputManager(nullptr),
+				filename(""),
+				realTime(true),
+				replayKeyboard(true),
+				replayMouse(true),
+				replayJoystick(true)
+			{}
+
+			/*! \brief The input manager to add the events to. If `nullptr`, CX::Instances::Input is used. */
+			CX_InputManager* inputManager;
+
+			/*! \brief The recording to replay. Relative paths are relative to the data directory. */
+			std::string filename;
+
+			/*! \brief If `true`, events are added at the same relative times as when they were recorded. If `false`, all of the
+			events are added the next time CX_InputManager::pollEvents() is called, but their timestamps keep the recorded spacing. */
+			bool realTime;
+
+			bool replayKeyboard; //!< If `true`, keyboard events are replayed.
+			bool replayMouse; //!< If `true`, mouse events are replayed.
+			bool replayJoystick; //!< If `true`, joystick events are replayed.
+		};
+
+		CX_InputReplayer(void);
+		~CX_InputReplayer(void);
+
+		bool setup(const Configuration& config);
+		Configuration getConfiguration(void);
+
+		void stop(void);
+		bool isReplaying(void);
+
+		size_t getEventCount(void);
+		size_t getRemainingEventCount(void);
+		CX_Millis getDuration(void);
+
+	private:
+
+		struct Record {
+			uint8_t device; // Which of the events is used
+			CX_Millis time; // Relative to the start of the recording
+			CX_Keyboard::Event keyboard;
+			CX_Mouse::Event mouse;
+			CX_Joystick::Event joystick;
+		};
+
+		std::recursive_mutex _mutex;
+		Configuration _config;
+		CX_InputManager* _manager;
+
+		std::vector<Record> _records;
+		size_t _nextRecord;
+		CX_Millis _startTime;
+
+		bool _load(std::string filename);
+		void _injectEvents(void); // Called by CX_InputManager::pollEvents()
+	};
+
+}
@@ -2,15 +2,30 @@
 
 #include "ofAppGLFWWindow.h"
 
+#ifdef TARGET_LINUX
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <linux/joystick.h>
+#endif
+
+#include "CX_Logger.h"
+
 namespace CX {
 
 CX_Joystick::CX_Joystick (void) :
     _joystickIndex(-1),
-	_joystickName("unnamed")
+	_joystickName("unnamed"),
+	_joystickEvents(1024),
+	_droppedEvents(0),
+	_pollingThreadDevice(-1)
 {
 }
 
 CX_Joystick::~CX_Joystick (void) {
+	_stopPollingThread();
 }
 
 /*!
@@ -65,12 +80,36 @@ int CX_Joystick::getJoystickIndex(void) {
 
 /*! Check to see if there are any new joystick events. If there are new events,
 they can be accessed with availableEvents() and getNextEvent().
+
+If the input polling thread of a CX_InputManager is polling this joystick (see CX_InputManager::startPollingThread()),
+this takes the events that the thread has received instead of polling the joystick.
 \return True if there are new events.*/
 bool CX_Joystick::pollEvents (void) {
 	if (_joystickIndex == -1) {
 		return false;
 	}
 
+	if (_pollingThreadEvents != nullptr) {
+		CX_Joystick::Event ev;
+		while (_pollingThreadEvents->pop(ev)) {
+			_storeEvent(ev);
+		}
+	} else {
+		_readEvents(_axisPositions, _buttonStates, _lastEventPollTime, [this](const CX_Joystick::Event& ev) {
+			_pushEvent(ev);
+		});
+	}
+
+	if (!_joystickEvents.empty()) {
+		return true;
+	}
+	return false;
+}
+
+// Compares the current joystick state to `axisPositions` and `buttonStates`, updates them, and gives an event for each change to `sink`.
+void CX_Joystick::_readEvents(std::vector<float>& axisPositions, std::vector<unsigned char>& buttonStates, CX_Millis& lastPollTime,
+							  std::function<void(const CX_Joystick::Event&)> sink)
+{
 	int axisCount = 0;
 	const float *axes = glfwGetJoystickAxes(_joystickIndex, &axisCount);
 
@@ -79,9 +118,9 @@ bool CX_Joystick::pollEvents (void) {
 
 	CX_Millis pollTime = CX::Instances::Clock.now();
 
-	if ((unsigned int)axisCount == _axisPositions.size()) {
+	if ((unsigned int)axisCount == axisPositions.size()) {
 		for (unsigned int i = 0; i < (unsigned int)axisCount; i++) {
-			if (_axisPositions[i] != axes[i]) {
+			if (axisPositions[i] != axes[i]) {
 				CX_Joystick::Event ev;
 
 				ev.type = CX_Joystick::EventType::AxisPositionChange;
@@ -89,18 +128,18 @@ bool CX_Joystick::pollEvents (void) {
 				ev.axisPosition = axes[i];
 
 				ev.time = pollTime;
-				ev.uncertainty = ev.time - _lastEventPollTime;
+				ev.uncertainty = ev.time - lastPollTime;
 
-				_joystickEvents.push_back(ev);
+				sink(ev);
 
-				_axisPositions[i] = axes[i];
+				axisPositions[i] = axes[i];
 			}
 		}
 	}
 
-	if ((unsigned int)buttonCount == _buttonStates.size()) {
+	if ((unsigned int)buttonCount == buttonStates.size()) {
 		for (unsigned int i = 0; i < (unsigned int)buttonCount; i++) {
-			if (_buttonStates[i] != buttons[i]) {
+			if (buttonStates[i] != buttons[i]) {
 				CX_Joystick::Event ev;
 
 				//I'm just guessing about button state here. 1 might be Pressed, but it could also be UNDEFINED_BUTTON.
@@ -114,21 +153,146 @@ bool CX_Joystick::pollEvents (void) {
 				ev.buttonState = buttons[i];
 
 				ev.time = pollTime;
-				ev.uncertainty = ev.time - _lastEventPollTime;
+				ev.uncertainty = ev.time - lastPollTime;
 
-				_joystickEvents.push_back( ev );
+				sink(ev);
 
-				_buttonStates[i] = buttons[i];
+				buttonStates[i] = buttons[i];
 			}
 		}
 	}
 
-	_lastEventPollTime = pollTime;
+	lastPollTime = pollTime;
+}
 
-	if (_joystickEvents.size() > 0) {
-		return true;
+void CX_Joystick::_storeEvent(const CX_Joystick::Event& ev) {
+	if (ev.type == CX_Joystick::AxisPositionChange) {
+		_axisPositions[ev.axisIndex] = ev.axisPosition;
+	} else {
+		_buttonStates[ev.buttonIndex] = ev.buttonState;
+	}
+
+	_pushEvent(ev);
+}
+
+void CX_Joystick::_pushEvent(const CX_Joystick::Event& ev) {
+	if (_eventObserver) {
+		_eventObserver(ev);
+	}
+
+	if (!_joystickEvents.push_back(ev)) {
+		if (_droppedEvents++ == 0) {
+			Instances::Log.warning("CX_Joystick") << "The event queue is full (capacity " << _joystickEvents.capacity() <<
+				"), so events are being dropped. See setEventQueueCapacity().";
+		}
 	}
+}
+
+// Opens the joystick device for the polling thread. GLFW numbers Linux joysticks by their /dev/input/jsN device,
+// so this is the same joystick that GLFW reads at _joystickIndex.
+bool CX_Joystick::_startPollingThread(size_t queueCapacity) {
+#ifdef TARGET_LINUX
+	std::string path = "/dev/input/js" + ofToString(_joystickIndex);
+	int fd = open(path.c_str(), O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+	if (fd < 0) {
+		Instances::Log.error("CX_Joystick") << "Could not open the joystick device \"" << path << "\" for the input polling thread: " <<
+			std::strerror(errno);
+		return false;
+	}
+	_pollingThreadDevice = fd;
+
+	// The thread works on its own copy of the state so that it never touches the state seen by user code.
+	_pollingThreadAxisPositions = _axisPositions;
+	_pollingThreadButtonStates = _buttonStates;
+	_pollingThreadLastPollTime = _lastEventPollTime;
+
+	_pollingThreadEvents = std::make_shared<Util::SpscQueue<CX_Joystick::Event>>(queueCapacity);
+	return true;
+#else
 	return false;
+#endif
+}
+
+void CX_Joystick::_stopPollingThread(void) {
+#ifdef TARGET_LINUX
+	if (_pollingThreadDevice >= 0) {
+		close(_pollingThreadDevice);
+		_pollingThreadDevice = -1;
+	}
+#endif
+	_pollingThreadEvents = nullptr;
+}
+
+// Called on the polling thread, so it must not use GLFW. Returns the number of events that were dropped because the queue was full.
+uint64_t CX_Joystick::_pollOnPollingThread(void) {
+	uint64_t dropped = 0;
+
+#ifdef TARGET_LINUX
+	if (_pollingThreadDevice < 0) {
+		return 0;
+	}
+
+	auto push = [&](CX_Joystick::Event& ev, CX_Millis pollTime) {
+		ev.time = pollTime;
+		ev.uncertainty = pollTime - _pollingThreadLastPollTime;
+		if (!_pollingThreadEvents->push(ev)) {
+			dropped++;
+		}
+	};
+
+	js_event buffer[64];
+	while (true) {
+		ssize_t bytes = read(_pollingThreadDevice, buffer, sizeof(buffer));
+
+		// Like _readEvents(), events are timestamped after reading.
+		CX_Millis pollTime = CX::Instances::Clock.now();
+
+		size_t count = bytes > 0 ? (size_t)bytes / sizeof(js_event) : 0;
+		for (size_t i = 0; i < count; i++) {
+			const js_event& jse = buffer[i];
+
+			// The initial state is reported with JS_EVENT_INIT. It only makes events if it differs from the known state.
+			unsigned char type = jse.type & ~JS_EVENT_INIT;
+
+			if (type == JS_EVENT_AXIS && jse.number < _pollingThreadAxisPositions.size()) {
+				float position = jse.value / 32767.0f; // The same scaling as GLFW
+				if (_pollingThreadAxisPositions[jse.number] != position) {
+					CX_Joystick::Event ev;
+					ev.type = CX_Joystick::EventType::AxisPositionChange;
+					ev.axisIndex = jse.number;
+					ev.axisPosition = position;
+					push(ev, pollTime);
+
+					_pollingThreadAxisPositions[jse.number] = position;
+				}
+			} else if (type == JS_EVENT_BUTTON && jse.number < _pollingThreadButtonStates.size()) {
+				unsigned char state = jse.value ? GLFW_PRESS : GLFW_RELEASE;
+				if (_pollingThreadButtonStates[jse.number] != state) {
+					CX_Joystick::Event ev;
+					ev.type = (state == GLFW_PRESS) ? CX_Joystick::EventType::ButtonPress : CX_Joystick::EventType::ButtonRelease;
+					ev.buttonIndex = jse.number;
+					ev.buttonState = state;
+					push(ev, pollTime);
+
+					_pollingThreadButtonStates[jse.number] = state;
+				}
+			}
+		}
+
+		if (bytes < (ssize_t)sizeof(buffer)) {
+			if (bytes < 0 && errno != EAGAIN && errno != EINTR) {
+				Instances::Log.error("CX_Joystick") << "Reading the joystick device failed: " << std::strerror(errno) <<
+					". The polling thread stopped reading it.";
+				close(_pollingThreadDevice);
+				_pollingThreadDevice = -1;
+			}
+			_pollingThreadLastPollTime = pollTime;
+			break;
+		}
+	}
+#endif
+
+	return dropped;
 }
 
 /*! Get the number of available events for this input device. 
@@ -156,11 +320,35 @@ void CX_Joystick::clearEvents (void) {
 /*! \brief Return a vector containing a copy of the currently stored events. The events stored by
 the input device are unchanged. The first element of the vector is the oldest event. */
 std::vector<CX_Joystick::Event> CX_Joystick::copyEvents(void) {
-	std::vector<CX_Joystick::Event> copy(_joystickEvents.size());
-	for (unsigned int i = 0; i < _joystickEvents.size(); i++) {
-		copy[i] = _joystickEvents.at(i);
-	}
-	return copy;
+	return _joystickEvents.toVector();
+}
+
+/*! Call a function with each of the currently stored events, from oldest to newest, without copying or
+removing them. This is faster than copyEvents() when many events are stored.
+\param f The function to call. It must not add or remove events from this joystick. */
+void CX_Joystick::forEachEvent(std::function<void(const CX_Joystick::Event&)> f) const {
+	_joystickEvents.forEach(f);
+}
+
+/*! Set the number of events that can be stored before events are dropped or more memory is allocated.
+Storing events does not allocate memory until the capacity is reached.
+\param capacity The number of events. This is rounded up to a power of 2.
+\param policy What to do when an event arrives while the queue is full. With Util::OverflowPolicy::Grow
+(the default), no events are lost. With the other policies, dropped events are counted (see getDroppedEventCount()).
+If `capacity` is less than the number of stored events, the oldest events are discarded. */
+void CX_Joystick::setEventQueueCapacity(size_t capacity, Util::OverflowPolicy policy) {
+	_joystickEvents.setCapacity(capacity);
+	_joystickEvents.setOverflowPolicy(policy);
+}
+
+/*! \brief Returns the number of events that can be stored before the overflow policy takes effect. */
+size_t CX_Joystick::getEventQueueCapacity(void) const {
+	return _joystickEvents.capacity();
+}
+
+/*! \brief Returns the number of events that have been dropped because the event queue was full. */
+uint64_t CX_Joystick::getDroppedEventCount(void) const {
+	return _droppedEvents;
 }
 
 /*! This function returns in the current positions of the joystick axes.
@@ -226,7 +414,7 @@ void CX_Joystick::appendEvent(CX_Joystick::Event ev) {
 		_buttonStates[ev.buttonIndex] = 0;
 	}
 
-	_joystickEvents.push_back(ev);
+	_pushEvent(ev);
 }
 
 static const std::string dlm = ", ";
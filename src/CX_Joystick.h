@@ -1,13 +1,17 @@
 #pragma once
 
-#include <deque>
 #include <string>
 #include <vector>
+#include <memory>
+#include <functional>
 
 #include "CX_Clock.h"
+#include "CX_Utilities.h"
 
 namespace CX {
 
+	class CX_InputManager;
+
 	/*! This class manages a joystick that is attached to the system (if any). If more than one joystick is needed
 	for the experiment, you can create more instances of CX_Joystick other than the one in CX::Instances::Input. Unlike
 	CX_Keyboard and CX_Mouse, CX_Joystick does not need to be in a CX_InputManager to work.
@@ -53,6 +57,7 @@ namespace CX {
 		CX_Joystick::Event getNextEvent(void);
 
 		std::vector<CX_Joystick::Event> copyEvents(void);
+		void forEachEvent(std::function<void(const CX_Joystick::Event&)> f) const;
 		void clearEvents(void);
 
 		std::vector<float> getAxisPositions(void);
@@ -60,16 +65,45 @@ namespace CX {
 
 		void appendEvent(CX_Joystick::Event ev);
 
+		void setEventQueueCapacity(size_t capacity, Util::OverflowPolicy policy = Util::OverflowPolicy::Grow);
+		size_t getEventQueueCapacity(void) const;
+		uint64_t getDroppedEventCount(void) const;
+
 	private:
 		int _joystickIndex;
 		std::string _joystickName;
 
-		std::deque<CX_Joystick::Event> _joystickEvents;
+		Util::RingBuffer<CX_Joystick::Event> _joystickEvents;
+		uint64_t _droppedEvents;
+		void _pushEvent(const CX_Joystick::Event& ev);
+
+		// Called with every event that is stored (used by CX_InputRecorder)
+		friend class CX_InputRecorder;
+		friend class CX_InputReplayer;
+		std::function<void(const CX_Joystick::Event&)> _eventObserver;
 
 		std::vector<float> _axisPositions;
 		std::vector<unsigned char> _buttonStates;
 
 		CX_Millis _lastEventPollTime;
+
+		void _readEvents(std::vector<float>& axisPositions, std::vector<unsigned char>& buttonStates, CX_Millis& lastPollTime,
+						 std::function<void(const CX_Joystick::Event&)> sink);
+		void _storeEvent(const CX_Joystick::Event& ev);
+
+		// Used by the input polling thread of CX_InputManager. GLFW may only be used on the main thread,
+		// so the thread reads the Linux joystick device instead.
+		friend class CX_InputManager;
+
+		int _pollingThreadDevice;
+		std::shared_ptr<Util::SpscQueue<CX_Joystick::Event>> _pollingThreadEvents;
+		std::vector<float> _pollingThreadAxisPositions;
+		std::vector<unsigned char> _pollingThreadButtonStates;
+		CX_Millis _pollingThreadLastPollTime;
+
+		bool _startPollingThread(size_t queueCapacity);
+		void _stopPollingThread(void);
+		uint64_t _pollOnPollingThread(void);
 	};
 
 	std::ostream& operator<< (std::ostream& os, const CX_Joystick::Event& ev);
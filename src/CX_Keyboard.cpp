@@ -7,7 +7,10 @@ namespace CX {
 CX_Keyboard::CX_Keyboard(CX_InputManager* owner) :
 	_owner(owner),
 	_enabled(false),
-	_listeningForEvents(false)
+	_keyEvents(256),
+	_droppedEvents(0),
+	_listeningForEvents(false),
+	_glfwEventsUsed(true)
 {
 }
 
@@ -24,12 +27,13 @@ void CX_Keyboard::enable(bool enable) {
 		return;
 	}
 
-	_listenForEvents(enable);
+	_listenForEvents(enable && _glfwEventsUsed);
 
 	_enabled = enable;
 	
 	clearEvents();
 	_heldKeys.clear();
+	_sequenceStates.clear();
 }
 
 /*! \brief Returns `true` if the keyboard is enabled. */
@@ -62,18 +66,52 @@ void CX_Keyboard::clearEvents(void) {
 /*! \brief Return a vector containing a copy of the currently stored events. The events stored by
 the input device are unchanged. The first element of the vector is the oldest event. */
 std::vector<CX_Keyboard::Event> CX_Keyboard::copyEvents(void) {
-	std::vector<CX_Keyboard::Event> copy(_keyEvents.size());
-	for (unsigned int i = 0; i < _keyEvents.size(); i++) {
-		copy[i] = _keyEvents.at(i);
+	return _keyEvents.toVector();
+}
+
+/*! Call a function with each of the currently stored events, from oldest to newest, without copying or
+removing them. This is faster than copyEvents() when many events are stored.
+\param f The function to call. It must not add or remove events from this keyboard.
+
+\code{.cpp}
+int keypresses = 0;
+Input.Keyboard.forEachEvent([&](const CX_Keyboard::Event& ev) {
+	if (ev.type == CX_Keyboard::Pressed) {
+		keypresses++;
 	}
-	return copy;
+});
+\endcode
+*/
+void CX_Keyboard::forEachEvent(std::function<void(const CX_Keyboard::Event&)> f) const {
+	_keyEvents.forEach(f);
+}
+
+/*! Set the number of events that can be stored before events are dropped or more memory is allocated.
+Storing events does not allocate memory until the capacity is reached.
+\param capacity The number of events. This is rounded up to a power of 2.
+\param policy What to do when an event arrives while the queue is full. With Util::OverflowPolicy::Grow
+(the default), no events are lost. With the other policies, dropped events are counted (see getDroppedEventCount()).
+If `capacity` is less than the number of stored events, the oldest events are discarded. */
+void CX_Keyboard::setEventQueueCapacity(size_t capacity, Util::OverflowPolicy policy) {
+	_keyEvents.setCapacity(capacity);
+	_keyEvents.setOverflowPolicy(policy);
+}
+
+/*! \brief Returns the number of events that can be stored before the overflow policy takes effect. */
+size_t CX_Keyboard::getEventQueueCapacity(void) const {
+	return _keyEvents.capacity();
+}
+
+/*! \brief Returns the number of events that have been dropped because the event queue was full. */
+uint64_t CX_Keyboard::getDroppedEventCount(void) const {
+	return _droppedEvents;
 }
 
 /*! This function checks to see if the given key is held, which means a keypress has been received, but not a key release.
 \param key The character literal for the key you are interested in or special key code from CX::Keycode. 
 \return `true` if the given key is held, `false` otherwise. */
 bool CX_Keyboard::isKeyHeld(int key) const {
-	return _heldKeys.find(key) != _heldKeys.end();
+	return _heldKeys.contains(key);
 }
 
 
@@ -125,16 +163,17 @@ CX_Keyboard::Event CX_Keyboard::waitForKeypress(std::vector<int> keys, bool clea
 			continue;
 		}
 
-		for (auto it = _keyEvents.begin(); it != _keyEvents.end(); it++) {
-			if (it->type == CX_Keyboard::Pressed) {
+		for (size_t i = 0; i < _keyEvents.size(); i++) {
+			const CX_Keyboard::Event& ev = _keyEvents[i];
+			if (ev.type == CX_Keyboard::Pressed) {
 				
-				bool keyFound = std::find(keys.begin(), keys.end(), it->key) != keys.end();
+				bool keyFound = std::find(keys.begin(), keys.end(), ev.key) != keys.end();
 
 				if (minus1Found || keyFound) {
-					rval = *it;
+					rval = ev;
 
 					if (eraseEvent) {
-						_keyEvents.erase(it);
+						_keyEvents.erase(i);
 					}
 
 					waiting = false;
@@ -161,13 +200,20 @@ This is an exact test: No extraneous keys may be held.
 Returns `true` if all of the keys in `chord` are held and no additional keys are held.
 */
 bool CX_Keyboard::isChordHeld(const std::vector<int>& chord) const {
-	if (chord.empty()) {
+	if (chord.empty() || chord.size() < _heldKeys.size()) {
 		return false;
 	}
 
-	std::set<int> chordSet(chord.begin(), chord.end());
+	for (int key : chord) {
+		if (!_heldKeys.contains(key)) {
+			return false;
+		}
+	}
 
-	return chordSet == _heldKeys;
+	// All of the chord keys are held, so the chord matches exactly if it has as many unique keys as are held.
+	std::vector<int> unique = chord;
+	std::sort(unique.begin(), unique.end());
+	return (size_t)(std::unique(unique.begin(), unique.end()) - unique.begin()) == _heldKeys.size();
 }
 
 /*! Appends a keyboard event to the event queue without any modification
@@ -186,7 +232,25 @@ void CX_Keyboard::appendEvent(CX_Keyboard::Event ev) {
 		_heldKeys.erase(ev.key);
 	}
 
-	_keyEvents.push_back(ev);
+	_pushEvent(ev);
+}
+
+void CX_Keyboard::_pushEvent(const CX_Keyboard::Event& ev) {
+	if (_eventObserver) {
+		_eventObserver(ev);
+	}
+
+	if (!_keyEvents.push_back(ev)) {
+		if (_droppedEvents++ == 0) {
+			Instances::Log.warning("CX_Keyboard") << "The event queue is full (capacity " << _keyEvents.capacity() <<
+				"), so events are being dropped. See setEventQueueCapacity().";
+		}
+	}
+}
+
+void CX_Keyboard::_useGlfwEvents(bool use) {
+	_glfwEventsUsed = use;
+	_listenForEvents(_enabled && _glfwEventsUsed);
 }
 
 void CX_Keyboard::_listenForEvents(bool listen) {
@@ -208,12 +272,7 @@ void CX_Keyboard::_listenForEvents(bool listen) {
 
 void CX_Keyboard::_keyPressHandler(ofKeyEventArgs &a) {
 	CX_Keyboard::Event ev;
-	
-	if (this->isKeyHeld(a.keycode)) {
-		ev.type = CX_Keyboard::Repeat;
-	} else {
-		ev.type = CX_Keyboard::Pressed;
-	}
+	ev.type = CX_Keyboard::Pressed; // Changed to Repeat by _storeEvent() if the key is already held
 
 	ev.codes = Keycodes(a.key, a.keycode, a.scancode, a.codepoint);
 	
@@ -240,7 +299,6 @@ void CX_Keyboard::_keyRepeatHandler(CX::Private::CX_KeyRepeatEventArgs_t &a) {
 
 void CX_Keyboard::_keyEventHandler(CX_Keyboard::Event &ev) {
 	ev.time = CX::Instances::Clock.now();
-	ev.uncertainty = ev.time - _lastEventPollTime;
 
 	ev.key = ev.codes.glfw;
 
@@ -253,6 +311,15 @@ void CX_Keyboard::_keyEventHandler(CX_Keyboard::Event &ev) {
 			//OF_KEY_RIGHT_X or OF_KEY_LEFT_X. This ignores the generic version.
 	}
 
+	ev.uncertainty = ev.time - _lastEventPollTime;
+	_storeEvent(ev);
+}
+
+void CX_Keyboard::_storeEvent(CX_Keyboard::Event& ev) {
+	if (ev.type == CX_Keyboard::Pressed && isKeyHeld(ev.key)) {
+		ev.type = CX_Keyboard::Repeat;
+	}
+
 	switch (ev.type) {
 	case CX_Keyboard::Pressed:
 		_heldKeys.insert(ev.key);
@@ -265,9 +332,9 @@ void CX_Keyboard::_keyEventHandler(CX_Keyboard::Event &ev) {
 		break;
 	}
 
-	_checkForShortcuts();
+	_checkForShortcuts(ev);
 
-	_keyEvents.push_back(ev);
+	_pushEvent(ev);
 }
 
 /*! Add a keyboard shortcut chord (1 or more keys held at once) and the function that will be called
@@ -329,10 +396,56 @@ void CX_Keyboard::addShortcut(std::string name, const std::vector<int>& chord, s
 	this->enable(true); // Automatically enable keyboard
 
 	KeyboardShortcut ks;
-	ks.chord.insert(chord.begin(), chord.end());
+	ks.keys = chord;
+	std::sort(ks.keys.begin(), ks.keys.end());
+	ks.keys.erase(std::unique(ks.keys.begin(), ks.keys.end()), ks.keys.end());
 	ks.callback = callback;
 
+	if (ks.keys.empty()) {
+		Instances::Log.warning("CX_Keyboard") << "addShortcut(): The chord for shortcut \"" << name << "\" is empty. The shortcut was not added.";
+		return;
+	}
+
 	_shortcuts[name] = ks;
+	_rebuildShortcutIndex();
+}
+
+/*! Add a keyboard shortcut that is triggered by pressing keys one after another, in order, like "G, G" or
+"Up, Up, Down, Down". Each key press must follow the previous one within `timeout`. Key releases and key repeats
+are ignored, but pressing any other key in the middle of the sequence starts it over.
+
+Like chord shortcuts (see addShortcut()), sequences are checked for when `CX_InputManager::pollEvents()` is called.
+The time needed to check for shortcuts does not depend on the number of shortcuts.
+
+\param name The name of the shortcut. Each shortcut (chord or sequence) must have a unique name.
+\param keys The keys that must be pressed, in order.
+\param timeout The longest time allowed between consecutive key presses in the sequence.
+\param callback A function that takes and returns `void`.
+
+\note The keyboard is automatically enabled.
+
+\code{.cpp}
+Input.Keyboard.addShortcutSequence("skipBlock", { 'S', 'K', 'I', 'P' }, CX_Millis(500), [&]() {
+	skipBlock = true;
+});
+\endcode
+*/
+void CX_Keyboard::addShortcutSequence(std::string name, const std::vector<int>& keys, CX_Millis timeout, std::function<void(void)> callback) {
+	this->enable(true); // Automatically enable keyboard
+
+	if (keys.empty()) {
+		Instances::Log.warning("CX_Keyboard") << "addShortcutSequence(): The sequence for shortcut \"" << name << "\" is empty. The shortcut was not added.";
+		return;
+	}
+
+	KeyboardShortcut ks;
+	ks.isSequence = true;
+	ks.keys = keys;
+	ks.timeout = timeout;
+	ks.callback = callback;
+
+	_shortcuts[name] = ks;
+	_rebuildShortcutIndex();
 }
 
 /*! Removes a shortcut by name.
@@ -340,11 +453,13 @@ void CX_Keyboard::addShortcut(std::string name, const std::vector<int>& chord, s
 */
 void CX_Keyboard::removeShortcut(std::string name) {
 	_shortcuts.erase(name);
+	_rebuildShortcutIndex();
 }
 
 /*! Clears all stored keyboard shortcuts. */
 void CX_Keyboard::clearShortcuts(void) {
 	_shortcuts.clear();
+	_rebuildShortcutIndex();
 }
 
 /*! Get a vector of the names of shortcuts.
@@ -358,12 +473,169 @@ std::vector<std::string> CX_Keyboard::getShortcutNames(void) const {
 	return names;
 }
 
-void CX_Keyboard::_checkForShortcuts(void) {
+void CX_Keyboard::_rebuildShortcutIndex(void) {
+	_chordIndex.clear();
+	_sequenceTrie.assign(1, SequenceNode());
+	_sequenceStates.clear();
+
 	for (const std::pair<std::string, KeyboardShortcut>& ks : _shortcuts) {
-		if (ks.second.chord == _heldKeys) {
-			ks.second.callback();
+		if (!ks.second.isSequence) {
+			uint64_t hash = 0;
+			for (int key : ks.second.keys) {
+				hash ^= HeldKeySet::keyHash(key);
+			}
+			_chordIndex[hash].push_back(ks.first);
+			continue;
+		}
+
+		size_t node = 0;
+		for (int key : ks.second.keys) {
+			_sequenceTrie[node].timeout = std::max(_sequenceTrie[node].timeout, ks.second.timeout);
+
+			auto child = _sequenceTrie[node].children.find(key);
+			if (child != _sequenceTrie[node].children.end()) {
+				node = child->second;
+			} else {
+				_sequenceTrie.push_back(SequenceNode());
+				_sequenceTrie[node].children[key] = _sequenceTrie.size() - 1;
+				node = _sequenceTrie.size() - 1;
+			}
+		}
+		_sequenceTrie[node].completed.push_back(ks.first);
+	}
+}
+
+// Called after the held keys have been updated for `ev`. The work done does not depend on the number of shortcuts: 
+// Chords are looked up by the hash of the held keys and sequences advance through the trie.
+void CX_Keyboard::_checkForShortcuts(const CX_Keyboard::Event& ev) {
+	// Shortcut callbacks may add or remove shortcuts, so the names of the shortcuts to call are collected first
+	std::vector<std::string> triggered;
+
+	auto chords = _chordIndex.find(_heldKeys.hash());
+	if (chords != _chordIndex.end()) {
+		for (const std::string& name : chords->second) {
+			const KeyboardShortcut& ks = _shortcuts[name];
+			if (ks.keys.size() != _heldKeys.size()) {
+				continue;
+			}
+			bool held = true;
+			for (int key : ks.keys) {
+				held = held && _heldKeys.contains(key);
+			}
+			if (held) {
+				triggered.push_back(name);
+			}
 		}
 	}
+
+	if (ev.type == CX_Keyboard::Pressed && _sequenceTrie.size() > 1) {
+		std::vector<SequenceState> next;
+
+		// Every press can also start a sequence, which is the same as advancing from the root
+		SequenceState root;
+		root.node = 0;
+		root.lastPressTime = ev.time;
+		root.longestGap = 0;
+		_sequenceStates.push_back(root);
+
+		for (const SequenceState& state : _sequenceStates) {
+			const SequenceNode& node = _sequenceTrie[state.node];
+
+			CX_Millis gap = ev.time - state.lastPressTime;
+			if (gap > node.timeout) {
+				continue;
+			}
+
+			auto child = node.children.find(ev.key);
+			if (child == node.children.end()) {
+				continue;
+			}
+
+			SequenceState advanced;
+			advanced.node = child->second;
+			advanced.lastPressTime = ev.time;
+			advanced.longestGap = std::max(state.longestGap, gap);
+
+			for (const std::string& name : _sequenceTrie[advanced.node].completed) {
+				if (advanced.longestGap <= _shortcuts[name].timeout) {
+					triggered.push_back(name);
+				}
+			}
+
+			if (!_sequenceTrie[advanced.node].children.empty()) {
+				next.push_back(advanced);
+			}
+		}
+
+		_sequenceStates.swap(next);
+	}
+
+	for (const std::string& name : triggered) {
+		auto it = _shortcuts.find(name);
+		if (it != _shortcuts.end()) {
+			std::function<void(void)> callback = it->second.callback;
+			callback();
+		}
+	}
+}
+
+CX_Keyboard::HeldKeySet::HeldKeySet(void) :
+	_count(0),
+	_hash(0)
+{}
+
+// Returns true if the key was not already held
+bool CX_Keyboard::HeldKeySet::insert(int key) {
+	if (contains(key)) {
+		return false;
+	}
+
+	if (key >= 0 && key < BitsetKeys) {
+		_bits.set(key);
+	} else {
+		_otherKeys.insert(key);
+	}
+	_count++;
+	_hash ^= keyHash(key);
+	return true;
+}
+
+// Returns true if the key was held
+bool CX_Keyboard::HeldKeySet::erase(int key) {
+	if (!contains(key)) {
+		return false;
+	}
+
+	if (key >= 0 && key < BitsetKeys) {
+		_bits.reset(key);
+	} else {
+		_otherKeys.erase(key);
+	}
+	_count--;
+	_hash ^= keyHash(key);
+	return true;
+}
+
+bool CX_Keyboard::HeldKeySet::contains(int key) const {
+	if (key >= 0 && key < BitsetKeys) {
+		return _bits.test(key);
+	}
+	return _otherKeys.find(key) != _otherKeys.end();
+}
+
+void CX_Keyboard::HeldKeySet::clear(void) {
+	_bits.reset();
+	_otherKeys.clear();
+	_count = 0;
+	_hash = 0;
+}
+
+// The splitmix64 finalizer, which spreads the key over all bits so that XORed key hashes rarely collide
+uint64_t CX_Keyboard::HeldKeySet::keyHash(int key) {
+	uint64_t z = (uint64_t)(int64_t)key + 0x9E3779B97F4A7C15ULL;
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+	return z ^ (z >> 31);
 }
 
 
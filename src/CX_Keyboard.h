@@ -1,12 +1,17 @@
 #pragma once
 
-#include <deque>
 #include <set>
+#include <map>
+#include <bitset>
+#include <memory>
+#include <functional>
+#include <unordered_map>
 
 #include "ofEvents.h"
 
 #include "CX_Clock.h"
 #include "CX_Events.h"
+#include "CX_Utilities.h"
 
 #define GLFW_INCLUDE_NONE
 #include "GLFW/glfw3.h"
@@ -263,9 +268,16 @@ namespace CX {
 		CX_Keyboard::Event waitForKeypress(int key, bool clear = true, bool eraseEvent = false);
 		CX_Keyboard::Event waitForKeypress(std::vector<int> keys, bool clear = true, bool eraseEvent = false);
 
+		void forEachEvent(std::function<void(const CX_Keyboard::Event&)> f) const;
+
 		void appendEvent(CX_Keyboard::Event ev);
 
+		void setEventQueueCapacity(size_t capacity, Util::OverflowPolicy policy = Util::OverflowPolicy::Grow);
+		size_t getEventQueueCapacity(void) const;
+		uint64_t getDroppedEventCount(void) const;
+
 		void addShortcut(std::string name, const std::vector<int>& chord, std::function<void(void)> callback);
+		void addShortcutSequence(std::string name, const std::vector<int>& keys, CX_Millis timeout, std::function<void(void)> callback);
 		void removeShortcut(std::string name);
 		void clearShortcuts(void);
 		std::vector<std::string> getShortcutNames(void) const;
@@ -278,25 +290,91 @@ namespace CX {
 		bool _enabled;
 		CX_Millis _lastEventPollTime;
 
-		std::deque<CX_Keyboard::Event> _keyEvents;
+		Util::RingBuffer<CX_Keyboard::Event> _keyEvents;
+		uint64_t _droppedEvents;
+		void _pushEvent(const CX_Keyboard::Event& ev);
+
+		// Called with every event that is stored (used by CX_InputRecorder)
+		friend class CX_InputRecorder;
+		friend class CX_InputReplayer;
+		std::function<void(const CX_Keyboard::Event&)> _eventObserver;
+
+		// The set of held keys. An order-independent hash of the set is updated with each insertion and removal,
+		// so that the set can be matched against shortcut chords without comparing it to each chord.
+		class HeldKeySet {
+		public:
+			HeldKeySet(void);
+
+			bool insert(int key);
+			bool erase(int key);
+			bool contains(int key) const;
+			void clear(void);
+
+			size_t size(void) const { return _count; }
+			uint64_t hash(void) const { return _hash; }
+
+			static uint64_t keyHash(int key);
+
+		private:
+			static const int BitsetKeys = 512; // More than GLFW_KEY_LAST; other keys are stored in _otherKeys
+			std::bitset<BitsetKeys> _bits;
+			std::set<int> _otherKeys;
+			size_t _count;
+			uint64_t _hash;
+		};
 
-		std::set<int> _heldKeys;
+		HeldKeySet _heldKeys;
 
 		void _keyPressHandler(ofKeyEventArgs &a);
 		void _keyReleaseHandler(ofKeyEventArgs &a);
 		void _keyRepeatHandler(CX::Private::CX_KeyRepeatEventArgs_t &a);
 		void _keyEventHandler(CX_Keyboard::Event &a);
+		void _storeEvent(CX_Keyboard::Event& ev);
 
 		void _listenForEvents(bool listen);
 		bool _listeningForEvents;
 
+		// If false, events come from another source (e.g. CX_EvdevInput) instead of GLFW
+		friend class CX_EvdevInput;
+		bool _glfwEventsUsed;
+		void _useGlfwEvents(bool use);
+
 		struct KeyboardShortcut {
-			std::set<int> chord;
+			KeyboardShortcut(void) :
+				isSequence(false),
+				timeout(0)
+			{}
+
+			bool isSequence;
+			std::vector<int> keys; // The unique keys of a chord, or the keys of a sequence in order
+			CX_Millis timeout; // The longest time between the key presses of a sequence
 			std::function<void(void)> callback;
 		};
 
 		std::map<std::string, KeyboardShortcut> _shortcuts;
-		void _checkForShortcuts(void);
+
+		// Chord shortcuts, indexed by the hash of their key sets
+		std::unordered_map<uint64_t, std::vector<std::string>> _chordIndex;
+
+		// Sequence shortcuts are stored in a trie of key presses. Node 0 is the root.
+		struct SequenceNode {
+			std::unordered_map<int, size_t> children; // key -> node index
+			CX_Millis timeout; // The longest timeout of the sequences that continue past this node
+			std::vector<std::string> completed; // The sequences that end at this node
+		};
+
+		// A partially matched sequence
+		struct SequenceState {
+			size_t node;
+			CX_Millis lastPressTime;
+			CX_Millis longestGap; // The longest time between presses so far
+		};
+
+		std::vector<SequenceNode> _sequenceTrie;
+		std::vector<SequenceState> _sequenceStates;
+
+		void _rebuildShortcutIndex(void);
+		void _checkForShortcuts(const CX_Keyboard::Event& ev);
 
 	};
 
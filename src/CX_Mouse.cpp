@@ -11,7 +11,11 @@ namespace CX {
 CX_Mouse::CX_Mouse(CX_InputManager* owner) :
 	_owner(owner),
 	_enabled(false),
+	_mouseEvents(4096),
+	_droppedEvents(0),
+	_coalesceMovedEvents(false),
 	_listeningForEvents(false),
+	_glfwEventsUsed(true),
 	_cursorPos(ofPoint(0,0))
 {
 }
@@ -29,7 +33,7 @@ void CX_Mouse::enable(bool enable) {
 		return;
 	}
 
-	_listenForEvents(enable);
+	_listenForEvents(enable && _glfwEventsUsed);
 
 	_enabled = enable;
 	
@@ -68,7 +72,61 @@ void CX_Mouse::clearEvents(void) {
 /*! \brief Return a vector containing a copy of the currently stored events. The events stored by
 the input device are unchanged. The first element of the vector is the oldest event. */
 std::vector<CX_Mouse::Event> CX_Mouse::copyEvents(void) {
-	return std::vector<CX_Mouse::Event>(_mouseEvents.begin(), _mouseEvents.end());
+	return _mouseEvents.toVector();
+}
+
+/*! Call a function with each of the currently stored events, from oldest to newest, without copying or
+removing them. This is faster than copyEvents() when many events are stored, e.g. when tracking the mouse.
+\param f The function to call. It must not add or remove events from this mouse.
+
+\code{.cpp}
+std::vector<ofPoint> path;
+Input.Mouse.forEachEvent([&](const CX_Mouse::Event& ev) {
+	if (ev.type == CX_Mouse::Moved || ev.type == CX_Mouse::Dragged) {
+		path.push_back(ofPoint(ev.x, ev.y));
+	}
+});
+\endcode
+*/
+void CX_Mouse::forEachEvent(std::function<void(const CX_Mouse::Event&)> f) const {
+	_mouseEvents.forEach(f);
+}
+
+/*! Set the number of events that can be stored before events are dropped or more memory is allocated.
+Storing events does not allocate memory until the capacity is reached. A mouse with a high polling rate
+can produce 1000 or more events per second, so size the queue for the longest interval between calls to clearEvents()
+or getNextEvent().
+\param capacity The number of events. This is rounded up to a power of 2.
+\param policy What to do when an event arrives while the queue is full. With Util::OverflowPolicy::Grow
+(the default), no events are lost. With the other policies, dropped events are counted (see getDroppedEventCount()).
+If `capacity` is less than the number of stored events, the oldest events are discarded. */
+void CX_Mouse::setEventQueueCapacity(size_t capacity, Util::OverflowPolicy policy) {
+	_mouseEvents.setCapacity(capacity);
+	_mouseEvents.setOverflowPolicy(policy);
+}
+
+/*! \brief Returns the number of events that can be stored before the overflow policy takes effect. */
+size_t CX_Mouse::getEventQueueCapacity(void) const {
+	return _mouseEvents.capacity();
+}
+
+/*! \brief Returns the number of events that have been dropped because the event queue was full. */
+uint64_t CX_Mouse::getDroppedEventCount(void) const {
+	return _droppedEvents;
+}
+
+/*! If coalescing is enabled, a CX_Mouse::Moved event that is received directly after another Moved event replaces
+that event instead of being stored separately, so only the latest position (and time) of each uninterrupted movement
+is kept. This greatly reduces the number of stored events if only the cursor position when something happens is
+of interest, but should not be used if the path of the cursor is of interest. Events added with appendEvent() are never coalesced.
+\param coalesce If `true`, Moved events are coalesced. The default is `false`. */
+void CX_Mouse::setCoalesceMovedEvents(bool coalesce) {
+	_coalesceMovedEvents = coalesce;
+}
+
+/*! \brief Returns `true` if Moved events are coalesced. See setCoalesceMovedEvents(). */
+bool CX_Mouse::getCoalesceMovedEvents(void) const {
+	return _coalesceMovedEvents;
 }
 
 /*!
@@ -153,16 +211,17 @@ CX_Mouse::Event CX_Mouse::waitForButtonPress(std::vector<int> buttons, bool clea
 			continue;
 		}
 
-		for (auto it = _mouseEvents.begin(); it != _mouseEvents.end(); it++) {
-			if (it->type == CX_Mouse::Pressed) {
+		for (size_t i = 0; i < _mouseEvents.size(); i++) {
+			const CX_Mouse::Event& ev = _mouseEvents[i];
+			if (ev.type == CX_Mouse::Pressed) {
 
-				bool buttonFound = std::find(buttons.begin(), buttons.end(), it->button) != buttons.end();
+				bool buttonFound = std::find(buttons.begin(), buttons.end(), ev.button) != buttons.end();
 
 				if (minus1Found || buttonFound) {
-					rval = *it;
+					rval = ev;
 
 					if (eraseEvent) {
-						_mouseEvents.erase(it);
+						_mouseEvents.erase(i);
 					}
 
 					waiting = false;
@@ -198,7 +257,7 @@ void CX_Mouse::appendEvent(CX_Mouse::Event ev) {
 		_heldButtons.erase(ev.button);
 	}
 
-	_mouseEvents.push_back(ev);
+	_pushEvent(ev);
 }
 
 //As of oF 084 (at least), the type of the event is properly marked by oF, so these functions are depreciated once oF 080 support is dropped.
@@ -226,23 +285,17 @@ void CX_Mouse::_mouseDraggedEventHandler(ofMouseEventArgs &a) {
 void CX_Mouse::_mouseWheelScrollHandler(ofMouseEventArgs &a) {
 	CX_Mouse::Event ev;
 
-	ev.time = CX::Instances::Clock.now();
-	ev.uncertainty = ev.time - _lastEventPollTime;
-
 	ev.type = CX_Mouse::Scrolled;
 
 	ev.button = -1;
 	ev.x = a.scrollX;
 	ev.y = a.scrollY;
 
-	_mouseEvents.push_back(ev);
+	_handleEvent(ev);
 }
 #else
 void CX_Mouse::_mouseWheelScrollHandler(Private::CX_MouseScrollEventArgs_t &a) {
 	CX_Mouse::Event ev;
-	
-	ev.time = CX::Instances::Clock.now();
-	ev.uncertainty = ev.time - _lastEventPollTime;
 
 	ev.type = CX_Mouse::Scrolled;
 
@@ -250,14 +303,12 @@ void CX_Mouse::_mouseWheelScrollHandler(Private::CX_MouseScrollEventArgs_t &a) {
 	ev.x = a.x;
 	ev.y = a.y;
 
-	_mouseEvents.push_back(ev);
+	_handleEvent(ev);
 }
 #endif
 
 void CX_Mouse::_mouseEventHandler(ofMouseEventArgs &ofEvent) {
 	CX_Mouse::Event ev;
-	ev.time = CX::Instances::Clock.now();
-	ev.uncertainty = ev.time - _lastEventPollTime;
 
 	ev.button = ofEvent.button;
 	ev.x = ofEvent.x;
@@ -266,16 +317,12 @@ void CX_Mouse::_mouseEventHandler(ofMouseEventArgs &ofEvent) {
 	//	ev.y = CX::Instances::Disp.getResolution().y - ev.y; //Not good if multiple displays are possible
 	//}
 
-	_cursorPos = ofPoint(ev.x, ev.y);
-
 	switch (ofEvent.type) {
 	case ofMouseEventArgs::Pressed:
 		ev.type = CX_Mouse::Pressed;
-		_heldButtons.insert(ofEvent.button);
 		break;
 	case ofMouseEventArgs::Released:
 		ev.type = CX_Mouse::Released;
-		_heldButtons.erase(ofEvent.button);
 		break;
 	case ofMouseEventArgs::Moved:
 		ev.type = CX_Mouse::Moved;
@@ -293,7 +340,58 @@ void CX_Mouse::_mouseEventHandler(ofMouseEventArgs &ofEvent) {
 		return; //This function should not be getting this event.
 	}
 
-	_mouseEvents.push_back(ev);
+	_handleEvent(ev);
+}
+
+void CX_Mouse::_handleEvent(CX_Mouse::Event& ev) {
+	ev.time = CX::Instances::Clock.now();
+	ev.uncertainty = ev.time - _lastEventPollTime;
+	_storeEvent(ev);
+}
+
+void CX_Mouse::_storeEvent(const CX_Mouse::Event& ev) {
+	switch (ev.type) {
+	case CX_Mouse::Pressed:
+		_heldButtons.insert(ev.button);
+		break;
+	case CX_Mouse::Released:
+		_heldButtons.erase(ev.button);
+		break;
+	default:
+		break;
+	}
+
+	if (ev.type != CX_Mouse::Scrolled) {
+		_cursorPos = ofPoint(ev.x, ev.y);
+	}
+
+	if (_coalesceMovedEvents && ev.type == CX_Mouse::Moved && !_mouseEvents.empty() && _mouseEvents.back().type == CX_Mouse::Moved) {
+		if (_eventObserver) {
+			_eventObserver(ev);
+		}
+		_mouseEvents.back() = ev;
+		return;
+	}
+
+	_pushEvent(ev);
+}
+
+void CX_Mouse::_pushEvent(const CX_Mouse::Event& ev) {
+	if (_eventObserver) {
+		_eventObserver(ev);
+	}
+
+	if (!_mouseEvents.push_back(ev)) {
+		if (_droppedEvents++ == 0) {
+			Instances::Log.warning("CX_Mouse") << "The event queue is full (capacity " << _mouseEvents.capacity() <<
+				"), so events are being dropped. See setEventQueueCapacity().";
+		}
+	}
+}
+
+void CX_Mouse::_useGlfwEvents(bool use) {
+	_glfwEventsUsed = use;
+	_listenForEvents(_enabled && _glfwEventsUsed);
 }
 
 void CX_Mouse::_listenForEvents(bool listen) {
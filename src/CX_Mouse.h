@@ -1,7 +1,8 @@
 #pragma once
 
-#include <deque>
 #include <set>
+#include <memory>
+#include <functional>
 
 #include "CX_Clock.h"
 #include "CX_Events.h"
@@ -83,8 +84,17 @@ namespace CX {
 		CX_Mouse::Event waitForButtonPress(int button, bool clear = true, bool eraseEvent = false);
 		CX_Mouse::Event waitForButtonPress(std::vector<int> buttons, bool clear = true, bool eraseEvent = false);
 
+		void forEachEvent(std::function<void(const CX_Mouse::Event&)> f) const;
+
 		void appendEvent(CX_Mouse::Event ev);
 
+		void setEventQueueCapacity(size_t capacity, Util::OverflowPolicy policy = Util::OverflowPolicy::Grow);
+		size_t getEventQueueCapacity(void) const;
+		uint64_t getDroppedEventCount(void) const;
+
+		void setCoalesceMovedEvents(bool coalesce);
+		bool getCoalesceMovedEvents(void) const;
+
 	private:
 		friend class CX_InputManager; //So that CX_InputManager can set _lastEventPollTime
 
@@ -94,7 +104,15 @@ namespace CX {
 		CX_Millis _lastEventPollTime;
 
 		std::set<int> _heldButtons;
-		std::deque<CX_Mouse::Event> _mouseEvents;
+		Util::RingBuffer<CX_Mouse::Event> _mouseEvents;
+		uint64_t _droppedEvents;
+		bool _coalesceMovedEvents;
+		void _pushEvent(const CX_Mouse::Event& ev);
+
+		// Called with every event that is stored (used by CX_InputRecorder)
+		friend class CX_InputRecorder;
+		friend class CX_InputReplayer;
+		std::function<void(const CX_Mouse::Event&)> _eventObserver;
 
 		void _mouseButtonPressedEventHandler (ofMouseEventArgs &a);
 		void _mouseButtonReleasedEventHandler (ofMouseEventArgs &a);
@@ -108,10 +126,17 @@ namespace CX {
 #endif
 
 		void _mouseEventHandler(ofMouseEventArgs& ofEvent);
+		void _handleEvent(CX_Mouse::Event& ev);
+		void _storeEvent(const CX_Mouse::Event& ev);
 
 		bool _listeningForEvents;
 		void _listenForEvents (bool listen);
 
+		// If false, events come from another source (e.g. CX_EvdevInput) instead of GLFW
+		friend class CX_EvdevInput;
+		bool _glfwEventsUsed;
+		void _useGlfwEvents(bool use);
+
 		ofPoint _cursorPos;
 
 	};
@@ -4,6 +4,109 @@
 
 namespace CX {
 
+/////////////////////
+// CX_PhiloxEngine //
+/////////////////////
+
+namespace {
+	// Philox4x32-10: the counter is 4 32-bit words and the key is 2 32-bit words.
+	void philox4x32_10(uint32_t counter[4], uint32_t key[2]) {
+		const uint32_t M0 = 0xD2511F53;
+		const uint32_t M1 = 0xCD9E8D57;
+		const uint32_t W0 = 0x9E3779B9;
+		const uint32_t W1 = 0xBB67AE85;
+
+		uint32_t k0 = key[0];
+		uint32_t k1 = key[1];
+		for (int round = 0; round < 10; round++) {
+			uint64_t product0 = (uint64_t)M0 * counter[0];
+			uint64_t product1 = (uint64_t)M1 * counter[2];
+
+			uint32_t c0 = (uint32_t)(product1 >> 32) ^ counter[1] ^ k0;
+			uint32_t c1 = (uint32_t)product1;
+			uint32_t c2 = (uint32_t)(product0 >> 32) ^ counter[3] ^ k1;
+			uint32_t c3 = (uint32_t)product0;
+
+			counter[0] = c0;
+			counter[1] = c1;
+			counter[2] = c2;
+			counter[3] = c3;
+
+			k0 += W0;
+			k1 += W1;
+		}
+	}
+
+	// The splitmix64 finalizer
+	uint64_t mix64(uint64_t z) {
+		z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+		z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+		return z ^ (z >> 31);
+	}
+}
+
+/*! \brief Construct an engine with key 0 and stream 0. */
+CX_PhiloxEngine::CX_PhiloxEngine(void) {
+	seed(0, 0);
+}
+
+/*! \brief Construct an engine with the given key and stream. See seed(). */
+CX_PhiloxEngine::CX_PhiloxEngine(uint64_t key, uint64_t stream) {
+	seed(key, stream);
+}
+
+/*! Set the key and stream of the engine and go to the start of the stream.
+\param key The key, which plays the role of a seed.
+\param stream The stream id. Different streams with the same key are independent. */
+void CX_PhiloxEngine::seed(uint64_t key, uint64_t stream) {
+	_key = key;
+	_stream = stream;
+	_position = 0;
+	_blockValid = false;
+}
+
+/*! \brief Get the next value in the stream. */
+CX_PhiloxEngine::result_type CX_PhiloxEngine::operator()(void) {
+	uint64_t blockCounter = _position / 2;
+	if (!_blockValid || blockCounter != _blockCounter) {
+		// The low half of the counter is the block number within the stream and the high half is the stream id
+		uint32_t counter[4] = { (uint32_t)blockCounter, (uint32_t)(blockCounter >> 32), (uint32_t)_stream, (uint32_t)(_stream >> 32) };
+		uint32_t key[2] = { (uint32_t)_key, (uint32_t)(_key >> 32) };
+		philox4x32_10(counter, key);
+
+		_block[0] = ((uint64_t)counter[1] << 32) | counter[0];
+		_block[1] = ((uint64_t)counter[3] << 32) | counter[2];
+		_blockCounter = blockCounter;
+		_blockValid = true;
+	}
+
+	return _block[_position++ % 2];
+}
+
+/*! \brief Skip the next `n` values. This takes constant time. */
+void CX_PhiloxEngine::discard(unsigned long long n) {
+	_position += n;
+}
+
+/*! \brief Get the key set with seed(). */
+uint64_t CX_PhiloxEngine::getKey(void) const {
+	return _key;
+}
+
+/*! \brief Get the stream id set with seed(). */
+uint64_t CX_PhiloxEngine::getStream(void) const {
+	return _stream;
+}
+
+/*! \brief Get the number of values that have been generated or discarded since the engine was seeded. */
+uint64_t CX_PhiloxEngine::getPosition(void) const {
+	return _position;
+}
+
+//////////////////////////////
+// CX_RandomNumberGenerator //
+//////////////////////////////
+
 /*! An instance of CX_RandomNumberGenerator that is very lightly hooked into the CX backend. The only
  way this is used outside of user code is to generate random numbers internally in, e.g., Algo::BlockSampler.
 \ingroup entryPoint
@@ -25,17 +128,21 @@ The random_device is only used to seed the Mersenne Twister, so as long as the i
 is random enough, it should be fine (this is not cryptography, just fooling humans).
 */
 CX_RandomNumberGenerator::CX_RandomNumberGenerator(void) {
+	_engine._algorithm = Algorithm::MersenneTwister;
+
 	std::random_device rd;
 	
 	setSeed( rd() ); //Store the seed for reference and seed the Mersenne Twister.
 }
 
 /*! Set the seed for the random number generator. You can retrieve the seed with getSeed().
+If the Philox algorithm is used, this also goes back to stream 0 (see split()).
 \param seed The new seed. */
 void CX_RandomNumberGenerator::setSeed(unsigned long seed) {
 	_seed = seed; //Store the seed for reference.
 
-	_mersenneTwister.seed( _seed );
+	_engine._mersenneTwister.seed( _seed );
+	_engine._philox.seed( _seed, 0 );
 }
 
 /*! This function provides a method of setting the seed using an arbitrary string
@@ -56,10 +163,64 @@ unsigned long CX_RandomNumberGenerator::getSeed(void) {
 	return _seed; 
 }
 
+/*! Set the algorithm used to generate random values. Changing the algorithm reseeds the generator with the current seed
+(see getSeed()), so the sequence of values starts over.
+
+The Philox algorithm is a counter-based algorithm (see CX_PhiloxEngine) that allows split() streams to be generated
+independently and in parallel and allows skipAhead() to take constant time. For a given seed, it gives different values
+than the Mersenne Twister, so the algorithm should be recorded with the seed if random values are to be reproduced.
+\param algorithm The algorithm to use. */
+void CX_RandomNumberGenerator::setAlgorithm(Algorithm algorithm) {
+	_engine._algorithm = algorithm;
+	setSeed(_seed);
+}
+
+/*! \brief Get the algorithm used to generate random values. See setAlgorithm(). */
+CX_RandomNumberGenerator::Algorithm CX_RandomNumberGenerator::getAlgorithm(void) const {
+	return _engine._algorithm;
+}
+
+/*! Get a new random number generator for an independent stream of random values. The new generator uses the Philox
+algorithm and the same seed as this generator. Its values depend only on the seed, the stream id of this generator (see
+getStreamId()), and `streamId`, not on how many values have been generated by this or any other generator. Streams can be
+split further, e.g. `RNG.split(block).split(trial)`.
+
+This function does not change this generator, so it is safe to call from multiple threads at once as long as
+this generator is not being used to generate values at the same time.
+
+\param streamId The id of the new stream, e.g. a trial number. Different ids give independent streams.
+\return A generator for the stream. */
+CX_RandomNumberGenerator CX_RandomNumberGenerator::split(uint64_t streamId) const {
+	CX_RandomNumberGenerator rval(*this);
+	rval._engine._algorithm = Algorithm::Philox;
+	rval._engine._philox.seed(_seed, mix64(getStreamId() + 0x9E3779B97F4A7C15ULL) + streamId);
+	return rval;
+}
+
+/*! \brief Get the id of the stream used by this generator. This is 0 unless the generator came from split(). */
+uint64_t CX_RandomNumberGenerator::getStreamId(void) const {
+	return (_engine._algorithm == Algorithm::Philox) ? _engine._philox.getStream() : 0;
+}
+
+/*! Skip the next `n` random values from the underlying engine, as though `n` values had been generated. With the Philox
+algorithm, this takes constant time. With the Mersenne Twister, the values are generated and discarded, which takes time
+proportional to `n`.
+
+The number of engine values used by each function depends on the function (and for some distributions, on the values that are
+generated), so this is most useful with getEngine() or for giving each of many items a fixed-size block of a stream.
+\param n The number of values to skip. */
+void CX_RandomNumberGenerator::skipAhead(uint64_t n) {
+	if (_engine._algorithm == Algorithm::Philox) {
+		_engine._philox.discard(n);
+	} else {
+		_engine._mersenneTwister.discard(n);
+	}
+}
+
 /*! Get a random integer in the range getMinimumRandomInt(), getMaximumRandomInt(), inclusive.
 \return The int. */
 CX_RandomInt_t CX_RandomNumberGenerator::randomInt(void) {
-	return std::uniform_int_distribution<CX_RandomInt_t>(std::numeric_limits<CX_RandomInt_t>::min(), std::numeric_limits<CX_RandomInt_t>::max())(_mersenneTwister);
+	return std::uniform_int_distribution<CX_RandomInt_t>(std::numeric_limits<CX_RandomInt_t>::min(), std::numeric_limits<CX_RandomInt_t>::max())(_engine);
 }
 
 /*! This function returns an integer from the range [rangeLower, rangeUpper]. The minimum and maximum values for the
@@ -73,7 +234,7 @@ CX_RandomInt_t CX_RandomNumberGenerator::randomInt(CX_RandomInt_t min, CX_Random
 		std::swap(min, max);
 	}
 
-	return std::uniform_int_distribution<CX_RandomInt_t>(min, max)(_mersenneTwister);
+	return std::uniform_int_distribution<CX_RandomInt_t>(min, max)(_engine);
 }
 
 /*! Get the minimum value that can be returned by randomInt(). 
@@ -97,7 +258,7 @@ double CX_RandomNumberGenerator::randomDouble(double lowerBound_closed, double u
 		Instances::Log.error("CX_RandomNumberGenerator") << "randomDouble: The lower bound is greater than the upper bound, returning 0.";
 		return 0;
 	}
-	return std::uniform_real_distribution<double>(lowerBound_closed, upperBound_open)(_mersenneTwister);
+	return std::uniform_real_distribution<double>(lowerBound_closed, upperBound_open)(_engine);
 }
 
 /*! Returns a vector of count integers drawn randomly from the range [lowerBound, upperBound] with or without replacement.
@@ -125,9 +286,22 @@ provided by the standard library: http://en.cppreference.com/w/cpp/numeric/rando
 \code{.cpp}
 std::poisson_distribution<int> pois(4);
 int deviate = pois(RNG.getGenerator());
-\endcode */
+\endcode
+\note This is only used when the Mersenne Twister algorithm is selected (see setAlgorithm()). getEngine() works with
+either algorithm. */
 std::mt19937_64& CX_RandomNumberGenerator::getGenerator(void) { 
-	return _mersenneTwister; 
+	return _engine._mersenneTwister; 
+}
+
+/*! This function returns a reference to the engine used by the CX_RandomNumberGenerator, which uses whichever algorithm
+is selected with setAlgorithm(). Like getGenerator(), it can be used with the distributions provided by the standard library.
+With the Mersenne Twister algorithm, it gives the same values as getGenerator().
+\code{.cpp}
+std::poisson_distribution<int> pois(4);
+int deviate = pois(RNG.getEngine());
+\endcode */
+CX_RandomNumberGenerator::Engine& CX_RandomNumberGenerator::getEngine(void) {
+	return _engine;
 }
 
 /*!	This function works like CX_RandomNumberGenerator::sampleBlocks(),
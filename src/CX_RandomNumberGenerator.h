@@ -4,6 +4,7 @@
 #include <cmath>
 #include <vector>
 #include <set>
+#include <limits>
 
 #include <stdint.h>
 
@@ -25,10 +26,49 @@ namespace CX {
 	/*! \brief The type of integer returned by the CX_RandomNumberGenerator::randomInt() functions. */
 	typedef int64_t CX_RandomInt_t;
 
+	/*! This class is a counter-based random number engine implementing the Philox4x32-10 algorithm (Salmon, Moraes, Dror, & Shaw, 2011,
+	"Parallel random numbers: As easy as 1, 2, 3"). Each output is a function of only the key, the stream, and the position of
+	the output in the stream, so there is no hidden state that depends on what was generated before. As a result, streams with
+	different stream ids are independent, any stream can be started at any position in constant time (see discard()), and
+	streams can be generated in any order or on any number of threads with the same results.
+
+	It satisfies the requirements of a uniform random bit generator, so it can be used with the standard library distributions.
+	It is usually used through CX_RandomNumberGenerator (see CX_RandomNumberGenerator::setAlgorithm() and CX_RandomNumberGenerator::split()).
+
+	\ingroup randomNumberGeneration
+	*/
+	class CX_PhiloxEngine {
+	public:
+		typedef uint64_t result_type;
+
+		static constexpr result_type min(void) { return 0; }
+		static constexpr result_type max(void) { return std::numeric_limits<result_type>::max(); }
+
+		CX_PhiloxEngine(void);
+		CX_PhiloxEngine(uint64_t key, uint64_t stream = 0);
+
+		void seed(uint64_t key, uint64_t stream = 0);
+		result_type operator()(void);
+		void discard(unsigned long long n);
+
+		uint64_t getKey(void) const;
+		uint64_t getStream(void) const;
+		uint64_t getPosition(void) const;
+
+	private:
+		uint64_t _key;
+		uint64_t _stream;
+		uint64_t _position; // The number of values that have been generated
+
+		uint64_t _block[2]; // Each counter value gives two outputs
+		uint64_t _blockCounter;
+		bool _blockValid;
+	};
+
 	/*! This class is used for generating random values from a pseudo-random number generator. If uses
 	a version of the Mersenne Twister algorithm, in particular std::mt19937_64 (see 
 	http://en.cppreference.com/w/cpp/numeric/random/mersenne_twister_engine for the parameters used with
-	this algorithm).
+	this algorithm). Alternatively, it can use a counter-based algorithm, CX_PhiloxEngine (see setAlgorithm()).
 
 	When an instance of this class is constructed, it is automatically seeded from a high-entropy source.
 	In particular, a `std::random_device`. See the documentation for CX_RandomNumberGenerator::CX_RandomNumberGenerator()
@@ -50,16 +90,62 @@ namespace CX {
 	own CX_RandomNumberGenerator. You should create a new CX_RandomNumberGenerator for the thread. 
 	You may seed the thread's new CX_RandomNumberGenerator with CX::Instances::RNG, for example.
 
+	A better way to do that is to use split(), which gives a generator for an independent stream that depends only on
+	the seed and the stream id, not on the order in which threads run. For example, each trial can get its own stream,
+	so stimuli can be generated in parallel and any one trial can be regenerated exactly from the seed:
+	\code{.cpp}
+	RNG.setSeed(participantSeed);
+
+	//In any thread, in any order:
+	CX_RandomNumberGenerator trialRng = RNG.split(trialNumber);
+	vector<double> noise = trialRng.sampleNormalRealizations<double>(pixelCount, 0, 1);
+	\endcode
+
 	\ingroup randomNumberGeneration
 	*/
 	class CX_RandomNumberGenerator {
 	public:
 
+		/*! \brief The algorithms that can be used to generate random values. See setAlgorithm(). */
+		enum class Algorithm {
+			MersenneTwister, //!< std::mt19937_64. This is the default.
+			Philox //!< CX_PhiloxEngine, a counter-based algorithm that supports split() streams and constant-time skipAhead().
+		};
+
+		/*! The random number engine used by CX_RandomNumberGenerator, which gives values from whichever algorithm is
+		selected with setAlgorithm(). It satisfies the requirements of a uniform random bit generator, so it can be used
+		with the standard library distributions. See getEngine(). */
+		class Engine {
+		public:
+			typedef uint64_t result_type;
+
+			static constexpr result_type min(void) { return 0; }
+			static constexpr result_type max(void) { return std::numeric_limits<result_type>::max(); }
+
+			result_type operator()(void) {
+				return (_algorithm == Algorithm::Philox) ? _philox() : _mersenneTwister();
+			}
+
+		private:
+			friend class CX_RandomNumberGenerator;
+
+			Algorithm _algorithm;
+			std::mt19937_64 _mersenneTwister;
+			CX_PhiloxEngine _philox;
+		};
+
 		CX_RandomNumberGenerator (void);
 
 		void setSeed(unsigned long seed);
 		void setSeed(const std::string& s);
 		unsigned long getSeed (void);
+
+		void setAlgorithm(Algorithm algorithm);
+		Algorithm getAlgorithm(void) const;
+
+		CX_RandomNumberGenerator split(uint64_t streamId) const;
+		uint64_t getStreamId(void) const;
+		void skipAhead(uint64_t n);
 	
 		CX_RandomInt_t getMinimumRandomInt(void);
 		CX_RandomInt_t getMaximumRandomInt(void);
@@ -90,11 +176,12 @@ namespace CX {
 		std::vector<unsigned int> sampleBinomialRealizations(unsigned int count, unsigned int trials, double probSuccess);
 
 		std::mt19937_64& getGenerator(void);
+		Engine& getEngine(void);
 
 	private:
 		unsigned long _seed;
 
-		std::mt19937_64 _mersenneTwister;
+		Engine _engine;
 	};
 
 	namespace Instances {
@@ -105,7 +192,7 @@ namespace CX {
 	\param v A pointer to the vector to be shuffled. */
 	template <typename T>
 	void CX_RandomNumberGenerator::shuffleVector(std::vector<T> *v) {
-		std::shuffle( v->begin(), v->end(), _mersenneTwister );
+		std::shuffle( v->begin(), v->end(), _engine );
 	}
 
 	/*! Makes a copy of the given vector, randomizes the order of its elements, and returns the shuffled copy.
@@ -113,7 +200,7 @@ namespace CX {
 	\return A shuffled copy of v. */
 	template <typename T>
 	std::vector<T> CX_RandomNumberGenerator::shuffleVector(std::vector<T> v) {
-		std::shuffle( v.begin(), v.end(), _mersenneTwister );
+		std::shuffle( v.begin(), v.end(), _engine );
 		return v;
 	}
 
@@ -236,7 +323,7 @@ namespace CX {
 	std::vector<typename stdDist::result_type> CX_RandomNumberGenerator::sampleRealizations(unsigned int count, stdDist dist) {
 		std::vector<typename stdDist::result_type> rval(count);
 		for (unsigned int i = 0; i < count; i++) {
-			rval[i] = dist(_mersenneTwister);
+			rval[i] = dist(_engine);
 		}
 		return rval;
 	}
@@ -0,0 +1,239 @@
+#include "CX_SimulatedDisplay.h"
+
+#include <random>
+
+#include "CX_Logger.h"
+
+namespace CX {
+
+CX_SimulatedDisplay::CX_SimulatedDisplay(void) :
+	_clock(std::make_shared<CX_SimulatedClock>()),
+	_anchorTime(0),
+	_nextRefresh(0),
+	_lastTrueSwapTime(0)
+{}
+
+CX_SimulatedDisplay::~CX_SimulatedDisplay(void) {
+	detach();
+}
+
+/*! Set up the simulated display and install it as the swap backend of `Configuration::display`. The frame period of
+the display is set to the nominal frame period. Refreshes are counted from the time at which this is called.
+\param config The configuration to use.
+\return `false` if the configuration was invalid, `true` otherwise. */
+bool CX_SimulatedDisplay::setup(const Configuration& config) {
+
+	if (config.nominalFramePeriod <= CX_Millis(0)) {
+		Instances::Log.error("CX_SimulatedDisplay") << "setup(): nominalFramePeriod must be positive.";
+		return false;
+	}
+
+	if (config.missedRefreshProbability < 0 || config.missedRefreshProbability >= 1) {
+		Instances::Log.error("CX_SimulatedDisplay") << "setup(): missedRefreshProbability must be in the interval [0, 1).";
+		return false;
+	}
+
+	detach();
+
+	CX_Display* display = config.display ? config.display : &Instances::Disp;
+
+	{
+		std::lock_guard<std::recursive_mutex> lock(_mutex);
+
+		_config = config;
+		_config.display = display;
+
+		if (_config.seed == 0) {
+			std::random_device rd;
+			_rng.setSeed(rd());
+		} else {
+			_rng.setSeed(_config.seed);
+		}
+
+		_anchorTime = Instances::Clock.now();
+		_nextRefresh = 1;
+		_lastTrueSwapTime = _anchorTime;
+		_lastSwap = SwapInfo();
+	}
+
+	display->setSwapBackend(this);
+	display->setFramePeriod(_config.nominalFramePeriod);
+
+	return true;
+}
+
+CX_SimulatedDisplay::Configuration CX_SimulatedDisplay::getConfiguration(void) {
+	std::lock_guard<std::recursive_mutex> lock(_mutex);
+	return _config;
+}
+
+/*! Remove the simulated display from the display it was set up for, so that the display swaps its video buffers again.
+This is done automatically when the simulated display is destroyed. */
+void CX_SimulatedDisplay::detach(void) {
+	CX_Display* display = nullptr;
+	{
+		std::lock_guard<std::recursive_mutex> lock(_mutex);
+		display = _config.display;
+		_config.display = nullptr;
+	}
+
+	if (display && display->getSwapBackend() == this) {
+		display->setSwapBackend(nullptr);
+	}
+}
+
+/*! \brief Get the simulated clock that is advanced by swaps when it is in use. See useSimulatedClock(). */
+std::shared_ptr<CX_SimulatedClock> CX_SimulatedDisplay::getClock(void) {
+	return _clock;
+}
+
+/*! Install the simulated clock as the implementation of CX::Instances::Clock, so that each swap advances time to
+the time at which the swap is detected instead of waiting for it. This resets the clock to 0, so call setup() afterwards.
+To go back to real time, install another clock implementation, e.g. with `Clock.setImplementation<CX_StdClockWrapper<std::chrono::steady_clock>>()`.
+
+\param autoAdvance The amount of time that passes each time the clock is read (see CX_SimulatedClock::setAutoAdvance()).
+The display thread, CX_DisplaySwapper, and CX_SlidePresenter wait for swap times by polling the clock, so this should not
+be 0 unless all swaps are made directly with step() or CX_Display::swapBuffers(). If the display thread is used, it should
+use CX_DisplayThread::SchedulingMode::Spin, because sleeping takes real time.
+*/
+void CX_SimulatedDisplay::useSimulatedClock(CX_Nanos autoAdvance) {
+	_clock->setAutoAdvance(autoAdvance);
+	Instances::Clock.setImplementation(_clock);
+}
+
+CX_SimulatedDisplay::SwapInfo CX_SimulatedDisplay::_planNextSwap(CX_Millis requestTime) {
+	std::lock_guard<std::recursive_mutex> lock(_mutex);
+
+	SwapInfo info;
+	info.requestTime = requestTime;
+
+	CX_RandomNumberGenerator::Engine& gen = _rng.getEngine();
+	std::uniform_real_distribution<double> unif(0, 1);
+
+	// With vertical sync, the swap happens on the first refresh that is not before the request.
+	cxTick_t periodNanos = std::max<cxTick_t>(_config.nominalFramePeriod.nanos(), 1);
+	cxTick_t sinceAnchor = (requestTime - _anchorTime).nanos();
+	uint64_t firstRefresh = sinceAnchor > 0 ? (uint64_t)((sinceAnchor + periodNanos - 1) / periodNanos) : 0;
+
+	info.refresh = std::max(_nextRefresh, firstRefresh);
+	while (_config.missedRefreshProbability > 0 && unif(gen) < _config.missedRefreshProbability) {
+		info.refresh++;
+		info.missedRefreshes++;
+	}
+
+	info.trueSwapTime = _anchorTime + CX_Nanos((cxTick_t)info.refresh * periodNanos);
+	if (_config.jitterSD > CX_Millis(0)) {
+		std::normal_distribution<double> jitter(0, _config.jitterSD.millis());
+		info.trueSwapTime += CX_Millis(jitter(gen));
+	}
+
+	// Very large jitter must not reorder swaps or put them before the request
+	if (info.trueSwapTime <= _lastTrueSwapTime) {
+		info.trueSwapTime = _lastTrueSwapTime + CX_Nanos(1);
+	}
+	if (info.trueSwapTime < requestTime) {
+		info.trueSwapTime = requestTime;
+	}
+
+	CX_Millis latency = _config.latency;
+	if (_config.latencySD > CX_Millis(0)) {
+		std::normal_distribution<double> latencyDist(_config.latency.millis(), _config.latencySD.millis());
+		latency = CX_Millis(latencyDist(gen));
+	}
+	if (latency < CX_Millis(0)) {
+		latency = CX_Millis(0);
+	}
+
+	info.reportedSwapTime = info.trueSwapTime + latency;
+
+	_nextRefresh = info.refresh + 1;
+	_lastTrueSwapTime = info.trueSwapTime;
+
+	return info;
+}
+
+/*! Perform one simulated swap. This is called by CX_Display for every swap of the display, so it does not normally
+need to be called directly.
+
+Time advances to the time at which the swap is detected, either by advancing the simulated clock or, if the simulated
+clock is not in use, by waiting. Then `swapEvent` and `Configuration::swapCallback` are notified. When this returns, the
+display stores the swap in its `swapData`, exactly as for a real swap. */
+void CX_SimulatedDisplay::swapBuffers(void) {
+
+	SwapInfo info = _planNextSwap(Instances::Clock.now());
+
+	if (Instances::Clock.getImplementation() == _clock) {
+		_clock->advanceTo(info.reportedSwapTime);
+	} else {
+		CX_Millis sleepUntil = info.reportedSwapTime - CX_Millis(1);
+		CX_Millis now = Instances::Clock.now();
+		if (sleepUntil > now) {
+			std::this_thread::sleep_for(std::chrono::nanoseconds((sleepUntil - now).nanos()));
+		}
+		while (Instances::Clock.now() < info.reportedSwapTime) {
+			std::this_thread::yield();
+		}
+	}
+
+	std::function<void(const SwapInfo&)> swapCallback;
+	{
+		std::lock_guard<std::recursive_mutex> lock(_mutex);
+		_stats.swaps++;
+		_stats.missedRefreshes += info.missedRefreshes;
+		_lastSwap = info;
+		swapCallback = _config.swapCallback;
+	}
+
+	ofNotifyEvent(swapEvent, info);
+
+	if (swapCallback) {
+		swapCallback(info);
+	}
+}
+
+/*! Swap the buffers of the display that the simulated display was set up for with CX_Display::swapBuffers(),
+i.e. through the same code path as any other swap.
+\return Information about the swap. */
+CX_SimulatedDisplay::SwapInfo CX_SimulatedDisplay::step(void) {
+	CX_Display* display = getConfiguration().display;
+	if (display == nullptr || display->getSwapBackend() != this) {
+		Instances::Log.error("CX_SimulatedDisplay") << "step(): The simulated display is not set up for a display.";
+		return SwapInfo();
+	}
+	if (display->isAutomaticallySwapping()) {
+		Instances::Log.error("CX_SimulatedDisplay") << "step(): The display is swapping automatically, so it cannot be stepped.";
+		return SwapInfo();
+	}
+
+	display->swapBuffers();
+
+	return getLastSwapInfo();
+}
+
+/*! \brief Perform `swaps` simulated swaps. See step(void). */
+std::vector<CX_SimulatedDisplay::SwapInfo> CX_SimulatedDisplay::step(unsigned int swaps) {
+	std::vector<SwapInfo> rval;
+	rval.reserve(swaps);
+	for (unsigned int i = 0; i < swaps; i++) {
+		rval.push_back(step());
+	}
+	return rval;
+}
+
+/*! \brief Get information about the most recent simulated swap. The swap as stored by the display is in `CX_Display::swapData`. */
+CX_SimulatedDisplay::SwapInfo CX_SimulatedDisplay::getLastSwapInfo(void) {
+	std::lock_guard<std::recursive_mutex> lock(_mutex);
+	return _lastSwap;
+}
+
+CX_SimulatedDisplay::Statistics CX_SimulatedDisplay::getStatistics(void) {
+	std::lock_guard<std::recursive_mutex> lock(_mutex);
+	return _stats;
+}
+
+void CX_SimulatedDisplay::resetStatistics(void) {
+	std::lock_guard<std::recursive_mutex> lock(_mutex);
+	_stats = Statistics();
+}
+
+} // namespace CX
@@ -0,0 +1,224 @@
+#pragma once
+
+#include <atomic>
+#include <algorithm>
+#include <thread>
+#include <mutex>
+#include <functional>
+
+#include "CX_Clock.h"
+#include "CX_RandomNumberGenerator.h"
+#include "CX_SynchronizationUtils.h"
+#include "CX_Display.h"
+
+namespace CX {
+
+	/*! A clock implementation in which time only moves when it is advanced with advance() or advanceTo(), or, if auto-advance
+	is enabled (see setAutoAdvance()), by a small amount every time the clock is read. Install it with
+	`CX::Instances::Clock.setImplementation(clock)` to run timing code faster than real time, e.g. with CX_SimulatedDisplay.
+
+	\ingroup timing
+	*/
+	class CX_SimulatedClock : public CX_BaseClockInterface {
+	public:
+
+		CX_SimulatedClock(void) :
+			_now(0),
+			_autoAdvance(0)
+		{}
+
+		cxTick_t nanos(void) const override {
+			cxTick_t step = _autoAdvance.load(std::memory_order_relaxed);
+			if (step > 0) {
+				return _now.fetch_add(step, std::memory_order_acq_rel) + step;
+			}
+			return _now.load(std::memory_order_acquire);
+		}
+
+		void resetStartTime(void) override {
+			_now.store(0, std::memory_order_release);
+		}
+
+		std::string getName(void) const override {
+			return "CX_SimulatedClock";
+		}
+
+		bool isMonotonic(void) const override {
+			return true;
+		}
+
+		/*! \brief Move time forward by `duration`. Negative durations are ignored. */
+		void advance(CX_Nanos duration) {
+			if (duration.nanos() > 0) {
+				_now.fetch_add(duration.nanos(), std::memory_order_acq_rel);
+			}
+		}
+
+		/*! \brief Move time forward to `time`. If `time` is in the past, nothing happens. */
+		void advanceTo(CX_Nanos time) {
+			cxTick_t target = time.nanos();
+			cxTick_t current = _now.load(std::memory_order_acquire);
+			while (current < target && !_now.compare_exchange_weak(current, target, std::memory_order_acq_rel)) {
+			}
+		}
+
+		/*! Set how much time passes each time the clock is read. Code that waits by polling the clock (e.g. the display thread,
+		CX_DisplaySwapper, or CX_Clock::wait()) never finishes waiting if time only moves when it is explicitly advanced, so
+		auto-advance should be enabled when such code runs on the simulated clock.
+		\param step The amount of time added per read. 0 disables auto-advance. */
+		void setAutoAdvance(CX_Nanos step) {
+			_autoAdvance.store(std::max<cxTick_t>(step.nanos(), 0), std::memory_order_relaxed);
+		}
+
+		/*! \brief Get the amount of time added per read. See setAutoAdvance(). */
+		CX_Nanos getAutoAdvance(void) const {
+			return CX_Nanos(_autoAdvance.load(std::memory_order_relaxed));
+		}
+
+	private:
+		mutable std::atomic<cxTick_t> _now;
+		std::atomic<cxTick_t> _autoAdvance;
+	};
+
+	/*! This class simulates the buffer swaps of a display without a monitor, for testing and benchmarking presentation and
+	synchronization logic on headless computers. It is a CX_DisplaySwapBackend: setup() installs it in a CX_Display, after which
+	every swap made through that display (CX_Display::swapBuffers(), the display thread, CX_DisplaySwapper, CX_SlidePresenter,
+	CX_SlideBuffer, etc.) waits for a simulated refresh instead of the monitor, and is stored in `CX_Display::swapData` by the
+	normal code path. So the real presentation and swap prediction code is what is being tested.
+
+	Like a swap with vertical synchronization, a simulated swap happens at the first refresh that is not earlier than the time
+	of the swap request. Refreshes happen at a nominal period, and swaps have injectable jitter, missed refreshes (a swap slipping
+	to a later refresh), and detection latency.
+
+	The simulated display can run in two ways:
+	+ Virtual time: If the simulated clock is installed as the implementation of `CX::Instances::Clock` (see useSimulatedClock()),
+	each swap advances the clock to the time at which the swap is detected, so simulations run as fast as the CPU allows.
+	+ Real time: Otherwise, each swap waits until that time on whatever clock `CX::Instances::Clock` uses.
+
+	Only the swaps are simulated. Drawing still uses the rendering context of the display, so slides are rendered as usual. On a
+	computer without a monitor, a hidden window or an offscreen OpenGL implementation (e.g. Mesa) can provide the context.
+
+	\code{.cpp}
+	CX_SimulatedDisplay sim;
+	sim.useSimulatedClock(); // Optional: run in virtual time
+
+	CX_SimulatedDisplay::Configuration config;
+	config.display = &Disp;
+	config.nominalFramePeriod = CX_Seconds(1.0 / 60);
+	config.jitterSD = CX_Micros(200);
+	config.missedRefreshProbability = 0.01;
+	config.seed = 12345;
+	sim.setup(config);
+
+	// Slide presentation, the display thread, etc. now swap on the simulated display
+	SlidePresenter.presentSlides();
+
+	Log.notice() << "Missed refreshes: " << sim.getStatistics().missedRefreshes;
+	\endcode
+
+	\ingroup video
+	*/
+	class CX_SimulatedDisplay : public CX_DisplaySwapBackend {
+	public:
+
+		/*! Information about a single simulated swap. */
+		struct SwapInfo {
+			SwapInfo(void) :
+				refresh(0),
+				missedRefreshes(0),
+				requestTime(0),
+				trueSwapTime(0),
+				reportedSwapTime(0)
+			{}
+
+			uint64_t refresh; //!< The index of the display refresh on which the swap happened.
+			uint64_t missedRefreshes; //!< The number of refreshes that were missed before this swap.
+			CX_Millis requestTime; //!< The time at which the swap was requested.
+			CX_Millis trueSwapTime; //!< The time at which the swap happened, including jitter.
+			CX_Millis reportedSwapTime; //!< The time at which the swap was detected, i.e. `trueSwapTime` plus latency.
+		};
+
+		struct Configuration {
+
+			Configuration(void) :
+				display(nullptr),
+				nominalFramePeriod(1000.0 / 60.0),
+				jitterSD(0),
+				missedRefreshProbability(0),
+				latency(0),
+				latencySD(0),
+				seed(0),
+				swapCallback(nullptr)
+			{}
+
+			/*! \brief The display to simulate swaps for. If `nullptr`, CX::Instances::Disp is used. */
+			CX_Display* display;
+
+			/*! \brief The refresh period of the simulated display. The frame period of the display is set to this. */
+			CX_Millis nominalFramePeriod;
+			CX_Millis jitterSD; //!< Standard deviation of normally distributed jitter in swap times. The jitter does not accumulate.
+
+			/*! \brief The probability that a swap misses the refresh it was intended for and slips to the next refresh.
+			A swap can miss several refreshes in a row. */
+			double missedRefreshProbability;
+
+			CX_Millis latency; //!< Mean delay between a swap and the time at which it is detected.
+			CX_Millis latencySD; //!< Standard deviation of the detection delay. The delay is never negative.
+
+			unsigned long seed; //!< Seed for the jitter, missed refreshes, and latency. If 0, a random seed is used.
+
+			/*! \brief Called after each swap, before the swap is stored by the display. Called on the thread that swapped. */
+			std::function<void(const SwapInfo&)> swapCallback;
+		};
+
+		/*! Counts of simulated events. */
+		struct Statistics {
+			Statistics(void) :
+				swaps(0),
+				missedRefreshes(0)
+			{}
+
+			uint64_t swaps; //!< Number of swaps.
+			uint64_t missedRefreshes; //!< Number of refreshes that were missed, summed over all swaps.
+		};
+
+		CX_SimulatedDisplay(void);
+		~CX_SimulatedDisplay(void);
+
+		bool setup(const Configuration& config);
+		Configuration getConfiguration(void);
+		void detach(void);
+
+		std::shared_ptr<CX_SimulatedClock> getClock(void);
+		void useSimulatedClock(CX_Nanos autoAdvance = CX_Micros(10));
+
+		void swapBuffers(void) override;
+
+		SwapInfo step(void);
+		std::vector<SwapInfo> step(unsigned int swaps);
+
+		SwapInfo getLastSwapInfo(void);
+		Statistics getStatistics(void);
+		void resetStatistics(void);
+
+		ofEvent<const SwapInfo&> swapEvent; //!< Notified after each swap, before the swap is stored by the display.
+
+	private:
+
+		std::recursive_mutex _mutex;
+		Configuration _config;
+
+		std::shared_ptr<CX_SimulatedClock> _clock;
+		CX_RandomNumberGenerator _rng;
+
+		CX_Millis _anchorTime; // refresh n happens at _anchorTime + n * nominalFramePeriod, plus jitter
+		uint64_t _nextRefresh;
+		CX_Millis _lastTrueSwapTime;
+
+		SwapInfo _lastSwap;
+		Statistics _stats;
+
+		SwapInfo _planNextSwap(CX_Millis requestTime);
+	};
+
+} // namespace CX
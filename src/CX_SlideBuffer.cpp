@@ -9,7 +9,7 @@ namespace CX {
 // CX_SlideBuffer::Slide //
 ///////////////////////////
 
-void CX_SlideBuffer::Slide::renderSlide(CX_Display* disp) {
+void CX_SlideBuffer::Slide::renderSlide(CX_Display* disp, bool allowCapture) {
 
 	if (_status >= PresentationStatus::RenderStarted) {
 		//warn that slide was re-rendered?
@@ -31,9 +31,29 @@ void CX_SlideBuffer::Slide::renderSlide(CX_Display* disp) {
 
 	_fenceSync.startSync();
 
+	// Started after the fence so that the readback does not delay renderCompleteTime.
+	// This is the thread that has the rendering context, so it is also where completed readbacks are collected.
+	if (this->frameCapture != nullptr) {
+		if (this->capture && allowCapture) {
+			std::string filename = this->frameCapture->makeFilename(this->name);
+			if (this->drawingFunction == nullptr && this->framebuffer != nullptr) {
+				this->frameCapture->capture(*this->framebuffer, filename);
+			} else {
+				this->frameCapture->captureBackBuffer(filename);
+			}
+		} else {
+			this->frameCapture->update();
+		}
+	}
+
 	_status = PresentationStatus::RenderStarted;
 }
 
+/*! \brief Returns `true` if the prepare step of the slide has finished or if the slide has no prepare step. */
+bool CX_SlideBuffer::Slide::isPrepared(void) const {
+	return !preparation.valid() || preparation.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+}
+
 bool CX_SlideBuffer::Slide::isRendering(void) const {
 	return _status == PresentationStatus::RenderStarted && _fenceSync.isSyncing();
 }
@@ -125,11 +145,11 @@ bool CX_SlideBuffer::Slide::isPreparedToSwap(void) const {
 	return _status == PresentationStatus::RenderComplete;
 }
 
+/*! Releases this slide's reference to its framebuffer. If the framebuffer came from a CX_FramebufferPool
+and no other slide uses it, it is returned to the pool for reuse. Otherwise, it is deallocated once the
+last reference to it is released. */
 void CX_SlideBuffer::Slide::deallocateFramebuffer(void) {
-	if (framebuffer) {
-		framebuffer->allocate(0, 0);
-		framebuffer = nullptr;
-	}
+	framebuffer = nullptr;
 }
 
 void CX_SlideBuffer::Slide::resetPresentationInfo(void) {
@@ -163,7 +183,44 @@ void CX_SlideBuffer::setup(CX_Display* disp) {
 }
 
 void CX_SlideBuffer::setup(Configuration config) {
+	std::shared_ptr<CX_FramebufferPool> previousPool = _config.framebufferPool;
+
 	_config = config;
+
+	if (_config.framebufferPool == nullptr) {
+		_config.framebufferPool = previousPool ? previousPool : std::make_shared<CX_FramebufferPool>();
+	}
+}
+
+/*! Preallocates framebuffers for slides so that beginDrawingNextSlide() does not need to allocate them.
+Allocating a framebuffer takes a noticeable amount of time, so this should be called during setup with
+the largest number of slides that will be drawn at once (e.g. the number of slides in a trial).
+Framebuffers are returned to the pool and reused when slides are cleared or deleted, or when
+Slide::deallocateFramebuffer() is called.
+
+\param slideCount The number of framebuffers that should be available for new slides.
+\return `false` if the framebuffers could not be allocated, `true` otherwise.
+*/
+bool CX_SlideBuffer::reserve(size_t slideCount) {
+	if (_config.display == nullptr) {
+		Instances::Log.error("CX_SlideBuffer") << "reserve(): Cannot allocate framebuffers without a valid CX_Display attached.";
+		return false;
+	}
+
+	if (!_config.display->renderingOnThisThread()) {
+		Instances::Log.error("CX_SlideBuffer") << "reserve(): Cannot allocate framebuffers while the rendering context is on the display thread.";
+		return false;
+	}
+
+	_config.framebufferPool->reserve(slideCount, _getFramebufferFormat());
+	return true;
+}
+
+CX_FramebufferPool::Format CX_SlideBuffer::_getFramebufferFormat(void) const {
+	ofRectangle resolution = _config.display->getResolution();
+
+	//Because we are always drawing over the whole display, there is no reason to have an alpha channel
+	return CX_FramebufferPool::Format(resolution.x, resolution.y, GL_RGB, CX::Util::getMsaaSampleCount());
 }
 
 const CX_SlideBuffer::Configuration& CX_SlideBuffer::getConfiguration(void) const {
@@ -189,6 +246,10 @@ bool CX_SlideBuffer::_appendSlide(Slide&& slide) {
 		return false;
 	}
 
+	if (slide.frameCapture == nullptr) {
+		slide.frameCapture = _config.frameCapture;
+	}
+
 	//if (_slides.size() > 0) {
 	//	Slide& prevSlide = _slides.back();
 	//	prevSlide.intended.timeDuration = slide.intended.startTime - prevSlide.intended.startTime;
@@ -222,6 +283,85 @@ void CX_SlideBuffer::appendSlide(Slide slide) {
 	_appendSlide(std::move(slide));
 }
 
+/*! \brief Returns `true` if the prepare steps of all slides appended with appendPreparedSlide() have finished. */
+bool CX_SlideBuffer::allSlidesPrepared(void) const {
+	for (const Slide& slide : _slides) {
+		if (!slide.isPrepared()) {
+			return false;
+		}
+	}
+	return true;
+}
+
+/*! Wait for the prepare steps of all slides appended with appendPreparedSlide() to finish. Call this before
+presenting the slides so that the rendering thread does not have to wait for slides to be prepared.
+\param timeout The maximum amount of time to wait.
+\return `true` if all slides were prepared before the timeout, `false` otherwise. */
+bool CX_SlideBuffer::waitForPreparation(CX_Millis timeout) {
+	endDrawingCurrentSlide();
+
+	CX_Millis deadline = (timeout == CX_Millis::max()) ? CX_Millis::max() : Instances::Clock.now() + timeout;
+
+	for (const Slide& slide : _slides) {
+		if (!slide.preparation.valid()) {
+			continue;
+		}
+
+		if (deadline == CX_Millis::max()) {
+			slide.preparation.wait();
+			continue;
+		}
+
+		CX_Millis remaining = deadline - Instances::Clock.now();
+		if (remaining < CX_Millis(0)) {
+			remaining = CX_Millis(0);
+		}
+		if (slide.preparation.wait_for(std::chrono::nanoseconds(remaining.nanos())) != std::future_status::ready) {
+			return false;
+		}
+	}
+	return true;
+}
+
+bool CX_SlideBuffer::_waitForSlidePreparation(const std::shared_future<void>& preparation, const std::string& slideName) {
+	if (preparation.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+		Instances::Log.warning("CX_SlideBuffer") << "Slide \"" << slideName << "\" had not finished being prepared when it was rendered." <<
+			" Rendering waited for it. Call waitForPreparation() before presenting slides.";
+	}
+
+	try {
+		preparation.get();
+	} catch (std::exception& e) {
+		Instances::Log.error("CX_SlideBuffer") << "Preparing slide \"" << slideName << "\" failed with exception: " << e.what();
+		return false;
+	} catch (...) {
+		Instances::Log.error("CX_SlideBuffer") << "Preparing slide \"" << slideName << "\" failed with an unknown exception.";
+		return false;
+	}
+	return true;
+}
+
+/*! Set whether the last slide that was appended is saved to a file when it is rendered.
+Captured slides are saved with the `CX_FrameCapture` in `Configuration::frameCapture` (or the slide's
+own `frameCapture`), without blocking presentation.
+\param capture If `true`, the slide is captured. */
+void CX_SlideBuffer::setLastSlideCapture(bool capture) {
+	endDrawingCurrentSlide();
+
+	if (_slides.empty()) {
+		CX::Instances::Log.warning("CX_SlideBuffer") << "setLastSlideCapture(): There are no slides.";
+		return;
+	}
+
+	Slide& slide = _slides.back();
+	slide.capture = capture;
+
+	if (capture && slide.frameCapture == nullptr) {
+		CX::Instances::Log.warning("CX_SlideBuffer") << "setLastSlideCapture(): Slide \"" << slide.name <<
+			"\" has no frame capture, so it will not be captured. Set Configuration::frameCapture.";
+	}
+}
+
 /*! Appends a slide to the slide presenter that will call the given drawing function when it comes time
 to render the slide to the back buffer. This approach has the advantage over using framebuffers that
 it takes essentially zero time to append a function to the list of slides, whereas a framebuffer must
@@ -357,15 +497,14 @@ void CX_SlideBuffer::beginDrawingNextSlide(CX_Millis timeDuration, std::string s
 	_currentSlide->intended.timeDuration = timeDuration;
 	_currentSlide->intended.frameDuration = frameDuration;
 
-	CX::Instances::Log.verbose("CX_SlideBuffer") << "Allocating framebuffer...";
-	_currentSlide->framebuffer = std::make_shared<ofFbo>();
-
-	ofRectangle resolution = _config.display->getResolution();
-
-	_currentSlide->framebuffer->allocate(resolution.x, resolution.y,
-		GL_RGB, //Because we are always drawing over the whole display, there is no reason to have an alpha channel
-		CX::Util::getMsaaSampleCount());
-	Instances::Log.verbose("CX_SlideBuffer") << "Finished allocating.";
+	CX::Instances::Log.verbose("CX_SlideBuffer") << "Acquiring framebuffer...";
+	_currentSlide->framebuffer = _config.framebufferPool->acquire(_getFramebufferFormat());
+	if (_currentSlide->framebuffer == nullptr) {
+		Instances::Log.error("CX_SlideBuffer") << "beginDrawingNextSlide(): Could not acquire a framebuffer for slide \"" << slideName << "\".";
+		_currentSlide = nullptr;
+		return;
+	}
+	Instances::Log.verbose("CX_SlideBuffer") << "Finished acquiring.";
 
 		
 		
@@ -779,7 +918,7 @@ void CX_SlideBufferPlaybackHelper::renderNextSlide(void) {
 void CX_SlideBufferPlaybackHelper::reRenderCurrentSlide(void) {
 	CX_SlideBuffer::Slide* currentSlide = getCurrentSlide();
 	if (currentSlide) {
-		currentSlide->renderSlide(_config.display);
+		currentSlide->renderSlide(_config.display, false);
 	}
 }
 
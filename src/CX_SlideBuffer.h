@@ -1,8 +1,13 @@
 #pragma once
 
+#include <future>
+
 #include "ofFbo.h"
 
 #include "CX_Display.h"
+#include "CX_ThreadUtils.h"
+#include "CX_FramebufferPool.h"
+#include "CX_FrameCapture.h"
 #include "CX_Time_t.h"
 
 namespace CX {
@@ -57,6 +62,8 @@ namespace CX {
 				framebuffer(nullptr),
 				drawingFunction(nullptr),
 				slidePresentedCallback(nullptr),
+				capture(false),
+				frameCapture(nullptr),
 				_status(PresentationStatus::NotStarted)
 			{}
 
@@ -81,6 +88,18 @@ namespace CX {
 			i.e. right after the back buffer containing the slide contents is swapped into the front buffer. */
 			std::function<void(void)> slidePresentedCallback;
 
+			/*! \brief If `true` and `frameCapture` is set, the contents of the slide are saved to a file each time the slide
+			is rendered. The file is named with CX_FrameCapture::makeFilename() using the slide name. */
+			bool capture;
+
+			/*! \brief The CX_FrameCapture used to save the slide if `capture` is `true`. If this is `nullptr` when the slide is
+			appended, it is set to `CX_SlideBuffer::Configuration::frameCapture`. */
+			std::shared_ptr<CX_FrameCapture> frameCapture;
+
+			/*! \brief If the slide was appended with CX_SlideBuffer::appendPreparedSlide(), this becomes ready when the prepare
+			step has finished on the worker pool. Otherwise, it is not valid. */
+			std::shared_future<void> preparation;
+
 			SlideTimingInfo intended; //!< The intended timing parameters (i.e. what should have happened if there were no presentation errors).
 			SlideTimingInfo actual; //!< The actual timing parameters. Set by whatever presents the slides.
 
@@ -90,7 +109,7 @@ namespace CX {
 
 
 			// this function shall be called whenever the caller wants to begin rendering this slide
-			void renderSlide(CX_Display* disp);
+			void renderSlide(CX_Display* disp, bool allowCapture = true); // allowCapture is false when re-rendering, so the slide is only captured once
 
 			// once renderSlide() has been called, the caller shall call updateRenderStatus() as long as isRendering() continues to return true
 			// once isRendering() returns false, updateRenderStatus() does not need to be called again
@@ -112,6 +131,8 @@ namespace CX {
 			void swappedOut(CX_Millis swapTime, FrameNumber swapFrame);
 
 
+			bool isPrepared(void) const;
+
 			bool isInactive(void) const;
 			bool isActive(void) const;
 			
@@ -140,8 +161,28 @@ namespace CX {
 
 		
 		struct Configuration {
+
+			Configuration(void) :
+				display(nullptr),
+				framebufferPool(nullptr),
+				frameCapture(nullptr),
+				preparationPool(nullptr)
+			{}
+
 			CX_Display* display;
 			//ofRectangle fboResolution; // all you need from the display...
+
+			/*! \brief The pool from which slide framebuffers are acquired. If this is `nullptr`, the slide
+			buffer creates its own pool during setup. Several slide buffers can share the same pool. */
+			std::shared_ptr<CX_FramebufferPool> framebufferPool;
+
+			/*! \brief The frame capture given to slides that are appended without one. Only slides with
+			`Slide::capture` set to `true` (see setLastSlideCapture()) are captured. */
+			std::shared_ptr<CX_FrameCapture> frameCapture;
+
+			/*! \brief The thread pool on which the prepare step of slides appended with appendPreparedSlide() is run.
+			If this is `nullptr`, Util::sharedThreadPool() is used. */
+			Util::ThreadPool* preparationPool;
 		};
 
 		CX_SlideBuffer(void);
@@ -151,14 +192,24 @@ namespace CX {
 		void setup(Configuration config);
 		const Configuration& getConfiguration(void) const;
 
+		bool reserve(size_t slideCount);
+
 		void beginDrawingNextSlide(CX_Millis timeDuration, std::string slideName = "", FrameNumber frameDuration = 0);
 		void endDrawingCurrentSlide(void);
 
 		void appendSlideFunction(CX_Millis timeDuration, std::function<void(void)> drawingFunction, std::string slideName = "", FrameNumber frameDuration = 0);
 		void appendSlide(CX_SlideBuffer::Slide slide);
 
+		template <typename T>
+		void appendPreparedSlide(CX_Millis timeDuration, std::function<T(void)> prepare, std::function<void(const T&)> draw,
+								 std::string slideName = "", FrameNumber frameDuration = 0);
+
+		bool allSlidesPrepared(void) const;
+		bool waitForPreparation(CX_Millis timeout = CX_Millis::max());
+
 		// modifiers to last slide
 		void setLastSlideFrameDuration(FrameNumber frameDuration);
+		void setLastSlideCapture(bool capture);
 
 
 		void clear(void);
@@ -241,6 +292,8 @@ namespace CX {
 
 		bool _appendSlide(Slide&& slide);
 
+		static bool _waitForSlidePreparation(const std::shared_future<void>& preparation, const std::string& slideName);
+
 		Configuration _config;
 
 		std::vector<Slide> _slides;
@@ -249,10 +302,91 @@ namespace CX {
 		std::shared_ptr<Slide> _currentSlide;
 
 		int _namedSlideIndex(std::string name) const;
+
+		CX_FramebufferPool::Format _getFramebufferFormat(void) const;
 		
 	};
 
 
+	/*! Appends a slide that is built in two phases:
+	1. `prepare` is run on a worker thread (see `Configuration::preparationPool`) as soon as the slide is appended. It should do
+	the CPU-heavy work of constructing the stimulus, like choosing random locations, laying out and word wrapping text,
+	or generating pixels, and return the result. It must not make any drawing or other OpenGL calls.
+	2. `draw` is called on the rendering thread when the slide is rendered, with the result of `prepare`. It should
+	only draw.
+
+	The result of `prepare` is not changed after it is returned, so `draw` can be called any number of times
+	(e.g. if the slide is rendered more than once) and always draws the same thing.
+
+	If `prepare` has not finished when the slide is rendered, the rendering thread waits for it and a warning is logged,
+	because waiting may delay the slide. To avoid this, call waitForPreparation() before presenting the slides. If
+	`prepare` throws an exception, an error is logged and nothing is drawn for the slide.
+
+	\tparam T The type of the draw data produced by `prepare`. It must be copy or move constructible.
+	\param timeDuration The intended duration of the slide.
+	\param prepare A function that produces the draw data. It is called once, on a worker thread.
+	\param draw A function that draws the slide from the draw data. It is called on the rendering thread.
+	\param slideName The name of the slide.
+	\param frameDuration The intended duration of the slide in frames.
+
+	\code{.cpp}
+	struct SearchArray {
+		std::vector<ofPoint> locations;
+	};
+
+	std::function<SearchArray(void)> prepare = [](void) {
+		SearchArray arr;
+		arr.locations = pickSeparatedLocations(200, 40); // Slow
+		return arr;
+	};
+
+	std::function<void(const SearchArray&)> draw = [](const SearchArray& arr) {
+		ofBackground(0);
+		for (const ofPoint& p : arr.locations) {
+			Draw::ring(p, 15, 4, 40);
+		}
+	};
+
+	slideBuffer.appendPreparedSlide<SearchArray>(1000, prepare, draw, "search array");
+
+	slideBuffer.waitForPreparation();
+	// present the slides...
+	\endcode
+	*/
+	template <typename T>
+	void CX_SlideBuffer::appendPreparedSlide(CX_Millis timeDuration, std::function<T(void)> prepare, std::function<void(const T&)> draw,
+											 std::string slideName, FrameNumber frameDuration)
+	{
+		endDrawingCurrentSlide();
+
+		if (prepare == nullptr || draw == nullptr) {
+			Instances::Log.error("CX_SlideBuffer") << "appendPreparedSlide(): nullptr to prepare or draw function given.";
+			return;
+		}
+
+		// Written once by the worker, then only read
+		std::shared_ptr<std::shared_ptr<const T>> drawData = std::make_shared<std::shared_ptr<const T>>();
+
+		Util::ThreadPool& pool = (_config.preparationPool != nullptr) ? *_config.preparationPool : Util::sharedThreadPool();
+
+		std::shared_future<void> preparation = pool.push([drawData, prepare]() {
+			*drawData = std::make_shared<const T>(prepare());
+		}).share();
+
+		Slide slide;
+		slide.name = slideName;
+		slide.intended.timeDuration = timeDuration;
+		slide.intended.frameDuration = frameDuration;
+		slide.preparation = preparation;
+		slide.drawingFunction = [preparation, drawData, draw, slideName]() {
+			if (CX_SlideBuffer::_waitForSlidePreparation(preparation, slideName)) {
+				draw(**drawData);
+			}
+		};
+
+		_appendSlide(std::move(slide));
+	}
+
 	// This class is not thread safe
 	class CX_SlideBufferPlaybackHelper {
 	public:
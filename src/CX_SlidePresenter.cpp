@@ -33,8 +33,14 @@ bool CX_SlidePresenter::setup(const CX_SlidePresenter::Configuration &config) {
 		return false;
 	}
 
+	std::shared_ptr<CX_FramebufferPool> previousPool = _config.framebufferPool;
+
 	_config = config;
 
+	if (_config.framebufferPool == nullptr) {
+		_config.framebufferPool = previousPool ? previousPool : std::make_shared<CX_FramebufferPool>();
+	}
+
 	_garbageFbo.allocate(1, 1);
 
 	if (!CX::Private::glFenceSyncSupported()) {
@@ -64,6 +70,24 @@ void CX_SlidePresenter::clearSlides (void) {
 	_currentSlide = 0;
 }
 
+/*! Preallocates framebuffers for slides so that beginDrawingNextSlide() does not need to allocate them
+during the inter-trial interval. Call this during setup with the number of slides that will be drawn per trial.
+The framebuffers of slides are returned to the pool when clearSlides() is called, or after the slides are
+presented if `Configuration::deallocateCompletedSlides` is `true`.
+
+\param slideCount The number of framebuffers that should be available for new slides.
+\return `false` if the slide presenter has not been set up, `true` otherwise.
+*/
+bool CX_SlidePresenter::reserve(size_t slideCount) {
+	if (_config.display == nullptr || _config.framebufferPool == nullptr) {
+		CX::Instances::Log.error("CX_SlidePresenter") << "reserve(): Call setup() before calling reserve().";
+		return false;
+	}
+
+	_config.framebufferPool->reserve(slideCount, _getFramebufferFormat());
+	return true;
+}
+
 /*! Start presenting the slides that are stored in the slide presenter.
 After this function is called, calls to update() will advance the state of the slide presentation.
 If you do not call update(), nothing will be presented.
@@ -249,19 +273,27 @@ void CX_SlidePresenter::beginDrawingNextSlide(CX_Millis slideDuration, std::stri
 	}
 	_slides.back().name = slideName;
 
-	CX::Instances::Log.verbose("CX_SlidePresenter") << "Allocating framebuffer...";
-	ofRectangle resolution = _config.display->getResolution();
-	_slides.back().framebuffer.allocate(resolution.x, resolution.y,
-										GL_RGB, //Because we are always drawing over the whole display, there is no reason to have an alpha channel
-										CX::Util::getMsaaSampleCount());
-	CX::Instances::Log.verbose("CX_SlidePresenter") << "Finished allocating.";
+	CX::Instances::Log.verbose("CX_SlidePresenter") << "Acquiring framebuffer...";
+	_slides.back().framebuffer = _config.framebufferPool->acquire(_getFramebufferFormat());
+	if (_slides.back().framebuffer == nullptr) {
+		CX::Instances::Log.error("CX_SlidePresenter") << "beginDrawingNextSlide(): Could not acquire a framebuffer for slide \"" << slideName << "\". The slide is ignored.";
+		_slides.pop_back();
+		_slideInfo.pop_back();
+
+		_garbageFbo.begin(); //Keep the user's drawing off of the back buffer.
+		_renderingToFramebuffer = true;
+		_renderingToGarbageFramebuffer = true;
+
+		return;
+	}
+	CX::Instances::Log.verbose("CX_SlidePresenter") << "Finished acquiring.";
 
 	_slides.back().intended.duration = slideDuration;
 	_slides.back().intended.frameCount = _calculateFrameCount(slideDuration);
 
 	CX::Instances::Log.verbose("CX_SlidePresenter") << "Beginning to draw to framebuffer.";
 
-	_slides.back().framebuffer.begin();
+	_slides.back().framebuffer->begin();
 	_renderingToFramebuffer = true;
 
 	CX::Instances::Log.verbose("CX_SlidePresenter") << "Slide #" << (_slides.size() - 1) << " (" << _slides.back().name << ") drawing begun. Frame count: " << _slides.back().intended.frameCount;
@@ -274,8 +306,8 @@ void CX_SlidePresenter::endDrawingCurrentSlide(void) {
 		_garbageFbo.end();
 		_renderingToGarbageFramebuffer = false;
 	} else {
-		if (_slides.size() >= 0) {
-			_slides.back().framebuffer.end();
+		if (_renderingToFramebuffer && !_slides.empty() && _slides.back().framebuffer) {
+			_slides.back().framebuffer->end();
 		}
 	}
 
@@ -306,7 +338,8 @@ void CX_SlidePresenter::appendSlide(CX_SlidePresenter::Slide slide) {
 		endDrawingCurrentSlide();
 	}
 
-	if (!slide.framebuffer.isAllocated() && (slide.drawingFunction == nullptr)) {
+	bool fboReady = slide.framebuffer != nullptr && slide.framebuffer->isAllocated();
+	if (!fboReady && (slide.drawingFunction == nullptr)) {
 		CX::Instances::Log.error("CX_SlidePresenter") << "appendSlide(): The framebuffer was not allocated and the drawing function was a nullptr.";
 		return;
 	}
@@ -895,7 +928,7 @@ void CX_SlidePresenter::_finishPreviousSlide(void) {
 
 	if (_config.deallocateCompletedSlides) {
 		if (previousSlide.drawingFunction == nullptr) { //If there is no drawing function
-			previousSlide.framebuffer.allocate(0, 0); //"Deallocate" the framebuffer
+			previousSlide.framebuffer = nullptr; //Return the framebuffer to the pool
 		}
 	}
 
@@ -957,7 +990,7 @@ void CX_SlidePresenter::_handleFinalSlide(void) {
 		if (_config.deallocateCompletedSlides) {
 			for (unsigned int i = _currentSlide; i < _slides.size(); i++) {
 				if (_slides.at(i).drawingFunction == nullptr) { //If there is no drawing function
-					_slides.at(i).framebuffer.allocate(0, 0);
+					_slides.at(i).framebuffer = nullptr;
 				}
 			}
 		}
@@ -1046,11 +1079,11 @@ void CX_SlidePresenter::_renderCurrentSlide(void) {
 	_config.display->beginDrawingToBackBuffer();
 	if (_slides.at(_currentSlide).drawingFunction != nullptr) {
 		_slides.at(_currentSlide).drawingFunction();
-	} else {
+	} else if (_slides.at(_currentSlide).framebuffer != nullptr) {
 		ofPushStyle();
 		ofDisableAlphaBlending();
 		ofSetColor(255);
-		_slides.at(_currentSlide).framebuffer.draw(0, 0);
+		_slides.at(_currentSlide).framebuffer->draw(0, 0);
 		ofPopStyle();
 	}
 	_config.display->endDrawingToBackBuffer();
@@ -1074,6 +1107,13 @@ unsigned int CX_SlidePresenter::_calculateFrameCount(CX_Millis duration) {
 	return (unsigned int)framesInDuration;
 }
 
+CX_FramebufferPool::Format CX_SlidePresenter::_getFramebufferFormat(void) const {
+	ofRectangle resolution = _config.display->getResolution();
+
+	//Because we are always drawing over the whole display, there is no reason to have an alpha channel
+	return CX_FramebufferPool::Format(resolution.x, resolution.y, GL_RGB, CX::Util::getMsaaSampleCount());
+}
+
 //This is a bit odd. it is a direct copy of CX_Display::hasSwappedSinceLastCheck(). Why did I reimplement it
 //for CX_SlidePresenter? Because if a user is using a slide presenter and they are also checking
 //CX_Display::hasSwappedSinceLastCheck(), it is possible to end up in the strange position of the slide presenter
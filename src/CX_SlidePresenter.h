@@ -8,6 +8,7 @@
 #include "CX_Logger.h"
 #include "CX_Utilities.h"
 #include "CX_Display.h"
+#include "CX_FramebufferPool.h"
 #include "CX_InputManager.h"
 
 namespace CX {
@@ -166,7 +167,8 @@ namespace CX {
 				swappingMode(CX_SlidePresenter::SwappingMode::SINGLE_CORE_BLOCKING_SWAPS),
 				preSwapCPUHoggingDuration(2),
 				useFenceSync(true),
-				waitUntilFenceSyncComplete(false)
+				waitUntilFenceSyncComplete(false),
+				framebufferPool(nullptr)
 			{}
 
 			CX_Display *display; //!< A pointer to the display on which to present the slides.
@@ -203,6 +205,11 @@ namespace CX {
 			confirmation that rendering has completed is delayed but the rendering has actually occurred on time.
 			Does nothing if `swappingMode` is `MULTI_CORE`. */
 			bool waitUntilFenceSyncComplete;
+
+			/*! \brief The pool from which slide framebuffers are acquired. If this is `nullptr`, the slide
+			presenter creates its own pool during setup. The pool can be shared with other slide presenters
+			or with a CX_SlideBuffer. */
+			std::shared_ptr<CX_FramebufferPool> framebufferPool;
 		};
 
 		/*! Contains information about the presentation timing of the slide. */
@@ -227,6 +234,7 @@ namespace CX {
 
 			Slide() :
 				name(""),
+				framebuffer(nullptr),
 				drawingFunction(nullptr),
 				slidePresentedCallback(nullptr),
 				presentationStatus(PresStatus::NOT_STARTED)
@@ -235,8 +243,22 @@ namespace CX {
 			std::string name; //!< The name of the slide. Set by the user during slide creation.
 
 			/*! \brief A framebuffer containing image data that will be drawn to the screen during this slide's presentation.
-			If drawingFunction points to a function, `framebuffer` will not be drawn and `drawingFunction` will be called instead. */
-			ofFbo framebuffer;
+			If drawingFunction points to a function, `framebuffer` will not be drawn and `drawingFunction` will be called instead.
+			Framebuffers for slides drawn with beginDrawingNextSlide() come from the slide presenter's CX_FramebufferPool and
+			are returned to the pool when the slide is deleted.
+
+			\note This used to be an `ofFbo`. Code that used it directly, e.g. `slide.framebuffer.allocate(w, h)`, should use
+			getFramebuffer() instead, e.g. `slide.getFramebuffer().allocate(w, h)`. Copies of a Slide now share the framebuffer. */
+			std::shared_ptr<ofFbo> framebuffer;
+
+			/*! \brief Get the framebuffer of the slide as an `ofFbo`. If `framebuffer` is `nullptr`, a new, unallocated
+			framebuffer is created for the slide first. It does not come from a CX_FramebufferPool. */
+			ofFbo& getFramebuffer(void) {
+				if (framebuffer == nullptr) {
+					framebuffer = std::make_shared<ofFbo>();
+				}
+				return *framebuffer;
+			}
 
 			/*! \brief Pointer to a user function that will be called to draw the slide, rather than using the `framebuffer`.
 			
@@ -288,6 +310,7 @@ namespace CX {
 
 
 		void clearSlides(void);
+		bool reserve(size_t slideCount);
 
 		std::vector<CX_SlidePresenter::Slide>& getSlides(void);
 		CX_SlidePresenter::Slide& getSlideByName(std::string name);
@@ -326,6 +349,7 @@ namespace CX {
 		bool _renderingToGarbageFramebuffer;
 
 		unsigned int _calculateFrameCount(CX_Millis duration);
+		CX_FramebufferPool::Format _getFramebufferFormat(void) const;
 
 		void _singleCoreBlockingUpdate(void);
 		void _singleCoreThreadedUpdate(void);
@@ -0,0 +1,422 @@
+#include "CX_SlideQueue.h"
+
+#include "CX_Display.h"
+#include "CX_Logger.h"
+#include "CX_Private.h"
+
+namespace CX {
+
+CX_SlideQueue::CX_SlideQueue(CX_Display* display) :
+	_display(display),
+	_reserveRequest(0),
+	_results(1024),
+	_lostResults(0)
+{
+	_config.framebufferPool = std::make_shared<CX_FramebufferPool>();
+}
+
+/*! Set up the slide queue. This can be called while slides are queued.
+\param config The configuration to use.
+\return `false` if the configuration was invalid, `true` otherwise. */
+bool CX_SlideQueue::setup(const Configuration& config) {
+	if (config.renderAheadFrames == 0) {
+		Instances::Log.error("CX_SlideQueue") << "setup(): renderAheadFrames must be at least 1.";
+		return false;
+	}
+
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	std::shared_ptr<CX_FramebufferPool> previousPool = _config.framebufferPool;
+
+	_config = config;
+
+	if (_config.framebufferPool == nullptr) {
+		_config.framebufferPool = previousPool;
+	}
+
+	return true;
+}
+
+CX_SlideQueue::Configuration CX_SlideQueue::getConfiguration(void) {
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _config;
+}
+
+/*! Preallocate framebuffers for rendering slides ahead. Framebuffers can only be allocated on the thread that owns
+the rendering context, so if the frame queue is enabled, the allocation happens on the display thread shortly after
+this function is called.
+\param count The number of framebuffers that should be available. There is little reason to reserve more than
+`Configuration::renderAheadFrames + 2` framebuffers.
+\return `true` if the framebuffers were allocated or the allocation was requested, `false` otherwise. */
+bool CX_SlideQueue::reserve(size_t count) {
+	if (_display->renderingOnThisThread()) {
+		std::shared_ptr<CX_FramebufferPool> pool = getConfiguration().framebufferPool;
+		pool->reserve(count, _getFramebufferFormat());
+		return true;
+	}
+
+	CX_DisplayThread* dt = _display->getDisplayThread();
+	if (!dt->isThreadRunning() || !dt->frameQueueEnabled()) {
+		Instances::Log.error("CX_SlideQueue") << "reserve(): The rendering context is not available on this thread or the display thread.";
+		return false;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_reserveRequest = std::max(_reserveRequest, count);
+	}
+
+	dt->wakeThread();
+	return true;
+}
+
+/*! Queue a slide to be presented starting on `slide.intended.startFrame`. If the slide has a drawing function,
+the drawing function is called on the display thread to render the slide into a framebuffer up to
+`Configuration::renderAheadFrames` frames before the start frame. Otherwise, `slide.framebuffer` is drawn.
+
+If a slide is already queued for the same start frame, it is replaced.
+
+\param slide The slide to queue.
+\param callback A function that is called on the display thread with the result of presenting the slide.
+The results can also be retrieved on any one thread with popResult().
+\return `true` if the slide was queued, `false` otherwise.
+*/
+bool CX_SlideQueue::queueSlide(const CX_SlideBuffer::Slide& slide, SlideCallback callback) {
+
+	std::shared_ptr<Entry> entry = std::make_shared<Entry>();
+
+	entry->slide = slide;
+	entry->slide.resetPresentationInfo();
+	entry->callback = callback;
+
+	if (entry->slide.drawingFunction != nullptr) {
+		entry->drawingFunction = entry->slide.drawingFunction;
+		entry->slide.drawingFunction = nullptr;
+		entry->slide.framebuffer = nullptr;
+	} else if (entry->slide.framebuffer != nullptr && entry->slide.framebuffer->isAllocated()) {
+		entry->renderedAhead = true; // Nothing to render
+	} else {
+		Instances::Log.error("CX_SlideQueue") << "queueSlide(): Slide \"" << slide.name << "\" for frame " << slide.intended.startFrame <<
+			" was ignored because it had neither a drawing function nor an allocated framebuffer.";
+		return false;
+	}
+
+	if (entry->slide.name == "") {
+		entry->slide.name = "Frame " + ofToString(entry->slide.intended.startFrame);
+	}
+
+	return _insert(entry);
+}
+
+/*! Queue a slide that is drawn by `drawingFunction`. See queueSlide(const CX_SlideBuffer::Slide&, SlideCallback). */
+bool CX_SlideQueue::queueSlide(FrameNumber startFrame, std::function<void(void)> drawingFunction, std::string name, SlideCallback callback) {
+	CX_SlideBuffer::Slide slide;
+	slide.name = name;
+	slide.intended.startFrame = startFrame;
+	slide.intended.frameDuration = 1;
+	slide.drawingFunction = drawingFunction;
+	return queueSlide(slide, callback);
+}
+
+/*! Queue a slide that shows the contents of `framebuffer`. See queueSlide(const CX_SlideBuffer::Slide&, SlideCallback). */
+bool CX_SlideQueue::queueSlide(FrameNumber startFrame, std::shared_ptr<ofFbo> framebuffer, std::string name, SlideCallback callback) {
+	CX_SlideBuffer::Slide slide;
+	slide.name = name;
+	slide.intended.startFrame = startFrame;
+	slide.intended.frameDuration = 1;
+	slide.framebuffer = framebuffer;
+	return queueSlide(slide, callback);
+}
+
+bool CX_SlideQueue::_insert(std::shared_ptr<Entry> entry) {
+
+	FrameNumber startFrame = entry->slide.intended.startFrame;
+
+	CX_DisplayThread* dt = _display->getDisplayThread();
+	if (!dt->isThreadRunning() || !dt->frameQueueEnabled()) {
+		Instances::Log.warning("CX_SlideQueue") << "Slide for frame number " << startFrame <<
+			" ignored because the display thread was not running or the frame queue was disabled.";
+		return false;
+	}
+
+	FrameNumber nextFrameNumber = _display->swapData.getNextSwapUnit();
+	if (startFrame < nextFrameNumber) {
+		Instances::Log.warning("CX_SlideQueue") << "Slide for frame number " << startFrame <<
+			" arrived late (next frame is " << nextFrameNumber << ") and was ignored.";
+		return false;
+	}
+
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	auto it = std::lower_bound(_queue.begin(), _queue.end(), startFrame,
+		[](const std::shared_ptr<Entry>& e, FrameNumber f) { return e->slide.intended.startFrame < f; });
+
+	if (it != _queue.end() && (*it)->slide.intended.startFrame == startFrame) {
+		Instances::Log.verbose("CX_SlideQueue") << "Slide for frame number " << startFrame << " replaced.";
+		*it = entry;
+	} else {
+		_queue.insert(it, entry);
+	}
+
+	dt->wakeThread();
+
+	return true;
+}
+
+/*! Move the slide queued for `oldStartFrame` to `newStartFrame`, replacing any slide queued for `newStartFrame`.
+If the slide was already rendered ahead, the rendered framebuffer is kept.
+\return `false` if no slide was queued for `oldStartFrame`, `true` otherwise. */
+bool CX_SlideQueue::requeueSlide(FrameNumber oldStartFrame, FrameNumber newStartFrame) {
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	std::shared_ptr<Entry> entry;
+	for (auto it = _queue.begin(); it != _queue.end(); it++) {
+		if ((*it)->slide.intended.startFrame == oldStartFrame) {
+			entry = *it;
+			_queue.erase(it);
+			break;
+		}
+	}
+
+	if (entry == nullptr) {
+		Instances::Log.warning("CX_SlideQueue") << "requeueSlide(): Nothing queued for frame " << oldStartFrame << ".";
+		return false;
+	}
+
+	entry->slide.intended.startFrame = newStartFrame;
+
+	auto it = std::lower_bound(_queue.begin(), _queue.end(), newStartFrame,
+		[](const std::shared_ptr<Entry>& e, FrameNumber f) { return e->slide.intended.startFrame < f; });
+
+	if (it != _queue.end() && (*it)->slide.intended.startFrame == newStartFrame) {
+		Instances::Log.warning("CX_SlideQueue") << "requeueSlide(): Slide queued for frame " <<
+			newStartFrame << " was replaced with the slide queued for frame " << oldStartFrame << ".";
+		*it = entry;
+	} else {
+		_queue.insert(it, entry);
+	}
+
+	return true;
+}
+
+/*! Remove all queued slides. A slide that has already been copied into the back buffer will still be presented. */
+void CX_SlideQueue::clear(void) {
+	std::lock_guard<std::mutex> lock(_mutex);
+	_queue.clear();
+}
+
+/*! \brief Get the number of slides that are queued and have not yet been copied into the back buffer. */
+size_t CX_SlideQueue::getQueuedSlideCount(void) {
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _queue.size();
+}
+
+/*! \brief Get the number of queued slides that have been rendered ahead into framebuffers. */
+size_t CX_SlideQueue::getRenderedAheadCount(void) {
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	size_t count = 0;
+	for (const std::shared_ptr<Entry>& e : _queue) {
+		if (e->renderedAhead) {
+			count++;
+		}
+	}
+	return count;
+}
+
+/*! \brief Get the start frames of all queued slides, in order. */
+std::vector<FrameNumber> CX_SlideQueue::getQueuedStartFrames(void) {
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	std::vector<FrameNumber> rval;
+	for (const std::shared_ptr<Entry>& e : _queue) {
+		rval.push_back(e->slide.intended.startFrame);
+	}
+	return rval;
+}
+
+/*! Get the result of the oldest presented or dropped slide. This does not block and does not take any locks.
+Results must be popped from only one thread at a time.
+\param result Set to the result, if there was one.
+\return `true` if there was a result, `false` if there were no results. */
+bool CX_SlideQueue::popResult(SlideResult& result) {
+	return _results.pop(result);
+}
+
+/*! \brief Get the number of results that are available from popResult(). */
+size_t CX_SlideQueue::getResultCount(void) {
+	return _results.size();
+}
+
+/*! \brief Discard all results that have not been popped. Must be called from the same thread as popResult(). */
+void CX_SlideQueue::clearResults(void) {
+	_results.clear();
+}
+
+/*! \brief Get the number of results that were lost because the result queue was full. Pop results regularly to avoid this. */
+uint64_t CX_SlideQueue::getLostResultCount(void) {
+	return _lostResults.load();
+}
+
+CX_FramebufferPool::Format CX_SlideQueue::_getFramebufferFormat(void) const {
+	ofRectangle resolution = _display->getResolution();
+	return CX_FramebufferPool::Format(resolution.x, resolution.y, GL_RGB, CX::Util::getMsaaSampleCount());
+}
+
+void CX_SlideQueue::_update(void) {
+
+	FrameNumber nextFrameNumber = _display->swapData.getNextSwapUnit();
+
+	std::vector<std::shared_ptr<Entry>> dropped;
+	std::vector<std::shared_ptr<Entry>> toRender;
+	std::shared_ptr<CX_FramebufferPool> pool;
+	size_t reserveRequest = 0;
+
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+
+		while (!_queue.empty() && _queue.front()->slide.intended.startFrame < nextFrameNumber) {
+			dropped.push_back(_queue.front());
+			_queue.pop_front();
+		}
+
+		FrameNumber renderAheadLimit = nextFrameNumber + _config.renderAheadFrames;
+		for (size_t i = 0; i < _queue.size() && i < _config.renderAheadFrames; i++) {
+			if (_queue[i]->slide.intended.startFrame >= renderAheadLimit) {
+				break;
+			}
+			if (!_queue[i]->renderedAhead) {
+				toRender.push_back(_queue[i]);
+			}
+		}
+
+		pool = _config.framebufferPool;
+		std::swap(reserveRequest, _reserveRequest);
+	}
+
+	for (std::shared_ptr<Entry>& e : dropped) {
+		Instances::Log.warning("CX_SlideQueue") << "Slide \"" << e->slide.name << "\" was dropped because its start frame (" <<
+			e->slide.intended.startFrame << ") passed.";
+
+		SlideResult result;
+		result.name = e->slide.name;
+		result.desiredStartFrame = e->slide.intended.startFrame;
+		result.dropped = true;
+		_reportResult(*e, result);
+	}
+
+	if (reserveRequest > 0) {
+		pool->reserve(reserveRequest, _getFramebufferFormat());
+	}
+
+	// Drawing functions are called without holding the lock so that the main thread can keep queueing slides
+	for (std::shared_ptr<Entry>& e : toRender) {
+		_renderAhead(e, pool);
+	}
+
+	for (size_t i = 0; i < _syncingEntries.size(); ) {
+		Entry& e = *_syncingEntries[i];
+		e.preRenderFence.updateSync();
+		if (e.preRenderFence.isSyncing()) {
+			i++;
+		} else {
+			_syncingEntries.erase(_syncingEntries.begin() + i);
+		}
+	}
+
+	if (_backBufferEntry == nullptr) {
+		std::lock_guard<std::mutex> lock(_mutex);
+
+		if (!_queue.empty() && _queue.front()->slide.intended.startFrame == nextFrameNumber && _queue.front()->renderedAhead) {
+			_backBufferEntry = _queue.front();
+			_queue.pop_front();
+		}
+	}
+
+	if (_backBufferEntry != nullptr) {
+		if (_backBufferEntry->slide.isInactive()) {
+			_backBufferEntry->slide.renderSlide(_display);
+		} else {
+			_backBufferEntry->slide.updateRenderStatus();
+		}
+	}
+}
+
+void CX_SlideQueue::_renderAhead(std::shared_ptr<Entry> entry, std::shared_ptr<CX_FramebufferPool> pool) {
+
+	std::shared_ptr<ofFbo> fbo = pool->acquire(_getFramebufferFormat());
+	if (fbo == nullptr) {
+		Instances::Log.error("CX_SlideQueue") << "Could not acquire a framebuffer for slide \"" << entry->slide.name << "\".";
+		return;
+	}
+
+	fbo->begin();
+	entry->drawingFunction();
+	fbo->end();
+
+	entry->preRenderFence.startSync();
+	_syncingEntries.push_back(entry);
+
+	entry->slide.framebuffer = fbo;
+
+	std::lock_guard<std::mutex> lock(_mutex);
+	entry->renderedAhead = true;
+}
+
+bool CX_SlideQueue::_bufferSwapped(const Sync::SwapData& swap, SlideResult* result) {
+
+	if (_backBufferEntry == nullptr) {
+		return false; // Nothing new was swapped in
+	}
+
+	if (_onScreenEntry != nullptr) {
+		_onScreenEntry->slide.swappedOut(swap.time, swap.unit);
+		_onScreenEntry = nullptr; // The framebuffer goes back to the pool
+	}
+
+	Entry& entry = *_backBufferEntry;
+
+	entry.slide.swappedIn(swap.time, swap.unit);
+
+	if (entry.preRenderFence.isSyncing()) {
+		entry.preRenderFence.updateSync();
+	}
+
+	SlideResult res;
+	res.name = entry.slide.name;
+	res.desiredStartFrame = entry.slide.intended.startFrame;
+	res.actualStartFrame = swap.unit;
+	res.startTime = swap.time;
+
+	if (entry.preRenderFence.syncComplete() && entry.preRenderFence.syncSuccess()) {
+		res.preRenderCompleteTime = entry.preRenderFence.getSyncTime();
+	}
+
+	res.renderTimeValid = !entry.slide.presInfo.swappedBeforeRenderingComplete && entry.slide.presInfo.renderCompleteTime >= CX_Millis(0);
+	if (res.renderTimeValid) {
+		res.renderCompleteTime = entry.slide.presInfo.renderCompleteTime;
+	}
+
+	_reportResult(entry, res);
+
+	if (result != nullptr) {
+		*result = res;
+	}
+
+	_onScreenEntry = _backBufferEntry;
+	_backBufferEntry = nullptr;
+
+	return true;
+}
+
+void CX_SlideQueue::_reportResult(const Entry& entry, const SlideResult& result) {
+	if (entry.callback != nullptr) {
+		entry.callback(result);
+	}
+
+	if (!_results.push(result)) {
+		_lostResults++;
+	}
+}
+
+} // namespace CX
@@ -0,0 +1,169 @@
+#pragma once
+
+#include <deque>
+#include <mutex>
+#include <atomic>
+
+#include "CX_SlideBuffer.h"
+#include "CX_FramebufferPool.h"
+#include "CX_Utilities.h"
+
+namespace CX {
+
+	/*! This class streams slides to the display from the display thread. Once slides are queued for their start frames,
+	the display thread renders up to `Configuration::renderAheadFrames` slides ahead into framebuffers from a
+	CX_FramebufferPool, copies each slide into the back buffer when its start frame is next, and reports the outcome
+	of each slide through a lock-free result queue. The main thread never needs to participate in individual frames,
+	so per-frame stimuli (e.g. dynamic noise) can be presented continuously while the main thread does other work.
+
+	The slide queue belongs to the display thread. Get it with `Disp.getDisplayThread()->getSlideQueue()`. The frame queue
+	must be enabled with CX_DisplayThread::enableFrameQueue() so that the display thread owns the rendering context.
+
+	\code{.cpp}
+	CX_DisplayThread* dt = Disp.getDisplayThread();
+	dt->enableFrameQueue(true);
+
+	CX_SlideQueue* sq = dt->getSlideQueue();
+
+	FrameNumber start = Disp.getLastFrameNumber() + 10;
+	for (FrameNumber i = 0; i < 120; i++) {
+		sq->queueSlide(start + i, [](void) {
+			ofBackground(0);
+			// draw a new noise field each frame
+		});
+	}
+
+	CX_SlideQueue::SlideResult res;
+	while (sq->getQueuedSlideCount() > 0 || sq->getResultCount() > 0) {
+		while (sq->popResult(res)) {
+			if (res.dropped || res.actualStartFrame != res.desiredStartFrame) {
+				Log.warning() << "Slide " << res.name << " was not presented on time.";
+			}
+		}
+		// do other work
+	}
+	\endcode
+
+	\note Drawing functions and framebuffers of queued slides are used on the display thread, so drawing functions must not
+	touch data that the main thread modifies without synchronization. Callbacks passed to queueSlide() and
+	`Slide::slidePresentedCallback` are also called on the display thread.
+
+	\ingroup video
+	*/
+	class CX_SlideQueue {
+	public:
+
+		struct Configuration {
+
+			Configuration(void) :
+				renderAheadFrames(3),
+				framebufferPool(nullptr)
+			{}
+
+			/*! \brief The maximum number of slides that are rendered into framebuffers ahead of their start frames.
+			More frames ahead smooth over occasional slow drawing functions at the cost of video memory. */
+			unsigned int renderAheadFrames;
+
+			/*! \brief The pool from which framebuffers for slides with drawing functions are acquired. If `nullptr`, the
+			slide queue uses its own pool. */
+			std::shared_ptr<CX_FramebufferPool> framebufferPool;
+		};
+
+		/*! Information about the presentation of a queued slide. */
+		struct SlideResult {
+
+			SlideResult(void) :
+				name(""),
+				desiredStartFrame(0),
+				actualStartFrame(0),
+				startTime(-1),
+				preRenderCompleteTime(-1),
+				renderTimeValid(false),
+				renderCompleteTime(-1),
+				dropped(false)
+			{}
+
+			std::string name; //!< The name of the slide.
+
+			FrameNumber desiredStartFrame; //!< The frame on which the slide was queued to start.
+			FrameNumber actualStartFrame; //!< The frame on which the slide actually started. Not valid if `dropped` is `true`.
+			CX_Millis startTime; //!< The time at which the slide started. Not valid if `dropped` is `true`.
+
+			/*! \brief The time at which rendering of the slide into its framebuffer was confirmed complete by a fence sync,
+			or -1 if the slide was not rendered ahead (e.g. it had a user framebuffer) or confirmation was not received. */
+			CX_Millis preRenderCompleteTime;
+
+			bool renderTimeValid; //!< `true` if copying the slide into the back buffer was confirmed complete before the swap.
+			CX_Millis renderCompleteTime; //!< The time at which copying the slide into the back buffer was complete, if `renderTimeValid`.
+
+			bool dropped; //!< `true` if the start frame of the slide passed before the slide could be presented.
+		};
+
+		typedef std::function<void(const SlideResult&)> SlideCallback;
+
+		bool setup(const Configuration& config);
+		Configuration getConfiguration(void);
+
+		bool reserve(size_t count);
+
+		bool queueSlide(const CX_SlideBuffer::Slide& slide, SlideCallback callback = nullptr);
+		bool queueSlide(FrameNumber startFrame, std::function<void(void)> drawingFunction, std::string name = "", SlideCallback callback = nullptr);
+		bool queueSlide(FrameNumber startFrame, std::shared_ptr<ofFbo> framebuffer, std::string name = "", SlideCallback callback = nullptr);
+
+		bool requeueSlide(FrameNumber oldStartFrame, FrameNumber newStartFrame);
+		void clear(void);
+
+		size_t getQueuedSlideCount(void);
+		size_t getRenderedAheadCount(void);
+		std::vector<FrameNumber> getQueuedStartFrames(void);
+
+		bool popResult(SlideResult& result);
+		size_t getResultCount(void);
+		void clearResults(void);
+		uint64_t getLostResultCount(void);
+
+	private:
+
+		friend class CX_DisplayThread;
+
+		CX_SlideQueue(CX_Display* display);
+
+		struct Entry {
+			Entry(void) :
+				renderedAhead(false)
+			{}
+
+			CX_SlideBuffer::Slide slide;
+			std::function<void(void)> drawingFunction; // Rendered into slide.framebuffer on the display thread
+			bool renderedAhead;
+			Private::CX_GLFenceSync preRenderFence;
+			SlideCallback callback;
+		};
+
+		CX_Display* _display;
+
+		std::mutex _mutex;
+		Configuration _config;
+		std::deque<std::shared_ptr<Entry>> _queue; // Sorted by start frame
+		size_t _reserveRequest;
+
+		// Only used on the display thread
+		std::shared_ptr<Entry> _backBufferEntry;
+		std::shared_ptr<Entry> _onScreenEntry;
+		std::vector<std::shared_ptr<Entry>> _syncingEntries;
+
+		Util::SpscQueue<SlideResult> _results;
+		std::atomic<uint64_t> _lostResults;
+
+		bool _insert(std::shared_ptr<Entry> entry);
+		CX_FramebufferPool::Format _getFramebufferFormat(void) const;
+
+		// Called by CX_DisplayThread on the display thread
+		void _update(void);
+		bool _bufferSwapped(const Sync::SwapData& swap, SlideResult* result);
+
+		void _renderAhead(std::shared_ptr<Entry> entry, std::shared_ptr<CX_FramebufferPool> pool);
+		void _reportResult(const Entry& entry, const SlideResult& result);
+	};
+
+} // namespace CX
@@ -163,6 +163,36 @@ bool CX_SoundBufferPlayer::queuePlayback(SampleFrame sampleFrame, bool restart)
 	return true;
 }
 
+/*! Queue playback to start at the same time as a swap in another domain, such as a frame on the display.
+The swap unit is converted to a sample frame of the sound stream using both domains' fitted models
+(see Sync::convert()), so the display and sound stream must both be swapping stably.
+
+\param sourceClient The data client for the other domain, e.g. `&Disp.swapClient`.
+\param sourceUnit The swap unit in the other domain, e.g. a frame number.
+\param restart If `true`, playback will be restarted from the beginning of the sound.
+\return `true` if playback was queued, `false` otherwise.
+
+\code{.cpp}
+FrameNumber stimFrame = Disp.getLastFrameNumber() + 10;
+// ... queue drawing of the stimulus on stimFrame
+player.queuePlayback(&Disp.swapClient, stimFrame);
+\endcode
+*/
+bool CX_SoundBufferPlayer::queuePlayback(Sync::DataClient* sourceClient, SwapUnit sourceUnit, bool restart) {
+
+	if (!_checkPlaybackRequirements("queuePlayback")) {
+		return false;
+	}
+
+	Sync::SwapUnitPrediction sp = Sync::convert(sourceClient, sourceUnit, &_soundStream->swapClient);
+	if (!sp.usable) {
+		CX::Instances::Log.error("CX_SoundBufferPlayer") << "queuePlayback(): The start sample frame could not be predicted. Are both domains swapping stably?";
+		return false;
+	}
+
+	return queuePlayback(sp.prediction(), restart);
+}
+
 bool CX_SoundBufferPlayer::_checkPlaybackRequirements(std::string callerName) {
 
 	if (_soundStream == nullptr) {
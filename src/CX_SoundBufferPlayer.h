@@ -51,6 +51,7 @@ namespace CX  {
 		bool play(bool restart = true);
 		bool queuePlayback(CX_Millis startTime, CX_Millis timeout, bool restart = true);
 		bool queuePlayback(SampleFrame sampleFrame, bool restart = true);
+		bool queuePlayback(Sync::DataClient* sourceClient, SwapUnit sourceUnit, bool restart = true);
 
 		// 4. (Optional) Check playback status or stop the sound before it finishes
 		bool isPlaying(void);
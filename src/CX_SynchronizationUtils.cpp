@@ -64,14 +64,102 @@ namespace Sync {
 	}
 
 
+	/////////////////
+	// SwapHistory //
+	/////////////////
+
+	SwapHistory::SwapHistory(size_t capacity) :
+		_data(capacity),
+		_start(0),
+		_size(0)
+	{}
+
+	/*! \brief Set the capacity of the buffer. Clears the buffer. */
+	void SwapHistory::setCapacity(size_t capacity) {
+		_data.assign(capacity, SwapData());
+		_start = 0;
+		_size = 0;
+	}
+
+	size_t SwapHistory::capacity(void) const {
+		return _data.size();
+	}
+
+	size_t SwapHistory::size(void) const {
+		return _size;
+	}
+
+	bool SwapHistory::empty(void) const {
+		return _size == 0;
+	}
+
+	bool SwapHistory::full(void) const {
+		return _size == _data.size();
+	}
+
+	void SwapHistory::clear(void) {
+		_start = 0;
+		_size = 0;
+	}
+
+	/*! Add a sample to the end of the buffer. If the buffer is full, the oldest sample is overwritten.
+	If the capacity is 0, nothing happens. */
+	void SwapHistory::push_back(const SwapData& data) {
+		if (_data.empty()) {
+			return;
+		}
+
+		if (_size < _data.size()) {
+			_data[(_start + _size) % _data.size()] = data;
+			_size++;
+		} else {
+			_data[_start] = data;
+			_start = (_start + 1) % _data.size();
+		}
+	}
+
+	const SwapData& SwapHistory::operator[](size_t i) const {
+		return _data[(_start + i) % _data.size()];
+	}
+
+	SwapData& SwapHistory::operator[](size_t i) {
+		return _data[(_start + i) % _data.size()];
+	}
+
+	const SwapData& SwapHistory::front(void) const {
+		return (*this)[0];
+	}
+
+	const SwapData& SwapHistory::back(void) const {
+		return (*this)[_size - 1];
+	}
+
+	std::deque<SwapData> SwapHistory::toDeque(void) const {
+		std::deque<SwapData> rval;
+		for (size_t i = 0; i < _size; i++) {
+			rval.push_back((*this)[i]);
+		}
+		return rval;
+	}
+
 	///////////////////////
 	// DataContainer //
 	///////////////////////
 
 	DataContainer::DataContainer(void) :
+		_sequence(0),
+		_ring(nullptr),
+		_stored(0),
+		_size(0),
+		_generation(0),
+		_activeReaders(0),
 		_timeStoreNextSwapUnit(0)
 	{}
 
+	DataContainer::~DataContainer(void) {
+		_stopListeningToSources();
+	}
+
 	void DataContainer::setup(const Configuration& config) {
 		std::lock_guard<std::recursive_mutex> lock(_mutex);
 
@@ -79,6 +167,13 @@ namespace Sync {
 
 		_config = config;
 
+		_beginWrite();
+		_allocateRing(_config.sampleSize);
+		_stored.store(0, std::memory_order_relaxed);
+		_size.store(0, std::memory_order_relaxed);
+		_generation.fetch_add(1, std::memory_order_relaxed);
+		_endWrite();
+
 		_timeStoreNextSwapUnit = 0;
 
 		_polledSwapListener = getPolledSwapListener();
@@ -139,94 +234,157 @@ namespace Sync {
 		_containerSourceHelper.stopListening();
 	}
 
+	// Seqlock writer side. Must be called with _mutex locked.
+	void DataContainer::_beginWrite(void) {
+		_sequence.fetch_add(1, std::memory_order_relaxed); // odd: write in progress
+		std::atomic_thread_fence(std::memory_order_release);
+	}
 
+	void DataContainer::_endWrite(void) {
+		_sequence.fetch_add(1, std::memory_order_release); // even: done
+	}
 
-	void DataContainer::storeSwap(CX_Millis time) {
-		std::lock_guard<std::recursive_mutex> lock(_mutex);
+	// Must be called between _beginWrite() and _endWrite().
+	void DataContainer::_writeSample(const SwapData& data) {
+		// _ring is only stored with _mutex locked, so writers can load it relaxed. Readers cannot: see _reclaimRings().
+		Ring* ring = _ring.load(std::memory_order_relaxed);
+		if (ring == nullptr || ring->capacity == 0) {
+			return;
+		}
 
-		// adjust for latency
-		time -= _config.latency;
+		uint64_t stored = _stored.load(std::memory_order_relaxed);
 
-		_data.push_back(SwapData(time, _timeStoreNextSwapUnit));
+		Slot& slot = ring->at(stored);
+		slot.time.store(data.time.nanos(), std::memory_order_relaxed);
+		slot.unit.store(data.unit, std::memory_order_relaxed);
 
-		// remove excess data
-		while (_data.size() > _config.sampleSize) {
-			_data.pop_front();
-		}
+		_stored.store(stored + 1, std::memory_order_relaxed);
+		_size.store(std::min(_size.load(std::memory_order_relaxed) + 1, ring->capacity), std::memory_order_relaxed);
+	}
 
-		// advance swap unit
-		_timeStoreNextSwapUnit += _config.unitsPerSwap;
+	// Must be called between _beginWrite() and _endWrite(). Does not reset _stored or _size.
+	void DataContainer::_allocateRing(size_t capacity) {
+		_rings.push_back(std::unique_ptr<Ring>(new Ring(capacity)));
+		_ring.store(_rings.back().get(), std::memory_order_seq_cst);
+		_reclaimRings();
+	}
 
-		ofNotifyEvent(this->newDataEvent, _data);
+	// Must be called with _mutex locked. Readers register in _activeReaders before loading _ring, so if there are
+	// no active readers after the current ring was published, no reader can hold or later load an old ring.
+	// This only holds if the registration, the load of _ring by readers, the store of _ring, and the check of
+	// _activeReaders are all sequentially consistent: with weaker orderings, a reader could load the old ring while
+	// the writer still sees no readers (a store-buffering race).
+	void DataContainer::_reclaimRings(void) {
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		if (_rings.size() > 1 && _activeReaders.load(std::memory_order_seq_cst) == 0) {
+			_rings.erase(_rings.begin(), _rings.end() - 1);
+		}
 	}
 
-	void DataContainer::storeSwap(SwapData data) {
+	// Must be called without _mutex locked, so that listeners do not hold up other writers.
+	void DataContainer::_notifyNewData(bool reset) {
+		NewData nd(this, getLastSwapData(), size(), reset);
+		ofNotifyEvent(this->newDataEvent, nd);
+	}
 
-		std::lock_guard<std::recursive_mutex> lock(_mutex);
+	void DataContainer::storeSwap(CX_Millis time) {
+		{
+			std::lock_guard<std::recursive_mutex> lock(_mutex);
 
-		// adjust for latency
-		data.time -= _config.latency;
+			// adjust for latency
+			time -= _config.latency;
 
-		_data.push_back(data);
+			_beginWrite();
+			_writeSample(SwapData(time, _timeStoreNextSwapUnit));
+			_endWrite();
+			_reclaimRings();
 
-		// remove excess data
-		while (_data.size() > _config.sampleSize) {
-			_data.pop_front();
+			// advance swap unit
+			_timeStoreNextSwapUnit += _config.unitsPerSwap;
 		}
 
-		// advance swap unit
-		//_timeStoreNextSwapUnit += _config.unitsPerSwap;
+		_notifyNewData(false);
+	}
+
+	void DataContainer::storeSwap(SwapData data) {
+		{
+			std::lock_guard<std::recursive_mutex> lock(_mutex);
+
+			// adjust for latency
+			data.time -= _config.latency;
+
+			_beginWrite();
+			_writeSample(data);
+			_endWrite();
+			_reclaimRings();
 
-		ofNotifyEvent(this->newDataEvent, _data);
+			// advance swap unit
+			//_timeStoreNextSwapUnit += _config.unitsPerSwap;
+		}
 
+		_notifyNewData(false);
 	}
 
 	size_t DataContainer::size(void) {
-		std::lock_guard<std::recursive_mutex> lock(_mutex);
-		return _data.size();
+		return _size.load(std::memory_order_acquire);
 	}
 
 	bool DataContainer::full(void) {
 		std::lock_guard<std::recursive_mutex> lock(_mutex);
-		return _data.size() == _config.sampleSize;
+		return size() == _config.sampleSize;
 	}
 
 	void DataContainer::clear(bool keepLastSample, bool resetSwapUnit) {
-		std::lock_guard<std::recursive_mutex> lock(_mutex);
-
-		SwapData last;
-		if (!_data.empty()) {
-			last = _data.back();
-		} else {
-			keepLastSample = false;
-		}
+		{
+			std::lock_guard<std::recursive_mutex> lock(_mutex);
 
-		_data.clear();
+			SwapData last = getLastSwapData();
+			if (size() == 0) {
+				keepLastSample = false;
+			}
 
-		if (resetSwapUnit) {
-			last.unit = 0; // reset last to 0
-			_timeStoreNextSwapUnit = _config.unitsPerSwap; // set next to 0 plus unitsPerSwap
-		}
+			if (resetSwapUnit) {
+				last.unit = 0; // reset last to 0
+				_timeStoreNextSwapUnit = _config.unitsPerSwap; // set next to 0 plus unitsPerSwap
+			}
 
-		if (keepLastSample) {
-			_data.push_back(std::move(last));
+			_beginWrite();
+			_stored.store(0, std::memory_order_relaxed);
+			_size.store(0, std::memory_order_relaxed);
+			_generation.fetch_add(1, std::memory_order_relaxed);
+			if (keepLastSample) {
+				_writeSample(last);
+			}
+			_endWrite();
 		}
 
-		ofNotifyEvent(this->newDataEvent, _data);
+		_notifyNewData(true);
 	}
 
 	void DataContainer::setLatency(CX_Millis latency) {
-		std::lock_guard<std::recursive_mutex> lock(_mutex);
+		{
+			std::lock_guard<std::recursive_mutex> lock(_mutex);
 
-		CX_Millis latencyUpdate = _config.latency - latency;
+			CX_Millis latencyUpdate = _config.latency - latency;
 
-		for (SwapData& d : _data) {
-			d.time += latencyUpdate;
-		}
+			_beginWrite();
 
-		_config.latency = latency;
+			Ring* ring = _ring.load(std::memory_order_relaxed);
+			uint64_t stored = _stored.load(std::memory_order_relaxed);
+			size_t n = _size.load(std::memory_order_relaxed);
+
+			for (uint64_t i = stored - n; i < stored; i++) {
+				Slot& slot = ring->at(i);
+				slot.time.store(slot.time.load(std::memory_order_relaxed) + latencyUpdate.nanos(), std::memory_order_relaxed);
+			}
+			_generation.fetch_add(1, std::memory_order_relaxed);
 
-		ofNotifyEvent(this->newDataEvent, _data);
+			_endWrite();
+
+			_config.latency = latency;
+		}
+
+		_notifyNewData(true);
 	}
 
 	CX_Millis DataContainer::getLatency(void) {
@@ -234,9 +392,29 @@ namespace Sync {
 		return _config.latency;
 	}
 
+	/*! Set the number of samples that are kept. The most recent samples are preserved.
+	\param size The new sample size. */
 	void DataContainer::setSampleSize(size_t size) {
 		std::lock_guard<std::recursive_mutex> lock(_mutex);
+
 		_config.sampleSize = size;
+
+		Ring* ring = _ring.load(std::memory_order_relaxed);
+		if (ring && size == ring->capacity) {
+			return;
+		}
+
+		SwapHistory kept = getSnapshot(size);
+
+		_beginWrite();
+		_allocateRing(size);
+		_stored.store(0, std::memory_order_relaxed);
+		_size.store(0, std::memory_order_relaxed);
+		for (size_t i = 0; i < kept.size(); i++) {
+			_writeSample(kept[i]);
+		}
+		_generation.fetch_add(1, std::memory_order_relaxed);
+		_endWrite();
 	}
 
 	void DataContainer::setMinimumSampleSize(size_t minSize) {
@@ -270,16 +448,60 @@ namespace Sync {
 		return getLastSwapData().unit + _config.unitsPerSwap;
 	}
 
-	DataContainer::LockedDataPointer DataContainer::getLockedDataPointer(void) {
-		return LockedDataPointer(&_data, _mutex);
+	/*! Get a consistent copy of the most recent swap data. This never blocks the thread that is storing swaps:
+	if a swap is stored while the copy is being made, the copy is retried.
+
+	\param newest The maximum number of samples to copy, starting from the newest sample.
+	\param generation If not `nullptr`, receives a counter that changes whenever existing data are
+	cleared or modified (rather than new data being added). Useful for detecting whether a previous
+	snapshot is still a prefix of the current data.
+	\return The swap data, from oldest to newest. */
+	SwapHistory DataContainer::getSnapshot(size_t newest, uint64_t* generation) {
+		SwapHistory rval;
+
+		ReaderScope reader(_activeReaders);
+		while (true) {
+			uint64_t seq = _sequence.load(std::memory_order_acquire);
+			if (seq & 1) {
+				std::this_thread::yield();
+				continue;
+			}
+
+			// seq_cst, so that this load is ordered after the registration in _activeReaders. See _reclaimRings().
+			Ring* ring = _ring.load(std::memory_order_seq_cst);
+			uint64_t stored = _stored.load(std::memory_order_relaxed);
+			size_t n = std::min(_size.load(std::memory_order_relaxed), newest);
+			uint64_t gen = _generation.load(std::memory_order_relaxed);
+
+			if (ring == nullptr) {
+				n = 0;
+			} else {
+				n = std::min(n, ring->capacity);
+			}
+
+			if (rval.capacity() != n) {
+				rval.setCapacity(n);
+			} else {
+				rval.clear();
+			}
+
+			for (uint64_t i = stored - n; i < stored; i++) {
+				const Slot& slot = ring->at(i);
+				rval.push_back(SwapData(CX_Nanos(slot.time.load(std::memory_order_relaxed)), slot.unit.load(std::memory_order_relaxed)));
+			}
+
+			std::atomic_thread_fence(std::memory_order_acquire);
+			if (_sequence.load(std::memory_order_relaxed) == seq) {
+				if (generation) {
+					*generation = gen;
+				}
+				return rval;
+			}
+		}
 	}
 
-	// yeah, I'm just gonna go ahead and say that copying the data is not that costly. it's three 64 bit ints per one of maybe 100 samples.
 	std::deque<SwapData> DataContainer::copyData(void) {
-		_mutex.lock();
-		std::deque<SwapData> copy(_data);
-		_mutex.unlock();
-		return std::move(copy);
+		return getSnapshot().toDeque();
 	}
 
 	/*
@@ -300,13 +522,30 @@ namespace Sync {
 		return getLastSwapData().unit;
 	}
 
+	// Does not lock: see getSnapshot().
 	SwapData DataContainer::getLastSwapData(void) {
-		std::lock_guard<std::recursive_mutex> lock(_mutex);
+		ReaderScope reader(_activeReaders);
+		while (true) {
+			uint64_t seq = _sequence.load(std::memory_order_acquire);
+			if (seq & 1) {
+				std::this_thread::yield();
+				continue;
+			}
 
-		if (_data.empty()) {
-			return SwapData();
+			SwapData rval;
+
+			Ring* ring = _ring.load(std::memory_order_seq_cst); // See getSnapshot()
+			if (ring && _size.load(std::memory_order_relaxed) > 0) {
+				const Slot& slot = ring->at(_stored.load(std::memory_order_relaxed) - 1);
+				rval.time = CX_Nanos(slot.time.load(std::memory_order_relaxed));
+				rval.unit = slot.unit.load(std::memory_order_relaxed);
+			}
+
+			std::atomic_thread_fence(std::memory_order_acquire);
+			if (_sequence.load(std::memory_order_relaxed) == seq) {
+				return rval;
+			}
 		}
-		return _data.back();
 	}
 
 	//////////////////////////
@@ -409,7 +648,7 @@ namespace Sync {
 	}
 	*/
 
-	StabilityVerifier::Status StabilityVerifier::_getStatus(const std::deque<SwapData>& data) {
+	StabilityVerifier::Status StabilityVerifier::_getStatus(const SwapHistory& data) {
 		std::lock_guard<std::recursive_mutex> lock(_mutex);
 
 		// only need one data point to determine stoppage
@@ -460,9 +699,7 @@ namespace Sync {
 			return _lastStatus;
 		}
 
-		DataContainer::LockedDataPointer ldp = _config.dataContainer->getLockedDataPointer();
-
-		return _getStatus(*ldp);
+		return _getStatus(_config.dataContainer->getSnapshot(_config.sampleSize));
 	}
 
 	std::string StabilityVerifier::getStatusString(Status status) {
@@ -523,7 +760,7 @@ namespace Sync {
 		std::lock_guard<std::recursive_mutex> lock(_mutex);
 
 		if (_config.autoUpdate) {
-			Status currentStatus = _getStatus(data.data);
+			Status currentStatus = _getStatus(data.container->getSnapshot(_config.sampleSize));
 
 			if (currentStatus != _lastStatus) {
 				ofNotifyEvent(statusChangeEvent, currentStatus);
@@ -568,6 +805,14 @@ namespace Sync {
 	/////////////////////
 
 
+	LinearModel::LinearModel(void) :
+		_newDataAvailable(false),
+		_windowGeneration(0),
+		_updatesSinceRefit(0)
+	{
+		_fm.fittedSuccessfully = false;
+	}
+
 	bool LinearModel::setup(const Configuration& config) {
 		std::lock_guard<std::recursive_mutex> lock(_mutex);
 
@@ -580,6 +825,12 @@ namespace Sync {
 
 		_newDataAvailable = false;
 
+		_window.clear();
+		_windowGeneration = 0;
+		_running.clear();
+		_updatesSinceRefit = 0;
+		_fm.fittedSuccessfully = false;
+
 		_config.dataContainer->setMinimumSampleSize(_config.sampleSize);
 
 		_newDataEventHelper.setup<LinearModel>(&_config.dataContainer->newDataEvent, this, &LinearModel::_newDataListener);
@@ -630,24 +881,37 @@ namespace Sync {
 		_newDataAvailable = true;
 
 		if (_config.autoUpdate) {
-			this->fitModel(&nd.data);
+			// Usually, only the newest sample is new, but get one more to check that the window is current.
+			_updateModel(nd.container, 2);
+			_newDataAvailable = false;
 		}
 
 	}
 
-	bool LinearModel::fitModel(const std::deque<SwapData>* data) {
+	bool LinearModel::fitModel(const SwapHistory& data) {
 		std::lock_guard<std::recursive_mutex> lock(_mutex);
-		_fm = _fitModel(*data);
+		_refit(data);
+		_windowGeneration = std::numeric_limits<uint64_t>::max(); // not from any container
 		_newDataAvailable = false;
 		return _fm.fittedSuccessfully;
 	}
 
+	bool LinearModel::fitModel(const std::deque<SwapData>* data) {
+		SwapHistory history(data->size());
+		for (const SwapData& d : *data) {
+			history.push_back(d);
+		}
+		return fitModel(history);
+	}
+
 	bool LinearModel::fitModel(DataContainer* store) {
 		if (!store) {
 			return false;
 		}
-		auto lockedData = store->getLockedDataPointer();
-		return this->fitModel(lockedData.get());
+		std::lock_guard<std::recursive_mutex> lock(_mutex);
+		_updateModel(store, _config.sampleSize);
+		_newDataAvailable = false;
+		return _fm.fittedSuccessfully;
 	}
 
 	bool LinearModel::fitModel(void) {
@@ -657,64 +921,144 @@ namespace Sync {
 		return true;
 	}
 
-	LinearModel::FittedModel LinearModel::_fitModel(const std::deque<SwapData>& data) {
+	// Must be called with _mutex locked
+	void LinearModel::_updateModel(DataContainer* container, size_t newestSamples) {
+		uint64_t generation = 0;
+		SwapHistory recent = container->getSnapshot(newestSamples, &generation);
 
-		_mutex.lock();
-		size_t sampleSize = _config.sampleSize;
-		_mutex.unlock();
+		if (generation == _windowGeneration && _updatesSinceRefit < _config.refitInterval && _updateIncrementally(recent)) {
+			return;
+		}
 
-		FittedModel fm;
-		fm.fittedSuccessfully = false;
+		if (recent.size() < _config.sampleSize) {
+			recent = container->getSnapshot(_config.sampleSize, &generation);
+		}
+		_refit(recent);
+		_windowGeneration = generation;
+	}
 
-		if (data.size() < sampleSize) {
-			Instances::Log.error("Sync::LinearModel") << "fitModel(): Insufficient data. Need " << sampleSize << " samples and have " << data.size() << " samples.";
-			return fm;
+	// If data ends with _window plus some number of new samples (the usual case of new swaps coming in),
+	// the new samples are shifted into the window in O(1) time each. Otherwise, returns false.
+	bool LinearModel::_updateIncrementally(const SwapHistory& data) {
+
+		if (_window.empty() || !_window.full() || _window.size() != _config.sampleSize) {
+			return false;
+		}
+
+		const SwapData& last = _window.back();
+
+		// Find the newest sample in the window. If it is more than a window back, it's as fast to refit.
+		size_t searchLimit = std::min(data.size(), _window.size());
+		size_t newSamples = 0;
+		bool found = false;
+		for (; newSamples < searchLimit; newSamples++) {
+			const SwapData& d = data[data.size() - 1 - newSamples];
+			if (d.unit == last.unit && d.time == last.time) {
+				found = true;
+				break;
+			}
+		}
+
+		if (!found) {
+			return false;
 		}
 
-		size_t startIndex = data.size() - sampleSize;
+		for (size_t i = data.size() - newSamples; i < data.size(); i++) {
+			const SwapData& oldest = _window.front();
+			_running.remove(oldest.unit, oldest.time.millis());
 
-		fm.N = data.size();
+			_window.push_back(data[i]); // overwrites oldest
+			_running.add(data[i].unit, data[i].time.millis());
 
-		fm.xBar = 0;
-		fm.yBar = 0;
-		for (size_t i = startIndex; i < data.size(); i++) {
-			fm.xBar += data[i].unit;
-			fm.yBar += data[i].time.millis();
+			_updatesSinceRefit++;
 		}
-		fm.xBar /= fm.N;
-		fm.yBar /= fm.N;
 
+		if (newSamples > 0 || !_fm.fittedSuccessfully) {
+			_fm = _makeFittedModel();
+		}
+
+		return true;
+	}
 
-		fm._numSum = 0;
-		fm._denSum = 0;
+	void LinearModel::_refit(const SwapHistory& data) {
 
-		for (size_t i = startIndex; i < data.size(); i++) {
+		size_t sampleSize = _config.sampleSize;
 
-			double xDif = data[i].unit - fm.xBar;
-			double yDif = data[i].time.millis() - fm.yBar;
+		_window.setCapacity(sampleSize);
+		_running.clear();
+		_updatesSinceRefit = 0;
 
-			fm._numSum += xDif * yDif;
-			fm._denSum += xDif * xDif;
+		if (data.size() < sampleSize || sampleSize < 3) {
+			Instances::Log.error("Sync::LinearModel") << "fitModel(): Insufficient data. Need " << std::max<size_t>(sampleSize, 3) << " samples and have " << data.size() << " samples.";
+			_fm = FittedModel();
+			_fm.fittedSuccessfully = false;
+			return;
 		}
 
-		fm.slope = CX_Millis(fm._numSum / fm._denSum);
-		fm.intercept = CX_Millis(fm.yBar) - fm.slope * fm.xBar;
+		for (size_t i = data.size() - sampleSize; i < data.size(); i++) {
+			_window.push_back(data[i]);
+		}
 
-		// mark as fitted before calculating MSE and residuals
-		fm.fittedSuccessfully = true;
+		// Two-pass calculation of the sums, which is more accurate than the running updates.
+		double xBar = 0;
+		double yBar = 0;
+		for (size_t i = 0; i < _window.size(); i++) {
+			xBar += _window[i].unit;
+			yBar += _window[i].time.millis();
+		}
+		xBar /= sampleSize;
+		yBar /= sampleSize;
+
+		double numSum = 0;
+		double denSum = 0;
+		double yySum = 0;
 
-		// calculate the residuals and MSE
-		fm.residuals.resize(fm.N);
-		fm.MSE = 0;
-		for (size_t i = startIndex; i < data.size(); i++) {
+		for (size_t i = 0; i < _window.size(); i++) {
 
-			CX_Millis predY = fm.calculateTime(data[i].unit);
-			fm.residuals[i] = data[i].time - predY;
+			double xDif = _window[i].unit - xBar;
+			double yDif = _window[i].time.millis() - yBar;
 
-			double dresid = fm.residuals[i].millis();
-			fm.MSE += dresid * dresid;
+			numSum += xDif * yDif;
+			denSum += xDif * xDif;
+			yySum += yDif * yDif;
+		}
+
+		_running.n = sampleSize;
+		_running.xBar = xBar;
+		_running.yBar = yBar;
+		_running.Sxy = numSum;
+		_running.Sxx = denSum;
+		_running.Syy = yySum;
+
+		_fm = _makeFittedModel();
+	}
+
+	LinearModel::FittedModel LinearModel::_makeFittedModel(void) const {
+
+		FittedModel fm;
+
+		fm.N = _running.n;
+
+		fm.xBar = _running.xBar;
+		fm.yBar = _running.yBar;
+
+		fm._numSum = _running.Sxy;
+		fm._denSum = _running.Sxx;
+
+		fm.slope = CX_Millis(_running.slope());
+		fm.intercept = CX_Millis(fm.yBar) - fm.slope * fm.xBar;
+
+		fm.MSE = _running.sumOfSquaredErrors() / (fm.N - 2);
+
+		// mark as fitted before calculating residuals
+		fm.fittedSuccessfully = true;
+
+		if (_config.calculateResiduals) {
+			fm.residuals.resize(_window.size());
+			for (size_t i = 0; i < _window.size(); i++) {
+				fm.residuals[i] = _window[i].time - fm.calculateTime(_window[i].unit);
+			}
 		}
-		fm.MSE /= (fm.N - 2);
 
 		return fm;
 	}
@@ -821,6 +1165,287 @@ namespace Sync {
 		return fittedSuccessfully;
 	}
 
+	/////////////////
+	// RobustModel //
+	/////////////////
+
+	// Median of the values. Reorders the values.
+	static double medianInPlace(std::vector<double>& v) {
+		size_t mid = v.size() / 2;
+		std::nth_element(v.begin(), v.begin() + mid, v.end());
+		double m = v[mid];
+		if (v.size() % 2 == 0) {
+			m = (m + *std::max_element(v.begin(), v.begin() + mid)) / 2;
+		}
+		return m;
+	}
+
+	RobustModel::RobustModel(void) :
+		_newDataAvailable(false)
+	{}
+
+	bool RobustModel::setup(const Configuration& config) {
+		std::lock_guard<std::recursive_mutex> lock(_mutex);
+
+		if (config.dataContainer == nullptr) {
+			_newDataEventHelper.stopListening();
+			return false;
+		}
+
+		_config = config;
+
+		if (_config.sampleSize < 3) {
+			Instances::Log.warning("Sync::RobustModel") << "setup(): config.sampleSize must be at least 3, but it was not. sampleSize was set to 3.";
+			_config.sampleSize = 3;
+		}
+
+		_newDataAvailable = false;
+		_fm = FittedModel();
+
+		_config.dataContainer->setMinimumSampleSize(_config.sampleSize);
+
+		_newDataEventHelper.setup<RobustModel>(&_config.dataContainer->newDataEvent, this, &RobustModel::_newDataListener);
+
+		return true;
+	}
+
+	RobustModel::Configuration RobustModel::getConfiguration(void) {
+		std::lock_guard<std::recursive_mutex> lock(_mutex);
+		return _config;
+	}
+
+	void RobustModel::_newDataListener(const DataContainer::NewData&) {
+		std::lock_guard<std::recursive_mutex> lock(_mutex);
+
+		_newDataAvailable = true;
+
+		if (_config.autoUpdate) {
+			this->fitModel();
+		}
+	}
+
+	/*! Fit the model to the given data.
+	\param data The swap data. The most recent `Configuration::sampleSize` samples are used.
+	\param nominalSwapPeriod The nominal swap period, used to detect missed swaps. If 0, missed swaps are not detected.
+	\param unitsPerSwap The number of swap units that the data container advances per swap.
+	\return `true` if the model was fitted successfully. */
+	bool RobustModel::fitModel(const SwapHistory& data, CX_Millis nominalSwapPeriod, SwapUnit unitsPerSwap) {
+		std::lock_guard<std::recursive_mutex> lock(_mutex);
+		_fm = _fitModel(data, nominalSwapPeriod, unitsPerSwap);
+		_newDataAvailable = false;
+		return _fm.fittedSuccessfully;
+	}
+
+	bool RobustModel::fitModel(void) {
+		std::lock_guard<std::recursive_mutex> lock(_mutex);
+
+		DataContainer* container = _config.dataContainer;
+		if (!container) {
+			return false;
+		}
+
+		return fitModel(container->getSnapshot(_config.sampleSize), container->getNominalSwapPeriod(), container->getUnitsPerSwap());
+	}
+
+	RobustModel::FittedModel RobustModel::copyFittedModel(void) {
+		std::lock_guard<std::recursive_mutex> lock(_mutex);
+		if (_newDataAvailable && !_config.autoUpdate) {
+			fitModel();
+		}
+		return _fm;
+	}
+
+	RobustModel::ResidualStatistics RobustModel::getResidualStatistics(void) {
+		return copyFittedModel().residuals;
+	}
+
+	RobustModel::FittedModel RobustModel::_fitModel(const SwapHistory& data, CX_Millis nominalSwapPeriod, SwapUnit unitsPerSwap) const {
+
+		FittedModel fm;
+
+		size_t n = _config.sampleSize;
+		if (n < 3 || data.size() < n) {
+			return fm;
+		}
+
+		size_t start = data.size() - n;
+
+		// Re-index swap units, relative to the first sample.
+		bool reindex = _config.reindexMissedSwaps && nominalSwapPeriod > CX_Millis(0) && unitsPerSwap > 0;
+
+		std::vector<double> x(n);
+		std::vector<double> y(n);
+		unsigned int missedSwaps = 0;
+
+		CX_Millis y0 = data[start].time;
+
+		x[0] = 0;
+		y[0] = 0;
+		for (size_t i = 1; i < n; i++) {
+			const SwapData& prev = data[start + i - 1];
+			const SwapData& cur = data[start + i];
+
+			double step = (double)(SwapUnitDif)(cur.unit - prev.unit);
+
+			if (reindex) {
+				double rawSwaps = step / unitsPerSwap;
+				double measuredSwaps = std::round((cur.time - prev.time) / nominalSwapPeriod);
+				if (measuredSwaps > rawSwaps) {
+					missedSwaps += (unsigned int)(measuredSwaps - rawSwaps);
+					step = measuredSwaps * unitsPerSwap;
+				}
+			}
+
+			x[i] = x[i - 1] + step;
+			y[i] = (cur.time - y0).millis();
+		}
+
+		// Theil-Sen slope. Use all pairs for small samples, otherwise pairs half a window apart.
+		std::vector<double> slopes;
+		if (n <= 64) {
+			slopes.reserve(n * (n - 1) / 2);
+			for (size_t i = 0; i < n; i++) {
+				for (size_t j = i + 1; j < n; j++) {
+					if (x[j] != x[i]) {
+						slopes.push_back((y[j] - y[i]) / (x[j] - x[i]));
+					}
+				}
+			}
+		} else {
+			size_t h = n / 2;
+			slopes.reserve(n - h);
+			for (size_t i = 0; i + h < n; i++) {
+				if (x[i + h] != x[i]) {
+					slopes.push_back((y[i + h] - y[i]) / (x[i + h] - x[i]));
+				}
+			}
+		}
+
+		if (slopes.empty()) {
+			return fm;
+		}
+
+		double slope = medianInPlace(slopes);
+
+		std::vector<double> offsets(n);
+		for (size_t i = 0; i < n; i++) {
+			offsets[i] = y[i] - slope * x[i];
+		}
+		double intercept = medianInPlace(offsets);
+
+		// Residual statistics
+		std::vector<double> residuals(n);
+		double xBar = 0;
+		double maxAbsolute = 0;
+		for (size_t i = 0; i < n; i++) {
+			residuals[i] = y[i] - (intercept + slope * x[i]);
+			maxAbsolute = std::max(maxAbsolute, std::abs(residuals[i]));
+			xBar += x[i];
+		}
+		xBar /= n;
+
+		std::vector<double> absDevs = residuals;
+		double medianResidual = medianInPlace(absDevs);
+		for (double& d : absDevs) {
+			d = std::abs(d - medianResidual);
+		}
+		double robustSD = 1.4826 * medianInPlace(absDevs);
+
+		unsigned int outliers = 0;
+		double denSum = 0;
+		for (size_t i = 0; i < n; i++) {
+			if (robustSD > 0 && std::abs(residuals[i] - medianResidual) > _config.outlierThreshold * robustSD) {
+				outliers++;
+			}
+			denSum += (x[i] - xBar) * (x[i] - xBar);
+		}
+
+		fm.N = n;
+		fm._x0 = (double)data[start].unit;
+		fm._y0 = y0 + CX_Millis(intercept);
+		fm._slope = slope;
+		fm._xBar = xBar;
+		fm._denSum = denSum;
+
+		fm.slope = CX_Millis(slope);
+		fm.unitOffset = (SwapUnitDif)std::llround(x[n - 1]) - (SwapUnitDif)(data.back().unit - data[start].unit);
+
+		fm.residuals.N = n;
+		fm.residuals.median = CX_Millis(medianResidual);
+		fm.residuals.robustSD = CX_Millis(robustSD);
+		fm.residuals.maxAbsolute = CX_Millis(maxAbsolute);
+		fm.residuals.outliers = outliers;
+		fm.residuals.missedSwaps = missedSwaps;
+
+		fm.fittedSuccessfully = denSum > 0;
+
+		return fm;
+	}
+
+	//////////////////////////////
+	// RobustModel::FittedModel //
+	//////////////////////////////
+
+	TimePrediction RobustModel::FittedModel::predictTimeFP(double unit) const {
+		TimePrediction tp;
+
+		if (!fittedSuccessfully) {
+			return tp;
+		}
+
+		double x = unit + unitOffset - _x0;
+
+		tp.pred = _y0 + CX_Millis(_slope * x);
+
+		double qt = LinearModel::FittedModel::_getQT(this->N - 2);
+		double xDif = x - _xBar;
+		double rhRad = 1.0 + (1.0 / this->N) + (xDif * xDif) / _denSum;
+
+		tp.predictionIntervalHalfWidth = residuals.robustSD * (qt * sqrt(rhRad));
+		tp.usable = true;
+
+		return tp;
+	}
+
+	TimePrediction RobustModel::FittedModel::predictTime(SwapUnit unit) const {
+		return predictTimeFP((double)unit);
+	}
+
+	SwapUnitPrediction RobustModel::FittedModel::predictSwapUnit(CX_Millis time) const {
+		SwapUnitPrediction sup;
+
+		if (!fittedSuccessfully) {
+			return sup;
+		}
+
+		TimePrediction tp = predictTimeFP(calculateSwapUnitFP(time));
+
+		sup.fp.pred = calculateSwapUnitFP(tp.pred);
+		sup.fp.lower = calculateSwapUnitFP(tp.lowerBound());
+		sup.fp.upper = calculateSwapUnitFP(tp.upperBound());
+		sup.usable = true;
+
+		return sup;
+	}
+
+	CX_Millis RobustModel::FittedModel::calculateTime(SwapUnit unit) const {
+		return calculateTimeFP((double)unit);
+	}
+
+	CX_Millis RobustModel::FittedModel::calculateTimeFP(double swapUnit) const {
+		if (!fittedSuccessfully) {
+			return 0;
+		}
+		return _y0 + CX_Millis(_slope * (swapUnit + unitOffset - _x0));
+	}
+
+	double RobustModel::FittedModel::calculateSwapUnitFP(CX_Millis time) const {
+		if (!fittedSuccessfully) {
+			return 0;
+		}
+		return (time - _y0).millis() / _slope + _x0 - unitOffset;
+	}
+
 	////////////////////////
 	// DomainSynchronizer //
 	////////////////////////
@@ -981,6 +1606,65 @@ namespace Sync {
 		return sp;
 	}
 
+	/*! Convert a swap unit in one domain to the swap unit in another domain that happens at the same time.
+	Both domains are mapped to CX_Clock time with their fitted models, and the uncertainty of both
+	mappings is included in the returned prediction.
+
+	\param fromDomain The name of the data client for the domain that `unit` is in.
+	\param unit The swap unit to convert.
+	\param toDomain The name of the data client for the domain to convert to.
+	\return The predicted swap unit in `toDomain`. Check `usable` before using it.
+
+	\code{.cpp}
+	Instances::DomainSync.addDataClient("display", &Disp.swapClient);
+	Instances::DomainSync.addDataClient("sound", &soundStream.swapClient);
+
+	Sync::SwapUnitPrediction sf = Instances::DomainSync.convert("display", Disp.getLastFrameNumber() + 10, "sound");
+	if (sf.usable) {
+		player.queuePlayback(sf.prediction());
+	}
+	\endcode
+	*/
+	SwapUnitPrediction DomainSynchronizer::convert(std::string fromDomain, SwapUnit unit, std::string toDomain) {
+		std::lock_guard<std::recursive_mutex> lock(_mutex);
+
+		DataClient* from = _getDataClient(fromDomain);
+		DataClient* to = _getDataClient(toDomain);
+
+		if (!from || !to) {
+			Instances::Log.error("DomainSynchronizer") << "convert(): Domain \"" << (from ? toDomain : fromDomain) << "\" not found.";
+			return SwapUnitPrediction();
+		}
+
+		return Sync::convert(from, unit, to);
+	}
+
+	/*! Predict the CX_Clock time at which a swap unit in the given domain happens. */
+	TimePrediction DomainSynchronizer::convertToTime(std::string fromDomain, SwapUnit unit) {
+		std::lock_guard<std::recursive_mutex> lock(_mutex);
+
+		DataClient* from = _getDataClient(fromDomain);
+		if (!from) {
+			Instances::Log.error("DomainSynchronizer") << "convertToTime(): Domain \"" << fromDomain << "\" not found.";
+			return TimePrediction();
+		}
+
+		return from->predictSwapTime(unit);
+	}
+
+	/*! Predict the swap unit in the given domain that happens at a CX_Clock time. */
+	SwapUnitPrediction DomainSynchronizer::convertFromTime(CX_Millis time, std::string toDomain) {
+		std::lock_guard<std::recursive_mutex> lock(_mutex);
+
+		DataClient* to = _getDataClient(toDomain);
+		if (!to) {
+			Instances::Log.error("DomainSynchronizer") << "convertFromTime(): Domain \"" << toDomain << "\" not found.";
+			return SwapUnitPrediction();
+		}
+
+		return to->predictSwapUnitAtTime(time);
+	}
+
 	// wrappers of getSwapUnit() and getTime()
 	/*
 	SwapUnit DomainSynchronizer::getSwapUnitOf(std::string name, CX_Millis time) {
@@ -1124,6 +1808,29 @@ namespace Sync {
 		return lfm->predictSwapUnit(time);
 	}
 
+	/*! Predict the swap unit at an uncertain time (e.g. a time predicted by another DataClient).
+	The uncertainty of `time` is combined with the uncertainty of this client's model. */
+	SwapUnitPrediction DataClient::predictSwapUnitAtTime(const TimePrediction& time) {
+		if (!time.usable || !this->allReady()) {
+			return Sync::SwapUnitPrediction();
+		}
+
+		Sync::LinearModel::LockedFittedModel lfm = this->lm.getLockedFittedModel();
+
+		TimePrediction own = lfm->predictTimeFP(lfm->calculateSwapUnitFP(time.pred));
+
+		// independent errors: half-widths add in quadrature
+		double a = time.predictionIntervalHalfWidth.millis();
+		double b = own.predictionIntervalHalfWidth.millis();
+
+		TimePrediction combined;
+		combined.pred = time.pred;
+		combined.predictionIntervalHalfWidth = CX_Millis(std::sqrt(a * a + b * b));
+		combined.usable = true;
+
+		return lfm->predictSwapUnit(combined);
+	}
+
 	TimePrediction DataClient::predictSwapTime(SwapUnit swapUnit) {
 		if (!this->allReady()) {
 			return Sync::TimePrediction();
@@ -1186,6 +1893,18 @@ namespace Sync {
 		return rval;
 	}
 
+	/*! Convert a swap unit from one data client's domain to the swap unit in another data client's domain
+	that happens at the same time, including the uncertainty of both clients' models.
+	See DomainSynchronizer::convert() for a version that uses named domains. */
+	SwapUnitPrediction convert(DataClient* from, SwapUnit unit, DataClient* to) {
+		if (!from || !to) {
+			return SwapUnitPrediction();
+		}
+
+		TimePrediction time = from->predictSwapTime(unit);
+		return to->predictSwapUnitAtTime(time);
+	}
+
 	  ////////////////////
 	 // DataVisualizer //
 	////////////////////
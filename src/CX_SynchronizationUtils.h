@@ -3,6 +3,8 @@
 #include <map>
 #include <mutex>
 #include <deque>
+#include <atomic>
+#include <memory>
 
 #include "CX_Time_t.h"
 #include "CX_Utilities.h"
@@ -40,6 +42,39 @@ struct SwapData {
 	SwapUnit unit;
 };
 
+/*! A fixed-capacity ring buffer of SwapData. Once the buffer is full, pushing a new sample overwrites
+the oldest sample. Indexing is from oldest (`0`) to newest (`size() - 1`), like a `std::deque`.
+
+This is the type of the snapshots returned by DataContainer::getSnapshot(). */
+class SwapHistory {
+public:
+
+	SwapHistory(size_t capacity = 0);
+
+	void setCapacity(size_t capacity);
+	size_t capacity(void) const;
+
+	size_t size(void) const;
+	bool empty(void) const;
+	bool full(void) const;
+	void clear(void);
+
+	void push_back(const SwapData& data);
+
+	const SwapData& operator[](size_t i) const;
+	SwapData& operator[](size_t i);
+
+	const SwapData& front(void) const;
+	const SwapData& back(void) const;
+
+	std::deque<SwapData> toDeque(void) const;
+
+private:
+	std::vector<SwapData> _data;
+	size_t _start;
+	size_t _size;
+};
+
 
 bool areTimesWithinTolerance(const CX_Millis& a, const CX_Millis& b, const CX_Millis& tolerance);
 
@@ -82,13 +117,12 @@ struct SwapUnitPrediction {
 class DataContainer {
 public:
 
-	typedef CX::Util::LockedPointer<const std::deque<SwapData>, std::recursive_mutex> LockedDataPointer;
-
 	struct Configuration {
 
 		Configuration(void) :
 			latency(0),
-			unitsPerSwap(1)
+			unitsPerSwap(1),
+			sampleSize(0)
 			//eventSource(nullptr),
 			//containerSource(nullptr)
 		{}
@@ -96,7 +130,7 @@ public:
 		CX_Millis nominalSwapPeriod;
 		SwapUnit unitsPerSwap;
 
-		size_t sampleSize;
+		size_t sampleSize; // capacity of the ring buffer: the sampleSize most recent swaps are kept
 
 		CX_Millis latency; // + values: more latency, so subtract latency
 
@@ -106,6 +140,7 @@ public:
 	};
 
 	DataContainer(void);
+	~DataContainer(void);
 
 	void setup(const Configuration& config);
 	Configuration getConfiguration(void);
@@ -136,8 +171,8 @@ public:
 	//void setUnitsPerSwap(SwapUnit unitsPerSwap);
 	SwapUnit getUnitsPerSwap(void);
 
-	
-	LockedDataPointer getLockedDataPointer(void);
+
+	SwapHistory getSnapshot(size_t newest = std::numeric_limits<size_t>::max(), uint64_t* generation = nullptr);
 	std::deque<SwapData> copyData(void);
 
 	SwapData getLastSwapData(void);
@@ -146,24 +181,28 @@ public:
 
 	SwapUnit getNextSwapUnit(void);
 
+	/*! Passed to listeners of newDataEvent. Only the newest sample is included. Listeners that need more
+	of the history should call `container->getSnapshot()`, which does not block the thread storing swaps. */
 	struct NewData {
 
-		NewData(const std::deque<SwapData>& d) :
-			data(d)
+		NewData(DataContainer* c, const SwapData& n, size_t sz, bool r) :
+			container(c),
+			newestSample(n),
+			size(sz),
+			reset(r)
 		{}
 
-		const std::deque<SwapData>& data;
+		DataContainer* container; //!< The container that the data are in.
+		SwapData newestSample;
+		size_t size; //!< The number of samples in the container.
+		bool reset; //!< `true` if existing data were cleared or modified (e.g. by clear() or setLatency()), rather than a new sample being added.
 
 		bool empty(void) const {
-			return data.empty();
+			return size == 0;
 		}
 
 		const SwapData& newest(void) const {
-			return data.back();
-		}
-
-		const SwapData& oldest(void) const {
-			return data.front();
+			return newestSample;
 		}
 	};
 
@@ -271,11 +310,65 @@ public:
 
 private:
 
+	// Serializes writers and protects _config. Readers of the swap data do not take this mutex.
 	std::recursive_mutex _mutex;
 
 	Configuration _config;
 
-	std::deque<SwapData> _data;
+	// The swap data are kept in a seqlock-protected ring buffer. The writer makes _sequence odd while
+	// it modifies the ring and even when it is done. Readers copy what they need and retry if the
+	// sequence changed while they were reading, so the swapping thread never waits for readers.
+	struct Slot {
+		std::atomic<cxTick_t> time;
+		std::atomic<SwapUnit> unit;
+	};
+
+	struct Ring {
+		Ring(size_t cap) :
+			slots(new Slot[std::max<size_t>(cap, 1)]),
+			capacity(cap)
+		{}
+
+		std::unique_ptr<Slot[]> slots;
+		size_t capacity;
+
+		Slot& at(uint64_t i) {
+			return slots[i % std::max<size_t>(capacity, 1)];
+		}
+	};
+
+	std::atomic<uint64_t> _sequence;
+	std::atomic<Ring*> _ring;
+	std::atomic<uint64_t> _stored; // total samples written since the last reset. The newest is at _ring->at(_stored - 1).
+	std::atomic<size_t> _size;
+	std::atomic<uint64_t> _generation; // incremented when existing data are cleared or modified
+
+	// The ring is replaced when the sample size changes. A reader may still be (harmlessly, it will retry)
+	// reading from an old ring, so old rings are only freed by _reclaimRings() when no reader is active.
+	std::vector<std::unique_ptr<Ring>> _rings;
+	std::atomic<unsigned int> _activeReaders;
+
+	// Registers a reader in _activeReaders for the lifetime of the scope.
+	struct ReaderScope {
+		ReaderScope(std::atomic<unsigned int>& r) :
+			readers(r)
+		{
+			readers.fetch_add(1, std::memory_order_seq_cst);
+		}
+
+		~ReaderScope(void) {
+			readers.fetch_sub(1, std::memory_order_release);
+		}
+
+		std::atomic<unsigned int>& readers;
+	};
+
+	void _beginWrite(void);
+	void _endWrite(void);
+	void _writeSample(const SwapData& data);
+	void _allocateRing(size_t capacity);
+	void _reclaimRings(void);
+	void _notifyNewData(bool reset);
 
 	SwapUnit _timeStoreNextSwapUnit;
 
@@ -361,7 +454,7 @@ private:
 
 	Status _lastStatus;
 
-	Status _getStatus(const std::deque<SwapData>& data);
+	Status _getStatus(const SwapHistory& data);
 };
 
 
@@ -432,6 +525,7 @@ public:
 		bool _fittedSuccessfully(bool warn = true) const;
 
 		friend class LinearModel;
+		friend class RobustModel;
 
 		double _numSum; // sum_i (x_i - xBar) * (y_i - yBar)
 		double _denSum; // sum_i (x_i - xBar)^2
@@ -440,17 +534,37 @@ public:
 	typedef CX::Util::LockedPointer<const FittedModel, std::recursive_mutex> LockedFittedModel;
 
 	struct Configuration {
+
+		Configuration(void) :
+			dataContainer(nullptr),
+			autoUpdate(true),
+			sampleSize(0),
+			refitInterval(1000),
+			calculateResiduals(true)
+		{}
+
 		DataContainer* dataContainer;
 		bool autoUpdate;
 
 		size_t sampleSize; // will use the most recent sampleSize samples
+
+		// The model is updated incrementally as samples enter and leave the window. Every refitInterval
+		// updates, it is refit from scratch to keep rounding error from accumulating.
+		size_t refitInterval;
+
+		// If true, FittedModel::residuals is filled, as it always was before the model was updated incrementally.
+		// This takes O(sampleSize) time per update, so set it to false if the residuals are not needed.
+		bool calculateResiduals;
 	};
 
+	LinearModel(void);
+
 	bool setup(const Configuration& config);
 	Configuration getConfiguration(void);
 
 	//bool setDataSource(DataContainer* dataSource, bool autoUpdate = true);
 
+	bool fitModel(const SwapHistory& data);
 	bool fitModel(const std::deque<SwapData>* data);
 	bool fitModel(DataContainer* store);
 	bool fitModel(void); // uses data store from config
@@ -471,7 +585,132 @@ private:
 	void _newDataListener(const DataContainer::NewData& dp);
 	CX::Util::ofEventHelper<const DataContainer::NewData&> _newDataEventHelper;
 
-	FittedModel _fitModel(const std::deque<SwapData>& data);
+	// The samples the model is currently fit to and running sums for them
+	SwapHistory _window;
+	uint64_t _windowGeneration; // DataContainer generation that _window came from
+	Util::RunningRegression _running;
+	size_t _updatesSinceRefit;
+
+	void _updateModel(DataContainer* container, size_t newestSamples);
+	bool _updateIncrementally(const SwapHistory& recent);
+	void _refit(const SwapHistory& data);
+	FittedModel _makeFittedModel(void) const;
+};
+
+
+/*! An outlier-resistant alternative to LinearModel for predicting swap times.
+
+The slope is estimated with a Theil-Sen estimator (the median of pairwise slopes; for large samples,
+only pairs half a window apart are used so that fitting is O(N log N)) and the intercept is the median
+offset from that slope, so a few late timestamps do not skew the model.
+
+Additionally, if `Configuration::reindexMissedSwaps` is `true`, intervals between swaps that are clearly
+multiples of the nominal swap period are treated as missed swaps: the swap units after them are shifted
+so that the model is fit to the swaps that actually happened. Predictions are made for the swap
+unit numbering of the DataContainer, assuming no further missed swaps after the newest sample.
+*/
+class RobustModel {
+public:
+
+	struct ResidualStatistics {
+
+		ResidualStatistics(void) :
+			N(0),
+			median(0),
+			robustSD(0),
+			maxAbsolute(0),
+			outliers(0),
+			missedSwaps(0)
+		{}
+
+		unsigned int N; //!< Number of samples that the model was fit to.
+		CX_Millis median; //!< Median residual.
+		CX_Millis robustSD; //!< Median absolute deviation of the residuals, scaled to be consistent with the standard deviation for normal data.
+		CX_Millis maxAbsolute; //!< Largest absolute residual.
+		unsigned int outliers; //!< Number of residuals more than `Configuration::outlierThreshold` robust SDs from the median.
+		unsigned int missedSwaps; //!< Number of swaps within the sample that were detected as missed.
+	};
+
+	struct FittedModel {
+
+		FittedModel(void) :
+			fittedSuccessfully(false),
+			N(0),
+			unitOffset(0)
+		{}
+
+		bool fittedSuccessfully;
+
+		unsigned int N; // sample size
+
+		CX_Millis slope;
+		SwapUnitDif unitOffset; // re-indexed unit minus container unit for the newest sample
+
+		ResidualStatistics residuals;
+
+		TimePrediction predictTime(SwapUnit unit) const;
+		TimePrediction predictTimeFP(double unit) const;
+		SwapUnitPrediction predictSwapUnit(CX_Millis time) const;
+
+		CX_Millis calculateTime(SwapUnit unit) const;
+		CX_Millis calculateTimeFP(double swapUnit) const;
+		double calculateSwapUnitFP(CX_Millis time) const;
+
+	private:
+		friend class RobustModel;
+
+		// The model is stored relative to an origin within the data to avoid losing precision.
+		double _x0; // re-indexed unit of origin
+		CX_Millis _y0; // time of origin
+		double _slope; // ms per unit
+		double _xBar; // relative to _x0
+		double _denSum; // sum_i (x_i - xBar)^2
+	};
+
+	struct Configuration {
+
+		Configuration(void) :
+			dataContainer(nullptr),
+			autoUpdate(true),
+			sampleSize(0),
+			outlierThreshold(3),
+			reindexMissedSwaps(true)
+		{}
+
+		DataContainer* dataContainer;
+		bool autoUpdate;
+
+		size_t sampleSize; // will use the most recent sampleSize samples
+
+		double outlierThreshold; // in robust SDs, for ResidualStatistics::outliers
+
+		bool reindexMissedSwaps;
+	};
+
+	RobustModel(void);
+
+	bool setup(const Configuration& config);
+	Configuration getConfiguration(void);
+
+	bool fitModel(const SwapHistory& data, CX_Millis nominalSwapPeriod, SwapUnit unitsPerSwap);
+	bool fitModel(void); // uses data store from config
+
+	FittedModel copyFittedModel(void);
+	ResidualStatistics getResidualStatistics(void);
+
+private:
+
+	std::recursive_mutex _mutex;
+
+	Configuration _config;
+
+	FittedModel _fm;
+
+	bool _newDataAvailable;
+	void _newDataListener(const DataContainer::NewData&);
+	CX::Util::ofEventHelper<const DataContainer::NewData&> _newDataEventHelper;
+
+	FittedModel _fitModel(const SwapHistory& data, CX_Millis nominalSwapPeriod, SwapUnit unitsPerSwap) const;
 };
 
 
@@ -492,6 +731,10 @@ public:
 	SyncPoint getSyncPoint(CX_Millis time);
 	SyncPoint getSyncPoint(std::string clientName, SwapUnit unit);
 
+	SwapUnitPrediction convert(std::string fromDomain, SwapUnit unit, std::string toDomain);
+	TimePrediction convertToTime(std::string fromDomain, SwapUnit unit);
+	SwapUnitPrediction convertFromTime(CX_Millis time, std::string toDomain);
+
 	// why? Data Client Locked Pointer
 	typedef CX::Util::LockedPointer<DataClient, std::recursive_mutex> DCLP;
 	DCLP getDCLP(std::string clientName);
@@ -535,6 +778,7 @@ public:
 	TimePrediction predictSwapTimeFP(double unit);
 	
 	SwapUnitPrediction predictSwapUnitAtTime(CX_Millis time);
+	SwapUnitPrediction predictSwapUnitAtTime(const TimePrediction& time);
 
 	
 
@@ -546,6 +790,8 @@ private:
 	Util::ofEventHelper<const std::deque<SwapData>&> _newDataEventHelper;
 };
 
+SwapUnitPrediction convert(DataClient* from, SwapUnit unit, DataClient* to);
+
 class DataVisualizer {
 public:
 
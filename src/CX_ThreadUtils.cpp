@@ -68,5 +68,163 @@ void PolledEventListener<void>::_listenFun(void) {
 	_available++;
 }
 
+
+
+namespace {
+	thread_local ThreadPool* currentWorkerPool = nullptr;
+}
+
+/*! Construct the pool and start its threads.
+\param threadCount The number of worker threads. If 0, one less than the number of hardware threads is used
+(at least 1), leaving a core for the thread that submits work. */
+ThreadPool::ThreadPool(unsigned int threadCount) :
+	_stopping(false)
+{
+	_startThreads(threadCount);
+}
+
+ThreadPool::~ThreadPool(void) {
+	_stopThreads();
+}
+
+/*! Change the number of worker threads. Tasks that are already queued are completed before the threads are replaced.
+\param threadCount The number of worker threads. See ThreadPool(unsigned int). */
+void ThreadPool::setThreadCount(unsigned int threadCount) {
+	_stopThreads();
+	_startThreads(threadCount);
+}
+
+unsigned int ThreadPool::getThreadCount(void) {
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _threads.size();
+}
+
+/*! Queue a task to be run on one of the worker threads.
+\param task The task.
+\return A future that becomes ready when the task has run. If the task throws, the exception is rethrown by `std::future::get()`. */
+std::future<void> ThreadPool::push(std::function<void(void)> task) {
+	std::packaged_task<void(void)> pt(task);
+	std::future<void> fut = pt.get_future();
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_tasks.push_back(std::move(pt));
+	}
+	_condition.notify_one();
+	return fut;
+}
+
+/*! Split the range `[begin, end)` into contiguous subranges and call `rangeFunction(subBegin, subEnd)` for each
+subrange, in parallel on the worker threads and the calling thread. This blocks until all subranges are complete.
+
+If this is called from one of the worker threads of this pool, the whole range is processed on the calling thread
+so that the pool cannot deadlock waiting for itself.
+
+\param begin The start of the range.
+\param end One past the end of the range.
+\param rangeFunction The function to call for each subrange.
+\param minRangeSize The minimum number of elements in each subrange. Use this to avoid splitting small jobs
+into pieces that cost more to schedule than to run. */
+void ThreadPool::parallelFor(size_t begin, size_t end, std::function<void(size_t, size_t)> rangeFunction, size_t minRangeSize) {
+	if (end <= begin) {
+		return;
+	}
+
+	size_t count = end - begin;
+	size_t maxRanges = count / std::max<size_t>(minRangeSize, 1);
+	size_t ranges = std::min<size_t>(getThreadCount() + 1, maxRanges);
+
+	if (ranges <= 1 || isWorkerThread()) {
+		rangeFunction(begin, end);
+		return;
+	}
+
+	size_t rangeSize = count / ranges;
+	size_t remainder = count % ranges;
+
+	std::vector<std::future<void>> futures;
+	futures.reserve(ranges - 1);
+
+	size_t subBegin = begin;
+	size_t callerBegin = 0;
+	size_t callerEnd = 0;
+	for (size_t i = 0; i < ranges; i++) {
+		size_t subEnd = subBegin + rangeSize + (i < remainder ? 1 : 0);
+		if (i == 0) {
+			// The calling thread does the first range
+			callerBegin = subBegin;
+			callerEnd = subEnd;
+		} else {
+			futures.push_back(push(std::bind(rangeFunction, subBegin, subEnd)));
+		}
+		subBegin = subEnd;
+	}
+
+	rangeFunction(callerBegin, callerEnd);
+
+	for (std::future<void>& f : futures) {
+		f.get();
+	}
+}
+
+/*! \brief Returns `true` if the calling thread is one of the worker threads of this pool. */
+bool ThreadPool::isWorkerThread(void) {
+	return currentWorkerPool == this;
+}
+
+void ThreadPool::_startThreads(unsigned int threadCount) {
+	if (threadCount == 0) {
+		unsigned int hardwareThreads = std::thread::hardware_concurrency();
+		threadCount = hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+	}
+
+	std::lock_guard<std::mutex> lock(_mutex);
+	_stopping = false;
+	for (unsigned int i = 0; i < threadCount; i++) {
+		_threads.push_back(std::thread(&ThreadPool::_workerFunction, this));
+	}
+}
+
+void ThreadPool::_stopThreads(void) {
+	std::vector<std::thread> threads;
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_stopping = true;
+		std::swap(threads, _threads);
+	}
+	_condition.notify_all();
+
+	for (std::thread& t : threads) {
+		t.join();
+	}
+}
+
+void ThreadPool::_workerFunction(void) {
+	currentWorkerPool = this;
+
+	while (true) {
+		std::packaged_task<void(void)> task;
+		{
+			std::unique_lock<std::mutex> lock(_mutex);
+			_condition.wait(lock, [this](void) { return _stopping || !_tasks.empty(); });
+
+			// Finish queued tasks before stopping
+			if (_tasks.empty()) {
+				return;
+			}
+
+			task = std::move(_tasks.front());
+			_tasks.pop_front();
+		}
+		task();
+	}
+}
+
+/*! \brief Get the thread pool that is shared by CX, e.g. for generating stimuli in parallel.
+The pool is created with the default number of threads the first time this is called. */
+ThreadPool& sharedThreadPool(void) {
+	static ThreadPool pool;
+	return pool;
+}
+
 }
 }
\ No newline at end of file
@@ -3,6 +3,10 @@
 #include <deque>
 #include <mutex>
 #include <atomic>
+#include <thread>
+#include <future>
+#include <functional>
+#include <condition_variable>
 
 #include "ofEvent.h"
 #include "ofEventUtils.h"
@@ -545,5 +549,48 @@ private:
 
 };
 
+
+/*! A fixed set of worker threads that run tasks from a shared queue. Use sharedThreadPool() to get
+the pool that is shared by CX, rather than creating a new pool for each job.
+
+\code{.cpp}
+std::vector<float> data(1000000);
+Util::sharedThreadPool().parallelFor(0, data.size(), [&](size_t begin, size_t end) {
+	for (size_t i = begin; i < end; i++) {
+		data[i] = std::sqrt((float)i);
+	}
+});
+\endcode
+*/
+class ThreadPool {
+public:
+
+	ThreadPool(unsigned int threadCount = 0);
+	~ThreadPool(void);
+
+	void setThreadCount(unsigned int threadCount);
+	unsigned int getThreadCount(void);
+
+	std::future<void> push(std::function<void(void)> task);
+
+	void parallelFor(size_t begin, size_t end, std::function<void(size_t, size_t)> rangeFunction, size_t minRangeSize = 1);
+
+	bool isWorkerThread(void);
+
+private:
+
+	std::mutex _mutex;
+	std::condition_variable _condition;
+	std::deque<std::packaged_task<void(void)>> _tasks;
+	std::vector<std::thread> _threads;
+	bool _stopping;
+
+	void _startThreads(unsigned int threadCount);
+	void _stopThreads(void);
+	void _workerFunction(void);
+};
+
+ThreadPool& sharedThreadPool(void);
+
 }
 }
\ No newline at end of file
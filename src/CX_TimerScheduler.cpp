@@ -0,0 +1,444 @@
+#include "CX_TimerScheduler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "CX_Clock.h"
+#include "CX_Logger.h"
+
+#if defined(TARGET_LINUX) || defined(TARGET_OSX)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#ifdef TARGET_WIN32
+#include <Windows.h>
+#endif
+
+namespace CX {
+
+CX_Millis CX_TimerScheduler::Timer::deadlineOf(uint64_t tick) const {
+	// Integer nanosecond math so that very long running timers do not accumulate rounding error.
+	return anchorTime + CX_Nanos(static_cast<cxTick_t>(tick - anchorTick) * period.nanos());
+}
+
+CX_TimerScheduler::CX_TimerScheduler(void) :
+	_threadRunning(false),
+	_nextTimerId(1)
+{}
+
+CX_TimerScheduler::~CX_TimerScheduler(void) {
+	stopThread();
+}
+
+/*! Configure the scheduler. If the scheduler thread is running, it is restarted so that the
+new priority and affinity settings take effect. Existing timers are preserved.
+
+\param config The configuration to use.
+\return `true` if the configuration was valid, `false` otherwise.
+*/
+bool CX_TimerScheduler::setup(const Configuration& config) {
+	if (config.spinWindow < CX_Millis(0)) {
+		Instances::Log.error("CX_TimerScheduler") << "setup(): spinWindow must be non-negative.";
+		return false;
+	}
+
+	if (std::this_thread::get_id() == _thread.get_id()) {
+		Instances::Log.error("CX_TimerScheduler") << "setup(): setup() cannot be called from a timer callback because the scheduler thread cannot restart itself.";
+		return false;
+	}
+
+	bool wasRunning = isThreadRunning();
+	stopThread();
+
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_config = config;
+	}
+
+	if (wasRunning || getTimerCount() > 0) {
+		_startThread();
+	}
+
+	return true;
+}
+
+/*! \brief Get the current configuration of the scheduler. */
+CX_TimerScheduler::Configuration CX_TimerScheduler::getConfiguration(void) {
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _config;
+}
+
+/*! Add a timer that first ticks one `period` from now and then every `period` after that.
+The scheduler thread is started if it is not already running.
+
+\param period The period of the timer. Must be greater than 0.
+\param callback A function that will be called from the scheduler thread on every tick.
+\return An id that can be used to refer to the timer or `CX_TimerScheduler::InvalidTimerId` on error.
+*/
+CX_TimerScheduler::TimerId CX_TimerScheduler::addTimer(CX_Millis period, std::function<void(const TickInfo&)> callback) {
+	return addTimerAt(Instances::Clock.now() + period, period, callback);
+}
+
+/*! Add a timer that first ticks at `startTime` and then every `period` after that.
+If `startTime` is in the past, the ticks that would have happened before now are skipped.
+
+\param startTime The time of the first tick, in the time base of `CX::Instances::Clock`.
+\param period The period of the timer. Must be greater than 0.
+\param callback A function that will be called from the scheduler thread on every tick.
+\return An id that can be used to refer to the timer or `CX_TimerScheduler::InvalidTimerId` on error.
+*/
+CX_TimerScheduler::TimerId CX_TimerScheduler::addTimerAt(CX_Millis startTime, CX_Millis period, std::function<void(const TickInfo&)> callback) {
+	if (period <= CX_Millis(0)) {
+		Instances::Log.error("CX_TimerScheduler") << "addTimer(): period must be greater than 0.";
+		return InvalidTimerId;
+	}
+	if (!callback) {
+		Instances::Log.error("CX_TimerScheduler") << "addTimer(): callback must not be empty.";
+		return InvalidTimerId;
+	}
+
+	TimerId id = InvalidTimerId;
+	bool startThread = false;
+
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+
+		id = _nextTimerId++;
+
+		Timer& timer = _timers[id];
+		timer.anchorTime = startTime;
+		timer.anchorTick = 0;
+		timer.period = period;
+		timer.nextTick = 0;
+		timer.nextDeadline = startTime;
+		timer.callback = callback;
+		_resetStatistics(timer);
+
+		_reschedule(timer, Instances::Clock.now());
+		_pushHeap(id, timer.nextDeadline);
+
+		startThread = !_threadRunning;
+	}
+
+	if (startThread) {
+		_startThread();
+	} else {
+		_wakeCondition.notify_all();
+	}
+
+	return id;
+}
+
+/*! Remove a timer. If the callback for the timer is currently executing, it will finish,
+but the timer will not tick again. A tick that has reached its deadline but whose callback has not started
+yet is cancelled.
+\param id The id of the timer to remove.
+\return `true` if the timer was found and removed, `false` otherwise.
+*/
+bool CX_TimerScheduler::removeTimer(TimerId id) {
+	std::lock_guard<std::mutex> lock(_mutex);
+	// The heap entry for the timer is discarded lazily by the scheduler thread.
+	return _timers.erase(id) > 0;
+}
+
+/*! \brief Remove all timers. The scheduler thread keeps running, but sleeps until a timer is added. */
+void CX_TimerScheduler::clearTimers(void) {
+	std::lock_guard<std::mutex> lock(_mutex);
+	_timers.clear();
+	_heap.clear();
+}
+
+/*! \brief Returns `true` if a timer with the given id exists. */
+bool CX_TimerScheduler::hasTimer(TimerId id) {
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _timers.find(id) != _timers.end();
+}
+
+/*! \brief Get the number of timers. */
+size_t CX_TimerScheduler::getTimerCount(void) {
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _timers.size();
+}
+
+/*! Change the period of a timer. The schedule is re-anchored at the next pending deadline,
+so the next tick happens when it would have with the old period and subsequent ticks
+use the new period.
+
+\param id The id of the timer.
+\param period The new period. Must be greater than 0.
+\return `true` if the period was changed, `false` otherwise.
+*/
+bool CX_TimerScheduler::setTimerPeriod(TimerId id, CX_Millis period) {
+	if (period <= CX_Millis(0)) {
+		Instances::Log.error("CX_TimerScheduler") << "setTimerPeriod(): period must be greater than 0.";
+		return false;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+
+		auto it = _timers.find(id);
+		if (it == _timers.end()) {
+			Instances::Log.error("CX_TimerScheduler") << "setTimerPeriod(): No timer with id " << id << ".";
+			return false;
+		}
+
+		Timer& timer = it->second;
+		timer.anchorTime = timer.nextDeadline;
+		timer.anchorTick = timer.nextTick;
+		timer.period = period;
+	}
+
+	_wakeCondition.notify_all();
+	return true;
+}
+
+/*! \brief Get the period of a timer. Returns 0 if there is no timer with the given id. */
+CX_Millis CX_TimerScheduler::getTimerPeriod(TimerId id) {
+	std::lock_guard<std::mutex> lock(_mutex);
+	auto it = _timers.find(id);
+	if (it == _timers.end()) {
+		return CX_Millis(0);
+	}
+	return it->second.period;
+}
+
+/*! Get statistics about how late callbacks for the given timer have been relative to their deadlines.
+\param id The id of the timer.
+\return The lateness statistics. If there is no timer with the given id, all values are 0.
+*/
+CX_TimerScheduler::LatenessStatistics CX_TimerScheduler::getLatenessStatistics(TimerId id) {
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	LatenessStatistics rval;
+
+	auto it = _timers.find(id);
+	if (it == _timers.end()) {
+		return rval;
+	}
+
+	const Timer& timer = it->second;
+
+	rval.ticks = timer.stats.ticks;
+	rval.skippedTicks = timer.stats.skippedTicks;
+	if (timer.stats.ticks > 0) {
+		rval.mean = CX_Millis(timer.stats.mean);
+		rval.min = CX_Millis(timer.stats.min);
+		rval.max = CX_Millis(timer.stats.max);
+	}
+	if (timer.stats.ticks > 1) {
+		rval.standardDeviation = CX_Millis(std::sqrt(timer.stats.M2 / (timer.stats.ticks - 1)));
+	}
+
+	return rval;
+}
+
+/*! \brief Reset the lateness statistics for the given timer. */
+void CX_TimerScheduler::resetLatenessStatistics(TimerId id) {
+	std::lock_guard<std::mutex> lock(_mutex);
+	auto it = _timers.find(id);
+	if (it != _timers.end()) {
+		_resetStatistics(it->second);
+	}
+}
+
+/*! \brief Returns `true` if the scheduler thread is running. */
+bool CX_TimerScheduler::isThreadRunning(void) {
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _threadRunning;
+}
+
+/*! Stop the scheduler thread and wait for it to exit. Timers are not removed, and the thread
+will be restarted if a timer is added or setup() is called while timers exist. */
+void CX_TimerScheduler::stopThread(void) {
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_threadRunning = false;
+	}
+	_wakeCondition.notify_all();
+
+	if (_thread.joinable() && _thread.get_id() != std::this_thread::get_id()) {
+		_thread.join();
+	}
+}
+
+void CX_TimerScheduler::_startThread(void) {
+	if (std::this_thread::get_id() == _thread.get_id()) {
+		// Assigning to a joinable std::thread terminates the program, and the thread cannot join itself.
+		Instances::Log.error("CX_TimerScheduler") << "The scheduler thread cannot be restarted from a timer callback. "
+			"Start it from another thread with setup() or by adding a timer.";
+		return;
+	}
+
+	stopThread();
+
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	_threadRunning = true;
+	_thread = std::thread(&CX_TimerScheduler::_threadFunction, this);
+}
+
+void CX_TimerScheduler::_threadFunction(void) {
+
+	_applyThreadPriority();
+
+	std::unique_lock<std::mutex> lock(_mutex);
+
+	while (_threadRunning) {
+
+		// Discard heap entries for timers that were removed or rescheduled
+		while (!_heap.empty()) {
+			const HeapEntry& top = _heap.front();
+			auto it = _timers.find(top.id);
+			if (it != _timers.end() && it->second.nextDeadline == top.deadline) {
+				break;
+			}
+			std::pop_heap(_heap.begin(), _heap.end(), std::greater<HeapEntry>());
+			_heap.pop_back();
+		}
+
+		if (_heap.empty()) {
+			_wakeCondition.wait(lock);
+			continue;
+		}
+
+		HeapEntry next = _heap.front();
+
+		CX_Millis remaining = next.deadline - Instances::Clock.now();
+		if (remaining > _config.spinWindow) {
+			// Sleep until the start of the spin window. Any change to the timers wakes the thread
+			// so that the heap can be re-examined.
+			_wakeCondition.wait_for(lock, std::chrono::nanoseconds((remaining - _config.spinWindow).nanos()));
+			continue;
+		}
+
+		std::pop_heap(_heap.begin(), _heap.end(), std::greater<HeapEntry>());
+		_heap.pop_back();
+
+		TickInfo info;
+		info.id = next.id;
+		info.tick = _timers[next.id].nextTick;
+		info.scheduledTime = next.deadline;
+
+		lock.unlock();
+
+		CX_Millis now = Instances::Clock.now();
+		while (now < next.deadline) {
+			std::this_thread::yield();
+			now = Instances::Clock.now();
+		}
+
+		// The timer may have been removed while spinning. Once this check passes, removeTimer() treats the
+		// callback as executing.
+		lock.lock();
+		auto current = _timers.find(next.id);
+		if (current == _timers.end()) {
+			continue;
+		}
+		std::function<void(const TickInfo&)> callback = current->second.callback;
+		lock.unlock();
+
+		info.actualTime = now;
+		callback(info);
+
+		lock.lock();
+
+		// The timer may have been removed or had its period changed during the callback.
+		auto it = _timers.find(next.id);
+		if (it == _timers.end()) {
+			continue;
+		}
+
+		Timer& t = it->second;
+
+		double lateness = info.lateness().millis();
+		t.stats.ticks++;
+		double delta = lateness - t.stats.mean;
+		t.stats.mean += delta / t.stats.ticks;
+		t.stats.M2 += delta * (lateness - t.stats.mean);
+		t.stats.min = std::min(t.stats.min, lateness);
+		t.stats.max = std::max(t.stats.max, lateness);
+
+		if (t.nextTick == info.tick) {
+			t.nextTick++;
+			t.nextDeadline = t.deadlineOf(t.nextTick);
+		}
+		_reschedule(t, Instances::Clock.now());
+		_pushHeap(next.id, t.nextDeadline);
+	}
+}
+
+// Skip any ticks that are already a full period in the past.
+void CX_TimerScheduler::_reschedule(Timer& timer, CX_Millis now) {
+	if (timer.nextDeadline + timer.period > now) {
+		return;
+	}
+
+	uint64_t behind = (now - timer.nextDeadline).nanos() / timer.period.nanos();
+
+	timer.nextTick += behind;
+	timer.nextDeadline = timer.deadlineOf(timer.nextTick);
+	timer.stats.skippedTicks += behind;
+}
+
+void CX_TimerScheduler::_pushHeap(TimerId id, CX_Millis deadline) {
+	HeapEntry entry;
+	entry.id = id;
+	entry.deadline = deadline;
+	_heap.push_back(entry);
+	std::push_heap(_heap.begin(), _heap.end(), std::greater<HeapEntry>());
+}
+
+void CX_TimerScheduler::_resetStatistics(Timer& timer) {
+	timer.stats.ticks = 0;
+	timer.stats.skippedTicks = 0;
+	timer.stats.mean = 0;
+	timer.stats.M2 = 0;
+	timer.stats.min = std::numeric_limits<double>::max();
+	timer.stats.max = std::numeric_limits<double>::lowest();
+}
+
+void CX_TimerScheduler::_applyThreadPriority(void) {
+	Configuration config = getConfiguration();
+
+#if defined(TARGET_LINUX) || defined(TARGET_OSX)
+	if (config.useRealtimePriority) {
+		sched_param param;
+		param.sched_priority = std::max(sched_get_priority_min(SCHED_FIFO), std::min(config.realtimePriority, sched_get_priority_max(SCHED_FIFO)));
+		if (pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) != 0) {
+			Instances::Log.warning("CX_TimerScheduler") << "Could not set real-time priority for the scheduler thread. Elevated privileges may be required.";
+		}
+	}
+#elif defined(TARGET_WIN32)
+	if (config.useRealtimePriority) {
+		if (SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_TIME_CRITICAL) == 0) {
+			Instances::Log.warning("CX_TimerScheduler") << "Could not set time critical priority for the scheduler thread.";
+		}
+	}
+#else
+	if (config.useRealtimePriority) {
+		Instances::Log.warning("CX_TimerScheduler") << "Real-time priority is not supported on this platform.";
+	}
+#endif
+
+	if (config.cpuAffinity >= 0) {
+#if defined(TARGET_LINUX)
+		cpu_set_t cpuSet;
+		CPU_ZERO(&cpuSet);
+		CPU_SET(config.cpuAffinity, &cpuSet);
+		if (pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuSet) != 0) {
+			Instances::Log.warning("CX_TimerScheduler") << "Could not set CPU affinity for the scheduler thread.";
+		}
+#elif defined(TARGET_WIN32)
+		if (SetThreadAffinityMask(GetCurrentThread(), DWORD_PTR(1) << config.cpuAffinity) == 0) {
+			Instances::Log.warning("CX_TimerScheduler") << "Could not set CPU affinity for the scheduler thread.";
+		}
+#else
+		Instances::Log.warning("CX_TimerScheduler") << "CPU affinity is not supported on this platform.";
+#endif
+	}
+}
+
+} // namespace CX
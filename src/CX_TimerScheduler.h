@@ -0,0 +1,193 @@
+#pragma once
+
+#include <map>
+#include <cstdint>
+#include <vector>
+#include <mutex>
+#include <thread>
+#include <functional>
+#include <condition_variable>
+
+#include "CX_Time_t.h"
+
+namespace CX {
+
+	/*! This class runs any number of periodic timers on a single secondary thread. Each timer
+	has an absolute schedule: the deadline for tick `n` is `startTime + n * period`, so time spent
+	in callbacks and operating system wakeup latency do not accumulate into drift.
+
+	To hit deadlines precisely, the thread sleeps until `Configuration::spinWindow` before the
+	next deadline and then spins on `CX::Instances::Clock` for the remainder of the interval.
+	Timers are kept in a heap ordered by their next deadline, so adding more timers does not
+	make the scheduling of any single timer more expensive.
+
+	If a timer falls more than one period behind (e.g. because a callback took a very long time),
+	the missed ticks are skipped rather than delivered in a burst. Skipped ticks are counted in the
+	lateness statistics for the timer (see getLatenessStatistics()).
+
+	\code{.cpp}
+	CX_TimerScheduler sched;
+
+	CX_TimerScheduler::Configuration config;
+	config.useRealtimePriority = true; // may require elevated privileges
+	sched.setup(config);
+
+	CX_TimerScheduler::TimerId id = sched.addTimer(CX_Millis(1), [](const CX_TimerScheduler::TickInfo& tick) {
+		// poll hardware, update stimulus logic, etc.
+	});
+
+	// Later...
+	CX_TimerScheduler::LatenessStatistics stats = sched.getLatenessStatistics(id);
+	Log.notice() << "Mean lateness: " << stats.mean << " ms, max lateness: " << stats.max << " ms";
+	\endcode
+
+	\note Callbacks are called from the scheduler thread, so anything they touch must be thread safe.
+	Callbacks for all timers share one thread, so a slow callback delays the other timers.
+	Callbacks may add and remove timers, but they cannot call setup() or restart the thread after stopThread().
+
+	\ingroup timing
+	*/
+	class CX_TimerScheduler {
+	public:
+
+		typedef uint64_t TimerId;
+		static const TimerId InvalidTimerId = 0; //!< Returned by addTimer() on failure.
+
+		/*! Information about a single timer tick, passed to the timer callback. */
+		struct TickInfo {
+			TimerId id; //!< The timer that ticked.
+			uint64_t tick; //!< The index of this tick. Skipped ticks are counted, so this is the number of periods since the start time.
+			CX_Millis scheduledTime; //!< The deadline for this tick.
+			CX_Millis actualTime; //!< The time at which the callback was called.
+
+			/*! \brief How late the callback was called relative to the deadline. */
+			CX_Millis lateness(void) const {
+				return actualTime - scheduledTime;
+			}
+		};
+
+		/*! Summary of the lateness of timer callbacks relative to their deadlines. */
+		struct LatenessStatistics {
+
+			LatenessStatistics(void) :
+				ticks(0),
+				skippedTicks(0),
+				mean(0),
+				standardDeviation(0),
+				min(0),
+				max(0)
+			{}
+
+			uint64_t ticks; //!< The number of callbacks that were made.
+			uint64_t skippedTicks; //!< The number of ticks that were skipped because the timer fell a full period behind.
+
+			CX_Millis mean; //!< Mean lateness.
+			CX_Millis standardDeviation; //!< Sample standard deviation of the lateness.
+			CX_Millis min; //!< Minimum lateness. May be negative if the spin loop is preempted in an unlucky way.
+			CX_Millis max; //!< Maximum lateness.
+		};
+
+		struct Configuration {
+
+			Configuration(void) :
+				spinWindow(CX_Micros(500)),
+				useRealtimePriority(false),
+				realtimePriority(50),
+				cpuAffinity(-1)
+			{}
+
+			/*! The thread stops sleeping this long before the next deadline and spins until the deadline.
+			Longer windows give more precise timing at the cost of more CPU use. Set to 0 to never spin. */
+			CX_Millis spinWindow;
+
+			/*! If `true`, the scheduler thread requests real-time scheduling. On Linux and OS X, this is `SCHED_FIFO`
+			with priority `realtimePriority`, which usually requires elevated privileges (e.g. `CAP_SYS_NICE`).
+			On Windows, the thread priority is set to `THREAD_PRIORITY_TIME_CRITICAL`. */
+			bool useRealtimePriority;
+			int realtimePriority; //!< `SCHED_FIFO` priority used if `useRealtimePriority` is `true`. Ignored on Windows.
+
+			/*! If non-negative, the scheduler thread is pinned to this CPU core. Linux and Windows only. */
+			int cpuAffinity;
+		};
+
+		CX_TimerScheduler(void);
+		~CX_TimerScheduler(void);
+
+		bool setup(const Configuration& config);
+		Configuration getConfiguration(void);
+
+		TimerId addTimer(CX_Millis period, std::function<void(const TickInfo&)> callback);
+		TimerId addTimerAt(CX_Millis startTime, CX_Millis period, std::function<void(const TickInfo&)> callback);
+		bool removeTimer(TimerId id);
+		void clearTimers(void);
+
+		bool hasTimer(TimerId id);
+		size_t getTimerCount(void);
+
+		bool setTimerPeriod(TimerId id, CX_Millis period);
+		CX_Millis getTimerPeriod(TimerId id);
+
+		LatenessStatistics getLatenessStatistics(TimerId id);
+		void resetLatenessStatistics(TimerId id);
+
+		bool isThreadRunning(void);
+		void stopThread(void);
+
+	private:
+
+		struct Timer {
+			// The deadline for tick n is anchorTime + (n - anchorTick) * period.
+			// The anchor only moves when the period is changed.
+			CX_Millis anchorTime;
+			uint64_t anchorTick;
+			CX_Millis period;
+
+			uint64_t nextTick;
+			CX_Millis nextDeadline;
+
+			CX_Millis deadlineOf(uint64_t tick) const;
+
+			std::function<void(const TickInfo&)> callback;
+
+			// Running lateness statistics (Welford's method), in milliseconds
+			struct {
+				uint64_t ticks;
+				uint64_t skippedTicks;
+				double mean;
+				double M2;
+				double min;
+				double max;
+			} stats;
+		};
+
+		struct HeapEntry {
+			CX_Millis deadline;
+			TimerId id;
+
+			bool operator>(const HeapEntry& rhs) const {
+				return deadline > rhs.deadline;
+			}
+		};
+
+		std::mutex _mutex;
+		std::condition_variable _wakeCondition;
+
+		Configuration _config;
+
+		std::thread _thread;
+		bool _threadRunning;
+
+		TimerId _nextTimerId;
+		std::map<TimerId, Timer> _timers;
+		std::vector<HeapEntry> _heap; // min-heap on deadline. Entries for removed or rescheduled timers are discarded lazily.
+
+		void _startThread(void);
+		void _threadFunction(void);
+		void _applyThreadPriority(void);
+
+		void _pushHeap(TimerId id, CX_Millis deadline);
+		void _reschedule(Timer& timer, CX_Millis now);
+		static void _resetStatistics(Timer& timer);
+	};
+
+}
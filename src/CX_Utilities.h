@@ -7,6 +7,7 @@
 #include <fstream>
 #include <iomanip>
 #include <cmath>
+#include <atomic>
 
 #include "ofUtils.h"
 #include "ofTrueTypeFont.h"
@@ -568,6 +569,24 @@ namespace Util {
 		return rval;
 	}
 
+	/*! Writes the bytes of `value` to `os` in native byte order. This is only meaningful for plain values like integers
+	and floating point numbers. Read the value back with readBinaryValue().
+	\param os The stream to write to. It should be opened in binary mode.
+	\param value The value to write. */
+	template <typename T>
+	void writeBinaryValue(std::ostream& os, const T& value) {
+		os.write(reinterpret_cast<const char*>(&value), sizeof(T));
+	}
+
+	/*! Reads a value that was written with writeBinaryValue().
+	\param is The stream to read from.
+	\param value Receives the value.
+	\return `false` if the full value could not be read, `true` otherwise. */
+	template <typename T>
+	bool readBinaryValue(std::istream& is, T& value) {
+		return (bool)is.read(reinterpret_cast<char*>(&value), sizeof(T));
+	}
+
 	/*! Concatenates together two vectors A and B.
 	\param A The first vector of values.
 	\param B The second vector of values.
@@ -709,5 +728,322 @@ namespace Util {
 		return std::find(values.begin(), values.end(), target) != values.end();
 	}
 
+	/*! Running sufficient statistics for a simple linear regression of `y` on `x`. Samples can be added
+	and removed in constant time, which makes this useful for regressions on a sliding window of data.
+	The updates use Welford's method, which is numerically stable for data with a large offset
+	(e.g. timestamps), but rounding error still accumulates slowly over many add/remove pairs, so users
+	that keep a window for a long time should periodically clear() and re-add the window.
+	*/
+	struct RunningRegression {
+
+		RunningRegression(void) {
+			clear();
+		}
+
+		/*! \brief Remove all samples. */
+		void clear(void) {
+			n = 0;
+			xBar = 0;
+			yBar = 0;
+			Sxx = 0;
+			Sxy = 0;
+			Syy = 0;
+		}
+
+		/*! \brief Add a sample. */
+		void add(double x, double y) {
+			n++;
+			double dx = x - xBar;
+			double dy = y - yBar;
+			xBar += dx / n;
+			yBar += dy / n;
+			Sxx += dx * (x - xBar);
+			Sxy += dx * (y - yBar);
+			Syy += dy * (y - yBar);
+		}
+
+		/*! Remove a sample that was previously added. Removing a sample that was never added
+		gives meaningless results. */
+		void remove(double x, double y) {
+			if (n <= 1) {
+				clear();
+				return;
+			}
+			double dx = x - xBar;
+			double dy = y - yBar;
+			n--;
+			xBar -= dx / n;
+			yBar -= dy / n;
+			Sxx -= dx * (x - xBar);
+			Sxy -= dx * (y - yBar);
+			Syy -= dy * (y - yBar);
+		}
+
+		double slope(void) const {
+			return Sxy / Sxx;
+		}
+
+		double intercept(void) const {
+			return yBar - slope() * xBar;
+		}
+
+		/*! \brief The sum of squared residuals of the fitted line. */
+		double sumOfSquaredErrors(void) const {
+			return std::max(Syy - Sxy * Sxy / Sxx, 0.0);
+		}
+
+		size_t n; //!< The number of samples.
+
+		double xBar; //!< Mean of x.
+		double yBar; //!< Mean of y.
+
+		double Sxx; //!< sum_i (x_i - xBar)^2
+		double Sxy; //!< sum_i (x_i - xBar) * (y_i - yBar)
+		double Syy; //!< sum_i (y_i - yBar)^2
+	};
+
+	/*! A bounded, lock-free queue for passing values from exactly one producer thread to exactly one
+	consumer thread. Neither push() nor pop() ever blocks, so this is suitable for reporting results from
+	time-critical threads (e.g. the display thread) without risking priority inversion on a mutex.
+
+	The capacity is rounded up to a power of 2. If the queue is full, push() fails and returns `false`.
+
+	\note Only one thread may call push() and only one (possibly different) thread may call pop(), front(),
+	and clear(). size() and empty() may be called from any thread, but the result may be stale.
+	*/
+	template <typename T>
+	class SpscQueue {
+	public:
+
+		SpscQueue(size_t capacity = 256) :
+			_head(0),
+			_tail(0)
+		{
+			size_t cap = 1;
+			while (cap < capacity) {
+				cap <<= 1;
+			}
+			_slots.resize(cap);
+			_mask = cap - 1;
+		}
+
+		/*! \brief Push a value. Returns `false` without modifying the queue if it is full. Producer only. */
+		bool push(const T& value) {
+			size_t tail = _tail.load(std::memory_order_relaxed);
+			if (tail - _head.load(std::memory_order_acquire) > _mask) {
+				return false;
+			}
+			_slots[tail & _mask] = value;
+			_tail.store(tail + 1, std::memory_order_release);
+			return true;
+		}
+
+		/*! \brief Pop a value into `value`. Returns `false` if the queue is empty. Consumer only. */
+		bool pop(T& value) {
+			size_t head = _head.load(std::memory_order_relaxed);
+			if (head == _tail.load(std::memory_order_acquire)) {
+				return false;
+			}
+			value = std::move(_slots[head & _mask]);
+			_head.store(head + 1, std::memory_order_release);
+			return true;
+		}
+
+		/*! \brief Get a pointer to the oldest value without removing it, or `nullptr` if the queue is empty. Consumer only. */
+		T* front(void) {
+			size_t head = _head.load(std::memory_order_relaxed);
+			if (head == _tail.load(std::memory_order_acquire)) {
+				return nullptr;
+			}
+			return &_slots[head & _mask];
+		}
+
+		/*! \brief Discard all values. Consumer only. */
+		void clear(void) {
+			_head.store(_tail.load(std::memory_order_acquire), std::memory_order_release);
+		}
+
+		size_t size(void) const {
+			// Load head first: tail only grows, so tail >= head
+			size_t head = _head.load(std::memory_order_acquire);
+			return _tail.load(std::memory_order_acquire) - head;
+		}
+
+		bool empty(void) const {
+			return size() == 0;
+		}
+
+		size_t capacity(void) const {
+			return _mask + 1;
+		}
+
+	private:
+
+		std::vector<T> _slots;
+		size_t _mask;
+
+		std::atomic<size_t> _head; // next slot to read; written by the consumer
+		std::atomic<size_t> _tail; // next slot to write; written by the producer
+	};
+
+	/*! What a RingBuffer does when a value is pushed while it is full. */
+	enum class OverflowPolicy {
+		Grow, //!< The capacity is doubled. No values are lost, but memory is allocated.
+		DropOldest, //!< The oldest value is discarded to make room for the new value.
+		DropNewest //!< The new value is discarded.
+	};
+
+	/*! A fixed-capacity FIFO queue stored in a single contiguous allocation. Once the capacity is reached, pushing
+	a value does not allocate (unless the overflow policy is OverflowPolicy::Grow), so a full queue behaves predictably.
+	Values are indexed from the oldest (index 0) to the newest.
+
+	Unlike SpscQueue, this class is not thread safe. The input devices use it to store events on the main thread
+	after they have been received from other threads through an SpscQueue.
+
+	The capacity is rounded up to a power of 2.
+	*/
+	template <typename T>
+	class RingBuffer {
+	public:
+
+		RingBuffer(size_t capacity = 256, OverflowPolicy policy = OverflowPolicy::Grow) :
+			_head(0),
+			_size(0),
+			_policy(policy)
+		{
+			_slots.resize(_roundCapacity(capacity));
+			_mask = _slots.size() - 1;
+		}
+
+		/*! \brief Push a value onto the end of the queue. Returns `false` if a value (either the oldest value or
+		`value`, depending on the overflow policy) was discarded because the queue was full. */
+		bool push_back(const T& value) {
+			bool dropped = false;
+			if (_size == _slots.size()) {
+				switch (_policy) {
+				case OverflowPolicy::Grow:
+					_reallocate(_slots.size() * 2);
+					break;
+				case OverflowPolicy::DropOldest:
+					pop_front();
+					dropped = true;
+					break;
+				case OverflowPolicy::DropNewest:
+					return false;
+				}
+			}
+			_slots[(_head + _size) & _mask] = value;
+			_size++;
+			return !dropped;
+		}
+
+		/*! \brief Remove the oldest value. The queue must not be empty. */
+		void pop_front(void) {
+			_head = (_head + 1) & _mask;
+			_size--;
+		}
+
+		/*! \brief Remove the value at `index`. Later values are moved forward by one. */
+		void erase(size_t index) {
+			for (size_t i = index; i + 1 < _size; i++) {
+				(*this)[i] = std::move((*this)[i + 1]);
+			}
+			_size--;
+		}
+
+		T& front(void) {
+			return _slots[_head];
+		}
+
+		T& back(void) {
+			return _slots[(_head + _size - 1) & _mask];
+		}
+
+		/*! \brief Access the value at `index`, where 0 is the oldest value. */
+		T& operator[](size_t index) {
+			return _slots[(_head + index) & _mask];
+		}
+
+		const T& operator[](size_t index) const {
+			return _slots[(_head + index) & _mask];
+		}
+
+		/*! \brief Call `f` with each value, from oldest to newest, without copying them. */
+		template <typename F>
+		void forEach(F f) const {
+			for (size_t i = 0; i < _size; i++) {
+				f((*this)[i]);
+			}
+		}
+
+		/*! \brief Copy the values into a vector, oldest first. */
+		std::vector<T> toVector(void) const {
+			std::vector<T> rval;
+			rval.reserve(_size);
+			forEach([&rval](const T& v) { rval.push_back(v); });
+			return rval;
+		}
+
+		/*! \brief Remove all values. Memory is not released. */
+		void clear(void) {
+			_head = 0;
+			_size = 0;
+		}
+
+		/*! \brief Change the capacity. If the new capacity is smaller than size(), the oldest values are discarded. */
+		void setCapacity(size_t capacity) {
+			_reallocate(_roundCapacity(capacity));
+		}
+
+		void setOverflowPolicy(OverflowPolicy policy) {
+			_policy = policy;
+		}
+
+		OverflowPolicy getOverflowPolicy(void) const {
+			return _policy;
+		}
+
+		size_t size(void) const {
+			return _size;
+		}
+
+		bool empty(void) const {
+			return _size == 0;
+		}
+
+		size_t capacity(void) const {
+			return _slots.size();
+		}
+
+	private:
+
+		std::vector<T> _slots;
+		size_t _mask;
+		size_t _head; // index of the oldest value in _slots
+		size_t _size;
+		OverflowPolicy _policy;
+
+		static size_t _roundCapacity(size_t capacity) {
+			size_t cap = 1;
+			while (cap < capacity) {
+				cap <<= 1;
+			}
+			return cap;
+		}
+
+		// Linearizes the values into a new allocation of size `capacity`, keeping the newest values.
+		void _reallocate(size_t capacity) {
+			size_t keep = std::min(_size, capacity);
+			std::vector<T> slots(capacity);
+			for (size_t i = 0; i < keep; i++) {
+				slots[i] = std::move((*this)[_size - keep + i]);
+			}
+			_slots.swap(slots);
+			_mask = capacity - 1;
+			_head = 0;
+			_size = keep;
+		}
+	};
+
 } // namespace Util
 } // namespace CX
\ No newline at end of file